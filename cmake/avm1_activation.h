@@ -11,6 +11,9 @@
 #include "avm1/object.h"
 #include "avm1/scope.h"
 #include "avm1/error.h"
+#include "avm1/value_stack.h"
+#include "avm1/bytecode.h"
+#include "execution_limit.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,18 +32,51 @@ enum class ReturnType {
 enum class FrameControl {
     CONTINUE,
     RETURN,
-    JUMP
+    JUMP,
+    // A bytecode call was staged with `Activation::stage_call`; the
+    // interpreter runs it before continuing.
+    CALL,
+    // A With statement replaced the scope for its body; the interpreter
+    // restores `Activation::take_outer_scope` once the body is left.
+    WITH
 };
 
 // Forward declarations
 class Avm1Function;
+class Avm1Profiler;
 class DisplayObject;
 class MovieClip;
+class ProtoLookupCache;
 class SwfSlice;
 class UpdateContext;
 
+// A call to a bytecode function that has been set up but not run: the
+// callee's activation, with registers and locals bound, and its body.
+struct PreparedCall {
+    std::shared_ptr<Activation> activation;
+    std::shared_ptr<const DecodedActions> body;
+    // Profiler function id, set while a profile is being recorded, and the
+    // profiler it belongs to. The call enters and leaves that profiler even
+    // if profiling stops or restarts in between.
+    std::optional<uint32_t> profile_id;
+    std::weak_ptr<Avm1Profiler> profiler;
+    // For `new`, the constructed object, which is what the call evaluates
+    // to unless the constructor returns an object of its own.
+    std::shared_ptr<Object> constructed;
+    // Arguments the caller left on its stack, dropped when the call ends.
+    size_t caller_args = 0;
+};
+
+// A call a native function asked to have made in its place, with its result
+// as the native's (see `Activation::tail_call`).
+struct NativeTailCall {
+    std::shared_ptr<Object> function;
+    std::shared_ptr<Object> this_obj;
+    std::vector<std::shared_ptr<Value>> args;
+};
+
 // Activation class for AVM1 execution context
-class Activation {
+class Activation : public std::enable_shared_from_this<Activation> {
 private:
     // Context and state information
     std::shared_ptr<UpdateContext> context_;
@@ -49,8 +85,15 @@ private:
     std::shared_ptr<MovieClip> target_clip_;
     std::shared_ptr<Object> this_object_;
     std::shared_ptr<Object> callee_object_;
-    std::vector<std::shared_ptr<Value>> stack_;
-    std::vector<std::shared_ptr<Value>> registers_;
+    // The `arguments` and `super` objects of a function call. Registers and
+    // locals only borrow them, so the activation keeps them alive.
+    std::shared_ptr<Object> arguments_object_;
+    std::shared_ptr<Object> super_object_;
+    // Operand stack and registers live in the runtime's shared value stack;
+    // this activation owns the window described by `frame_`.
+    std::shared_ptr<ValueStack> value_stack_;
+    StackFrame frame_;
+    bool frame_entered_;
     std::shared_ptr<SwfSlice> action_data_;
     std::shared_ptr<Avm1Function> function_;
     ActivationIdentifier id_;
@@ -59,6 +102,17 @@ private:
     bool is_executing_;
     bool show_debug_output_;
     int recursion_depth_;
+    // The call this activation is suspended on, while the interpreter runs
+    // it on its frame stack.
+    std::optional<PreparedCall> call_;
+    // Set by a native through `tail_call`, taken by whoever called it.
+    std::optional<NativeTailCall> tail_call_;
+    // The active constant pool, set by ActionConstantPool or inherited from
+    // the function's definition. Shared with the block that defined it.
+    std::shared_ptr<const std::vector<Avm1Atom>> constant_pool_;
+    // Set by `run_action` when a With statement replaces the scope, for the
+    // interpreter to pick up with `take_outer_scope`.
+    std::shared_ptr<Scope> outer_scope_;
 
 public:
     // Constructor
@@ -67,13 +121,18 @@ public:
                std::shared_ptr<MovieClip> base_clip,
                std::shared_ptr<Object> this_object,
                std::shared_ptr<Avm1Function> function,
-               ActivationIdentifier id)
+               ActivationIdentifier id,
+               std::shared_ptr<ValueStack> value_stack,
+               uint8_t register_count = 0)
         : context_(std::move(context))
         , scope_(std::move(scope))
         , base_clip_(std::move(base_clip))
         , target_clip_(base_clip_)
         , this_object_(std::move(this_object))
         , callee_object_(this_object_)
+        , value_stack_(std::move(value_stack))
+        , frame_(value_stack_->enter_frame(register_count))
+        , frame_entered_(true)
         , function_(std::move(function))
         , id_(id)
         , is_executing_(false)
@@ -81,6 +140,75 @@ public:
         , recursion_depth_(0) {
     }
 
+    // Leaving an activation releases its registers and any operands it left
+    // on the stack.
+    ~Activation() {
+        leave_frame();
+    }
+
+    // Release this activation's stack frame early, e.g. before returning it
+    // to an `ActivationPool`.
+    void leave_frame() {
+        if (frame_entered_) {
+            value_stack_->leave_frame(frame_);
+            frame_entered_ = false;
+        }
+    }
+
+    // Drop references held by an activation parked in a pool, so that it
+    // does not keep its last call's objects alive.
+    void clear() {
+        call_.reset();
+        tail_call_.reset();
+        outer_scope_ = nullptr;
+        constant_pool_ = nullptr;
+        context_ = nullptr;
+        scope_ = nullptr;
+        base_clip_ = nullptr;
+        target_clip_ = nullptr;
+        this_object_ = nullptr;
+        callee_object_ = nullptr;
+        arguments_object_ = nullptr;
+        super_object_ = nullptr;
+        action_data_ = nullptr;
+        function_ = nullptr;
+    }
+
+    // Re-initialize a pooled activation for a new call. The activation must
+    // have left its previous frame.
+    void reset(std::shared_ptr<UpdateContext> context,
+               std::shared_ptr<Scope> scope,
+               std::shared_ptr<MovieClip> base_clip,
+               std::shared_ptr<Object> this_object,
+               std::shared_ptr<Avm1Function> function,
+               ActivationIdentifier id,
+               std::shared_ptr<ValueStack> value_stack,
+               uint8_t register_count = 0) {
+        context_ = std::move(context);
+        scope_ = std::move(scope);
+        base_clip_ = std::move(base_clip);
+        target_clip_ = base_clip_;
+        this_object_ = std::move(this_object);
+        callee_object_ = this_object_;
+        arguments_object_ = nullptr;
+        super_object_ = nullptr;
+        value_stack_ = std::move(value_stack);
+        frame_ = value_stack_->enter_frame(register_count);
+        frame_entered_ = true;
+        action_data_ = nullptr;
+        function_ = std::move(function);
+        id_ = id;
+        is_executing_ = false;
+        show_debug_output_ = false;
+        recursion_depth_ = 0;
+        tail_call_.reset();
+        constant_pool_ = nullptr;
+        outer_scope_ = nullptr;
+    }
+
+    Activation(const Activation&) = delete;
+    Activation& operator=(const Activation&) = delete;
+
     // Getters
     std::shared_ptr<UpdateContext> context() const { return context_; }
     std::shared_ptr<Scope> scope() const { return scope_; }
@@ -90,50 +218,151 @@ public:
     std::shared_ptr<Object> callee() const { return callee_object_; }
     std::shared_ptr<Avm1Function> function() const { return function_; }
     const ActivationIdentifier& id() const { return id_; }
+    uint8_t swf_version() const;
+    // Property names are case sensitive from SWFv7 on.
+    bool is_case_sensitive() const { return swf_version() >= 7; }
     
     // Setters
     void set_scope(std::shared_ptr<Scope> scope) { scope_ = std::move(scope); }
     void set_target_clip(std::shared_ptr<MovieClip> clip) { target_clip_ = std::move(clip); }
     void set_this(std::shared_ptr<Object> obj) { this_object_ = std::move(obj); }
     void set_callee(std::shared_ptr<Object> obj) { callee_object_ = std::move(obj); }
+    void set_call_objects(std::shared_ptr<Object> arguments, std::shared_ptr<Object> super_obj) {
+        arguments_object_ = std::move(arguments);
+        super_object_ = std::move(super_obj);
+    }
+    std::shared_ptr<Object> super_object() const { return super_object_; }
     
     // Stack operations
-    void push(std::shared_ptr<Value> value) { stack_.push_back(std::move(value)); }
-    std::shared_ptr<Value> pop() {
-        if (stack_.empty()) {
-            return std::make_shared<Value>(Value::UNDEFINED);
-        }
-        auto value = stack_.back();
-        stack_.pop_back();
-        return value;
+    void push(CompactValue value) { value_stack_->push(value); }
+    CompactValue pop() { return value_stack_->pop(frame_); }
+    CompactValue peek() const { return value_stack_->peek(frame_); }
+    size_t stack_len() const { return value_stack_->operand_count(frame_); }
+
+    // Register operations
+    //
+    // Registers are sized once when the frame is entered, from the
+    // DefineFunction2 register count; a count of zero selects the four
+    // global registers.
+    void set_register(uint8_t index, CompactValue value) {
+        value_stack_->set_register(frame_, index, value);
     }
-    std::shared_ptr<Value> peek() const {
-        if (stack_.empty()) {
-            return std::make_shared<Value>(Value::UNDEFINED);
-        }
-        return stack_.back();
+
+    CompactValue get_register(uint8_t index) const {
+        return value_stack_->get_register(frame_, index);
     }
-    
-    // Register operations
-    void set_register(int index, std::shared_ptr<Value> value) {
-        if (index >= static_cast<int>(registers_.size())) {
-            registers_.resize(index + 1);
-        }
-        registers_[index] = std::move(value);
+
+    bool has_local_registers() const { return frame_.register_count != 0; }
+
+    // Constant pool. Entries are atoms bound once per action block, so
+    // pushing one never hashes or copies the string, and setting the pool
+    // never copies it.
+    const std::shared_ptr<const std::vector<Avm1Atom>>& constant_pool() const {
+        return constant_pool_;
     }
-    
-    std::shared_ptr<Value> get_register(int index) const {
-        if (index < 0 || index >= static_cast<int>(registers_.size())) {
-            return std::make_shared<Value>(Value::UNDEFINED);
+    void set_constant_pool(std::shared_ptr<const std::vector<Avm1Atom>> pool) {
+        constant_pool_ = std::move(pool);
+    }
+    std::optional<Avm1Atom> constant_pool_entry(uint16_t index) const {
+        if (constant_pool_ && index < constant_pool_->size()) {
+            return (*constant_pool_)[index];
         }
-        return registers_[index];
+        return std::nullopt;
     }
+
+    // The update's execution limit, charged by the interpreter.
+    ExecutionLimit& execution_limit();
+    // The runtime's atom table.
+    Avm1AtomTable& atoms();
+    // The runtime's prototype lookup cache.
+    ProtoLookupCache& proto_lookup_cache();
+
+    // `value` as a stack value. Strings and objects are owned by the value
+    // stack, since `value` may be their only owner.
+    CompactValue compact(const Value& value);
+    void push_value(const Value& value) { push(compact(value)); }
+    // A computed string, owned by the value stack (see `ValueStack::own_string`).
+    Avm1Atom own_string(std::string text) { return value_stack_->own_string(std::move(text)); }
+
+    // `_root` and `_parent` of the base clip, for DefineFunction2 preloads.
+    CompactValue root_object() const;
+    CompactValue parent_object() const;
+
+    // Property access for the interpreter. `cache` is the access site's
+    // inline cache from `DecodedActions::property_caches`.
+    CompactValue get_member(CompactValue object, CompactValue name, PropertyCache& cache);
+    void set_member(CompactValue object, CompactValue name, CompactValue value,
+                    PropertyCache& cache);
+    // Push `undefined`, then the for..in keys of `object` (none unless it
+    // is an object).
+    void push_enumeration(CompactValue object);
+    // Variable access by name or by target path (`/clip:var`, `clip.var`).
+    CompactValue get_variable(CompactValue path);
+    void set_variable(CompactValue path, CompactValue value);
+    std::shared_ptr<ValueStack> value_stack() const { return value_stack_; }
+    const StackFrame& frame() const { return frame_; }
+
+    // Visit the references this activation holds, as GC roots.
+    void gc_trace(GcTracer& tracer) const;
     
     // Execution methods
     std::shared_ptr<Value> run_stack_frame_for_action(const std::string& action_name);
+    // Runs `data` through the runtime's bytecode cache, so a slice is only
+    // decoded the first time it runs.
     std::shared_ptr<Value> run_with_data(std::shared_ptr<SwfSlice> data);
+    // Run an already decoded action block. Opcodes are counted into
+    // `Avm1::opcode_counter()` while a profile is being recorded.
+    std::shared_ptr<Value> run_actions(std::shared_ptr<const DecodedActions> actions);
+
+    // The full semantics of one instruction, for the interpreter's slow
+    // path. `next_pc` is the instruction to continue at and may be changed
+    // to branch.
+    FrameControl run_action(const Instruction& insn, const DecodedActions& actions,
+                            uint32_t& next_pc);
+    // The scope a With statement replaced, after `run_action` returned
+    // `FrameControl::WITH`.
+    std::shared_ptr<Scope> take_outer_scope() { return std::move(outer_scope_); }
+    // Bind an exception thrown in `block`'s try block for its catch block,
+    // dropping the operands pushed since the Try (`stack_base` of them were
+    // there before). Returns false, binding nothing, unless the block has a
+    // catch and `error` is a thrown script value; timeouts and the like are
+    // never caught.
+    bool catch_exception(const TryBlock& block, const Avm1Exception& error, size_t stack_base);
+
+    // Calls run on the interpreter's frame stack (see `Interpreter`).
+    //
+    // `run_action` implements CallFunction, CallMethod and NewObject on a
+    // bytecode function by returning `stage_call` with the function's
+    // `prepare_call`. The interpreter then takes the callee with
+    // `begin_call`, which counts it against the runtime's recursion limit,
+    // and finishes it with `end_call` or `abort_call`.
+    FrameControl stage_call(PreparedCall call) {
+        call_ = std::move(call);
+        return FrameControl::CALL;
+    }
+    Activation* begin_call(const DecodedActions*& body);
+    // Release the callee and push what the call evaluates to.
+    void end_call(Activation* callee, std::optional<CompactValue> result);
+    void abort_call(Activation* callee) noexcept;
+
+    // Have `function` called once the running native returns, its result
+    // standing in for the native's. A native whose result is a call's
+    // result (`Function.prototype.call` and `apply`) uses this instead of
+    // calling it, so that bytecode it reaches is staged on the interpreter
+    // rather than run nested on the native stack.
+    void tail_call(std::shared_ptr<Object> function,
+                   std::shared_ptr<Object> this_obj,
+                   std::vector<std::shared_ptr<Value>> args) {
+        tail_call_ = NativeTailCall{std::move(function), std::move(this_obj), std::move(args)};
+    }
+    std::optional<NativeTailCall> take_tail_call() {
+        std::optional<NativeTailCall> call = std::move(tail_call_);
+        tail_call_.reset();
+        return call;
+    }
     
-    // Target resolution
+    // Target resolution. Paths that only go through the display list are
+    // answered from `Avm1::target_path_cache()`.
     std::optional<std::shared_ptr<Object>> resolve_target_path(
         std::shared_ptr<DisplayObject> root,
         std::shared_ptr<DisplayObject> start,
@@ -167,6 +396,28 @@ public:
         std::shared_ptr<Object> this_obj,
         const std::vector<std::shared_ptr<Value>>& args,
         ExecutionReason reason);
+
+private:
+    // Operands popped by `run_action` are converted to `Value`s straight
+    // away, since anything that creates a stack value may sweep what the
+    // popped operands borrowed.
+    Value pop_value() { return pop().to_value(); }
+    Value to_primitive(const Value& value);
+    double to_number(const Value& value);
+    std::string to_string(const Value& value);
+    std::shared_ptr<Object> to_object(const Value& value);
+    // The interned atom of a property name, for inline caches. Names that
+    // are not interned strings are looked up uncached.
+    std::optional<Avm1Atom> property_atom(CompactValue name);
+    // The object and variable named by a path such as `/clip:var`, or
+    // nothing for a plain variable name.
+    std::optional<std::pair<std::shared_ptr<Object>, std::string>> resolve_variable_path(
+        const std::string& path);
+    FrameControl call_value(const Value& function, std::shared_ptr<Object> this_obj,
+                            const std::string& name, size_t num_args,
+                            std::shared_ptr<Object> constructed);
+    std::shared_ptr<Object> define_function(const FunctionDecl& decl);
+    FrameControl run_with();
 };
 
 // Macro for AVM1 debugging (equivalent to avm_debug!)
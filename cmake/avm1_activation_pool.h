@@ -0,0 +1,93 @@
+/*
+ * C++ header for the AVM1 activation pool
+ * Reuses activation records across function calls
+ */
+
+#ifndef AVM1_ACTIVATION_POOL_H
+#define AVM1_ACTIVATION_POOL_H
+
+#include "avm1/activation.h"
+#include <memory>
+#include <vector>
+
+namespace ruffle {
+
+// Free list of activations.
+//
+// Function calls acquire an activation from the pool and release it when
+// they return, so a call allocates nothing for the activation itself.
+// An activation that is still referenced elsewhere when released (say, by
+// a closure or an error handler) is not reused; it stays owned by those
+// references instead.
+class ActivationPool {
+public:
+    static constexpr size_t MAX_POOLED = 64;
+
+private:
+    std::vector<std::shared_ptr<Activation>> free_;
+
+public:
+    ActivationPool() = default;
+    ActivationPool(const ActivationPool&) = delete;
+    ActivationPool& operator=(const ActivationPool&) = delete;
+
+    std::shared_ptr<Activation> acquire(std::shared_ptr<UpdateContext> context,
+                                        std::shared_ptr<Scope> scope,
+                                        std::shared_ptr<MovieClip> base_clip,
+                                        std::shared_ptr<Object> this_object,
+                                        std::shared_ptr<Avm1Function> function,
+                                        ActivationIdentifier id,
+                                        std::shared_ptr<ValueStack> value_stack,
+                                        uint8_t register_count = 0) {
+        if (free_.empty()) {
+            return std::make_shared<Activation>(
+                std::move(context), std::move(scope), std::move(base_clip),
+                std::move(this_object), std::move(function), id,
+                std::move(value_stack), register_count);
+        }
+        auto activation = std::move(free_.back());
+        free_.pop_back();
+        activation->reset(std::move(context), std::move(scope), std::move(base_clip),
+                          std::move(this_object), std::move(function), id,
+                          std::move(value_stack), register_count);
+        return activation;
+    }
+
+    // Return `activation` to the pool. Its stack frame is released either
+    // way, since frames must be left in order.
+    void release(std::shared_ptr<Activation> activation) {
+        activation->leave_frame();
+        if (activation.use_count() == 1 && free_.size() < MAX_POOLED) {
+            activation->clear();
+            free_.push_back(std::move(activation));
+        }
+    }
+
+    size_t len() const { return free_.size(); }
+};
+
+// Releases a pooled activation when the call that acquired it ends,
+// including by exception.
+class PooledActivation {
+private:
+    ActivationPool& pool_;
+    std::shared_ptr<Activation> activation_;
+
+public:
+    PooledActivation(ActivationPool& pool, std::shared_ptr<Activation> activation)
+        : pool_(pool), activation_(std::move(activation)) {}
+
+    ~PooledActivation() {
+        pool_.release(std::move(activation_));
+    }
+
+    PooledActivation(const PooledActivation&) = delete;
+    PooledActivation& operator=(const PooledActivation&) = delete;
+
+    Activation* operator->() const { return activation_.get(); }
+    const std::shared_ptr<Activation>& get() const { return activation_; }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_ACTIVATION_POOL_H
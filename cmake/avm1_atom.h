@@ -0,0 +1,165 @@
+/*
+ * C++ header for AVM1 atom functionality
+ * Interned AVM1 strings with pointer equality and precomputed hashes
+ */
+
+#ifndef AVM1_ATOM_H
+#define AVM1_ATOM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ruffle {
+
+// Lowercase a single ASCII byte. Flash's case-insensitive name matching
+// (SWFv6 and below) only folds ASCII, so this intentionally ignores locales.
+constexpr char ascii_fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// FNV-1a hash of a name, exact or case-folded. Usable in constant
+// expressions, for tables of well-known names.
+constexpr size_t avm1_name_hash(std::string_view s) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : s) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 0x100000001b3ull;
+    }
+    return static_cast<size_t>(h);
+}
+
+constexpr size_t avm1_folded_name_hash(std::string_view s) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : s) {
+        h ^= static_cast<uint8_t>(ascii_fold(c));
+        h *= 0x100000001b3ull;
+    }
+    return static_cast<size_t>(h);
+}
+
+// Compare two names ignoring ASCII case.
+inline bool avm1_eq_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (ascii_fold(a[i]) != ascii_fold(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Storage for a single interned string. Entries are owned by an
+// `Avm1AtomTable` and never move, so their address is their identity.
+//
+// Strings computed at run time (concatenations and the like) use the same
+// entry type without being interned; see `ValueStack::own_string`. Such an
+// entry is only equal to itself by address, never to another entry with the
+// same text.
+struct Avm1AtomEntry {
+    std::string text;
+    size_t hash;
+    size_t folded_hash;
+    bool interned;
+
+    explicit Avm1AtomEntry(std::string s, bool is_interned = true)
+        : text(std::move(s)), hash(avm1_name_hash(text)),
+          folded_hash(avm1_folded_name_hash(text)), interned(is_interned) {}
+};
+
+// A handle to an interned AVM1 string.
+//
+// Atoms are trivially copyable and compare by pointer. Both the exact and the
+// ASCII-folded hash are computed once at intern time, so hashed containers
+// never need to rehash the text in either case-sensitivity mode.
+class Avm1Atom {
+private:
+    const Avm1AtomEntry* entry_;
+
+public:
+    constexpr Avm1Atom() : entry_(nullptr) {}
+    explicit constexpr Avm1Atom(const Avm1AtomEntry* entry) : entry_(entry) {}
+
+    bool is_null() const { return entry_ == nullptr; }
+    const Avm1AtomEntry* entry() const { return entry_; }
+    // False for a string owned by the value stack rather than a table.
+    bool is_interned() const { return entry_->interned; }
+
+    const std::string& as_str() const { return entry_->text; }
+    std::string_view view() const { return entry_->text; }
+    size_t len() const { return entry_->text.size(); }
+    size_t hash() const { return entry_->hash; }
+    size_t folded_hash() const { return entry_->folded_hash; }
+
+    bool operator==(const Avm1Atom& other) const { return entry_ == other.entry_; }
+    bool operator!=(const Avm1Atom& other) const { return entry_ != other.entry_; }
+
+    // Case-insensitive equality, as used by SWFv6 and below.
+    bool eq_ignore_case(const Avm1Atom& other) const {
+        if (entry_ == other.entry_) {
+            return true;
+        }
+        if (entry_->folded_hash != other.entry_->folded_hash) {
+            return false;
+        }
+        return avm1_eq_ignore_case(entry_->text, other.entry_->text);
+    }
+};
+
+// The intern table for AVM1 atoms.
+//
+// Interned entries live as long as the table, which is owned by the AVM1
+// runtime alongside the global environment.
+class Avm1AtomTable {
+private:
+    // Keys are views into the owned entry text.
+    std::unordered_map<std::string_view, std::unique_ptr<Avm1AtomEntry>> entries_;
+
+public:
+    Avm1AtomTable() = default;
+    Avm1AtomTable(const Avm1AtomTable&) = delete;
+    Avm1AtomTable& operator=(const Avm1AtomTable&) = delete;
+
+    // Intern a string, returning the existing atom if one exists.
+    Avm1Atom intern(std::string_view s) {
+        auto it = entries_.find(s);
+        if (it != entries_.end()) {
+            return Avm1Atom(it->second.get());
+        }
+
+        auto entry = std::make_unique<Avm1AtomEntry>(std::string(s));
+        const Avm1AtomEntry* ptr = entry.get();
+        entries_.emplace(std::string_view(ptr->text), std::move(entry));
+        return Avm1Atom(ptr);
+    }
+
+    // Look up a string without interning it.
+    std::optional<Avm1Atom> get(std::string_view s) const {
+        auto it = entries_.find(s);
+        if (it != entries_.end()) {
+            return Avm1Atom(it->second.get());
+        }
+        return std::nullopt;
+    }
+
+    size_t len() const { return entries_.size(); }
+};
+
+} // namespace ruffle
+
+namespace std {
+    template<>
+    struct hash<ruffle::Avm1Atom> {
+        size_t operator()(const ruffle::Avm1Atom& atom) const {
+            return atom.hash();
+        }
+    };
+}
+
+#endif // AVM1_ATOM_H
@@ -0,0 +1,829 @@
+/*
+ * C++ header for pre-decoded AVM1 bytecode
+ * Decodes an action block once into a compact instruction array
+ */
+
+#ifndef AVM1_BYTECODE_H
+#define AVM1_BYTECODE_H
+
+#include "avm1/atom.h"
+#include "avm1/shape.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ruffle {
+
+// AVM1 action codes, as they appear in the SWF action stream.
+enum class OpCode : uint8_t {
+    End = 0x00,
+    NextFrame = 0x04,
+    PreviousFrame = 0x05,
+    Play = 0x06,
+    Stop = 0x07,
+    ToggleQuality = 0x08,
+    StopSounds = 0x09,
+    Add = 0x0A,
+    Subtract = 0x0B,
+    Multiply = 0x0C,
+    Divide = 0x0D,
+    Equals = 0x0E,
+    Less = 0x0F,
+    And = 0x10,
+    Or = 0x11,
+    Not = 0x12,
+    StringEquals = 0x13,
+    StringLength = 0x14,
+    StringExtract = 0x15,
+    Pop = 0x17,
+    ToInteger = 0x18,
+    GetVariable = 0x1C,
+    SetVariable = 0x1D,
+    SetTarget2 = 0x20,
+    StringAdd = 0x21,
+    GetProperty = 0x22,
+    SetProperty = 0x23,
+    CloneSprite = 0x24,
+    RemoveSprite = 0x25,
+    Trace = 0x26,
+    StartDrag = 0x27,
+    EndDrag = 0x28,
+    StringLess = 0x29,
+    Throw = 0x2A,
+    CastOp = 0x2B,
+    ImplementsOp = 0x2C,
+    FsCommand2 = 0x2D,
+    RandomNumber = 0x30,
+    MBStringLength = 0x31,
+    CharToAscii = 0x32,
+    AsciiToChar = 0x33,
+    GetTime = 0x34,
+    MBStringExtract = 0x35,
+    MBCharToAscii = 0x36,
+    MBAsciiToChar = 0x37,
+    Delete = 0x3A,
+    Delete2 = 0x3B,
+    DefineLocal = 0x3C,
+    CallFunction = 0x3D,
+    Return = 0x3E,
+    Modulo = 0x3F,
+    NewObject = 0x40,
+    DefineLocal2 = 0x41,
+    InitArray = 0x42,
+    InitObject = 0x43,
+    TypeOf = 0x44,
+    TargetPath = 0x45,
+    Enumerate = 0x46,
+    Add2 = 0x47,
+    Less2 = 0x48,
+    Equals2 = 0x49,
+    ToNumber = 0x4A,
+    ToString = 0x4B,
+    PushDuplicate = 0x4C,
+    StackSwap = 0x4D,
+    GetMember = 0x4E,
+    SetMember = 0x4F,
+    Increment = 0x50,
+    Decrement = 0x51,
+    CallMethod = 0x52,
+    NewMethod = 0x53,
+    InstanceOf = 0x54,
+    Enumerate2 = 0x55,
+    BitAnd = 0x60,
+    BitOr = 0x61,
+    BitXor = 0x62,
+    BitLShift = 0x63,
+    BitRShift = 0x64,
+    BitURShift = 0x65,
+    StrictEquals = 0x66,
+    Greater = 0x67,
+    StringGreater = 0x68,
+    Extends = 0x69,
+    GotoFrame = 0x81,
+    GetUrl = 0x83,
+    StoreRegister = 0x87,
+    ConstantPool = 0x88,
+    WaitForFrame = 0x8A,
+    SetTarget = 0x8B,
+    GotoLabel = 0x8C,
+    WaitForFrame2 = 0x8D,
+    DefineFunction2 = 0x8E,
+    Try = 0x8F,
+    With = 0x94,
+    Push = 0x96,
+    Jump = 0x99,
+    GetUrl2 = 0x9A,
+    DefineFunction = 0x9B,
+    If = 0x9D,
+    Call = 0x9E,
+    GotoFrame2 = 0x9F,
+
+    // Codes above this point never come from a SWF; the decoder maps any
+    // such action code to `Unknown`.
+    //
+    // Superinstructions, produced by `fuse_superinstructions`. `arg8` holds
+    // the number of instructions the fused sequence covers.
+    PushGetVariable = 0xF0,
+    PushGetMember = 0xF1,
+    PushPushAdd2 = 0xF2,
+    // An action code the player does not understand; ignored at run time.
+    Unknown = 0xFF,
+};
+
+constexpr uint8_t FIRST_SYNTHETIC_OPCODE = 0xF0;
+
+// Kinds of value a Push action can carry.
+enum class PushKind : uint8_t {
+    STRING = 0,
+    FLOAT = 1,
+    NULL_VAL = 2,
+    UNDEFINED = 3,
+    REGISTER = 4,
+    BOOLEAN = 5,
+    DOUBLE = 6,
+    INT = 7,
+    CONSTANT8 = 8,
+    CONSTANT16 = 9,
+};
+
+// A single Push operand.
+//
+// FLOAT, DOUBLE and INT are all widened to `number`. STRING refers to the
+// block's string table. CONSTANT8/CONSTANT16 are unified as CONSTANT16 and
+// refer to the active constant pool at run time, unless the decoder could
+// bind them statically, in which case they become STRING.
+struct PushItem {
+    PushKind kind;
+    union {
+        double number;
+        uint32_t index;
+        bool boolean;
+    };
+
+    static PushItem make(PushKind kind) {
+        PushItem item;
+        item.kind = kind;
+        item.number = 0.0;
+        return item;
+    }
+};
+
+// Flags for DefineFunction2, as laid out in the SWF.
+enum DefineFunction2Flags : uint16_t {
+    PRELOAD_THIS = 0x0001,
+    SUPPRESS_THIS = 0x0002,
+    PRELOAD_ARGUMENTS = 0x0004,
+    SUPPRESS_ARGUMENTS = 0x0008,
+    PRELOAD_SUPER = 0x0010,
+    SUPPRESS_SUPER = 0x0020,
+    PRELOAD_ROOT = 0x0040,
+    PRELOAD_PARENT = 0x0080,
+    PRELOAD_GLOBAL = 0x0100,
+};
+
+// A function declared by DefineFunction or DefineFunction2.
+//
+// The body is not decoded inline; it is described by its byte range within
+// the owning slice so it can be decoded (and cached) when first called.
+struct FunctionDecl {
+    std::string name;
+    std::vector<std::string> params;
+    // Register assigned to each parameter (0 = none). DefineFunction2 only.
+    std::vector<uint8_t> param_registers;
+    uint8_t register_count;
+    uint16_t flags;
+    bool is_function2;
+    // Body range, relative to the start of the decoded block.
+    size_t body_offset;
+    size_t body_len;
+};
+
+// A try/catch/finally region, resolved to instruction indices.
+struct TryBlock {
+    uint32_t try_end;
+    std::optional<uint32_t> catch_start;
+    uint32_t catch_end;
+    std::optional<uint32_t> finally_start;
+    uint32_t finally_end;
+    // Catch target: either a variable name or a register.
+    std::optional<std::string> catch_var;
+    std::optional<uint8_t> catch_register;
+};
+
+// One decoded instruction.
+//
+// `arg` is an instruction index for branches, or an index into one of the
+// side tables of `DecodedActions`; `arg8` and `arg16` carry small immediate
+// operands. See `decode_actions` for the per-opcode encoding.
+struct Instruction {
+    OpCode op;
+    uint8_t arg8;
+    uint16_t arg16;
+    uint32_t arg;
+};
+
+static_assert(sizeof(Instruction) == 8, "Instruction should stay one word");
+
+// A fully decoded action block.
+class DecodedActions {
+public:
+    static constexpr uint32_t NO_TARGET = std::numeric_limits<uint32_t>::max();
+
+    std::vector<Instruction> code;
+    std::vector<PushItem> push_items;
+    std::vector<std::string> strings;
+    std::vector<std::vector<std::string>> constant_pools;
+    std::vector<FunctionDecl> functions;
+    std::vector<TryBlock> try_blocks;
+
+    // Inline caches for GetMember, SetMember and CallMethod, indexed by the
+    // instruction's `arg`. They are run-time state, not part of the decoded
+    // program, hence mutable.
+    mutable std::vector<PropertyCache> property_caches;
+
+    // `strings` and each of `constant_pools` as atoms of one runtime's
+    // table, filled in once by `bind_atoms`, so that pushing a string or a
+    // constant never hashes it again. A pool is shared with the activations
+    // and functions that use it rather than copied.
+    std::vector<Avm1Atom> string_atoms;
+    std::vector<std::shared_ptr<const std::vector<Avm1Atom>>> pool_atoms;
+
+    // Byte offset of each instruction within the block, for debugging and
+    // for mapping back to SWF offsets. Ascending up to the block's final
+    // End; instructions decoded for a branch into the middle of an action
+    // follow it (see `decode_actions`).
+    std::vector<uint32_t> byte_offsets;
+
+    // Size of the source action bytes.
+    size_t source_len = 0;
+
+    // Set when the block can create local variables (DefineLocal,
+    // DefineLocal2, a named DefineFunction, or a Try that catches into a
+    // named variable). Function calls skip creating
+    // a local scope object for bodies that cannot use one.
+    bool defines_locals = false;
+
+    // Intern the block's strings and constant pools into `atoms`. Done once,
+    // by the runtime's `BytecodeCache` right after decoding: a decoded block
+    // belongs to the runtime whose table it is bound to.
+    void bind_atoms(Avm1AtomTable& atoms) {
+        string_atoms.clear();
+        string_atoms.reserve(strings.size());
+        for (const auto& s : strings) {
+            string_atoms.push_back(atoms.intern(s));
+        }
+        pool_atoms.clear();
+        pool_atoms.reserve(constant_pools.size());
+        for (const auto& pool : constant_pools) {
+            auto bound = std::make_shared<std::vector<Avm1Atom>>();
+            bound->reserve(pool.size());
+            for (const auto& s : pool) {
+                bound->push_back(atoms.intern(s));
+            }
+            pool_atoms.push_back(std::move(bound));
+        }
+    }
+
+    // Approximate heap footprint, used by the bytecode cache's memory cap.
+    size_t heap_size() const {
+        size_t size = sizeof(DecodedActions);
+        size += code.capacity() * sizeof(Instruction);
+        size += push_items.capacity() * sizeof(PushItem);
+        size += byte_offsets.capacity() * sizeof(uint32_t);
+        for (const auto& s : strings) size += sizeof(std::string) + s.capacity();
+        for (const auto& pool : constant_pools) {
+            for (const auto& s : pool) size += sizeof(std::string) + s.capacity();
+        }
+        for (const auto& f : functions) {
+            size += sizeof(FunctionDecl) + f.name.capacity();
+            for (const auto& p : f.params) size += sizeof(std::string) + p.capacity();
+        }
+        size += try_blocks.capacity() * sizeof(TryBlock);
+        size += property_caches.capacity() * sizeof(PropertyCache);
+        size += string_atoms.capacity() * sizeof(Avm1Atom);
+        for (const auto& pool : pool_atoms) size += pool->capacity() * sizeof(Avm1Atom);
+        return size;
+    }
+};
+
+// Minimal little-endian reader over an action block.
+class ActionReader {
+private:
+    const uint8_t* data_;
+    size_t len_;
+    size_t pos_;
+    bool error_;
+
+public:
+    ActionReader(const uint8_t* data, size_t len)
+        : data_(data), len_(len), pos_(0), error_(false) {}
+
+    size_t pos() const { return pos_; }
+    size_t len() const { return len_; }
+    bool at_end() const { return pos_ >= len_; }
+    bool error() const { return error_; }
+    void seek(size_t pos) { pos_ = pos; }
+
+    uint8_t read_u8() {
+        if (pos_ + 1 > len_) { error_ = true; pos_ = len_; return 0; }
+        return data_[pos_++];
+    }
+
+    uint16_t read_u16() {
+        if (pos_ + 2 > len_) { error_ = true; pos_ = len_; return 0; }
+        uint16_t v = static_cast<uint16_t>(data_[pos_] | (data_[pos_ + 1] << 8));
+        pos_ += 2;
+        return v;
+    }
+
+    uint32_t read_u32() {
+        if (pos_ + 4 > len_) { error_ = true; pos_ = len_; return 0; }
+        uint32_t v = static_cast<uint32_t>(data_[pos_]) |
+                     (static_cast<uint32_t>(data_[pos_ + 1]) << 8) |
+                     (static_cast<uint32_t>(data_[pos_ + 2]) << 16) |
+                     (static_cast<uint32_t>(data_[pos_ + 3]) << 24);
+        pos_ += 4;
+        return v;
+    }
+
+    float read_f32() {
+        uint32_t bits = read_u32();
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    // Push doubles are stored as two little-endian words, high word first.
+    double read_f64_me() {
+        uint64_t hi = read_u32();
+        uint64_t lo = read_u32();
+        uint64_t bits = (hi << 32) | lo;
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    // Null-terminated string. A missing terminator ends at the limit.
+    std::string read_str(size_t limit) {
+        size_t end = std::min(limit, len_);
+        size_t start = pos_;
+        while (pos_ < end && data_[pos_] != 0) {
+            ++pos_;
+        }
+        std::string s(reinterpret_cast<const char*>(data_ + start), pos_ - start);
+        if (pos_ < end) {
+            ++pos_; // Skip terminator
+        }
+        return s;
+    }
+};
+
+namespace detail {
+
+// A branch whose target is still a byte offset.
+struct PendingBranch {
+    size_t instruction;
+    int64_t target_offset;
+};
+
+inline uint32_t add_string(DecodedActions& out, std::string s) {
+    out.strings.push_back(std::move(s));
+    return static_cast<uint32_t>(out.strings.size() - 1);
+}
+
+} // namespace detail
+
+// Fuse common instruction sequences into superinstructions.
+//
+// Fused instructions replace the first instruction of their sequence and
+// leave the rest in place, so instruction indices (and therefore branch
+// targets and WaitForFrame skips) are unchanged. A sequence is only fused
+// when nothing branches into its middle.
+//
+// * Push(n), GetVariable     -> PushGetVariable
+// * Push(n), GetMember       -> PushGetMember
+// * Push(2), Add2            -> PushPushAdd2
+// * Push(1), Push(1), Add2   -> PushPushAdd2
+//
+// Push items of consecutive pushes are contiguous in `push_items`, so the
+// last one or two items of the sequence are always `arg + arg16 - 1` and
+// the one before it.
+inline void fuse_superinstructions(DecodedActions& actions) {
+    auto& code = actions.code;
+    std::vector<bool> is_target(code.size() + 1, false);
+    for (const auto& insn : code) {
+        switch (insn.op) {
+            case OpCode::Jump:
+            case OpCode::If:
+            case OpCode::With:
+            case OpCode::WaitForFrame:
+            case OpCode::WaitForFrame2:
+                if (insn.arg < is_target.size()) is_target[insn.arg] = true;
+                break;
+            default:
+                break;
+        }
+    }
+    for (const auto& block : actions.try_blocks) {
+        for (uint32_t target : {block.try_end, block.catch_end, block.finally_end}) {
+            if (target < is_target.size()) is_target[target] = true;
+        }
+    }
+
+    for (size_t i = 0; i + 1 < code.size(); ++i) {
+        Instruction& first = code[i];
+        if (first.op != OpCode::Push || first.arg16 == 0 || is_target[i + 1]) {
+            continue;
+        }
+        const Instruction& second = code[i + 1];
+        if (second.op == OpCode::GetVariable) {
+            first.op = OpCode::PushGetVariable;
+            first.arg8 = 2;
+        } else if (second.op == OpCode::GetMember) {
+            first.op = OpCode::PushGetMember;
+            first.arg8 = 2;
+        } else if (second.op == OpCode::Add2 && first.arg16 == 2) {
+            first.op = OpCode::PushPushAdd2;
+            first.arg8 = 2;
+        } else if (second.op == OpCode::Push && second.arg16 == 1 && first.arg16 == 1 &&
+                   i + 2 < code.size() && code[i + 2].op == OpCode::Add2 &&
+                   !is_target[i + 2]) {
+            first.op = OpCode::PushPushAdd2;
+            first.arg8 = 3;
+            first.arg16 = 2;
+        }
+    }
+}
+
+// Decode an action block into a `DecodedActions`.
+//
+// Per-opcode operand encoding:
+//
+// * Push: `arg` = first item in `push_items`, `arg16` = item count.
+// * Jump, If: `arg` = target instruction index.
+// * StoreRegister: `arg8` = register.
+// * GotoFrame: `arg` = frame.
+// * GetUrl: `arg` = url string, `arg + 1` = target string.
+// * SetTarget, GotoLabel: `arg` = string.
+// * ConstantPool: `arg` = index into `constant_pools`.
+// * WaitForFrame: `arg16` = frame, `arg` = instruction to skip to.
+// * WaitForFrame2: `arg` = instruction to skip to.
+// * DefineFunction(2): `arg` = index into `functions`.
+// * Try: `arg` = index into `try_blocks`.
+// * With: `arg` = instruction index where the with body ends.
+// * GetMember, SetMember, CallMethod: `arg` = index into `property_caches`.
+// * GetUrl2: `arg8` = flags.
+// * GotoFrame2: `arg8` = flags, `arg16` = scene bias.
+//
+// Branch targets are clamped to the block like Flash does; a target that
+// lands past the last decoded instruction resolves to the final End.
+inline std::shared_ptr<DecodedActions> decode_actions(const uint8_t* data, size_t len) {
+    auto out = std::make_shared<DecodedActions>();
+    out->source_len = len;
+
+    ActionReader reader(data, len);
+    std::vector<detail::PendingBranch> branches;
+    // Action-count skips for WaitForFrame, resolved after decoding.
+    std::vector<std::pair<size_t, uint32_t>> skips;
+    // With/Try regions whose byte end must be mapped to an instruction.
+    std::vector<std::pair<size_t, size_t>> region_ends;
+    struct PendingTry { size_t block; size_t try_start; uint16_t try_size, catch_size, finally_size; };
+    std::vector<PendingTry> pending_tries;
+
+    // Instruction index of each decoded action, by byte offset.
+    std::unordered_map<size_t, uint32_t> index_of;
+    // Index of the last instruction of each run of decoded actions: the
+    // final End of the block, then the Jump ending each extra run.
+    std::vector<uint32_t> run_ends;
+
+    // Decode actions from `offset` until the end of the block, a truncated
+    // action, or an action that is already decoded. End actions are decoded
+    // like any other: code after one is still reachable by branches.
+    // Returns the offset where decoding stopped.
+    auto decode_run = [&](size_t offset) -> size_t {
+        reader.seek(offset);
+        while (!reader.at_end()) {
+            size_t start = reader.pos();
+            if (index_of.count(start)) {
+                return start;
+            }
+            uint8_t code = reader.read_u8();
+            size_t length = 0;
+            if (code >= 0x80) {
+                length = reader.read_u16();
+            }
+            size_t payload_start = reader.pos();
+            size_t payload_end = payload_start + length;
+            if (reader.error() || payload_end > len) {
+                return start; // Truncated action; Flash stops executing here.
+            }
+
+            Instruction insn{static_cast<OpCode>(code), 0, 0, 0};
+            size_t index = out->code.size();
+            size_t next = payload_end;
+
+            switch (static_cast<OpCode>(code)) {
+                case OpCode::Push: {
+                    insn.arg = static_cast<uint32_t>(out->push_items.size());
+                    uint16_t count = 0;
+                    while (reader.pos() < payload_end && !reader.error()) {
+                        auto kind = static_cast<PushKind>(reader.read_u8());
+                        PushItem item = PushItem::make(kind);
+                        switch (kind) {
+                            case PushKind::STRING:
+                                item.index = detail::add_string(*out, reader.read_str(payload_end));
+                                break;
+                            case PushKind::FLOAT:
+                                item.kind = PushKind::DOUBLE;
+                                item.number = reader.read_f32();
+                                break;
+                            case PushKind::NULL_VAL:
+                            case PushKind::UNDEFINED:
+                                break;
+                            case PushKind::REGISTER:
+                                item.index = reader.read_u8();
+                                break;
+                            case PushKind::BOOLEAN:
+                                item.boolean = reader.read_u8() != 0;
+                                break;
+                            case PushKind::DOUBLE:
+                                item.number = reader.read_f64_me();
+                                break;
+                            case PushKind::INT:
+                                item.kind = PushKind::DOUBLE;
+                                item.number = static_cast<int32_t>(reader.read_u32());
+                                break;
+                            case PushKind::CONSTANT8:
+                                item.kind = PushKind::CONSTANT16;
+                                item.index = reader.read_u8();
+                                break;
+                            case PushKind::CONSTANT16:
+                                item.index = reader.read_u16();
+                                break;
+                            default:
+                                // Unknown push type: Flash stops reading the action.
+                                reader.seek(payload_end);
+                                continue;
+                        }
+                        out->push_items.push_back(item);
+                        ++count;
+                    }
+                    insn.arg16 = count;
+                    break;
+                }
+                case OpCode::Jump:
+                case OpCode::If: {
+                    int16_t offset = static_cast<int16_t>(reader.read_u16());
+                    branches.push_back({index, static_cast<int64_t>(payload_end) + offset});
+                    break;
+                }
+                case OpCode::StoreRegister:
+                    insn.arg8 = reader.read_u8();
+                    break;
+                case OpCode::GotoFrame:
+                    insn.arg = reader.read_u16();
+                    break;
+                case OpCode::GetUrl: {
+                    insn.arg = detail::add_string(*out, reader.read_str(payload_end));
+                    detail::add_string(*out, reader.read_str(payload_end));
+                    break;
+                }
+                case OpCode::SetTarget:
+                case OpCode::GotoLabel:
+                    insn.arg = detail::add_string(*out, reader.read_str(payload_end));
+                    break;
+                case OpCode::ConstantPool: {
+                    uint16_t count = reader.read_u16();
+                    std::vector<std::string> pool;
+                    pool.reserve(count);
+                    for (uint16_t i = 0; i < count && reader.pos() < payload_end; ++i) {
+                        pool.push_back(reader.read_str(payload_end));
+                    }
+                    insn.arg = static_cast<uint32_t>(out->constant_pools.size());
+                    out->constant_pools.push_back(std::move(pool));
+                    break;
+                }
+                case OpCode::WaitForFrame:
+                    insn.arg16 = reader.read_u16();
+                    skips.push_back({index, reader.read_u8()});
+                    break;
+                case OpCode::WaitForFrame2:
+                    skips.push_back({index, reader.read_u8()});
+                    break;
+                case OpCode::DefineFunction:
+                case OpCode::DefineFunction2: {
+                    bool is_function2 = code == static_cast<uint8_t>(OpCode::DefineFunction2);
+                    FunctionDecl decl;
+                    decl.name = reader.read_str(payload_end);
+                    uint16_t num_params = reader.read_u16();
+                    decl.register_count = is_function2 ? reader.read_u8() : 0;
+                    decl.flags = is_function2 ? reader.read_u16() : 0;
+                    decl.is_function2 = is_function2;
+                    for (uint16_t i = 0; i < num_params && !reader.error(); ++i) {
+                        uint8_t reg = is_function2 ? reader.read_u8() : 0;
+                        decl.param_registers.push_back(reg);
+                        decl.params.push_back(reader.read_str(payload_end));
+                    }
+                    uint16_t body_len = reader.read_u16();
+                    decl.body_offset = payload_end;
+                    decl.body_len = std::min<size_t>(body_len, len - payload_end);
+                    insn.arg = static_cast<uint32_t>(out->functions.size());
+                    out->functions.push_back(std::move(decl));
+                    // The body follows the action and is skipped here.
+                    next = payload_end + out->functions.back().body_len;
+                    break;
+                }
+                case OpCode::With: {
+                    uint16_t body_len = reader.read_u16();
+                    region_ends.push_back({index, payload_end + body_len});
+                    break;
+                }
+                case OpCode::Try: {
+                    uint8_t flags = reader.read_u8();
+                    uint16_t try_size = reader.read_u16();
+                    uint16_t catch_size = reader.read_u16();
+                    uint16_t finally_size = reader.read_u16();
+                    TryBlock block{};
+                    if (flags & 0x4) {
+                        block.catch_register = reader.read_u8();
+                    } else {
+                        // The catch variable is defined as a local.
+                        block.catch_var = reader.read_str(payload_end);
+                        out->defines_locals = true;
+                    }
+                    if (!(flags & 0x1)) {
+                        catch_size = 0;
+                    }
+                    if (!(flags & 0x2)) {
+                        finally_size = 0;
+                    }
+                    insn.arg = static_cast<uint32_t>(out->try_blocks.size());
+                    out->try_blocks.push_back(std::move(block));
+                    pending_tries.push_back({insn.arg, payload_end, try_size, catch_size, finally_size});
+                    break;
+                }
+                case OpCode::GetMember:
+                case OpCode::SetMember:
+                case OpCode::CallMethod:
+                    insn.arg = static_cast<uint32_t>(out->property_caches.size());
+                    out->property_caches.emplace_back();
+                    break;
+                case OpCode::GetUrl2:
+                    insn.arg8 = reader.read_u8();
+                    break;
+                case OpCode::GotoFrame2: {
+                    uint8_t flags = reader.read_u8();
+                    insn.arg8 = flags;
+                    if (flags & 0x2) {
+                        insn.arg16 = reader.read_u16();
+                    }
+                    break;
+                }
+                default:
+                    // Actions without operands, including unknown ones. Unknown
+                    // actions are kept so that instruction indices match action
+                    // counts (WaitForFrame skips by action) and are ignored at
+                    // run time, like Flash does.
+                    if (code >= FIRST_SYNTHETIC_OPCODE) {
+                        insn.op = OpCode::Unknown;
+                        insn.arg8 = code;
+                    }
+                    break;
+            }
+
+            switch (insn.op) {
+                case OpCode::DefineLocal:
+                case OpCode::DefineLocal2:
+                case OpCode::DefineFunction:
+                case OpCode::DefineFunction2:
+                    out->defines_locals = true;
+                    break;
+                default:
+                    break;
+            }
+
+            index_of.emplace(start, static_cast<uint32_t>(index));
+            out->code.push_back(insn);
+            out->byte_offsets.push_back(static_cast<uint32_t>(start));
+            reader.seek(next);
+        }
+        return reader.pos();
+    };
+
+    size_t decoded_end = decode_run(0);
+
+    // Every block ends with an End instruction, so the interpreter can run
+    // without bounds checks: linear flow and all branches stop there.
+    if (out->code.empty() || out->code.back().op != OpCode::End) {
+        out->code.push_back(Instruction{OpCode::End, 0, 0, 0});
+        out->byte_offsets.push_back(static_cast<uint32_t>(decoded_end));
+    }
+    uint32_t end_index = static_cast<uint32_t>(out->code.size() - 1);
+    run_ends.push_back(end_index);
+
+    // Map a byte offset to an instruction index. Offsets at or past the end
+    // of the decoded region end the block.
+    //
+    // A branch into the middle of an action, as obfuscated SWFs use, gets
+    // the bytes from there decoded as a run of instructions of its own,
+    // appended after the final End. The run ends with a Jump to where it
+    // rejoins already decoded code, or to the final End. A With or Try body
+    // is a range of instruction indices, so branching to such a run from
+    // within one leaves the body.
+    auto resolve = [&](int64_t offset) -> uint32_t {
+        if (offset < 0) offset = 0;
+        if (offset > static_cast<int64_t>(len)) offset = static_cast<int64_t>(len);
+        if (static_cast<size_t>(offset) >= decoded_end) {
+            return end_index;
+        }
+        auto it = index_of.find(static_cast<size_t>(offset));
+        if (it != index_of.end()) {
+            return it->second;
+        }
+        auto run_start = static_cast<uint32_t>(out->code.size());
+        size_t stop = decode_run(static_cast<size_t>(offset));
+        auto joined = index_of.find(stop);
+        uint32_t next = stop < decoded_end && joined != index_of.end() ? joined->second : end_index;
+        out->code.push_back(Instruction{OpCode::Jump, 0, 0, next});
+        out->byte_offsets.push_back(static_cast<uint32_t>(stop));
+        run_ends.push_back(static_cast<uint32_t>(out->code.size() - 1));
+        return run_start;
+    };
+
+    // Resolving can decode more actions, and with them more branches and
+    // regions; go on until everything is resolved.
+    size_t branches_done = 0;
+    size_t regions_done = 0;
+    size_t tries_done = 0;
+    while (branches_done < branches.size() || regions_done < region_ends.size() ||
+           tries_done < pending_tries.size()) {
+        for (; branches_done < branches.size(); ++branches_done) {
+            detail::PendingBranch branch = branches[branches_done];
+            uint32_t target = resolve(branch.target_offset);
+            out->code[branch.instruction].arg = target;
+        }
+
+        for (; regions_done < region_ends.size(); ++regions_done) {
+            auto [index, end] = region_ends[regions_done];
+            uint32_t target = resolve(static_cast<int64_t>(end));
+            out->code[index].arg = target;
+        }
+
+        for (; tries_done < pending_tries.size(); ++tries_done) {
+            PendingTry pending = pending_tries[tries_done];
+            size_t catch_start = pending.try_start + pending.try_size;
+            size_t finally_start = catch_start + pending.catch_size;
+            size_t finally_end = finally_start + pending.finally_size;
+
+            uint32_t try_end = resolve(static_cast<int64_t>(catch_start));
+            uint32_t catch_end = resolve(static_cast<int64_t>(finally_start));
+            uint32_t fin_end = resolve(static_cast<int64_t>(finally_end));
+            TryBlock& block = out->try_blocks[pending.block];
+            block.try_end = try_end;
+            if (pending.catch_size > 0) block.catch_start = try_end;
+            block.catch_end = catch_end;
+            if (pending.finally_size > 0) block.finally_start = catch_end;
+            block.finally_end = fin_end;
+        }
+    }
+
+    // WaitForFrame skips a number of actions, not bytes, and never past the
+    // end of its run.
+    for (const auto& [index, count] : skips) {
+        uint32_t run_end = *std::lower_bound(run_ends.begin(), run_ends.end(),
+                                             static_cast<uint32_t>(index));
+        size_t target = std::min<size_t>(index + 1 + count, run_end);
+        out->code[index].arg = static_cast<uint32_t>(target);
+    }
+
+
+    // Pre-bind constant pool references. This is only sound when the block
+    // sets exactly one pool, as its very first action: every push in the
+    // block then observes that pool.
+    if (out->constant_pools.size() == 1 && !out->code.empty() &&
+        out->code[0].op == OpCode::ConstantPool) {
+        const auto& pool = out->constant_pools[0];
+        uint32_t base = static_cast<uint32_t>(out->strings.size());
+        out->strings.insert(out->strings.end(), pool.begin(), pool.end());
+        for (auto& item : out->push_items) {
+            if (item.kind == PushKind::CONSTANT16 && item.index < pool.size()) {
+                item.kind = PushKind::STRING;
+                item.index += base;
+            }
+        }
+    }
+
+    fuse_superinstructions(*out);
+    return out;
+}
+
+} // namespace ruffle
+
+#endif // AVM1_BYTECODE_H
@@ -0,0 +1,156 @@
+/*
+ * C++ header for the AVM1 bytecode cache
+ * Caches decoded action blocks per movie and offset, under a memory cap
+ */
+
+#ifndef AVM1_BYTECODE_CACHE_H
+#define AVM1_BYTECODE_CACHE_H
+
+#include "avm1/bytecode.h"
+#include "tag_utils.h"
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace ruffle {
+
+// Cache of decoded action blocks.
+//
+// Frame scripts, button actions and function bodies are all `SwfSlice`s of
+// some movie. The first run of a slice decodes it; later runs reuse the
+// decoded block. Entries are keyed by movie and byte range and evicted in
+// least-recently-used order once the cache exceeds its memory cap.
+//
+// Each runtime has its own cache, and binds the blocks it decodes to its
+// own atom table (`DecodedActions::bind_atoms`), so a decoded block is never
+// shared between runtimes.
+//
+// Entries hold the movie weakly: an unloaded movie's blocks are dropped the
+// next time they are looked up, and a new movie allocated at the same
+// address can never observe a stale entry.
+class BytecodeCache {
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+
+private:
+    struct Key {
+        const SwfMovie* movie;
+        size_t start;
+        size_t end;
+
+        bool operator==(const Key& other) const {
+            return movie == other.movie && start == other.start && end == other.end;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t h = std::hash<const void*>{}(key.movie);
+            h ^= std::hash<size_t>{}(key.start) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<size_t>{}(key.end) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    struct Entry {
+        std::weak_ptr<SwfMovie> movie;
+        std::shared_ptr<const DecodedActions> actions;
+        size_t size;
+        std::list<Key>::iterator lru_position;
+    };
+
+    Avm1AtomTable& atoms_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    // Most recently used at the front.
+    std::list<Key> lru_;
+    size_t bytes_;
+    size_t max_bytes_;
+    size_t hits_;
+    size_t misses_;
+
+    void erase(std::unordered_map<Key, Entry, KeyHash>::iterator it) {
+        bytes_ -= it->second.size;
+        lru_.erase(it->second.lru_position);
+        entries_.erase(it);
+    }
+
+    void evict_to(size_t limit) {
+        while (bytes_ > limit && !lru_.empty()) {
+            auto it = entries_.find(lru_.back());
+            erase(it);
+        }
+    }
+
+public:
+    explicit BytecodeCache(Avm1AtomTable& atoms, size_t max_bytes = DEFAULT_MAX_BYTES)
+        : atoms_(atoms), bytes_(0), max_bytes_(max_bytes), hits_(0), misses_(0) {}
+
+    // Return the decoded form of `slice`, decoding it on first use.
+    //
+    // Decoded blocks are shared: callers such as `Avm1Function` may hold on
+    // to the result, and it stays valid after eviction.
+    std::shared_ptr<const DecodedActions> get_or_decode(const SwfSlice& slice) {
+        const auto& movie = slice.movie();
+        Key key{movie.get(), slice.start(), slice.end()};
+
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            if (it->second.movie.expired()) {
+                erase(it);
+            } else {
+                ++hits_;
+                lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+                return it->second.actions;
+            }
+        }
+
+        ++misses_;
+        std::shared_ptr<DecodedActions> decoded =
+            decode_actions(movie->data().data() + slice.start(), slice.len());
+        decoded->bind_atoms(atoms_);
+        std::shared_ptr<const DecodedActions> actions = std::move(decoded);
+
+        size_t size = actions->heap_size();
+        if (size <= max_bytes_) {
+            evict_to(max_bytes_ - size);
+            lru_.push_front(key);
+            entries_.emplace(key, Entry{movie, actions, size, lru_.begin()});
+            bytes_ += size;
+        }
+        return actions;
+    }
+
+    // Drop every entry belonging to `movie`, e.g. when it is unloaded.
+    void remove_movie(const SwfMovie* movie) {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            auto next = std::next(it);
+            if (it->first.movie == movie) {
+                erase(it);
+            }
+            it = next;
+        }
+    }
+
+    void clear() {
+        entries_.clear();
+        lru_.clear();
+        bytes_ = 0;
+    }
+
+    void set_max_bytes(size_t max_bytes) {
+        max_bytes_ = max_bytes;
+        evict_to(max_bytes_);
+    }
+
+    size_t max_bytes() const { return max_bytes_; }
+    size_t memory_usage() const { return bytes_; }
+    size_t len() const { return entries_.size(); }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_BYTECODE_CACHE_H
@@ -0,0 +1,229 @@
+/*
+ * C++ header for AVM1 compact value functionality
+ * A 16-byte, trivially copyable counterpart to `Value` for interpreter hot paths
+ */
+
+#ifndef AVM1_COMPACT_VALUE_H
+#define AVM1_COMPACT_VALUE_H
+
+#include "avm1/atom.h"
+#include "avm1/string_kernels.h"
+#include "avm1/value_type.h"
+#include "number_format.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace ruffle {
+
+// Forward declarations
+class Object;
+class MovieClipReference;
+class Value;
+
+// Compact AVM1 value.
+//
+// A `Value` holds a `std::string` and two kinds of `shared_ptr`, so copying
+// one may allocate and always touches atomic refcounts. `CompactValue` is a
+// tag plus an 8-byte payload:
+//
+// * undefined, null, booleans and numbers are stored inline;
+// * strings are `Avm1Atom`s: interned, or owned by the value stack for
+//   strings computed at run time;
+// * objects and movie clip references are borrowed pointers.
+//
+// Borrowed pointers do not keep their target alive. Whoever stores a
+// `CompactValue` (the activation stack, registers, property slots) is
+// responsible for the target being reachable from a root for as long as the
+// value is live.
+//
+// A NaN-boxed 8-byte layout was considered, but it would require
+// canonicalizing NaN payloads and 48-bit pointers; the 16-byte layout keeps
+// numbers bit-exact and is still two machine words.
+class CompactValue {
+private:
+    union Payload {
+        double number;
+        bool boolean;
+        const Avm1AtomEntry* string;
+        Object* object;
+        MovieClipReference* clip;
+    };
+
+    Payload payload_;
+    ValueType type_;
+
+    explicit constexpr CompactValue(ValueType type) : payload_{0.0}, type_(type) {}
+
+public:
+    constexpr CompactValue() : payload_{0.0}, type_(ValueType::UNDEFINED) {}
+
+    // Static constructors for specific types
+    static constexpr CompactValue undefined() { return CompactValue(ValueType::UNDEFINED); }
+    static constexpr CompactValue null() { return CompactValue(ValueType::NULL_VAL); }
+
+    static CompactValue boolean(bool b) {
+        CompactValue v(ValueType::BOOLEAN);
+        v.payload_.boolean = b;
+        return v;
+    }
+
+    static CompactValue number(double d) {
+        CompactValue v(ValueType::NUMBER);
+        v.payload_.number = d;
+        return v;
+    }
+
+    static CompactValue string(Avm1Atom atom) {
+        CompactValue v(ValueType::STRING);
+        v.payload_.string = atom.entry();
+        return v;
+    }
+
+    static CompactValue object(Object* obj) {
+        if (!obj) {
+            return null();
+        }
+        CompactValue v(ValueType::OBJECT);
+        v.payload_.object = obj;
+        return v;
+    }
+
+    static CompactValue movie_clip(MovieClipReference* mc) {
+        if (!mc) {
+            return null();
+        }
+        CompactValue v(ValueType::MOVIE_CLIP);
+        v.payload_.clip = mc;
+        return v;
+    }
+
+    // Convert from a full `Value`, interning strings as atoms.
+    template<typename V = Value>
+    static CompactValue from_value(const V& value, Avm1AtomTable& atoms) {
+        switch (value.type()) {
+            case ValueType::UNDEFINED: return undefined();
+            case ValueType::NULL_VAL: return null();
+            case ValueType::BOOLEAN: return boolean(value.as_bool());
+            case ValueType::NUMBER: return number(value.as_number());
+            case ValueType::STRING: return string(atoms.intern(value.as_string()));
+            case ValueType::OBJECT: return object(value.as_object().get());
+            case ValueType::MOVIE_CLIP: return movie_clip(value.as_movie_clip().get());
+        }
+        return undefined();
+    }
+
+    // Convert back to a full `Value`.
+    //
+    // Objects and clips are re-owned through `shared_from_this`. Both
+    // conversions are templates so that `Value`, `Object` and
+    // `MovieClipReference` only need to be complete where a value is
+    // actually converted; the value stack builds without them.
+    template<typename V = Value, typename Obj = Object, typename Clip = MovieClipReference>
+    V to_value() const {
+        switch (type_) {
+            case ValueType::UNDEFINED: return V::undefined();
+            case ValueType::NULL_VAL: return V::NULL_VAL;
+            case ValueType::BOOLEAN: return V::boolean(payload_.boolean);
+            case ValueType::NUMBER: return V::number(payload_.number);
+            case ValueType::STRING: return V::string(payload_.string->text);
+            case ValueType::OBJECT: return V::object(static_cast<Obj*>(payload_.object)->shared_from_this());
+            case ValueType::MOVIE_CLIP:
+                return V::movie_clip(static_cast<Clip*>(payload_.clip)->shared_from_this());
+        }
+        return V::undefined();
+    }
+
+    // Type checking methods
+    ValueType type() const { return type_; }
+    bool is_undefined() const { return type_ == ValueType::UNDEFINED; }
+    bool is_null() const { return type_ == ValueType::NULL_VAL; }
+    bool is_boolean() const { return type_ == ValueType::BOOLEAN; }
+    bool is_number() const { return type_ == ValueType::NUMBER; }
+    bool is_string() const { return type_ == ValueType::STRING; }
+    bool is_object() const { return type_ == ValueType::OBJECT; }
+    bool is_movie_clip() const { return type_ == ValueType::MOVIE_CLIP; }
+    bool is_primitive() const { return !is_object() && !is_movie_clip(); }
+
+    // Getters
+    bool as_bool() const {
+        switch (type_) {
+            case ValueType::BOOLEAN: return payload_.boolean;
+            case ValueType::NUMBER: return payload_.number != 0.0 && !std::isnan(payload_.number);
+            case ValueType::STRING: return !payload_.string->text.empty();
+            case ValueType::UNDEFINED:
+            case ValueType::NULL_VAL: return false;
+            default: return true; // Objects and movie clips are truthy
+        }
+    }
+
+    double as_number() const {
+        switch (type_) {
+            case ValueType::NUMBER: return payload_.number;
+            case ValueType::BOOLEAN: return payload_.boolean ? 1.0 : 0.0;
+            case ValueType::STRING: return avm1_string_to_number(payload_.string->text);
+            case ValueType::UNDEFINED:
+            case ValueType::NULL_VAL: return std::numeric_limits<double>::quiet_NaN();
+            default: return 0.0; // Objects convert to 0
+        }
+    }
+
+    // String payload as an atom. Only valid when `is_string()`.
+    Avm1Atom as_atom() const { return Avm1Atom(payload_.string); }
+
+    std::string as_string() const {
+        switch (type_) {
+            case ValueType::STRING: return payload_.string->text;
+            case ValueType::NUMBER: return format_avm1_number(payload_.number);
+            case ValueType::BOOLEAN: return payload_.boolean ? "true" : "false";
+            case ValueType::NULL_VAL: return "null";
+            case ValueType::UNDEFINED: return "undefined";
+            default: return "[type Object]"; // Objects convert to this string
+        }
+    }
+
+    Object* as_object() const { return is_object() ? payload_.object : nullptr; }
+    MovieClipReference* as_movie_clip() const { return is_movie_clip() ? payload_.clip : nullptr; }
+
+    // Identity comparison, matching `Value::operator==`. Interned strings
+    // compare by atom, which is equivalent to comparing contents within one
+    // table; a string owned by the value stack compares by contents.
+    bool operator==(const CompactValue& other) const {
+        if (type_ != other.type_) return false;
+        switch (type_) {
+            case ValueType::UNDEFINED:
+            case ValueType::NULL_VAL: return true;
+            case ValueType::BOOLEAN: return payload_.boolean == other.payload_.boolean;
+            case ValueType::NUMBER: {
+                double a = payload_.number;
+                double b = other.payload_.number;
+                if (std::isnan(a) && std::isnan(b)) return true;
+                return a == b;
+            }
+            case ValueType::STRING: {
+                const Avm1AtomEntry* a = payload_.string;
+                const Avm1AtomEntry* b = other.payload_.string;
+                if (a == b) return true;
+                if (a->interned && b->interned) return false;
+                return a->hash == b->hash && a->text == b->text;
+            }
+            case ValueType::OBJECT: return payload_.object == other.payload_.object;
+            case ValueType::MOVIE_CLIP: return payload_.clip == other.payload_.clip;
+        }
+        return false;
+    }
+
+    bool operator!=(const CompactValue& other) const {
+        return !(*this == other);
+    }
+};
+
+static_assert(sizeof(CompactValue) == 16, "CompactValue must stay two words");
+static_assert(std::is_trivially_copyable_v<CompactValue>, "CompactValue must be trivially copyable");
+
+} // namespace ruffle
+
+#endif // AVM1_COMPACT_VALUE_H
@@ -0,0 +1,137 @@
+/*
+ * C++ header for AVM1 property enumeration
+ * Lazy for..in key iteration over an object and its prototype chain
+ */
+
+#ifndef AVM1_ENUMERATOR_H
+#define AVM1_ENUMERATOR_H
+
+#include "avm1/atom.h"
+#include "avm1/object.h"
+#include "avm1/value_stack.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace ruffle {
+
+// Names an enumeration has already seen, by atom identity.
+//
+// Open addressing with linear probing, kept at most half full. The first
+// INLINE_CAPACITY slots are part of the set itself, so enumerating a small
+// object allocates nothing.
+class EnumeratedKeySet {
+public:
+    static constexpr size_t INLINE_CAPACITY = 32;
+
+private:
+    std::array<const Avm1AtomEntry*, INLINE_CAPACITY> inline_{};
+    std::vector<const Avm1AtomEntry*> heap_;
+    size_t len_ = 0;
+
+    const Avm1AtomEntry** slots() { return heap_.empty() ? inline_.data() : heap_.data(); }
+    size_t capacity() const { return heap_.empty() ? INLINE_CAPACITY : heap_.size(); }
+
+    static size_t slot_for(const Avm1AtomEntry* entry, size_t mask) {
+        // Entries are heap allocated, so the low bits carry no information.
+        uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(entry) >> 4);
+        return static_cast<size_t>((h * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }
+
+    static bool place(const Avm1AtomEntry** slots, size_t mask, const Avm1AtomEntry* entry) {
+        for (size_t i = slot_for(entry, mask);; i = (i + 1) & mask) {
+            if (slots[i] == entry) {
+                return false;
+            }
+            if (!slots[i]) {
+                slots[i] = entry;
+                return true;
+            }
+        }
+    }
+
+    void grow() {
+        std::vector<const Avm1AtomEntry*> grown(capacity() * 2, nullptr);
+        const Avm1AtomEntry** old = slots();
+        for (size_t i = 0, n = capacity(); i < n; ++i) {
+            if (old[i]) {
+                place(grown.data(), grown.size() - 1, old[i]);
+            }
+        }
+        heap_ = std::move(grown);
+    }
+
+public:
+    // Returns true if `name` was not in the set yet.
+    bool insert(Avm1Atom name) {
+        if ((len_ + 1) * 2 > capacity()) {
+            grow();
+        }
+        if (!place(slots(), capacity() - 1, name.entry())) {
+            return false;
+        }
+        ++len_;
+        return true;
+    }
+
+    size_t len() const { return len_; }
+};
+
+// Produces the keys a for..in loop visits, one at a time: the object's
+// own enumerable keys, then those of each prototype that no nearer object
+// already has. A key that is already interned is produced as its atom, so
+// enumerating an object whose names are interned builds no strings. Any
+// other key, such as an array index, becomes a string owned by the value
+// stack (`ValueStack::own_string`), so enumeration never grows the atom
+// table.
+//
+// Nothing is copied up front; the enumerator reads each object through
+// `Object::next_own_key`, so the objects must not change until it is done.
+class KeyEnumerator {
+private:
+    std::shared_ptr<Object> object_;
+    OwnKeyCursor cursor_;
+    EnumeratedKeySet seen_;
+    // Names seen that have no atom, compared by text.
+    std::unordered_set<std::string> seen_uninterned_;
+    // Own keys are unique, so names only need recording once there is a
+    // prototype for them to shadow.
+    bool record_ = false;
+
+public:
+    explicit KeyEnumerator(std::shared_ptr<Object> object) : object_(std::move(object)) {
+        record_ = object_ && object_->proto();
+    }
+
+    // The next key. Like `ValueStack::own_string`, this may sweep `stack`.
+    std::optional<Avm1Atom> next(const Avm1AtomTable& atoms, ValueStack& stack) {
+        while (object_) {
+            std::optional<OwnKey> key = object_->next_own_key(cursor_);
+            if (!key) {
+                object_ = object_->proto();
+                cursor_ = OwnKeyCursor{};
+                record_ = true;
+                continue;
+            }
+            std::optional<Avm1Atom> atom = atoms.get(key->name);
+            bool fresh = true;
+            if (record_) {
+                fresh = atom ? seen_.insert(*atom)
+                             : seen_uninterned_.emplace(key->name).second;
+            }
+            if (key->enumerable && fresh) {
+                return atom ? *atom : stack.own_string(std::string(key->name));
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_ENUMERATOR_H
@@ -12,6 +12,11 @@
 #include "avm1/activation.h"
 #include "avm1/error.h"
 #include "avm1/scope.h"
+#include "avm1/bytecode_cache.h"
+#include "avm1/activation_pool.h"
+#include "avm1/profiler.h"
+#include "avm1/value_stack.h"
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <string>
@@ -24,6 +29,10 @@ namespace ruffle {
 class Avm1Function;
 class FunctionObject;
 
+// Make a native's pending tail call from native code (defined below).
+inline std::shared_ptr<Value> run_native_tail_call(std::shared_ptr<Activation> activation,
+                                                   NativeTailCall call);
+
 // Type for native functions in AVM1
 using NativeFunction = std::function<std::shared_ptr<Value>(
     std::shared_ptr<Activation>,
@@ -75,8 +84,16 @@ public:
 };
 
 // AVM1 function class
-class Avm1Function {
+class Avm1Function : public std::enable_shared_from_this<Avm1Function> {
 private:
+    // What a call must set up besides registers and parameters. Derived
+    // once, from the DefineFunction2 flags and the decoded body.
+    struct CallPlan {
+        bool arguments_object;
+        bool super_object;
+        bool local_scope;
+    };
+
     std::string name_;
     std::vector<std::string> parameters_;
     std::shared_ptr<SwfSlice> action_data_;
@@ -84,6 +101,19 @@ private:
     FunctionFlags flags_;
     std::optional<NativeFunction> native_function_;
     std::shared_ptr<Object> constructor_;  // For constructor functions
+    // Decoded body, pinned on first call so it survives cache eviction.
+    mutable std::shared_ptr<const DecodedActions> decoded_;
+    mutable std::optional<CallPlan> call_plan_;
+
+    // DefineFunction2 metadata; unused for DefineFunction and natives.
+    bool is_function2_ = false;
+    uint16_t function2_flags_ = 0;
+    uint8_t register_count_ = 0;
+    // Register for each parameter, 0 for a local variable.
+    std::vector<uint8_t> param_registers_;
+    // The constant pool active where the function was defined. Its body
+    // sees this pool until it sets one of its own.
+    std::shared_ptr<const std::vector<Avm1Atom>> constant_pool_;
 
 public:
     Avm1Function(const std::string& name,
@@ -98,6 +128,22 @@ public:
           flags_(flags), native_function_(std::move(native_func)),
           constructor_(std::move(constructor)) {}
 
+    // Create a function from a decoded DefineFunction or DefineFunction2,
+    // capturing the defining activation's constant pool.
+    static std::shared_ptr<Avm1Function> from_decl(const FunctionDecl& decl,
+                                                   std::shared_ptr<SwfSlice> body,
+                                                   std::shared_ptr<Scope> scope,
+                                                   std::shared_ptr<const std::vector<Avm1Atom>> constant_pool = nullptr) {
+        auto function = std::make_shared<Avm1Function>(decl.name, decl.params,
+                                                       std::move(body), std::move(scope));
+        function->constant_pool_ = std::move(constant_pool);
+        function->is_function2_ = decl.is_function2;
+        function->function2_flags_ = decl.flags;
+        function->register_count_ = decl.register_count;
+        function->param_registers_ = decl.param_registers;
+        return function;
+    }
+
     // Getters
     const std::string& name() const { return name_; }
     const std::vector<std::string>& parameters() const { return parameters_; }
@@ -107,6 +153,15 @@ public:
     bool has_native_function() const { return native_function_.has_value(); }
     std::shared_ptr<Object> constructor() const { return constructor_; }
 
+    // Get the decoded body of this function, decoding it through `cache` on
+    // first use.
+    std::shared_ptr<const DecodedActions> decoded_actions(BytecodeCache& cache) const {
+        if (!decoded_ && action_data_) {
+            decoded_ = cache.get_or_decode(*action_data_);
+        }
+        return decoded_;
+    }
+
     // Execute the function
     std::shared_ptr<Value> call(
         std::shared_ptr<Activation> activation,
@@ -115,13 +170,62 @@ public:
         
         if (native_function_) {
             // Call the native function
-            return native_function_.value()(activation, this_obj, args);
-        } else {
-            // Execute the bytecode function
-            return exec(ExecutionName(name_), activation, this_obj, args);
+            auto result = native_function_.value()(activation, this_obj, args);
+            if (auto tail = activation->take_tail_call()) {
+                return run_native_tail_call(activation, std::move(*tail));
+            }
+            return result;
+        }
+
+        // Execute the bytecode function, with the arguments copied onto the
+        // caller's stack, last first as AVM1 pushes them
+        for (auto it = args.rbegin(); it != args.rend(); ++it) {
+            activation->push(activation->compact(**it));
+        }
+        StackArgs stack_args = activation->value_stack()->args(activation->frame(), args.size());
+        try {
+            auto result = exec(ExecutionName(name_), activation, this_obj, stack_args);
+            activation->value_stack()->drop(activation->frame(), args.size());
+            return result;
+        } catch (...) {
+            activation->value_stack()->drop(activation->frame(), args.size());
+            throw;
         }
     }
 
+    // Execute the function with arguments that are already on the caller's
+    // stack, as CallFunction and CallMethod leave them. The caller drops the
+    // arguments afterwards.
+    std::shared_ptr<Value> call_with_stack_args(
+        std::shared_ptr<Activation> activation,
+        std::shared_ptr<Object> this_obj,
+        StackArgs args) const {
+
+        if (native_function_) {
+            auto result = call_native(activation, std::move(this_obj), args);
+            if (auto tail = activation->take_tail_call()) {
+                return run_native_tail_call(activation, std::move(*tail));
+            }
+            return result;
+        }
+        return exec(ExecutionName(name_), activation, this_obj, args);
+    }
+
+    // Run the native function on arguments from the caller's stack, leaving
+    // any tail call it asks for pending on `activation`.
+    std::shared_ptr<Value> call_native(
+        std::shared_ptr<Activation> activation,
+        std::shared_ptr<Object> this_obj,
+        StackArgs args) const {
+
+        std::vector<std::shared_ptr<Value>> values;
+        values.reserve(args.size());
+        for (size_t i = 0; i < args.size(); ++i) {
+            values.push_back(std::make_shared<Value>(args[i].to_value()));
+        }
+        return native_function_.value()(activation, this_obj, values);
+    }
+
     // Execute constructor
     std::shared_ptr<Value> construct(
         std::shared_ptr<Activation> activation,
@@ -146,18 +250,176 @@ public:
     }
 
 private:
-    // Execute the function with bytecode
+    const CallPlan& call_plan(const DecodedActions& body) const {
+        if (!call_plan_) {
+            CallPlan plan{true, true, true};
+            if (is_function2_) {
+                uint16_t flags = function2_flags_;
+                auto has = [flags](DefineFunction2Flags flag) {
+                    return (flags & static_cast<uint16_t>(flag)) != 0;
+                };
+                // Unless suppressed or preloaded into a register, `arguments`
+                // and `super` are visible as locals.
+                bool arguments_local = !has(DefineFunction2Flags::SUPPRESS_ARGUMENTS) &&
+                                       !has(DefineFunction2Flags::PRELOAD_ARGUMENTS);
+                bool super_local = !has(DefineFunction2Flags::SUPPRESS_SUPER) &&
+                                   !has(DefineFunction2Flags::PRELOAD_SUPER);
+                bool param_locals = std::find(param_registers_.begin(), param_registers_.end(),
+                                              0) != param_registers_.end();
+                plan.arguments_object = arguments_local ||
+                                        has(DefineFunction2Flags::PRELOAD_ARGUMENTS);
+                plan.super_object = super_local || has(DefineFunction2Flags::PRELOAD_SUPER);
+                plan.local_scope = arguments_local || super_local || param_locals ||
+                                   body.defines_locals;
+            }
+            // DefineFunction bodies can name `arguments` or `super`
+            // dynamically, so they always get everything.
+            call_plan_ = plan;
+        }
+        return *call_plan_;
+    }
+
+    // Build the `arguments` and `super` objects for a call from `caller`.
+    // `callee` is the function object being called, if known.
+    std::shared_ptr<Object> create_arguments_object(std::shared_ptr<Activation> caller,
+                                                    std::shared_ptr<Object> callee,
+                                                    StackArgs args) const;
+    std::shared_ptr<Object> create_super_object(std::shared_ptr<Activation> caller,
+                                                std::shared_ptr<Object> this_obj) const;
+
+    // Execute the function with bytecode, nested in the caller's native
+    // frame. Used when the player or a native calls into script.
     std::shared_ptr<Value> exec(
         ExecutionName name,
         std::shared_ptr<Activation> activation,
         std::shared_ptr<Object> this_obj,
-        const std::vector<std::shared_ptr<Value>>& args) const {
-        
-        // In a real implementation, this would execute the bytecode
-        // For now, we'll return undefined
-        return std::make_shared<Value>(Value::UNDEFINED);
+        StackArgs args) const {
+
+        PreparedCall call = prepare_call(name, activation, this_obj, args);
+        if (!call.activation) {
+            return std::make_shared<Value>(Value::UNDEFINED);
+        }
+        auto& avm = *activation->context()->avm1;
+        PooledActivation callee(avm.activation_pool(), std::move(call.activation));
+        avm.enter_call();
+        std::shared_ptr<Value> result;
+        try {
+            ProfilerFrame profile(call.profiler, call.profile_id.value_or(0));
+            result = callee->run_actions(std::move(call.body));
+        } catch (...) {
+            avm.leave_call();
+            throw;
+        }
+        avm.leave_call();
+        return result ? result : std::make_shared<Value>(Value::UNDEFINED);
     }
 
+public:
+    // Set up a call to this bytecode function: acquire the callee's
+    // activation and bind `this`, `arguments`, `super`, preloaded registers
+    // and parameters. `args` are read here and may be dropped once the call
+    // has finished. `callee_object` is the function object being called, if
+    // known. Returns an empty call if the function has no body.
+    PreparedCall prepare_call(
+        ExecutionName name,
+        std::shared_ptr<Activation> activation,
+        std::shared_ptr<Object> this_obj,
+        StackArgs args,
+        std::shared_ptr<Object> callee_object = nullptr) const {
+
+        auto context = activation->context();
+        if (context->execution_limit.check()) {
+            throw Avm1Exception(Avm1Error::execution_timeout());
+        }
+        auto& avm = *context->avm1;
+        auto body = decoded_actions(avm.bytecode_cache());
+        if (!body) {
+            return PreparedCall{};
+        }
+        const CallPlan& plan = call_plan(*body);
+
+        PreparedCall call;
+        auto scope = plan.local_scope
+            ? std::make_shared<Scope>(Scope::new_local_scope(scope_))
+            : scope_;
+        auto callee = avm.activation_pool().acquire(
+            context, scope, activation->base_clip(), this_obj,
+            std::const_pointer_cast<Avm1Function>(shared_from_this()),
+            ActivationIdentifier(activation->id().id + 1, name.name()),
+            avm.value_stack(), is_function2_ ? register_count_ : 0);
+
+        if (const auto& profiler = avm.profiler()) {
+            call.profile_id = profiler->function_id(action_data_->movie().get(),
+                                                    action_data_->start(), callee->id());
+            call.profiler = profiler;
+        }
+
+        callee->set_constant_pool(constant_pool_);
+        if (callee_object) {
+            callee->set_callee(callee_object);
+        }
+
+        std::shared_ptr<Object> arguments;
+        if (plan.arguments_object) {
+            arguments = create_arguments_object(activation, callee_object, args);
+        }
+        std::shared_ptr<Object> super_obj;
+        if (plan.super_object) {
+            super_obj = create_super_object(activation, this_obj);
+        }
+        // Registers only borrow these; the callee owns them for the call.
+        callee->set_call_objects(arguments, super_obj);
+
+        if (is_function2_) {
+            auto has = [this](DefineFunction2Flags flag) {
+                return (function2_flags_ & static_cast<uint16_t>(flag)) != 0;
+            };
+            // Preloaded values take registers 1, 2, ... in this order.
+            uint8_t reg = 1;
+            if (has(DefineFunction2Flags::PRELOAD_THIS)) {
+                callee->set_register(reg++, CompactValue::object(this_obj.get()));
+            }
+            if (has(DefineFunction2Flags::PRELOAD_ARGUMENTS)) {
+                callee->set_register(reg++, CompactValue::object(arguments.get()));
+            } else if (!has(DefineFunction2Flags::SUPPRESS_ARGUMENTS)) {
+                scope->force_define_local("arguments", arguments->as_value());
+            }
+            if (has(DefineFunction2Flags::PRELOAD_SUPER)) {
+                callee->set_register(reg++, CompactValue::object(super_obj.get()));
+            } else if (!has(DefineFunction2Flags::SUPPRESS_SUPER)) {
+                scope->force_define_local("super", super_obj->as_value());
+            }
+            if (has(DefineFunction2Flags::PRELOAD_ROOT)) {
+                callee->set_register(reg++, callee->root_object());
+            }
+            if (has(DefineFunction2Flags::PRELOAD_PARENT)) {
+                callee->set_register(reg++, callee->parent_object());
+            }
+            if (has(DefineFunction2Flags::PRELOAD_GLOBAL)) {
+                callee->set_register(reg++, CompactValue::object(
+                    avm.global_scope(context->swf_version())->locals().get()));
+            }
+        } else {
+            scope->force_define_local("arguments", arguments->as_value());
+            scope->force_define_local("super", super_obj->as_value());
+        }
+
+        // Parameters go to their register, or to a local
+        for (size_t i = 0; i < parameters_.size(); ++i) {
+            uint8_t reg = i < param_registers_.size() ? param_registers_[i] : 0;
+            if (reg != 0) {
+                callee->set_register(reg, args[i]);
+            } else {
+                scope->force_define_local(parameters_[i], std::make_shared<Value>(args[i].to_value()));
+            }
+        }
+
+        call.activation = std::move(callee);
+        call.body = std::move(body);
+        return call;
+    }
+
+private:
     // Execute constructor with bytecode
     std::shared_ptr<Value> exec_constructor(
         ExecutionName name,
@@ -228,6 +490,15 @@ public:
     }
 };
 
+inline std::shared_ptr<Value> run_native_tail_call(std::shared_ptr<Activation> activation,
+                                                   NativeTailCall call) {
+    std::shared_ptr<FunctionObject> function = call.function ? call.function->as_function() : nullptr;
+    if (!function) {
+        return std::make_shared<Value>(Value::undefined());
+    }
+    return function->call("[Tail Call]", activation, call.this_obj, call.args);
+}
+
 } // namespace ruffle
 
 #endif // AVM1_FUNCTION_H
\ No newline at end of file
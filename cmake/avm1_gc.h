@@ -0,0 +1,550 @@
+/*
+ * C++ header for the AVM1 garbage collector
+ * Incremental mark-sweep over AVM1 heap objects, with size-class arenas
+ */
+
+#ifndef AVM1_GC_H
+#define AVM1_GC_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace ruffle {
+
+class GcHeap;
+class GcTracer;
+
+// Size-class allocator for AVM1 heap cells.
+//
+// Requests of up to `MAX_SMALL_SIZE` bytes are rounded up to a multiple of
+// `GRANULE` and served from per-class free lists carved out of `CHUNK_SIZE`
+// chunks. Freed blocks go back on their class's free list; chunks are only
+// returned to the system when the arenas are destroyed. Larger requests go
+// to the global allocator.
+class GcArenas {
+public:
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_SMALL_SIZE = 512;
+    static constexpr size_t NUM_CLASSES = MAX_SMALL_SIZE / GRANULE;
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::array<FreeBlock*, NUM_CLASSES> free_lists_{};
+    std::vector<std::unique_ptr<unsigned char[]>> chunks_;
+    unsigned char* bump_ = nullptr;
+    unsigned char* bump_end_ = nullptr;
+    size_t bytes_in_use_ = 0;
+
+    static size_t class_of(size_t size) { return (std::max<size_t>(size, 1) - 1) / GRANULE; }
+
+    unsigned char* carve(size_t block_size) {
+        if (static_cast<size_t>(bump_end_ - bump_) < block_size) {
+            chunks_.push_back(std::make_unique<unsigned char[]>(CHUNK_SIZE));
+            bump_ = chunks_.back().get();
+            bump_end_ = bump_ + CHUNK_SIZE;
+        }
+        unsigned char* block = bump_;
+        bump_ += block_size;
+        return block;
+    }
+
+public:
+    GcArenas() = default;
+    GcArenas(const GcArenas&) = delete;
+    GcArenas& operator=(const GcArenas&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        if (size > MAX_SMALL_SIZE || align > GRANULE) {
+            return ::operator new(size, std::align_val_t(std::max(align, alignof(void*))));
+        }
+        size_t cls = class_of(size);
+        bytes_in_use_ += (cls + 1) * GRANULE;
+        if (FreeBlock* block = free_lists_[cls]) {
+            free_lists_[cls] = block->next;
+            return block;
+        }
+        return carve((cls + 1) * GRANULE);
+    }
+
+    void deallocate(void* ptr, size_t size, size_t align) {
+        if (size > MAX_SMALL_SIZE || align > GRANULE) {
+            ::operator delete(ptr, std::align_val_t(std::max(align, alignof(void*))));
+            return;
+        }
+        size_t cls = class_of(size);
+        bytes_in_use_ -= (cls + 1) * GRANULE;
+        auto* block = static_cast<FreeBlock*>(ptr);
+        block->next = free_lists_[cls];
+        free_lists_[cls] = block;
+    }
+
+    size_t bytes_in_use() const { return bytes_in_use_; }
+    size_t bytes_reserved() const { return chunks_.size() * CHUNK_SIZE; }
+};
+
+// Standard allocator over `GcArenas`, for `std::allocate_shared`. The
+// object and its control block then share one arena block. Each control
+// block keeps the arenas alive, so cells may outlive their heap.
+template<typename T>
+class GcAllocator {
+private:
+    std::shared_ptr<GcArenas> arenas_;
+
+    template<typename U>
+    friend class GcAllocator;
+
+public:
+    using value_type = T;
+
+    explicit GcAllocator(std::shared_ptr<GcArenas> arenas) : arenas_(std::move(arenas)) {}
+    template<typename U>
+    GcAllocator(const GcAllocator<U>& other) : arenas_(other.arenas_) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arenas_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        arenas_->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const GcAllocator<U>& other) const { return arenas_ == other.arenas_; }
+    template<typename U>
+    bool operator!=(const GcAllocator<U>& other) const { return arenas_ != other.arenas_; }
+};
+
+// Base of every object the collector manages.
+//
+// A cell links itself into the current heap (see `GcHeapScope`) when
+// constructed and unlinks when destroyed; cells created while no heap is
+// current are never collected. Ownership stays with `std::shared_ptr`. Collecting a cell
+// means calling `gc_clear`, which drops its outgoing references so that
+// cycles through it are freed by their reference counts.
+class GcCell {
+private:
+    friend class GcHeap;
+
+    GcHeap* gc_heap_;
+    GcCell* gc_prev_ = nullptr;
+    GcCell* gc_next_ = nullptr;
+    uint32_t gc_mark_ = 0;
+
+protected:
+    GcCell();
+
+    // Shade `value`'s object if this cell has already been marked in the
+    // current cycle. Must be called when storing a reference into a cell.
+    template<typename V>
+    void gc_write_barrier(const V& value) const;
+
+    void gc_write_barrier_cell(const GcCell* target) const;
+
+public:
+    GcCell(const GcCell&) = delete;
+    GcCell& operator=(const GcCell&) = delete;
+    virtual ~GcCell();
+
+    // Visit every reference this cell holds to other cells.
+    virtual void gc_trace(GcTracer& tracer) const = 0;
+    // Drop every reference this cell holds. Only called on unreachable cells.
+    virtual void gc_clear() = 0;
+    // A strong reference to this cell, or null if it is not (or no longer)
+    // owned by a `shared_ptr`.
+    virtual std::shared_ptr<GcCell> gc_retain() = 0;
+};
+
+// Marks cells reachable from the references it is given.
+//
+// The visitors are templates so that callers can pass pointers and values
+// of types that are only declared at this point.
+class GcTracer {
+private:
+    friend class GcHeap;
+
+    GcHeap& heap_;
+
+    explicit GcTracer(GcHeap& heap) : heap_(heap) {}
+
+public:
+    void visit_cell(const GcCell* cell);
+
+    template<typename T>
+    void visit(const std::shared_ptr<T>& cell) {
+        visit_cell(cell.get());
+    }
+
+    template<typename T>
+    void visit(const T* cell) {
+        visit_cell(cell);
+    }
+
+    // A `Value` or `CompactValue`.
+    template<typename V>
+    void visit_value(const V& value) {
+        if (value.is_object()) {
+            visit(value.as_object());
+        }
+    }
+
+    // A scope and all of its parents.
+    template<typename S>
+    void visit_scope(const S* scope) {
+        for (; scope; scope = scope->parent().get()) {
+            visit(scope->locals());
+        }
+    }
+};
+
+// Incremental mark-sweep collector for AVM1 heap cells.
+//
+// A cycle marks everything reachable from the roots, then collects every
+// linked cell that was not marked. Both phases run in slices bounded by a
+// time budget, so a cycle is spread over as many frames as it needs.
+//
+// Between slices the mutator keeps running. Cells allocated during a cycle
+// are marked on creation, and stores into marked cells go through
+// `GcCell::gc_write_barrier`, which marks the stored cell. Roots are not
+// barriered; they are traced again before marking completes.
+//
+// Slices must only run while no AVM1 code is on the stack, since native
+// code may hold untraced references in locals. References held by native
+// code across frames must be reachable from a root source or pinned.
+//
+// Each runtime owns its heap. A heap is only current on the thread that
+// entered it, and only while a `GcHeapScope` for it is alive.
+class GcHeap {
+public:
+    using RootSource = std::function<void(GcTracer&)>;
+    using RootSourceId = uint64_t;
+
+    enum class Phase : uint8_t { IDLE, MARK, SWEEP };
+
+    // A cycle starts once this many cells have been allocated since the last
+    // one finished, or the live count at that point, whichever is larger.
+    static constexpr size_t MIN_CYCLE_ALLOCATIONS = 10000;
+    // Cells processed between clock checks.
+    static constexpr size_t WORK_CHUNK = 64;
+
+    struct Stats {
+        size_t cycles = 0;
+        size_t collected = 0;
+        size_t last_live = 0;
+    };
+
+private:
+    std::shared_ptr<GcArenas> arenas_ = std::make_shared<GcArenas>();
+    GcCell* head_ = nullptr;
+    size_t cell_count_ = 0;
+    size_t allocated_since_cycle_ = 0;
+    size_t live_after_cycle_ = 0;
+
+    Phase phase_ = Phase::IDLE;
+    uint32_t mark_epoch_ = 0;
+    std::vector<const GcCell*> gray_;
+    GcCell* sweep_cursor_ = nullptr;
+    std::vector<std::shared_ptr<GcCell>> condemned_;
+    size_t clear_cursor_ = 0;
+
+    std::vector<std::shared_ptr<GcCell>> pinned_;
+    std::vector<std::pair<RootSourceId, RootSource>> root_sources_;
+    RootSourceId next_root_source_ = 0;
+    Stats stats_;
+
+    static GcHeap*& current_slot() {
+        thread_local GcHeap* current = nullptr;
+        return current;
+    }
+
+    friend class GcCell;
+    friend class GcTracer;
+    friend class GcHeapScope;
+
+    void link(GcCell* cell) {
+        cell->gc_next_ = head_;
+        if (head_) {
+            head_->gc_prev_ = cell;
+        }
+        head_ = cell;
+        cell_count_++;
+        allocated_since_cycle_++;
+        // Allocate black: a cell created mid-cycle survives it.
+        if (phase_ != Phase::IDLE) {
+            cell->gc_mark_ = mark_epoch_;
+        }
+    }
+
+    void unlink(GcCell* cell) {
+        if (sweep_cursor_ == cell) {
+            sweep_cursor_ = cell->gc_next_;
+        }
+        if (cell->gc_prev_) {
+            cell->gc_prev_->gc_next_ = cell->gc_next_;
+        } else {
+            head_ = cell->gc_next_;
+        }
+        if (cell->gc_next_) {
+            cell->gc_next_->gc_prev_ = cell->gc_prev_;
+        }
+        cell->gc_prev_ = cell->gc_next_ = nullptr;
+        cell_count_--;
+    }
+
+    bool is_marked(const GcCell* cell) const { return cell->gc_mark_ == mark_epoch_; }
+
+    void shade(const GcCell* cell) {
+        if (cell && cell->gc_heap_ == this && !is_marked(cell)) {
+            const_cast<GcCell*>(cell)->gc_mark_ = mark_epoch_;
+            gray_.push_back(cell);
+        }
+    }
+
+    void trace_roots(const RootSource& roots) {
+        GcTracer tracer(*this);
+        for (const auto& cell : pinned_) {
+            tracer.visit(cell);
+        }
+        for (const auto& [id, source] : root_sources_) {
+            source(tracer);
+        }
+        if (roots) {
+            roots(tracer);
+        }
+    }
+
+    // Returns false if the deadline passed before the gray stack emptied.
+    template<typename Deadline>
+    bool drain_gray(const Deadline& deadline) {
+        GcTracer tracer(*this);
+        while (!gray_.empty()) {
+            for (size_t i = 0; i < WORK_CHUNK && !gray_.empty(); ++i) {
+                const GcCell* cell = gray_.back();
+                gray_.pop_back();
+                cell->gc_trace(tracer);
+            }
+            if (deadline()) {
+                return gray_.empty();
+            }
+        }
+        return true;
+    }
+
+    void begin_cycle(const RootSource& roots) {
+        // Zero marks "never marked", so skip it on wraparound.
+        if (++mark_epoch_ == 0) {
+            mark_epoch_ = 1;
+        }
+        phase_ = Phase::MARK;
+        trace_roots(roots);
+    }
+
+    void finish_mark(const RootSource& roots) {
+        // Roots are not barriered, so trace them again and finish marking
+        // without a budget; only what changed since the last slice is left.
+        trace_roots(roots);
+        drain_gray([] { return false; });
+        phase_ = Phase::SWEEP;
+        sweep_cursor_ = head_;
+        clear_cursor_ = 0;
+    }
+
+    template<typename Deadline>
+    bool sweep(const Deadline& deadline) {
+        // Retain the condemned cells first, so clearing one cannot free
+        // another out from under the walk.
+        while (sweep_cursor_) {
+            for (size_t i = 0; i < WORK_CHUNK && sweep_cursor_; ++i) {
+                GcCell* cell = sweep_cursor_;
+                sweep_cursor_ = cell->gc_next_;
+                if (!is_marked(cell)) {
+                    if (auto retained = cell->gc_retain()) {
+                        condemned_.push_back(std::move(retained));
+                    }
+                }
+            }
+            if (deadline()) {
+                return false;
+            }
+        }
+        while (clear_cursor_ < condemned_.size()) {
+            size_t end = std::min(clear_cursor_ + WORK_CHUNK, condemned_.size());
+            for (; clear_cursor_ < end; ++clear_cursor_) {
+                condemned_[clear_cursor_]->gc_clear();
+            }
+            if (deadline()) {
+                return false;
+            }
+        }
+        stats_.cycles++;
+        stats_.collected += condemned_.size();
+        condemned_.clear();
+        condemned_.shrink_to_fit();
+        clear_cursor_ = 0;
+        phase_ = Phase::IDLE;
+        live_after_cycle_ = cell_count_;
+        stats_.last_live = cell_count_;
+        allocated_since_cycle_ = 0;
+        return true;
+    }
+
+public:
+    GcHeap() = default;
+    GcHeap(const GcHeap&) = delete;
+    GcHeap& operator=(const GcHeap&) = delete;
+
+    ~GcHeap() {
+        condemned_.clear();
+        pinned_.clear();
+        for (GcCell* cell = head_; cell; cell = cell->gc_next_) {
+            cell->gc_heap_ = nullptr;
+        }
+        if (current_slot() == this) {
+            current_slot() = nullptr;
+        }
+    }
+
+    // The heap new cells on this thread are linked into, if any.
+    static GcHeap* current() { return current_slot(); }
+
+    // Allocate a `T` (a `GcCell`) from the arenas.
+    template<typename T, typename... Args>
+    std::shared_ptr<T> allocate(Args&&... args) {
+        return std::allocate_shared<T>(GcAllocator<T>(arenas_), std::forward<Args>(args)...);
+    }
+
+    // Keep `cell` alive until unpinned.
+    void pin(std::shared_ptr<GcCell> cell) { pinned_.push_back(std::move(cell)); }
+
+    void unpin(const GcCell* cell) {
+        auto it = std::find_if(pinned_.begin(), pinned_.end(),
+                               [cell](const auto& pinned) { return pinned.get() == cell; });
+        if (it != pinned_.end()) {
+            pinned_.erase(it);
+        }
+    }
+
+    // Register roots held outside the runtime, such as the display list's
+    // script objects. The source must be removed before what it traces is
+    // destroyed.
+    RootSourceId add_root_source(RootSource source) {
+        RootSourceId id = ++next_root_source_;
+        root_sources_.emplace_back(id, std::move(source));
+        return id;
+    }
+
+    void remove_root_source(RootSourceId id) {
+        auto it = std::find_if(root_sources_.begin(), root_sources_.end(),
+                               [id](const auto& source) { return source.first == id; });
+        if (it != root_sources_.end()) {
+            root_sources_.erase(it);
+        }
+    }
+
+    bool should_collect() const {
+        return phase_ != Phase::IDLE ||
+               allocated_since_cycle_ >= std::max(MIN_CYCLE_ALLOCATIONS, live_after_cycle_);
+    }
+
+    // Run collection work for at most about `budget`, starting a cycle if
+    // enough has been allocated. `roots` enumerates the caller's roots.
+    // Returns true if a cycle completed.
+    bool step(std::chrono::microseconds budget, const RootSource& roots) {
+        if (!should_collect()) {
+            return false;
+        }
+        auto deadline_at = std::chrono::steady_clock::now() + budget;
+        auto deadline = [deadline_at] { return std::chrono::steady_clock::now() >= deadline_at; };
+
+        if (phase_ == Phase::IDLE) {
+            begin_cycle(roots);
+        }
+        if (phase_ == Phase::MARK) {
+            if (!drain_gray(deadline)) {
+                return false;
+            }
+            finish_mark(roots);
+        }
+        return sweep(deadline);
+    }
+
+    // Run a whole cycle, finishing any cycle already in progress first.
+    void collect(const RootSource& roots) {
+        auto never = [] { return false; };
+        if (phase_ == Phase::IDLE) {
+            begin_cycle(roots);
+        }
+        if (phase_ == Phase::MARK) {
+            drain_gray(never);
+            finish_mark(roots);
+        }
+        sweep(never);
+    }
+
+    Phase phase() const { return phase_; }
+    bool is_marking() const { return phase_ == Phase::MARK; }
+    size_t cell_count() const { return cell_count_; }
+    const Stats& stats() const { return stats_; }
+    const GcArenas& arenas() const { return *arenas_; }
+};
+
+// Makes `heap` current on this thread for the lifetime of the scope, so
+// that cells created meanwhile belong to it. Scopes nest; the previously
+// current heap is restored on exit.
+class GcHeapScope {
+private:
+    GcHeap* previous_;
+
+public:
+    explicit GcHeapScope(GcHeap& heap) : previous_(GcHeap::current()) {
+        GcHeap::current_slot() = &heap;
+    }
+    GcHeapScope(const GcHeapScope&) = delete;
+    GcHeapScope& operator=(const GcHeapScope&) = delete;
+
+    ~GcHeapScope() { GcHeap::current_slot() = previous_; }
+};
+
+inline void GcTracer::visit_cell(const GcCell* cell) {
+    heap_.shade(cell);
+}
+
+inline GcCell::GcCell() : gc_heap_(GcHeap::current()) {
+    if (gc_heap_) {
+        gc_heap_->link(this);
+    }
+}
+
+inline GcCell::~GcCell() {
+    if (gc_heap_) {
+        gc_heap_->unlink(this);
+    }
+}
+
+inline void GcCell::gc_write_barrier_cell(const GcCell* target) const {
+    if (gc_heap_ && gc_heap_->is_marking() && gc_heap_->is_marked(this)) {
+        gc_heap_->shade(target);
+    }
+}
+
+template<typename V>
+void GcCell::gc_write_barrier(const V& value) const {
+    if (gc_heap_ && gc_heap_->is_marking() && value && value->is_object()) {
+        gc_write_barrier_cell(value->as_object().get());
+    }
+}
+
+} // namespace ruffle
+
+#endif // AVM1_GC_H
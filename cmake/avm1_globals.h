@@ -11,8 +11,12 @@
 #include "avm1/object.h"
 #include "avm1/activation.h"
 #include "avm1/error.h"
+#include "avm1/string_kernels.h"
+#include "timer.h"
 #include <functional>
+#include <initializer_list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -59,78 +63,18 @@ public:
     // Parse integer from string
     static std::shared_ptr<Value> parse_int(std::shared_ptr<Activation> activation,
                                           const std::vector<std::shared_ptr<Value>>& args) {
+        // Flash returns undefined rather than NaN when called without arguments
         if (args.empty()) {
             return std::make_shared<Value>(Value::UNDEFINED);
         }
 
-        std::string str = args[0]->coerce_to_string(activation);
-        
-        // Get radix if provided
-        int radix = 10;
+        // An explicit radix is checked before the string is coerced
+        std::optional<int32_t> radix;
         if (args.size() > 1) {
-            radix = static_cast<int>(args[1]->coerce_to_number(activation));
-            if (radix < 2 || radix > 36) {
-                return std::make_shared<Value>(std::numeric_limits<double>::quiet_NaN());
-            }
-        }
-
-        // Handle hex prefix
-        size_t start_pos = 0;
-        if (radix == 0) {
-            if (str.length() >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
-                radix = 16;
-                start_pos = 2;
-            } else {
-                radix = 10; // Default
-            }
-        } else if (radix == 16) {
-            if (str.length() >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
-                start_pos = 2;
-            }
-        }
-
-        // Skip whitespace
-        while (start_pos < str.length() && isspace(str[start_pos])) {
-            start_pos++;
-        }
-
-        // Handle sign
-        bool negative = false;
-        if (start_pos < str.length() && (str[start_pos] == '+' || str[start_pos] == '-')) {
-            negative = (str[start_pos] == '-');
-            start_pos++;
-        }
-
-        // Parse digits
-        double result = 0.0;
-        bool has_digits = false;
-        for (size_t i = start_pos; i < str.length(); ++i) {
-            char c = str[i];
-            int digit;
-            
-            if (c >= '0' && c <= '9') {
-                digit = c - '0';
-            } else if (c >= 'a' && c <= 'z') {
-                digit = c - 'a' + 10;
-            } else if (c >= 'A' && c <= 'Z') {
-                digit = c - 'A' + 10;
-            } else {
-                break; // Stop at first invalid character
-            }
-            
-            if (digit >= radix) {
-                break; // Stop at first invalid digit for this radix
-            }
-            
-            result = result * radix + digit;
-            has_digits = true;
-        }
-
-        if (!has_digits) {
-            return std::make_shared<Value>(std::numeric_limits<double>::quiet_NaN());
+            radix = args[1]->coerce_to_i32(activation);
         }
-
-        return std::make_shared<Value>(negative ? -result : result);
+        std::string str = args[0]->coerce_to_string(activation);
+        return std::make_shared<Value>(avm1_parse_int(str, radix));
     }
 
     // Get infinity value based on SWF version
@@ -159,23 +103,9 @@ public:
         if (args.empty()) {
             return std::make_shared<Value>(Value::UNDEFINED);
         }
-        
+
         std::string str = args[0]->coerce_to_string(activation);
-        
-        // Simple float parsing
-        try {
-            size_t pos;
-            double result = std::stod(str, &pos);
-            // If we consumed the entire string, return the result
-            if (pos == str.length()) {
-                return std::make_shared<Value>(result);
-            } else {
-                // If there are remaining characters, return NaN
-                return std::make_shared<Value>(std::numeric_limits<double>::quiet_NaN());
-            }
-        } catch (...) {
-            return std::make_shared<Value>(std::numeric_limits<double>::quiet_NaN());
-        }
+        return std::make_shared<Value>(avm1_parse_float(str));
     }
 
     // Set interval function (for timers)
@@ -198,7 +128,7 @@ public:
         }
         
         int32_t id = static_cast<int32_t>(args[0]->coerce_to_number(activation));
-        activation->context()->timers.remove(id);
+        activation->context()->timers->remove(id);
         
         return std::make_shared<Value>(Value::UNDEFINED);
     }
@@ -216,25 +146,12 @@ public:
         if (args.empty()) {
             return std::make_shared<Value>(Value::UNDEFINED);
         }
-        
+
         std::string str = args[0]->coerce_to_string(activation);
-        std::string result;
-        
-        for (unsigned char c : str) {
-            // Characters that don't need escaping
-            if ((c >= '0' && c <= '9') || 
-                (c >= 'A' && c <= 'Z') || 
-                (c >= 'a' && c <= 'z')) {
-                result += static_cast<char>(c);
-            } else {
-                // Escape the character
-                char buffer[4];
-                snprintf(buffer, sizeof(buffer), "%%%02X", c);
-                result += buffer;
-            }
+        if (auto escaped = avm1_escape(str)) {
+            return std::make_shared<Value>(std::move(*escaped));
         }
-        
-        return std::make_shared<Value>(result);
+        return std::make_shared<Value>(std::move(str));
     }
 
     // Unescape function for URL decoding
@@ -243,31 +160,47 @@ public:
         if (args.empty()) {
             return std::make_shared<Value>(Value::UNDEFINED);
         }
-        
+
         std::string str = args[0]->coerce_to_string(activation);
-        std::string result;
-        
-        for (size_t i = 0; i < str.length(); ++i) {
-            if (str[i] == '%' && i + 2 < str.length()) {
-                // Try to parse the hex value
-                char hex_str[3] = {str[i+1], str[i+2], '\0'};
-                char* end_ptr;
-                long val = strtol(hex_str, &end_ptr, 16);
-                
-                if (*end_ptr == '\0') {  // Successfully parsed
-                    result += static_cast<char>(val);
-                    i += 2;  // Skip the next two characters
-                } else {
-                    result += str[i];  // Not a valid hex sequence
-                }
-            } else if (str[i] == '+') {
-                result += ' ';  // Convert + to space
-            } else {
-                result += str[i];
+        if (auto unescaped = avm1_unescape(str)) {
+            return std::make_shared<Value>(std::move(*unescaped));
+        }
+        return std::make_shared<Value>(std::move(str));
+    }
+
+    // Function.prototype.call: call `this` with the first argument as its
+    // `this` and the rest as its arguments. The call is left to the caller
+    // as a tail call, so a bytecode function runs on the interpreter.
+    static std::shared_ptr<Value> function_call(std::shared_ptr<Activation> activation,
+                                                std::shared_ptr<Object> this_obj,
+                                                const std::vector<std::shared_ptr<Value>>& args) {
+        std::shared_ptr<Object> call_this = args.empty() ? nullptr : args[0]->as_object();
+        std::vector<std::shared_ptr<Value>> params;
+        if (args.size() > 1) {
+            params.assign(args.begin() + 1, args.end());
+        }
+        activation->tail_call(std::move(this_obj), std::move(call_this), std::move(params));
+        return std::make_shared<Value>(Value::UNDEFINED);
+    }
+
+    // Function.prototype.apply: like `call`, with the arguments taken from
+    // the array-like second argument.
+    static std::shared_ptr<Value> function_apply(std::shared_ptr<Activation> activation,
+                                                 std::shared_ptr<Object> this_obj,
+                                                 const std::vector<std::shared_ptr<Value>>& args) {
+        std::shared_ptr<Object> call_this = args.empty() ? nullptr : args[0]->as_object();
+        std::vector<std::shared_ptr<Value>> params;
+        std::shared_ptr<Object> array = args.size() > 1 ? args[1]->as_object() : nullptr;
+        if (array) {
+            auto length = array->get("length", activation);
+            double count = length ? length->coerce_to_number(activation) : 0.0;
+            for (int32_t i = 0; i < count; ++i) {
+                auto element = array->get(std::to_string(i), activation);
+                params.push_back(element ? element : std::make_shared<Value>(Value::UNDEFINED));
             }
         }
-        
-        return std::make_shared<Value>(result);
+        activation->tail_call(std::move(this_obj), std::move(call_this), std::move(params));
+        return std::make_shared<Value>(Value::UNDEFINED);
     }
 
 private:
@@ -275,18 +208,28 @@ private:
     static std::shared_ptr<Value> create_timer(std::shared_ptr<Activation> activation,
                                              const std::vector<std::shared_ptr<Value>>& args,
                                              bool is_timeout) {
-        if (args.size() < 2) {
+        if (args.size() < 2 || !args[0]->is_object()) {
             return std::make_shared<Value>(Value::UNDEFINED);
         }
-        
-        // In a real implementation, this would create a timer and return its ID
-        // For now, we'll return a dummy ID
-        int32_t interval = static_cast<int32_t>(args[1]->coerce_to_number(activation));
-        
-        // Create a timer callback based on the first argument
-        // This would be more complex in a real implementation
-        int32_t timer_id = activation->context()->timers.add_timer(interval, is_timeout);
-        
+
+        // Either (function, interval, ...) or (object, "method", interval, ...)
+        auto object = args[0]->as_object();
+        std::optional<TimerCallback> callback;
+        size_t interval_index = 1;
+        if (object->is_function()) {
+            callback = TimerCallback::avm1_function(object);
+        } else if (args.size() >= 3) {
+            callback = TimerCallback::avm1_method(object, args[1]->coerce_to_string(activation));
+            interval_index = 2;
+        } else {
+            return std::make_shared<Value>(Value::UNDEFINED);
+        }
+
+        int32_t interval = static_cast<int32_t>(args[interval_index]->coerce_to_number(activation));
+        std::vector<std::shared_ptr<Value>> params(args.begin() + interval_index + 1, args.end());
+        int32_t timer_id = activation->context()->timers->add_timer(
+            std::move(*callback), interval, std::move(params), is_timeout);
+
         return std::make_shared<Value>(static_cast<double>(timer_id));
     }
 };
@@ -325,6 +268,21 @@ struct SystemPrototypes {
     std::shared_ptr<Object> convolution_filter;
     std::shared_ptr<Object> gradient_bevel_filter;
     std::shared_ptr<Object> gradient_glow_filter;
+
+    // Garbage collection roots
+    void gc_trace(GcTracer& tracer) const {
+        for (const auto* prototype : {
+            &button, &object, &object_constructor, &function, &movie_clip, &text_field,
+            &text_format, &array, &array_constructor, &xml_node_constructor, &xml_constructor,
+            &matrix_constructor, &point_constructor, &rectangle, &rectangle_constructor,
+            &transform_constructor, &shared_object_constructor, &color_transform_constructor,
+            &context_menu_constructor, &context_menu_item_constructor, &date_constructor,
+            &bitmap_data, &video, &blur_filter, &bevel_filter, &glow_filter,
+            &drop_shadow_filter, &color_matrix_filter, &displacement_map_filter,
+            &convolution_filter, &gradient_bevel_filter, &gradient_glow_filter}) {
+            tracer.visit(*prototype);
+        }
+    }
 };
 
 // Constants for AVM depth handling
@@ -0,0 +1,12 @@
+/*
+ * C++ implementation for the AVM1 interpreter
+ * Instantiates `Interpreter` for the runtime's `Activation`
+ */
+
+#include "avm1/runtime.h"
+
+namespace ruffle {
+
+template class Interpreter<Activation>;
+
+} // namespace ruffle
@@ -0,0 +1,1093 @@
+/*
+ * C++ header for the AVM1 interpreter loop
+ * Threaded dispatch over pre-decoded action blocks
+ */
+
+#ifndef AVM1_INTERPRETER_H
+#define AVM1_INTERPRETER_H
+
+#include "avm1/activation.h"
+#include "avm1/bytecode.h"
+#include "avm1/compact_value.h"
+#include "avm1/error.h"
+#include "execution_limit.h"
+#include "avm1/atom.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Use computed goto ("labels as values") where the compiler supports it.
+// Each handler then ends in its own indirect jump, which gives the branch
+// predictor one history per opcode instead of a single shared switch.
+#if !defined(AVM1_NO_THREADED_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+#define AVM1_THREADED_DISPATCH 1
+#endif
+
+namespace ruffle {
+
+// Counts executed opcode pairs, to find sequences worth fusing.
+//
+// Superinstructions are counted as the opcodes they replace, so a profile
+// taken with fusion enabled still reports the original pairs.
+class OpcodePairCounter {
+public:
+    struct Pair {
+        uint8_t first;
+        uint8_t second;
+        uint64_t count;
+    };
+
+private:
+    std::unique_ptr<std::array<uint64_t, 256 * 256>> counts_;
+    // Executions of each opcode, counted as pairs are recorded.
+    std::array<uint64_t, 256> opcodes_;
+    uint64_t total_;
+
+public:
+    OpcodePairCounter()
+        : counts_(std::make_unique<std::array<uint64_t, 256 * 256>>()), opcodes_{}, total_(0) {
+        counts_->fill(0);
+    }
+
+    void record(uint8_t first, uint8_t second) {
+        (*counts_)[(static_cast<size_t>(first) << 8) | second]++;
+        opcodes_[second]++;
+        total_++;
+    }
+
+    uint64_t count(OpCode first, OpCode second) const {
+        return (*counts_)[(static_cast<size_t>(first) << 8) | static_cast<uint8_t>(second)];
+    }
+
+    uint64_t total() const { return total_; }
+
+    // Executions of each opcode.
+    const std::array<uint64_t, 256>& opcode_counts() const { return opcodes_; }
+
+    // The `limit` most frequent pairs, most frequent first.
+    std::vector<Pair> top_pairs(size_t limit) const {
+        std::vector<Pair> pairs;
+        for (size_t i = 0; i < counts_->size(); ++i) {
+            if ((*counts_)[i] != 0) {
+                pairs.push_back({static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i & 0xFF),
+                                 (*counts_)[i]});
+            }
+        }
+        std::sort(pairs.begin(), pairs.end(),
+                  [](const Pair& a, const Pair& b) { return a.count > b.count; });
+        if (pairs.size() > limit) {
+            pairs.resize(limit);
+        }
+        return pairs;
+    }
+
+    void clear() {
+        counts_->fill(0);
+        opcodes_.fill(0);
+        total_ = 0;
+    }
+};
+
+// Opcodes with an inline handler in the interpreter loop. Every other
+// opcode goes through `Host::run_action`.
+#define AVM1_INLINE_HANDLERS(X) \
+    X(End) \
+    X(Push) \
+    X(Pop) \
+    X(Add) \
+    X(Add2) \
+    X(Subtract) \
+    X(Multiply) \
+    X(Divide) \
+    X(Modulo) \
+    X(Increment) \
+    X(Decrement) \
+    X(Less) \
+    X(Less2) \
+    X(Greater) \
+    X(Equals) \
+    X(Equals2) \
+    X(StrictEquals) \
+    X(Not) \
+    X(BitAnd) \
+    X(BitOr) \
+    X(BitXor) \
+    X(BitLShift) \
+    X(BitRShift) \
+    X(BitURShift) \
+    X(PushDuplicate) \
+    X(StackSwap) \
+    X(StoreRegister) \
+    X(Jump) \
+    X(If) \
+    X(Return) \
+    X(GetVariable) \
+    X(SetVariable) \
+    X(GetMember) \
+    X(SetMember) \
+    X(Enumerate) \
+    X(Enumerate2) \
+    X(ConstantPool) \
+    X(Try) \
+    X(Unknown) \
+    X(PushGetVariable) \
+    X(PushGetMember) \
+    X(PushPushAdd2)
+
+enum class HandlerId : uint8_t {
+    Slow,
+#define AVM1_HANDLER_ID(name) name,
+    AVM1_INLINE_HANDLERS(AVM1_HANDLER_ID)
+#undef AVM1_HANDLER_ID
+};
+
+// Maps each action code to its handler.
+constexpr std::array<uint8_t, 256> make_handler_table() {
+    std::array<uint8_t, 256> table{};
+#define AVM1_HANDLER_ENTRY(name) \
+    table[static_cast<uint8_t>(OpCode::name)] = static_cast<uint8_t>(HandlerId::name);
+    AVM1_INLINE_HANDLERS(AVM1_HANDLER_ENTRY)
+#undef AVM1_HANDLER_ENTRY
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> HANDLER_TABLE = make_handler_table();
+
+// The AVM1 interpreter loop.
+//
+// `Host` is the executing activation. It must provide:
+//
+//   void push(CompactValue);
+//   CompactValue pop();
+//   CompactValue peek() const;
+//   CompactValue get_register(uint8_t) const;
+//   void set_register(uint8_t, CompactValue);
+//   uint8_t swf_version() const;
+//   Avm1AtomTable& atoms();
+//   Avm1Atom own_string(std::string text);
+//   std::optional<Avm1Atom> constant_pool_entry(uint16_t index) const;
+//   void set_constant_pool(std::shared_ptr<const std::vector<Avm1Atom>> pool);
+//   CompactValue get_variable(CompactValue path);
+//   void set_variable(CompactValue path, CompactValue value);
+//   CompactValue get_member(CompactValue object, CompactValue name, PropertyCache&);
+//   void set_member(CompactValue object, CompactValue name, CompactValue value,
+//                   PropertyCache&);
+//   void push_enumeration(CompactValue object);
+//   FrameControl run_action(const Instruction&, const DecodedActions&, uint32_t& next_pc);
+//   size_t stack_len() const;
+//   Scope take_outer_scope();
+//   void set_scope(Scope);
+//   bool catch_exception(const TryBlock&, const Avm1Exception&, size_t stack_base);
+//   ExecutionLimit& execution_limit();
+//   Host* begin_call(const DecodedActions*& body);
+//   void end_call(Host* callee, std::optional<CompactValue> result);
+//   void abort_call(Host* callee) noexcept;
+//
+// Blocks must be bound to the host's atom table, as the runtime's
+// `BytecodeCache` binds every block it decodes (`DecodedActions::bind_atoms`),
+// so pushing a string or a constant yields an atom that property lookups
+// compare by pointer.
+//
+// Enumerate and Enumerate2 hand the object to `push_enumeration`, which
+// pushes `undefined` as the end marker and then each for..in key straight
+// from a `KeyEnumerator`; no list of key strings is built, and keys that
+// aren't interned yet are pushed as owned strings.
+//
+// Inline handlers only cover primitive operands. Whenever an operand is an
+// object (and so may need `valueOf`/`toString`), or an opcode has no inline
+// handler at all, the instruction is handed to `run_action`, which
+// implements the full semantics of every opcode. `run_action` receives the
+// index of the following instruction and may change it to branch; it
+// returns `FrameControl::RETURN` to stop the block.
+//
+// Concatenation results are not interned: `own_string` makes a string
+// owned by the value stack, freed once no slot refers to it.
+//
+// Calls to bytecode functions do not recurse. `run_action` sets the call
+// up and returns `FrameControl::CALL`; the loop then asks the caller for
+// the callee with `begin_call`, suspends the caller on a heap-allocated
+// frame stack and runs the callee's body. When the callee returns, the
+// caller gets its result through `end_call`, which also releases the
+// callee, and resumes after the call. If an exception unwinds the loop,
+// each suspended caller gets `abort_call` instead. Script recursion
+// therefore uses no native stack; only natives that call back into
+// script nest `run` calls.
+//
+// With and Try statements don't nest either. Their bodies run in the loop
+// as regions of the host's code, recorded on the same frame stack. A With
+// enters its region once `run_action` has replaced the scope and returned
+// `FrameControl::WITH`; leaving the body by any path, including a return
+// or an exception, restores the scope from `take_outer_scope`. A Try
+// region moves through its try, catch and finally blocks as control leaves
+// each one. An exception thrown inside a Try is offered to
+// `catch_exception`, which binds the thrown value for the catch block. A
+// return or exception that leaves a Try with a finally block waits for that
+// block to fall through before it goes on.
+//
+// Every instruction is charged to the host's `ExecutionLimit`, a
+// superinstruction as the opcodes it replaces, and the limit is checked at
+// backward branches; calls check it on entry. Exceeding it
+// throws an execution timeout.
+template<typename Host>
+class Interpreter {
+private:
+    static bool is_primitive(CompactValue v) { return v.is_primitive(); }
+
+    static double to_number(Host& host, CompactValue v) {
+        switch (v.type()) {
+            case ValueType::NUMBER: return v.as_number();
+            case ValueType::UNDEFINED:
+            case ValueType::NULL_VAL:
+                return host.swf_version() >= 7 ? std::numeric_limits<double>::quiet_NaN() : 0.0;
+            default: return v.as_number();
+        }
+    }
+
+    // Flash 4-style numeric coercion: everything non-numeric becomes 0.
+    static double to_number_v1(CompactValue v) {
+        double n = v.as_number();
+        return std::isnan(n) && !v.is_number() ? 0.0 : n;
+    }
+
+    static bool to_bool(Host& host, CompactValue v) {
+        if (v.is_string() && host.swf_version() < 7) {
+            double n = v.as_number();
+            return n != 0.0 && !std::isnan(n);
+        }
+        return v.as_bool();
+    }
+
+    static std::string to_string(Host& host, CompactValue v) {
+        if (v.is_undefined() && host.swf_version() < 7) {
+            return std::string();
+        }
+        return v.as_string();
+    }
+
+    // ECMA-262 ToInt32.
+    static int32_t to_int32(double n) {
+        if (!std::isfinite(n)) {
+            return 0;
+        }
+        double m = std::fmod(std::trunc(n), 4294967296.0);
+        if (m < 0) m += 4294967296.0;
+        return static_cast<int32_t>(static_cast<uint32_t>(m));
+    }
+
+    static CompactValue from_bool(Host& host, bool b) {
+        // SWFv4 represents booleans as numbers.
+        if (host.swf_version() < 5) {
+            return CompactValue::number(b ? 1.0 : 0.0);
+        }
+        return CompactValue::boolean(b);
+    }
+
+    static CompactValue push_item(Host& host, const DecodedActions& actions, const PushItem& item) {
+        switch (item.kind) {
+            case PushKind::STRING:
+                return CompactValue::string(actions.string_atoms[item.index]);
+            case PushKind::DOUBLE: return CompactValue::number(item.number);
+            case PushKind::NULL_VAL: return CompactValue::null();
+            case PushKind::REGISTER: return host.get_register(static_cast<uint8_t>(item.index));
+            case PushKind::BOOLEAN: return CompactValue::boolean(item.boolean);
+            case PushKind::CONSTANT16: {
+                auto entry = host.constant_pool_entry(static_cast<uint16_t>(item.index));
+                return entry ? CompactValue::string(*entry) : CompactValue::undefined();
+            }
+            default: return CompactValue::undefined();
+        }
+    }
+
+    static void push_items(Host& host, const DecodedActions& actions, uint32_t first, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            host.push(push_item(host, actions, actions.push_items[first + i]));
+        }
+    }
+
+    // Add2 on primitives: string concatenation if either side is a string.
+    static CompactValue add2(Host& host, CompactValue a, CompactValue b) {
+        if (a.is_string() || b.is_string()) {
+            std::string s = to_string(host, a);
+            s += to_string(host, b);
+            return CompactValue::string(host.own_string(std::move(s)));
+        }
+        return CompactValue::number(to_number(host, a) + to_number(host, b));
+    }
+
+    // Abstract relational comparison `a < b` on primitives. Returns
+    // `undefined` if either side is NaN.
+    static CompactValue less2(Host& host, CompactValue a, CompactValue b) {
+        if (a.is_string() && b.is_string()) {
+            return CompactValue::boolean(a.as_atom().view() < b.as_atom().view());
+        }
+        double x = to_number(host, a);
+        double y = to_number(host, b);
+        if (std::isnan(x) || std::isnan(y)) {
+            return CompactValue::undefined();
+        }
+        return CompactValue::boolean(x < y);
+    }
+
+    // Abstract equality on primitives.
+    static bool equals2(Host& host, CompactValue a, CompactValue b) {
+        bool a_nullish = a.is_undefined() || a.is_null();
+        bool b_nullish = b.is_undefined() || b.is_null();
+        if (a_nullish || b_nullish) {
+            return a_nullish && b_nullish;
+        }
+        if (a.type() == b.type()) {
+            if (a.is_number()) return a.as_number() == b.as_number();
+            return a == b;
+        }
+        return to_number(host, a) == to_number(host, b);
+    }
+
+    static bool strict_equals(CompactValue a, CompactValue b) {
+        if (a.is_number() && b.is_number()) {
+            return a.as_number() == b.as_number();
+        }
+        return a == b;
+    }
+
+    // A caller suspended while one of its calls runs.
+    struct CallerFrame {
+        Host* host;
+        const DecodedActions* actions;
+        // Where the caller resumes.
+        uint32_t pc;
+    };
+
+    using Scope = decltype(std::declval<Host&>().take_outer_scope());
+
+    enum class RegionStage : uint8_t { WITH, TRY, CATCH, FINALLY };
+
+    // A With or Try statement whose body is running.
+    struct RegionFrame {
+        // Number of suspended callers when the statement began, which
+        // identifies the host it belongs to.
+        size_t depth = 0;
+        RegionStage stage = RegionStage::WITH;
+        // The block running now, as instruction indices [begin, end).
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        // Null for a With.
+        const TryBlock* try_block = nullptr;
+        // The With's enclosing scope.
+        Scope outer_scope;
+        // The host's operand count at the Try, restored for its catch block.
+        size_t stack_base = 0;
+        // Where to continue once the finally block falls through.
+        uint32_t resume = 0;
+        // A return or exception held until the finally block has run.
+        bool returning = false;
+        std::optional<CompactValue> return_value;
+        std::exception_ptr exception;
+
+        static RegionFrame with_body(size_t depth, uint32_t begin, uint32_t end, Scope outer) {
+            RegionFrame region;
+            region.depth = depth;
+            region.enter(RegionStage::WITH, begin, end);
+            region.outer_scope = std::move(outer);
+            return region;
+        }
+
+        static RegionFrame try_body(size_t depth, uint32_t begin, const TryBlock& block,
+                                    size_t stack_base) {
+            RegionFrame region;
+            region.depth = depth;
+            region.enter(RegionStage::TRY, begin, block.try_end);
+            region.try_block = &block;
+            region.stack_base = stack_base;
+            return region;
+        }
+
+        void enter(RegionStage next, uint32_t next_begin, uint32_t next_end) {
+            stage = next;
+            begin = next_begin;
+            end = next_end;
+        }
+    };
+
+    // The frames of one `execute`. If an exception leaves the loop, the
+    // calls still in progress are abandoned innermost first.
+    class CallStack {
+    private:
+        std::vector<CallerFrame> frames_;
+        std::vector<RegionFrame> regions_;
+        Host*& current_;
+
+    public:
+        explicit CallStack(Host*& current) : current_(current) {}
+
+        ~CallStack() {
+            while (!frames_.empty()) {
+                CallerFrame caller = frames_.back();
+                frames_.pop_back();
+                caller.host->abort_call(current_);
+                current_ = caller.host;
+            }
+        }
+
+        CallStack(const CallStack&) = delete;
+        CallStack& operator=(const CallStack&) = delete;
+
+        bool empty() const { return frames_.empty(); }
+        size_t depth() const { return frames_.size(); }
+        void push(const CallerFrame& frame) { frames_.push_back(frame); }
+
+        CallerFrame pop() {
+            CallerFrame frame = frames_.back();
+            frames_.pop_back();
+            return frame;
+        }
+
+        // Whether the running host is inside a With or Try.
+        bool in_region() const { return !regions_.empty() && regions_.back().depth == frames_.size(); }
+        bool has_regions() const { return !regions_.empty(); }
+        RegionFrame& region() { return regions_.back(); }
+        void push_region(RegionFrame region) { regions_.push_back(std::move(region)); }
+        void pop_region() { regions_.pop_back(); }
+    };
+
+    template<bool Profile>
+    static std::optional<CompactValue> execute(Host& entry_host, const DecodedActions& entry_actions,
+                                               OpcodePairCounter* counter) {
+        Host* host = &entry_host;
+        const DecodedActions* actions = &entry_actions;
+        const Instruction* code = actions->code.data();
+        uint32_t pc = 0;
+        const Instruction* insn = nullptr;
+        uint8_t prev_op = static_cast<uint8_t>(OpCode::End);
+        ExecutionLimit& limit = host->execution_limit();
+        CallStack calls(host);
+        std::optional<CompactValue> result;
+
+        // The block the running host's innermost region is in, as
+        // [region_begin, region_begin + region_span); everything when the
+        // host is in no region. Leaving it is checked on every fetch.
+        uint32_t region_begin = 0;
+        uint32_t region_span = std::numeric_limits<uint32_t>::max();
+        auto update_region = [&]() {
+            if (calls.in_region()) {
+                const RegionFrame& region = calls.region();
+                region_begin = region.begin;
+                region_span = region.end > region.begin ? region.end - region.begin : 0;
+            } else {
+                region_begin = 0;
+                region_span = std::numeric_limits<uint32_t>::max();
+            }
+        };
+
+        // Unwind an exception to the innermost Try that handles it: one that
+        // catches it, or has a finally block to run first. With scopes are
+        // restored and calls abandoned on the way. Returns false if nothing
+        // handles it.
+        auto unwind = [&](const Avm1Exception* error, std::exception_ptr exception) -> bool {
+            while (calls.has_regions()) {
+                RegionFrame& region = calls.region();
+                while (calls.depth() > region.depth) {
+                    CallerFrame caller = calls.pop();
+                    caller.host->abort_call(host);
+                    host = caller.host;
+                    actions = caller.actions;
+                    code = actions->code.data();
+                }
+                const TryBlock* block = region.try_block;
+                switch (region.stage) {
+                    case RegionStage::WITH:
+                        host->set_scope(std::move(region.outer_scope));
+                        break;
+                    case RegionStage::TRY:
+                        if (error && host->catch_exception(*block, *error, region.stack_base)) {
+                            region.enter(RegionStage::CATCH, *block->catch_start, block->catch_end);
+                            pc = region.begin;
+                            update_region();
+                            return true;
+                        }
+                        [[fallthrough]];
+                    case RegionStage::CATCH:
+                        if (block->finally_start) {
+                            region.exception = std::move(exception);
+                            region.enter(RegionStage::FINALLY, *block->finally_start, block->finally_end);
+                            pc = region.begin;
+                            update_region();
+                            return true;
+                        }
+                        break;
+                    case RegionStage::FINALLY:
+                        break;
+                }
+                calls.pop_region();
+            }
+            update_region();
+            return false;
+        };
+
+#ifdef AVM1_THREADED_DISPATCH
+#define AVM1_HANDLER_LABEL(name) &&op_##name,
+        static void* const labels[] = {
+            &&op_Slow,
+            AVM1_INLINE_HANDLERS(AVM1_HANDLER_LABEL)
+        };
+#undef AVM1_HANDLER_LABEL
+#endif
+
+        // Fetch the instruction at `pc` and jump to its handler.
+#define AVM1_FETCH() \
+    do { \
+        if (pc - region_begin >= region_span) goto leave_region; \
+        insn = &code[pc]; \
+        limit.tick(); \
+        if constexpr (Profile) { \
+            record(counter, prev_op, static_cast<uint8_t>(insn->op)); \
+            prev_op = static_cast<uint8_t>(insn->op); \
+        } \
+    } while (0)
+
+#ifdef AVM1_THREADED_DISPATCH
+#define AVM1_NEXT() \
+    do { \
+        AVM1_FETCH(); \
+        goto *labels[HANDLER_TABLE[static_cast<uint8_t>(insn->op)]]; \
+    } while (0)
+#define AVM1_CASE(name) op_##name:
+#else
+#define AVM1_NEXT() goto dispatch
+#define AVM1_CASE(name) case HandlerId::name:
+#endif
+
+// Stop the script if it has run for too long. Only used on backward
+// branches, which every loop takes.
+#define AVM1_CHECK_LIMIT() \
+    do { \
+        if (limit.check()) throw Avm1Exception(Avm1Error::execution_timeout()); \
+    } while (0)
+
+// Hand the current instruction to the host's generic implementation. A
+// call to a bytecode function suspends the caller and continues in the
+// callee, on the same native stack frame.
+#define AVM1_SLOW_PATH() \
+    do { \
+        uint32_t next_pc = pc + 1; \
+        switch (host->run_action(*insn, *actions, next_pc)) { \
+            case FrameControl::RETURN: \
+                result.reset(); \
+                goto returning; \
+            case FrameControl::CALL: { \
+                const DecodedActions* callee_actions = nullptr; \
+                Host* callee = host->begin_call(callee_actions); \
+                calls.push(CallerFrame{host, actions, next_pc}); \
+                host = callee; \
+                actions = callee_actions; \
+                code = actions->code.data(); \
+                pc = 0; \
+                update_region(); \
+                AVM1_NEXT(); \
+            } \
+            case FrameControl::WITH: \
+                calls.push_region(RegionFrame::with_body(calls.depth(), next_pc, insn->arg, \
+                                                         host->take_outer_scope())); \
+                update_region(); \
+                break; \
+            default: \
+                break; \
+        } \
+        if (next_pc <= pc) AVM1_CHECK_LIMIT(); \
+        pc = next_pc; \
+        AVM1_NEXT(); \
+    } while (0)
+
+// Binary numeric operator on primitive operands.
+#define AVM1_NUMERIC_BINOP(expr) \
+    do { \
+        CompactValue b = host->peek(); \
+        if (!is_primitive(b)) AVM1_SLOW_PATH(); \
+        host->pop(); \
+        CompactValue a = host->peek(); \
+        if (!is_primitive(a)) { host->push(b); AVM1_SLOW_PATH(); } \
+        host->pop(); \
+        double x = to_number(*host, a); \
+        double y = to_number(*host, b); \
+        (void)x; (void)y; \
+        host->push(expr); \
+        ++pc; \
+        AVM1_NEXT(); \
+    } while (0)
+
+        // Each pass runs until the block returns or an exception is thrown;
+        // a handled exception starts another pass at its handler.
+        for (;;) {
+        try {
+
+#ifdef AVM1_THREADED_DISPATCH
+        AVM1_NEXT();
+#else
+    dispatch:
+        AVM1_FETCH();
+        switch (static_cast<HandlerId>(HANDLER_TABLE[static_cast<uint8_t>(insn->op)])) {
+#endif
+
+        AVM1_CASE(Slow) {
+            AVM1_SLOW_PATH();
+        }
+
+        AVM1_CASE(End) {
+            result.reset();
+            goto returning;
+        }
+
+        AVM1_CASE(Unknown) {
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Push) {
+            push_items(*host, *actions, insn->arg, insn->arg16);
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Pop) {
+            host->pop();
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Add) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(to_number_v1(a) + to_number_v1(b)));
+        }
+
+        AVM1_CASE(Add2) {
+            CompactValue b = host->peek();
+            if (!is_primitive(b)) AVM1_SLOW_PATH();
+            host->pop();
+            CompactValue a = host->peek();
+            if (!is_primitive(a)) { host->push(b); AVM1_SLOW_PATH(); }
+            host->pop();
+            host->push(add2(*host, a, b));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Subtract) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(x - y));
+        }
+
+        AVM1_CASE(Multiply) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(x * y));
+        }
+
+        AVM1_CASE(Divide) {
+            // SWFv4 division by zero produces "#ERROR#"; leave that to the host->
+            if (host->swf_version() < 5) AVM1_SLOW_PATH();
+            AVM1_NUMERIC_BINOP(CompactValue::number(x / y));
+        }
+
+        AVM1_CASE(Modulo) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(std::fmod(x, y)));
+        }
+
+        AVM1_CASE(Increment) {
+            CompactValue a = host->peek();
+            if (!is_primitive(a)) AVM1_SLOW_PATH();
+            host->pop();
+            host->push(CompactValue::number(to_number(*host, a) + 1.0));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Decrement) {
+            CompactValue a = host->peek();
+            if (!is_primitive(a)) AVM1_SLOW_PATH();
+            host->pop();
+            host->push(CompactValue::number(to_number(*host, a) - 1.0));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Less) {
+            AVM1_NUMERIC_BINOP(from_bool(*host, to_number_v1(a) < to_number_v1(b)));
+        }
+
+        AVM1_CASE(Equals) {
+            AVM1_NUMERIC_BINOP(from_bool(*host, to_number_v1(a) == to_number_v1(b)));
+        }
+
+        AVM1_CASE(Less2) {
+            CompactValue b = host->peek();
+            if (!is_primitive(b)) AVM1_SLOW_PATH();
+            host->pop();
+            CompactValue a = host->peek();
+            if (!is_primitive(a)) { host->push(b); AVM1_SLOW_PATH(); }
+            host->pop();
+            host->push(less2(*host, a, b));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Greater) {
+            CompactValue b = host->peek();
+            if (!is_primitive(b)) AVM1_SLOW_PATH();
+            host->pop();
+            CompactValue a = host->peek();
+            if (!is_primitive(a)) { host->push(b); AVM1_SLOW_PATH(); }
+            host->pop();
+            host->push(less2(*host, b, a));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Equals2) {
+            CompactValue b = host->peek();
+            if (!is_primitive(b)) AVM1_SLOW_PATH();
+            host->pop();
+            CompactValue a = host->peek();
+            if (!is_primitive(a)) { host->push(b); AVM1_SLOW_PATH(); }
+            host->pop();
+            host->push(CompactValue::boolean(equals2(*host, a, b)));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(StrictEquals) {
+            CompactValue b = host->pop();
+            CompactValue a = host->pop();
+            host->push(CompactValue::boolean(strict_equals(a, b)));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Not) {
+            CompactValue a = host->pop();
+            host->push(from_bool(*host, !to_bool(*host, a)));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(BitAnd) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(to_int32(x) & to_int32(y)));
+        }
+
+        AVM1_CASE(BitOr) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(to_int32(x) | to_int32(y)));
+        }
+
+        AVM1_CASE(BitXor) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(to_int32(x) ^ to_int32(y)));
+        }
+
+        AVM1_CASE(BitLShift) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(static_cast<int32_t>(
+                static_cast<uint32_t>(to_int32(x)) << (to_int32(y) & 0x1F))));
+        }
+
+        AVM1_CASE(BitRShift) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(to_int32(x) >> (to_int32(y) & 0x1F)));
+        }
+
+        AVM1_CASE(BitURShift) {
+            AVM1_NUMERIC_BINOP(CompactValue::number(
+                static_cast<uint32_t>(to_int32(x)) >> (to_int32(y) & 0x1F)));
+        }
+
+        AVM1_CASE(PushDuplicate) {
+            host->push(host->peek());
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(StackSwap) {
+            CompactValue b = host->pop();
+            CompactValue a = host->pop();
+            host->push(b);
+            host->push(a);
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(StoreRegister) {
+            host->set_register(insn->arg8, host->peek());
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Jump) {
+            if (insn->arg <= pc) AVM1_CHECK_LIMIT();
+            pc = insn->arg;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(If) {
+            CompactValue cond = host->pop();
+            if (to_bool(*host, cond)) {
+                if (insn->arg <= pc) AVM1_CHECK_LIMIT();
+                pc = insn->arg;
+            } else {
+                ++pc;
+            }
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Return) {
+            result = host->pop();
+            goto returning;
+        }
+
+        AVM1_CASE(GetVariable) {
+            CompactValue path = host->pop();
+            host->push(host->get_variable(path));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(SetVariable) {
+            CompactValue value = host->pop();
+            CompactValue path = host->pop();
+            host->set_variable(path, value);
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(GetMember) {
+            CompactValue name = host->pop();
+            CompactValue object = host->pop();
+            host->push(host->get_member(object, name, actions->property_caches[insn->arg]));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(SetMember) {
+            CompactValue value = host->pop();
+            CompactValue name = host->pop();
+            CompactValue object = host->pop();
+            host->set_member(object, name, value, actions->property_caches[insn->arg]);
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Enumerate) {
+            CompactValue path = host->pop();
+            host->push_enumeration(host->get_variable(path));
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Enumerate2) {
+            host->push_enumeration(host->pop());
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(ConstantPool) {
+            host->set_constant_pool(actions->pool_atoms[insn->arg]);
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(Try) {
+            calls.push_region(RegionFrame::try_body(calls.depth(), pc + 1, actions->try_blocks[insn->arg],
+                                                    host->stack_len()));
+            update_region();
+            ++pc;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(PushGetVariable) {
+            limit.charge(insn->arg8 - 1u);
+            if constexpr (Profile) {
+                record(counter, static_cast<uint8_t>(OpCode::Push),
+                       static_cast<uint8_t>(OpCode::GetVariable));
+                prev_op = static_cast<uint8_t>(OpCode::GetVariable);
+            }
+            uint32_t last = insn->arg + insn->arg16 - 1;
+            push_items(*host, *actions, insn->arg, insn->arg16 - 1u);
+            CompactValue path = push_item(*host, *actions, actions->push_items[last]);
+            host->push(host->get_variable(path));
+            pc += insn->arg8;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(PushGetMember) {
+            limit.charge(insn->arg8 - 1u);
+            if constexpr (Profile) {
+                record(counter, static_cast<uint8_t>(OpCode::Push),
+                       static_cast<uint8_t>(OpCode::GetMember));
+                prev_op = static_cast<uint8_t>(OpCode::GetMember);
+            }
+            uint32_t last = insn->arg + insn->arg16 - 1;
+            push_items(*host, *actions, insn->arg, insn->arg16 - 1u);
+            CompactValue name = push_item(*host, *actions, actions->push_items[last]);
+            CompactValue object = host->pop();
+            // The fused GetMember is still in place and owns the site's cache.
+            const Instruction& get = code[pc + insn->arg8 - 1];
+            host->push(host->get_member(object, name, actions->property_caches[get.arg]));
+            pc += insn->arg8;
+            AVM1_NEXT();
+        }
+
+        AVM1_CASE(PushPushAdd2) {
+            limit.charge(insn->arg8 - 1u);
+            if constexpr (Profile) {
+                if (insn->arg8 == 3) {
+                    record(counter, static_cast<uint8_t>(OpCode::Push),
+                           static_cast<uint8_t>(OpCode::Push));
+                }
+                record(counter, static_cast<uint8_t>(OpCode::Push),
+                       static_cast<uint8_t>(OpCode::Add2));
+                prev_op = static_cast<uint8_t>(OpCode::Add2);
+            }
+            CompactValue a = push_item(*host, *actions, actions->push_items[insn->arg]);
+            CompactValue b = push_item(*host, *actions, actions->push_items[insn->arg + 1]);
+            if (!is_primitive(a) || !is_primitive(b)) {
+                // Registers may hold objects; run the unfused sequence.
+                host->push(a);
+                host->push(b);
+                pc += insn->arg8 - 1;
+                insn = &code[pc];
+                AVM1_SLOW_PATH();
+            }
+            host->push(add2(*host, a, b));
+            pc += insn->arg8;
+            AVM1_NEXT();
+        }
+
+#ifndef AVM1_THREADED_DISPATCH
+        }
+#endif
+
+    leave_region: {
+            // Control left the block the innermost region is running.
+            RegionFrame& region = calls.region();
+            const TryBlock* block = region.try_block;
+            switch (region.stage) {
+                case RegionStage::WITH:
+                    host->set_scope(std::move(region.outer_scope));
+                    calls.pop_region();
+                    break;
+                case RegionStage::TRY:
+                case RegionStage::CATCH: {
+                    // Falling off the end of the try or catch block continues
+                    // after the whole statement; a branch out of it continues
+                    // at its target.
+                    uint32_t resume = pc == region.end ? block->finally_end : pc;
+                    if (block->finally_start) {
+                        region.resume = resume;
+                        region.enter(RegionStage::FINALLY, *block->finally_start, block->finally_end);
+                        pc = region.begin;
+                    } else {
+                        calls.pop_region();
+                        pc = resume;
+                    }
+                    break;
+                }
+                case RegionStage::FINALLY: {
+                    if (pc != region.end) {
+                        // A branch out of the finally block overrides whatever
+                        // was pending.
+                        calls.pop_region();
+                        break;
+                    }
+                    std::exception_ptr exception = std::move(region.exception);
+                    bool was_returning = region.returning;
+                    std::optional<CompactValue> value = region.return_value;
+                    pc = region.resume;
+                    calls.pop_region();
+                    update_region();
+                    if (exception) {
+                        std::rethrow_exception(exception);
+                    }
+                    if (was_returning) {
+                        result = value;
+                        goto returning;
+                    }
+                    break;
+                }
+            }
+            update_region();
+            AVM1_NEXT();
+        }
+
+    returning:
+        // A return, or the end of the block, leaves the host's regions
+        // first. A finally block on the way runs before it goes on.
+        while (calls.in_region()) {
+            RegionFrame& region = calls.region();
+            if (region.stage == RegionStage::WITH) {
+                host->set_scope(std::move(region.outer_scope));
+            } else if (region.stage != RegionStage::FINALLY && region.try_block->finally_start) {
+                region.returning = true;
+                region.return_value = result;
+                region.enter(RegionStage::FINALLY, *region.try_block->finally_start,
+                             region.try_block->finally_end);
+                pc = region.begin;
+                result.reset();
+                update_region();
+                AVM1_NEXT();
+            }
+            calls.pop_region();
+        }
+
+        if (!calls.empty()) {
+            // The callee finished: hand its result to the caller and resume
+            // it after the call instruction.
+            CallerFrame caller = calls.pop();
+            Host* callee = host;
+            host = caller.host;
+            actions = caller.actions;
+            code = actions->code.data();
+            pc = caller.pc;
+            update_region();
+            host->end_call(callee, result);
+            result.reset();
+            AVM1_NEXT();
+        }
+        return result;
+
+        } catch (const Avm1Exception& error) {
+            if (!unwind(&error, std::current_exception())) {
+                throw;
+            }
+        } catch (...) {
+            if (!unwind(nullptr, std::current_exception())) {
+                throw;
+            }
+        }
+        }
+
+#undef AVM1_FETCH
+#undef AVM1_NEXT
+#undef AVM1_CASE
+#undef AVM1_SLOW_PATH
+#undef AVM1_CHECK_LIMIT
+#undef AVM1_NUMERIC_BINOP
+    }
+
+    static void record(OpcodePairCounter* counter, uint8_t prev, uint8_t op) {
+        if (counter) {
+            counter->record(prev, op);
+        }
+    }
+
+public:
+    // Run a whole decoded block. Returns the value of an explicit `return`,
+    // or nothing if the block ran to its end.
+    static std::optional<CompactValue> run(Host& host, const DecodedActions& actions,
+                                           OpcodePairCounter* counter = nullptr) {
+        if (counter) {
+            return execute<true>(host, actions, counter);
+        }
+        return execute<false>(host, actions, nullptr);
+    }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_INTERPRETER_H
@@ -0,0 +1,215 @@
+/*
+ * C++ header for AVM1 native objects
+ * The host-side payload an AVM1 object wraps, such as a display object or XML node
+ */
+
+#ifndef AVM1_NATIVE_OBJECT_H
+#define AVM1_NATIVE_OBJECT_H
+
+#include "avm1/gc.h"
+#include <memory>
+#include <type_traits>
+#include <variant>
+
+namespace ruffle {
+
+// Forward declarations
+class DisplayObject;
+class MovieClip;
+class EditText;
+class Avm1Button;
+class Video;
+class NetStream;
+class XmlNode;
+class Xml;
+class Sound;
+class LocalConnection;
+class SharedObject;
+class NetConnection;
+class TextFormat;
+class ColorTransformObject;
+class TransformObject;
+class BitmapData;
+class StyleSheetObject;
+class TextSnapshotObject;
+class BevelFilter;
+class BlurFilter;
+class ColorMatrixFilter;
+class ConvolutionFilter;
+class DisplacementMapFilter;
+class DropShadowFilter;
+class GlowFilter;
+class GradientFilter;
+
+// Enum for native objects in AVM1
+enum class NativeObjectType {
+    NONE,
+    SUPER,
+    DISPLAY_OBJECT,
+    MOVIE_CLIP,
+    EDIT_TEXT,
+    BUTTON,
+    VIDEO,
+    NET_STREAM,
+    XML_NODE,
+    XML,
+    SOUND,
+    LOCAL_CONNECTION,
+    SHARED_OBJECT,
+    NET_CONNECTION,
+    TEXT_FORMAT,
+    COLOR_TRANSFORM,
+    TRANSFORM,
+    BITMAP_DATA,
+    STYLE_SHEET,
+    TEXT_SNAPSHOT,
+    BEVEL_FILTER,
+    BLUR_FILTER,
+    COLOR_MATRIX_FILTER,
+    CONVOLUTION_FILTER,
+    DISPLACEMENT_MAP_FILTER,
+    DROP_SHADOW_FILTER,
+    GLOW_FILTER,
+    GRADIENT_FILTER
+};
+
+// Variant to hold different native object types
+using NativeObjectVariant = std::variant<
+    std::monostate,  // None
+    std::shared_ptr<DisplayObject>,  // DisplayObject
+    std::shared_ptr<MovieClip>,      // MovieClip
+    std::shared_ptr<EditText>,       // EditText
+    std::shared_ptr<Avm1Button>,     // Button
+    std::shared_ptr<Video>,          // Video
+    std::shared_ptr<NetStream>,      // NetStream
+    std::shared_ptr<XmlNode>,        // XmlNode
+    std::shared_ptr<Xml>,            // Xml
+    std::shared_ptr<Sound>,          // Sound
+    std::shared_ptr<LocalConnection>, // LocalConnection
+    std::shared_ptr<SharedObject>,    // SharedObject
+    std::shared_ptr<NetConnection>,   // NetConnection
+    std::shared_ptr<TextFormat>,      // TextFormat
+    std::shared_ptr<ColorTransformObject>, // ColorTransform
+    std::shared_ptr<TransformObject>, // Transform
+    std::shared_ptr<BitmapData>,      // BitmapData
+    std::shared_ptr<StyleSheetObject>, // StyleSheet
+    std::shared_ptr<TextSnapshotObject>, // TextSnapshot
+    std::shared_ptr<BevelFilter>,     // BevelFilter
+    std::shared_ptr<BlurFilter>,      // BlurFilter
+    std::shared_ptr<ColorMatrixFilter>, // ColorMatrixFilter
+    std::shared_ptr<ConvolutionFilter>, // ConvolutionFilter
+    std::shared_ptr<DisplacementMapFilter>, // DisplacementMapFilter
+    std::shared_ptr<DropShadowFilter>, // DropShadowFilter
+    std::shared_ptr<GlowFilter>,      // GlowFilter
+    std::shared_ptr<GradientFilter>   // GradientFilter
+>;
+
+// Native object wrapper
+//
+// A native type whose payload holds AVM1 objects declares
+// `void gc_trace(GcTracer&) const`; the owning object's trace then visits
+// them through `gc_trace` here. The tracer is picked when the payload is
+// stored, where its type is complete.
+class NativeObject {
+private:
+    using TraceFn = void (*)(GcTracer&, const NativeObjectVariant&);
+
+    NativeObjectVariant data_;
+    TraceFn trace_ = nullptr;
+
+public:
+    NativeObject() : data_(std::monostate{}) {}
+    
+    template<typename T>
+    explicit NativeObject(std::shared_ptr<T> obj) : data_(obj) {
+        if constexpr (requires(const T& native, GcTracer& tracer) { native.gc_trace(tracer); }) {
+            trace_ = [](GcTracer& tracer, const NativeObjectVariant& data) {
+                if (const auto& native = *std::get_if<std::shared_ptr<T>>(&data)) {
+                    native->gc_trace(tracer);
+                }
+            };
+        }
+    }
+
+    // Visit the AVM1 objects the payload holds.
+    void gc_trace(GcTracer& tracer) const {
+        if (trace_) {
+            trace_(tracer, data_);
+        }
+    }
+    
+    NativeObjectType type() const {
+        return std::visit([](const auto& value) -> NativeObjectType {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::monostate>) {
+                return NativeObjectType::NONE;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<DisplayObject>>) {
+                return NativeObjectType::DISPLAY_OBJECT;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<MovieClip>>) {
+                return NativeObjectType::MOVIE_CLIP;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<EditText>>) {
+                return NativeObjectType::EDIT_TEXT;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<Avm1Button>>) {
+                return NativeObjectType::BUTTON;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<Video>>) {
+                return NativeObjectType::VIDEO;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<NetStream>>) {
+                return NativeObjectType::NET_STREAM;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<XmlNode>>) {
+                return NativeObjectType::XML_NODE;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<Xml>>) {
+                return NativeObjectType::XML;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<Sound>>) {
+                return NativeObjectType::SOUND;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<LocalConnection>>) {
+                return NativeObjectType::LOCAL_CONNECTION;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<SharedObject>>) {
+                return NativeObjectType::SHARED_OBJECT;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<NetConnection>>) {
+                return NativeObjectType::NET_CONNECTION;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<TextFormat>>) {
+                return NativeObjectType::TEXT_FORMAT;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<ColorTransformObject>>) {
+                return NativeObjectType::COLOR_TRANSFORM;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<TransformObject>>) {
+                return NativeObjectType::TRANSFORM;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<BitmapData>>) {
+                return NativeObjectType::BITMAP_DATA;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<StyleSheetObject>>) {
+                return NativeObjectType::STYLE_SHEET;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<TextSnapshotObject>>) {
+                return NativeObjectType::TEXT_SNAPSHOT;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<BevelFilter>>) {
+                return NativeObjectType::BEVEL_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<BlurFilter>>) {
+                return NativeObjectType::BLUR_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<ColorMatrixFilter>>) {
+                return NativeObjectType::COLOR_MATRIX_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<ConvolutionFilter>>) {
+                return NativeObjectType::CONVOLUTION_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<DisplacementMapFilter>>) {
+                return NativeObjectType::DISPLACEMENT_MAP_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<DropShadowFilter>>) {
+                return NativeObjectType::DROP_SHADOW_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<GlowFilter>>) {
+                return NativeObjectType::GLOW_FILTER;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<GradientFilter>>) {
+                return NativeObjectType::GRADIENT_FILTER;
+            } else {
+                return NativeObjectType::NONE;
+            }
+        }, data_);
+    }
+    
+    template<typename T>
+    std::shared_ptr<T> get() const {
+        if (auto ptr = std::get_if<std::shared_ptr<T>>(&data_)) {
+            return *ptr;
+        }
+        return nullptr;
+    }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_NATIVE_OBJECT_H
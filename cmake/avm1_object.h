@@ -7,236 +7,191 @@
 #define AVM1_OBJECT_H
 
 #include "avm1.h"
+#include "avm1/atom.h"
 #include "avm1/value.h"
 #include "avm1/activation.h"
 #include "avm1/error.h"
 #include "avm1/function.h"
+#include "avm1/gc.h"
+#include "avm1/native_object.h"
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <variant>
 #include <functional>
+#include <array>
+#include <atomic>
+#include <cstdint>
 
 namespace ruffle {
 
 // Forward declarations
 class Object;
-class DisplayObject;
-class MovieClip;
-class EditText;
-class Avm1Button;
-class Video;
-class NetStream;
-class XmlNode;
-class Xml;
-class Sound;
-class LocalConnection;
-class SharedObject;
-class NetConnection;
-class TextFormat;
-class ColorTransformObject;
-class TransformObject;
-class BitmapData;
-class StyleSheetObject;
-class TextSnapshotObject;
-class BevelFilter;
-class BlurFilter;
-class ColorMatrixFilter;
-class ConvolutionFilter;
-class DisplacementMapFilter;
-class DropShadowFilter;
-class GlowFilter;
-class GradientFilter;
-
-// Enum for native objects in AVM1
-enum class NativeObjectType {
-    NONE,
-    SUPER,
-    DISPLAY_OBJECT,
-    MOVIE_CLIP,
-    EDIT_TEXT,
-    BUTTON,
-    VIDEO,
-    NET_STREAM,
-    XML_NODE,
-    XML,
-    SOUND,
-    LOCAL_CONNECTION,
-    SHARED_OBJECT,
-    NET_CONNECTION,
-    TEXT_FORMAT,
-    COLOR_TRANSFORM,
-    TRANSFORM,
-    BITMAP_DATA,
-    STYLE_SHEET,
-    TEXT_SNAPSHOT,
-    BEVEL_FILTER,
-    BLUR_FILTER,
-    COLOR_MATRIX_FILTER,
-    CONVOLUTION_FILTER,
-    DISPLACEMENT_MAP_FILTER,
-    DROP_SHADOW_FILTER,
-    GLOW_FILTER,
-    GRADIENT_FILTER
-};
+class ScriptObject;
 
-// Variant to hold different native object types
-using NativeObjectVariant = std::variant<
-    std::monostate,  // None
-    std::shared_ptr<DisplayObject>,  // DisplayObject
-    std::shared_ptr<MovieClip>,      // MovieClip
-    std::shared_ptr<EditText>,       // EditText
-    std::shared_ptr<Avm1Button>,     // Button
-    std::shared_ptr<Video>,          // Video
-    std::shared_ptr<NetStream>,      // NetStream
-    std::shared_ptr<XmlNode>,        // XmlNode
-    std::shared_ptr<Xml>,            // Xml
-    std::shared_ptr<Sound>,          // Sound
-    std::shared_ptr<LocalConnection>, // LocalConnection
-    std::shared_ptr<SharedObject>,    // SharedObject
-    std::shared_ptr<NetConnection>,   // NetConnection
-    std::shared_ptr<TextFormat>,      // TextFormat
-    std::shared_ptr<ColorTransformObject>, // ColorTransform
-    std::shared_ptr<TransformObject>, // Transform
-    std::shared_ptr<BitmapData>,      // BitmapData
-    std::shared_ptr<StyleSheetObject>, // StyleSheet
-    std::shared_ptr<TextSnapshotObject>, // TextSnapshot
-    std::shared_ptr<BevelFilter>,     // BevelFilter
-    std::shared_ptr<BlurFilter>,      // BlurFilter
-    std::shared_ptr<ColorMatrixFilter>, // ColorMatrixFilter
-    std::shared_ptr<ConvolutionFilter>, // ConvolutionFilter
-    std::shared_ptr<DisplacementMapFilter>, // DisplacementMapFilter
-    std::shared_ptr<DropShadowFilter>, // DropShadowFilter
-    std::shared_ptr<GlowFilter>,      // GlowFilter
-    std::shared_ptr<GradientFilter>   // GradientFilter
->;
-
-// Native object wrapper
-class NativeObject {
-private:
-    NativeObjectVariant data_;
+// Next object epoch. Epochs are drawn from one counter, so an epoch is
+// never shared by two objects, even one allocated at a freed object's
+// address.
+inline uint64_t next_object_epoch() {
+    static std::atomic<uint64_t> epoch{0};
+    return epoch.fetch_add(1, std::memory_order_relaxed) + 1;
+}
 
-public:
-    NativeObject() : data_(std::monostate{}) {}
-    
-    template<typename T>
-    explicit NativeObject(std::shared_ptr<T> obj) : data_(obj) {}
-    
-    NativeObjectType type() const {
-        return std::visit([](const auto& value) -> NativeObjectType {
-            using T = std::decay_t<decltype(value)>;
-            if constexpr (std::is_same_v<T, std::monostate>) {
-                return NativeObjectType::NONE;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<DisplayObject>>) {
-                return NativeObjectType::DISPLAY_OBJECT;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<MovieClip>>) {
-                return NativeObjectType::MOVIE_CLIP;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<EditText>>) {
-                return NativeObjectType::EDIT_TEXT;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<Avm1Button>>) {
-                return NativeObjectType::BUTTON;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<Video>>) {
-                return NativeObjectType::VIDEO;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<NetStream>>) {
-                return NativeObjectType::NET_STREAM;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<XmlNode>>) {
-                return NativeObjectType::XML_NODE;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<Xml>>) {
-                return NativeObjectType::XML;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<Sound>>) {
-                return NativeObjectType::SOUND;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<LocalConnection>>) {
-                return NativeObjectType::LOCAL_CONNECTION;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<SharedObject>>) {
-                return NativeObjectType::SHARED_OBJECT;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<NetConnection>>) {
-                return NativeObjectType::NET_CONNECTION;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<TextFormat>>) {
-                return NativeObjectType::TEXT_FORMAT;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<ColorTransformObject>>) {
-                return NativeObjectType::COLOR_TRANSFORM;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<TransformObject>>) {
-                return NativeObjectType::TRANSFORM;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<BitmapData>>) {
-                return NativeObjectType::BITMAP_DATA;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<StyleSheetObject>>) {
-                return NativeObjectType::STYLE_SHEET;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<TextSnapshotObject>>) {
-                return NativeObjectType::TEXT_SNAPSHOT;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<BevelFilter>>) {
-                return NativeObjectType::BEVEL_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<BlurFilter>>) {
-                return NativeObjectType::BLUR_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<ColorMatrixFilter>>) {
-                return NativeObjectType::COLOR_MATRIX_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<ConvolutionFilter>>) {
-                return NativeObjectType::CONVOLUTION_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<DisplacementMapFilter>>) {
-                return NativeObjectType::DISPLACEMENT_MAP_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<DropShadowFilter>>) {
-                return NativeObjectType::DROP_SHADOW_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<GlowFilter>>) {
-                return NativeObjectType::GLOW_FILTER;
-            } else if constexpr (std::is_same_v<T, std::shared_ptr<GradientFilter>>) {
-                return NativeObjectType::GRADIENT_FILTER;
-            } else {
-                return NativeObjectType::NONE;
-            }
-        }, data_);
-    }
-    
-    template<typename T>
-    std::shared_ptr<T> get() const {
-        if (auto ptr = std::get_if<std::shared_ptr<T>>(&data_)) {
-            return *ptr;
-        }
-        return nullptr;
-    }
+// Where an object is in its own keys during enumeration. What the fields
+// count is up to the object; a default-constructed cursor is at the start.
+struct OwnKeyCursor {
+    uint32_t position = 0;
+    uint32_t secondary = 0;
+    bool started = false;
+    // Text of a key the object has no string for, such as an array index.
+    char digits[16];
+};
+
+// An own property name produced by `Object::next_own_key`. Hidden
+// (DONT_ENUM) names are produced too, as they still shadow prototypes.
+// `name` views the object's own key, or the cursor's `digits`, so it is
+// only valid until the cursor is advanced again.
+struct OwnKey {
+    std::string_view name;
+    bool enumerable;
 };
 
 // Object class for AVM1
-class Object {
+class Object : public GcCell, public std::enable_shared_from_this<Object> {
 private:
     std::unordered_map<std::string, std::shared_ptr<Value>> properties_;
     std::shared_ptr<Object> prototype_;
     std::shared_ptr<FunctionObject> constructor_;
     NativeObject native_object_;
     std::string type_name_;
+    // Changes whenever the set of own property names or the prototype
+    // changes. Used to validate `ProtoLookupCache` entries.
+    uint64_t epoch_;
+
+protected:
+    void bump_epoch() { epoch_ = next_object_epoch(); }
+
+    // A function object's references: its prototype, constructor and the
+    // scope chain it closes over.
+    static void gc_trace_function(GcTracer& tracer, const FunctionObject* function) {
+        if (!function) {
+            return;
+        }
+        if (auto avm1_function = function->function()) {
+            tracer.visit_scope(avm1_function->scope().get());
+        }
+        tracer.visit(function->prototype());
+        tracer.visit(function->constructor());
+    }
+
+    void gc_write_barrier_function(const FunctionObject* function) const {
+        if (!function) {
+            return;
+        }
+        gc_write_barrier_cell(function->prototype().get());
+        gc_write_barrier_cell(function->constructor().get());
+        if (auto avm1_function = function->function()) {
+            for (auto scope = avm1_function->scope(); scope; scope = scope->parent()) {
+                gc_write_barrier_cell(scope->locals().get());
+            }
+        }
+    }
 
 public:
     Object(std::shared_ptr<Object> prototype = nullptr, 
            const std::string& type_name = "Object")
-        : prototype_(std::move(prototype)), type_name_(type_name) {}
+        : prototype_(std::move(prototype)), type_name_(type_name),
+          epoch_(next_object_epoch()) {}
+
+    virtual ~Object() = default;
+
+    // Garbage collection
+    void gc_trace(GcTracer& tracer) const override {
+        for (const auto& [key, value] : properties_) {
+            if (value) {
+                tracer.visit_value(*value);
+            }
+        }
+        tracer.visit(prototype_);
+        gc_trace_function(tracer, constructor_.get());
+        native_object_.gc_trace(tracer);
+    }
+
+    void gc_clear() override {
+        properties_.clear();
+        prototype_.reset();
+        constructor_.reset();
+        native_object_ = NativeObject();
+        bump_epoch();
+    }
+
+    std::shared_ptr<GcCell> gc_retain() override {
+        auto self = weak_from_this().lock();
+        return std::shared_ptr<GcCell>(self, static_cast<GcCell*>(self.get()));
+    }
 
     // Get a property value
     std::shared_ptr<Value> get(const std::string& name, 
-                              std::shared_ptr<Activation> activation) const {
+                              std::shared_ptr<Activation> activation) const;
+
+    // Own property lookup, without the prototype chain
+    virtual bool has_own_property(const std::string& name,
+                                  std::shared_ptr<Activation> activation) const {
+        return properties_.count(name) != 0;
+    }
+
+    virtual std::shared_ptr<Value> get_own(const std::string& name,
+                                           std::shared_ptr<Activation> activation) const {
         auto it = properties_.find(name);
-        if (it != properties_.end()) {
-            return it->second;
-        }
-        
-        // Search in prototype chain
-        if (prototype_) {
-            return prototype_->get(name, activation);
-        }
-        
-        return std::make_shared<Value>(Value::UNDEFINED);
+        return it != properties_.end() ? it->second : nullptr;
     }
 
+    uint64_t epoch() const { return epoch_; }
+
+    // This object as a `ScriptObject`, or null. Lets the interpreter take
+    // the shape-cached property paths without a `dynamic_cast`.
+    virtual ScriptObject* as_script_object() { return nullptr; }
+
     // Set a property value
     void set(const std::string& name, 
              std::shared_ptr<Value> value, 
              std::shared_ptr<Activation> activation) {
-        properties_[name] = std::move(value);
+        gc_write_barrier(value);
+        auto [it, inserted] = properties_.insert_or_assign(name, std::move(value));
+        if (inserted) {
+            bump_epoch();
+        }
     }
 
     // Define a value property
     void define_value(const std::string& name, 
                      std::shared_ptr<Value> value, 
                      int attributes = 0) {
-        properties_[name] = std::move(value);
+        gc_write_barrier(value);
+        auto [it, inserted] = properties_.insert_or_assign(name, std::move(value));
+        if (inserted) {
+            bump_epoch();
+        }
+    }
+
+    // The own key after `cursor`, advancing it, or nothing once all have
+    // been produced. The object must not change while a cursor is in use.
+    virtual std::optional<OwnKey> next_own_key(OwnKeyCursor& cursor) const {
+        // `position` is the bucket and `secondary` the entry within it.
+        while (cursor.position < properties_.bucket_count()) {
+            if (cursor.secondary < properties_.bucket_size(cursor.position)) {
+                auto it = properties_.begin(cursor.position);
+                std::advance(it, cursor.secondary++);
+                return OwnKey{it->first, true};
+            }
+            ++cursor.position;
+            cursor.secondary = 0;
+        }
+        return std::nullopt;
     }
 
     // Get all property names
@@ -264,17 +219,7 @@ public:
 
     // Check if this object has a specific property
     bool has_property(const std::string& name, 
-                    std::shared_ptr<Activation> activation) const {
-        if (properties_.find(name) != properties_.end()) {
-            return true;
-        }
-        
-        if (prototype_) {
-            return prototype_->has_property(name, activation);
-        }
-        
-        return false;
-    }
+                    std::shared_ptr<Activation> activation) const;
 
     // Call a method on this object
     std::shared_ptr<Value> call(const std::string& name,
@@ -309,15 +254,22 @@ public:
     }
 
     // Getters
-    std::shared_ptr<Object> proto() const { return prototype_; }
+    virtual std::shared_ptr<Object> proto() const { return prototype_; }
     std::shared_ptr<FunctionObject> constr() const { return constructor_; }
     NativeObject& native() { return native_object_; }
     const NativeObject& native() const { return native_object_; }
     const std::string& type_name() const { return type_name_; }
 
     // Setters
-    void set_proto(std::shared_ptr<Object> proto) { prototype_ = std::move(proto); }
-    void set_constr(std::shared_ptr<FunctionObject> constr) { constructor_ = std::move(constr); }
+    virtual void set_proto(std::shared_ptr<Object> proto) {
+        gc_write_barrier_cell(proto.get());
+        prototype_ = std::move(proto);
+        bump_epoch();
+    }
+    void set_constr(std::shared_ptr<FunctionObject> constr) {
+        gc_write_barrier_function(constr.get());
+        constructor_ = std::move(constr);
+    }
 
     // Convert to value
     std::shared_ptr<Value> as_value() const {
@@ -353,69 +305,235 @@ public:
     }
 };
 
-// Helper function to find a property in the prototype chain
-std::pair<std::shared_ptr<Value>, int> find_property(
-    std::shared_ptr<Object> this_obj,
-    const std::string& name,
-    std::shared_ptr<Activation> activation,
-    bool call_resolve_fn = true) {
-    
-    auto proto = this_obj;
-    int depth = 0;
-    auto orig_proto = this_obj;
-    
-    while (proto) {
-        if (depth == 255) {
-            throw Avm1Exception(Avm1Error::prototype_recursion_limit());
+// Global cache of prototype chain lookups.
+//
+// Maps (start object, name atom) to the object on the chain that holds
+// `name`, or to "not found". Every object carries an epoch that changes when its
+// own property names or its prototype change; an entry records the epoch
+// of each object it walked past and is only used if all of them are
+// unchanged. Property values are not cached, only where they live, so
+// getters and value writes need no invalidation.
+//
+// Entries are validated from the start object outwards. An unchanged
+// epoch means the object still holds the same prototype, which keeps the
+// next object in the entry alive.
+class ProtoLookupCache {
+public:
+    static constexpr size_t SIZE = 1024;
+    // Longer chains are looked up but not cached.
+    static constexpr size_t MAX_DEPTH = 8;
+
+private:
+    struct Entry {
+        const Object* start = nullptr;
+        Avm1Atom name;
+        // Own-property checks depend on the SWF version's case rules.
+        bool case_sensitive = false;
+        uint8_t len = 0;
+        std::array<const Object*, MAX_DEPTH> chain{};
+        std::array<uint64_t, MAX_DEPTH> epochs{};
+        // Index into `chain` of the holder, or `len` if not found.
+        uint8_t holder = 0;
+    };
+
+    std::vector<Entry> entries_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+
+    static size_t slot_for(const Object* start, Avm1Atom name) {
+        size_t h = name.hash();
+        h ^= reinterpret_cast<uintptr_t>(start) >> 4;
+        return h & (SIZE - 1);
+    }
+
+    static bool is_valid(const Entry& entry) {
+        for (uint8_t i = 0; i < entry.len; ++i) {
+            if (entry.chain[i]->epoch() != entry.epochs[i]) {
+                return false;
+            }
         }
-        
-        // Check for local stored property
-        if (proto->has_property(name, activation)) {
-            auto value = proto->get(name, activation);
-            return std::make_pair(value, depth);
+        return true;
+    }
+
+public:
+    ProtoLookupCache() : entries_(SIZE) {}
+
+    // Find the object holding `name` on the chain starting at `start`
+    // (inclusive). Returns the holder and its depth from `start`, or
+    // (nullptr, -1).
+    std::pair<std::shared_ptr<Object>, int> lookup(const std::shared_ptr<Object>& start,
+                                                   Avm1Atom name,
+                                                   const std::shared_ptr<Activation>& activation) {
+        bool case_sensitive = activation && activation->is_case_sensitive();
+        Entry& entry = entries_[slot_for(start.get(), name)];
+        if (entry.start == start.get() && entry.len > 0 && entry.case_sensitive == case_sensitive &&
+            entry.name == name && is_valid(entry)) {
+            ++hits_;
+            if (entry.holder == entry.len) {
+                return {nullptr, -1};
+            }
+            auto holder = std::const_pointer_cast<Object>(entry.chain[entry.holder]->shared_from_this());
+            return {std::move(holder), entry.holder};
         }
-        
-        proto = proto->proto();
-        depth++;
+
+        ++misses_;
+        Entry fresh;
+        fresh.start = start.get();
+        fresh.name = name;
+        fresh.case_sensitive = case_sensitive;
+        std::shared_ptr<Object> found;
+        int depth = 0;
+        bool cacheable = true;
+        for (auto proto = start; proto; proto = proto->proto(), ++depth) {
+            if (depth == 255) {
+                throw Avm1Exception(Avm1Error::prototype_recursion_limit());
+            }
+            if (static_cast<size_t>(depth) < MAX_DEPTH) {
+                fresh.chain[depth] = proto.get();
+                fresh.epochs[depth] = proto->epoch();
+                fresh.len = static_cast<uint8_t>(depth + 1);
+            } else {
+                cacheable = false;
+            }
+            if (proto->has_own_property(name.as_str(), activation)) {
+                found = proto;
+                break;
+            }
+        }
+        if (cacheable) {
+            fresh.holder = found ? static_cast<uint8_t>(depth) : fresh.len;
+            entry = std::move(fresh);
+        }
+        if (!found) {
+            return {nullptr, -1};
+        }
+        return {std::move(found), depth};
     }
-    
-    // If resolve function should be called and we found one
-    if (call_resolve_fn) {
-        auto resolve_method = find_resolve_method(orig_proto, activation);
-        if (resolve_method) {
-            auto result = resolve_method->call("__resolve", activation, this_obj, 
-                                            {std::make_shared<Value>(name)});
-            return std::make_pair(result, 0);
+
+    // `lookup` without the cache.
+    static std::pair<std::shared_ptr<Object>, int> walk(const std::shared_ptr<Object>& start,
+                                                        const std::string& name,
+                                                        const std::shared_ptr<Activation>& activation) {
+        int depth = 0;
+        for (auto proto = start; proto; proto = proto->proto(), ++depth) {
+            if (depth == 255) {
+                throw Avm1Exception(Avm1Error::prototype_recursion_limit());
+            }
+            if (proto->has_own_property(name, activation)) {
+                return {proto, depth};
+            }
         }
+        return {nullptr, -1};
     }
-    
-    return std::make_pair(nullptr, -1);
+
+    void clear() {
+        for (auto& entry : entries_) {
+            entry = Entry();
+        }
+    }
+
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+};
+
+// Find the object holding `name` on the chain starting at `start`, through
+// the running runtime's lookup cache. Without an activation there is no
+// runtime to cache in, and a name that was never interned is not worth
+// interning for one lookup, so in both cases the chain is walked.
+inline std::pair<std::shared_ptr<Object>, int> lookup_proto_chain(const std::shared_ptr<Object>& start,
+                                                                  Avm1Atom name,
+                                                                  const std::shared_ptr<Activation>& activation) {
+    if (activation) {
+        return activation->proto_lookup_cache().lookup(start, name, activation);
+    }
+    return ProtoLookupCache::walk(start, name.as_str(), activation);
+}
+
+inline std::pair<std::shared_ptr<Object>, int> lookup_proto_chain(const std::shared_ptr<Object>& start,
+                                                                  const std::string& name,
+                                                                  const std::shared_ptr<Activation>& activation) {
+    if (activation) {
+        if (std::optional<Avm1Atom> atom = activation->atoms().get(name)) {
+            return lookup_proto_chain(start, *atom, activation);
+        }
+    }
+    return ProtoLookupCache::walk(start, name, activation);
+}
+
+inline std::shared_ptr<Value> Object::get(const std::string& name,
+                                          std::shared_ptr<Activation> activation) const {
+    auto it = properties_.find(name);
+    if (it != properties_.end()) {
+        return it->second;
+    }
+
+    // Search in prototype chain
+    if (auto proto = this->proto()) {
+        auto [holder, depth] = lookup_proto_chain(proto, name, activation);
+        if (holder) {
+            return holder->get_own(name, activation);
+        }
+    }
+
+    return std::make_shared<Value>(Value::UNDEFINED);
+}
+
+inline bool Object::has_property(const std::string& name,
+                                 std::shared_ptr<Activation> activation) const {
+    if (has_own_property(name, activation)) {
+        return true;
+    }
+    auto proto = this->proto();
+    return proto && lookup_proto_chain(proto, name, activation).first != nullptr;
 }
 
 // Helper function to find the resolve method in the prototype chain
-std::shared_ptr<Object> find_resolve_method(
+inline std::shared_ptr<Object> find_resolve_method(
     std::shared_ptr<Object> proto,
     std::shared_ptr<Activation> activation) {
-    
-    int depth = 0;
-    
-    while (proto) {
-        if (depth == 255) {
-            throw Avm1Exception(Avm1Error::prototype_recursion_limit());
-        }
-        
-        auto resolve_prop = proto->get("__resolve", activation);
+
+    if (!proto) {
+        return nullptr;
+    }
+
+    auto [holder, depth] = lookup_proto_chain(proto, "__resolve", activation);
+    if (holder) {
+        auto resolve_prop = holder->get_own("__resolve", activation);
         if (resolve_prop && resolve_prop->is_object()) {
             return resolve_prop->as_object();
         }
-        
-        proto = proto->proto();
-        depth++;
     }
-    
+
     return nullptr;
 }
 
+// Helper function to find a property in the prototype chain
+inline std::pair<std::shared_ptr<Value>, int> find_property(
+    std::shared_ptr<Object> this_obj,
+    const std::string& name,
+    std::shared_ptr<Activation> activation,
+    bool call_resolve_fn = true) {
+
+    if (this_obj) {
+        auto [holder, depth] = lookup_proto_chain(this_obj, name, activation);
+        if (holder) {
+            return std::make_pair(holder->get_own(name, activation), depth);
+        }
+    }
+
+    // If resolve function should be called and we found one
+    if (call_resolve_fn) {
+        auto resolve_method = find_resolve_method(this_obj, activation);
+        if (resolve_method) {
+            auto result = resolve_method->call("__resolve", activation, this_obj,
+                                            {std::make_shared<Value>(name)});
+            return std::make_pair(result, 0);
+        }
+    }
+
+    return std::make_pair(nullptr, -1);
+}
+
 } // namespace ruffle
 
 #endif // AVM1_OBJECT_H
\ No newline at end of file
@@ -0,0 +1,310 @@
+/*
+ * C++ header for the AVM1 profiler
+ * Per-function timing, opcode histograms, and flame graph / Chrome trace export
+ */
+
+#ifndef AVM1_PROFILER_H
+#define AVM1_PROFILER_H
+
+#include "avm1.h"
+#include "avm1/bytecode.h"
+#include "avm1/interpreter.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ruffle {
+
+class SwfMovie;
+
+// Opt-in profiler for AVM1 code.
+//
+// Every profiled call enters and leaves a frame on a shadow call stack.
+// Each function gets call counts and inclusive and exclusive time, and each
+// distinct call path accumulates exclusive time in a call tree, which is
+// what the folded-stack export is built from. Opcodes are counted through
+// the interpreter's `OpcodePairCounter` hook.
+//
+// Functions are identified by movie and body offset, so two closures over
+// the same code share a profile entry; the name is that of the first
+// activation (see `ActivationIdentifier`) it was seen running in.
+//
+// Calls hold the profiler weakly, so one that outlives its profile, such
+// as a call running while `Avm1::stop_profiling` is called, is left in the
+// profile it entered, if that is still alive, and otherwise not at all.
+class Avm1Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Complete events kept for the Chrome trace. Older calls are still
+    // counted, just not traced.
+    static constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    struct FunctionStats {
+        std::string name;
+        const SwfMovie* movie;
+        size_t offset;
+        uint64_t calls = 0;
+        std::chrono::nanoseconds inclusive{0};
+        std::chrono::nanoseconds exclusive{0};
+    };
+
+private:
+    struct FunctionKey {
+        const SwfMovie* movie;
+        size_t offset;
+
+        bool operator==(const FunctionKey& other) const {
+            return movie == other.movie && offset == other.offset;
+        }
+    };
+
+    struct FunctionKeyHash {
+        size_t operator()(const FunctionKey& key) const {
+            return std::hash<const void*>{}(key.movie) ^ (std::hash<size_t>{}(key.offset) << 1);
+        }
+    };
+
+    // A node per distinct call path. Node 0 is the root.
+    struct CallNode {
+        uint32_t function;
+        uint32_t parent;
+        std::unordered_map<uint32_t, uint32_t> children;
+        std::chrono::nanoseconds exclusive{0};
+    };
+
+    struct Frame {
+        uint32_t function;
+        uint32_t node;
+        Clock::time_point start;
+        std::chrono::nanoseconds children{0};
+        // Recursive calls only count once towards inclusive time.
+        bool outermost;
+    };
+
+    struct TraceEvent {
+        uint32_t function;
+        std::chrono::nanoseconds start;
+        std::chrono::nanoseconds duration;
+        uint32_t depth;
+    };
+
+    std::vector<FunctionStats> functions_;
+    std::unordered_map<FunctionKey, uint32_t, FunctionKeyHash> function_ids_;
+    std::vector<uint32_t> active_count_;
+    std::vector<CallNode> nodes_;
+    std::vector<Frame> stack_;
+    std::vector<TraceEvent> trace_;
+    Clock::time_point epoch_;
+    OpcodePairCounter opcodes_;
+
+    static void append_json_string(std::string& out, const std::string& str) {
+        out += '"';
+        for (char c : str) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buffer[8];
+                        snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                        out += buffer;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+
+    // Folded-stack frames are separated by ';', so it may not appear in
+    // a frame name.
+    static std::string folded_name(const std::string& name) {
+        std::string out = name;
+        for (char& c : out) {
+            if (c == ';' || c == ' ' || c == '\n') {
+                c = '_';
+            }
+        }
+        return out;
+    }
+
+public:
+    Avm1Profiler() : epoch_(Clock::now()) {
+        nodes_.push_back(CallNode{0, 0, {}, {}});
+    }
+
+    Avm1Profiler(const Avm1Profiler&) = delete;
+    Avm1Profiler& operator=(const Avm1Profiler&) = delete;
+
+    // Id of the function whose body starts at `offset` in `movie`, running
+    // in `activation`. Anonymous functions are named after their location.
+    uint32_t function_id(const SwfMovie* movie, size_t offset,
+                         const ActivationIdentifier& activation) {
+        const std::string& name = activation.description;
+        auto [it, inserted] = function_ids_.emplace(FunctionKey{movie, offset},
+                                                    static_cast<uint32_t>(functions_.size()));
+        if (inserted) {
+            FunctionStats stats;
+            stats.name = name.empty() ? "<anonymous>@" + std::to_string(offset)
+                                      : name + "@" + std::to_string(offset);
+            stats.movie = movie;
+            stats.offset = offset;
+            functions_.push_back(std::move(stats));
+            active_count_.push_back(0);
+        }
+        return it->second;
+    }
+
+    void enter(uint32_t function) {
+        uint32_t parent = stack_.empty() ? 0 : stack_.back().node;
+        auto [child, inserted] = nodes_[parent].children.emplace(
+            function, static_cast<uint32_t>(nodes_.size()));
+        uint32_t node = child->second;
+        if (inserted) {
+            nodes_.push_back(CallNode{function, parent, {}, {}});
+        }
+        bool outermost = active_count_[function]++ == 0;
+        stack_.push_back(Frame{function, node, Clock::now(), {}, outermost});
+    }
+
+    void exit() {
+        if (stack_.empty()) {
+            return;
+        }
+        Frame frame = stack_.back();
+        stack_.pop_back();
+        auto end = Clock::now();
+        auto inclusive = std::chrono::duration_cast<std::chrono::nanoseconds>(end - frame.start);
+        auto exclusive = inclusive - frame.children;
+
+        FunctionStats& stats = functions_[frame.function];
+        stats.calls++;
+        stats.exclusive += exclusive;
+        if (frame.outermost) {
+            stats.inclusive += inclusive;
+        }
+        active_count_[frame.function]--;
+        nodes_[frame.node].exclusive += exclusive;
+        if (!stack_.empty()) {
+            stack_.back().children += inclusive;
+        }
+
+        if (trace_.size() < MAX_TRACE_EVENTS) {
+            trace_.push_back(TraceEvent{
+                frame.function,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(frame.start - epoch_),
+                inclusive, static_cast<uint32_t>(stack_.size())});
+        }
+    }
+
+    // Pass to `Interpreter::run` to count executed opcodes.
+    OpcodePairCounter* opcode_counter() { return &opcodes_; }
+
+    // Executions of each opcode. Superinstructions count as the opcodes
+    // they replace.
+    const std::array<uint64_t, 256>& opcode_histogram() const { return opcodes_.opcode_counts(); }
+
+    const std::vector<FunctionStats>& functions() const { return functions_; }
+    const OpcodePairCounter& opcode_pairs() const { return opcodes_; }
+
+    // One line per call path, "outer;inner microseconds", for flamegraph.pl
+    // and compatible tools. Paths with no exclusive time are omitted.
+    std::string folded_stacks() const {
+        std::string out;
+        std::vector<uint32_t> path;
+        for (uint32_t node = 1; node < nodes_.size(); ++node) {
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                nodes_[node].exclusive).count();
+            if (micros <= 0) {
+                continue;
+            }
+            path.clear();
+            for (uint32_t n = node; n != 0; n = nodes_[n].parent) {
+                path.push_back(n);
+            }
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                if (it != path.rbegin()) {
+                    out += ';';
+                }
+                out += folded_name(functions_[nodes_[*it].function].name);
+            }
+            out += ' ';
+            out += std::to_string(micros);
+            out += '\n';
+        }
+        return out;
+    }
+
+    // The recorded calls as Chrome trace "complete" events, for
+    // chrome://tracing and Perfetto.
+    std::string chrome_trace_json() const {
+        std::string out = "{\"traceEvents\":[";
+        char buffer[96];
+        for (size_t i = 0; i < trace_.size(); ++i) {
+            const TraceEvent& event = trace_[i];
+            if (i != 0) {
+                out += ',';
+            }
+            out += "{\"name\":";
+            append_json_string(out, functions_[event.function].name);
+            snprintf(buffer, sizeof(buffer),
+                     ",\"cat\":\"avm1\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                     event.start.count() / 1000.0, event.duration.count() / 1000.0);
+            out += buffer;
+        }
+        out += "],\"displayTimeUnit\":\"ms\"}";
+        return out;
+    }
+
+    // Drop everything recorded so far. Frames still on the stack are
+    // discarded too, so only call this between frames.
+    void clear() {
+        functions_.clear();
+        function_ids_.clear();
+        active_count_.clear();
+        nodes_.clear();
+        nodes_.push_back(CallNode{0, 0, {}, {}});
+        stack_.clear();
+        trace_.clear();
+        opcodes_.clear();
+        epoch_ = Clock::now();
+    }
+};
+
+// Enters a profiler frame for the lifetime of the guard, and leaves it in
+// the same profiler if that is still alive. An empty profiler makes the
+// guard a no-op.
+class ProfilerFrame {
+private:
+    std::weak_ptr<Avm1Profiler> profiler_;
+
+public:
+    ProfilerFrame(std::weak_ptr<Avm1Profiler> profiler, uint32_t function)
+        : profiler_(std::move(profiler)) {
+        if (auto active = profiler_.lock()) {
+            active->enter(function);
+        }
+    }
+
+    ~ProfilerFrame() {
+        if (auto active = profiler_.lock()) {
+            active->exit();
+        }
+    }
+
+    ProfilerFrame(const ProfilerFrame&) = delete;
+    ProfilerFrame& operator=(const ProfilerFrame&) = delete;
+};
+
+} // namespace ruffle
+
+#endif // AVM1_PROFILER_H
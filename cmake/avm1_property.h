@@ -115,6 +115,17 @@ public:
         }
     }
 
+    // Overwrite the stored value, reusing its allocation when nothing else
+    // holds it. For writable data properties without version bits, where
+    // `set_data` would have nothing else to do.
+    void assign_data(Value value) {
+        if (data_ && data_.use_count() == 1) {
+            *data_ = std::move(value);
+        } else {
+            data_ = std::make_shared<Value>(std::move(value));
+        }
+    }
+
     // Make this property virtual by attaching a getter/setter to it.
     void set_virtual(std::shared_ptr<Object> getter, 
                     std::optional<std::shared_ptr<Object>> setter) {
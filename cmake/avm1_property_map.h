@@ -9,72 +9,20 @@
 #include "avm1.h"
 #include "avm1/value.h"
 #include "avm1/object.h"
+#include "avm1/atom.h"
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <optional>
 #include <functional>
 #include <algorithm>
-#include <cctype>
 
 namespace ruffle {
 
-// Helper function to convert string to lowercase for case-insensitive comparison
-inline std::string to_lowercase(const std::string& str) {
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), 
-                   [](unsigned char c) { return std::tolower(c); });
-    return result;
-}
-
-// Property name wrapper that handles case sensitivity
-class PropertyName {
-private:
-    std::string name_;
-    std::string lowercase_name_;  // For case-insensitive comparisons
-
-public:
-    explicit PropertyName(const std::string& name) 
-        : name_(name), lowercase_name_(to_lowercase(name)) {}
-
-    const std::string& name() const { return name_; }
-    const std::string& lowercase_name() const { return lowercase_name_; }
-
-    bool operator==(const PropertyName& other) const {
-        return name_ == other.name_;
-    }
-
-    bool operator!=(const PropertyName& other) const {
-        return !(*this == other);
-    }
-};
-
-// Hash function for PropertyName
-struct PropertyNameHash {
-    std::size_t operator()(const PropertyName& prop_name) const {
-        // Use case-insensitive hash for SWF compatibility
-        std::size_t h = 0;
-        for (char c : prop_name.lowercase_name()) {
-            h ^= std::hash<char>{}(std::tolower(c)) + 0x9e3779b9 + (h << 6) + (h >> 2);
-        }
-        return h;
-    }
-};
-
-// Case-insensitive comparator
-struct CaseInsensitiveComparator {
-    bool operator()(const std::string& a, const std::string& b) const {
-        return to_lowercase(a) == to_lowercase(b);
-    }
-};
-
-// Case-sensitive comparator
-struct CaseSensitiveComparator {
-    bool operator()(const std::string& a, const std::string& b) const {
-        return a == b;
-    }
-};
+template<typename V>
+class PropertyMap;
 
 // Entry enum for property map operations
 template<typename V>
@@ -86,11 +34,11 @@ private:
     Type type_;
     std::string key_;
     V* value_ptr_;  // For occupied entries
-    std::unordered_map<PropertyName, V, PropertyNameHash>* map_ptr_;  // For vacant entries
+    PropertyMap<V>* map_ptr_;  // For vacant entries
 
 public:
-    Entry(Type type, const std::string& key, V* value = nullptr, 
-          std::unordered_map<PropertyName, V, PropertyNameHash>* map = nullptr)
+    Entry(Type type, const std::string& key, V* value = nullptr,
+          PropertyMap<V>* map = nullptr)
         : type_(type), key_(key), value_ptr_(value), map_ptr_(map) {}
 
     Type type() const { return type_; }
@@ -105,7 +53,7 @@ public:
 
     void insert_value(const V& value) {
         if (type_ == Type::VACANT && map_ptr_) {
-            map_ptr_->insert({PropertyName(key_), value});
+            map_ptr_->insert(key_, value, true);
         }
     }
 };
@@ -114,31 +62,26 @@ public:
 template<typename V>
 class OccupiedEntry {
 private:
-    std::unordered_map<PropertyName, V, PropertyNameHash>* map_;
-    typename std::unordered_map<PropertyName, V, PropertyNameHash>::iterator iter_;
+    PropertyMap<V>* map_;
+    uint32_t slot_;
 
 public:
-    OccupiedEntry(std::unordered_map<PropertyName, V, PropertyNameHash>* map,
-                  typename std::unordered_map<PropertyName, V, PropertyNameHash>::iterator iter)
-        : map_(map), iter_(iter) {}
+    OccupiedEntry(PropertyMap<V>* map, uint32_t slot)
+        : map_(map), slot_(slot) {}
 
-    V& get() { return iter_->second; }
-    const V& get() const { return iter_->second; }
+    V& get() { return map_->slot_value(slot_); }
+    const V& get() const { return map_->slot_value(slot_); }
 
-    V& get_mut() { return iter_->second; }
+    V& get_mut() { return map_->slot_value(slot_); }
 
     V insert(V value) {
-        V old_value = std::move(iter_->second);
-        iter_->second = std::move(value);
+        V old_value = std::move(map_->slot_value(slot_));
+        map_->slot_value(slot_) = std::move(value);
         return old_value;
     }
 
     std::pair<std::string, V> remove_entry() {
-        std::string key = iter_->first.name();
-        V value = std::move(iter_->second);
-        auto next_iter = map_->erase(iter_);
-        (void)next_iter; // Suppress unused warning
-        return {key, std::move(value)};
+        return map_->remove_slot(slot_);
     }
 };
 
@@ -146,203 +89,242 @@ public:
 template<typename V>
 class VacantEntry {
 private:
-    std::unordered_map<PropertyName, V, PropertyNameHash>* map_;
+    PropertyMap<V>* map_;
     std::string key_;
 
 public:
-    VacantEntry(std::unordered_map<PropertyName, V, PropertyNameHash>* map, const std::string& key)
+    VacantEntry(PropertyMap<V>* map, const std::string& key)
         : map_(map), key_(key) {}
 
     void insert(V value) {
-        map_->insert({PropertyName(key_), std::move(value)});
+        map_->insert(key_, std::move(value), true);
     }
 };
 
 // Property map class for AVM1
+//
+// Entries live in a slot array in insertion order. Two hash indexes map
+// the exact hash and the ASCII-folded hash of each key to its slot, so
+// lookups are hashed in both case-sensitive (SWFv7+) and case-insensitive
+// modes.
+//
+// Removing an entry leaves a tombstone in the slot array, keeping removal
+// O(1). Once tombstones outnumber live entries, the array is compacted and
+// the indexes rebuilt.
 template<typename V>
 class PropertyMap {
 private:
-    std::unordered_map<PropertyName, V, PropertyNameHash> map_;
-    std::vector<PropertyName> insertion_order_;  // To maintain insertion order
+    struct Slot {
+        std::string key;
+        size_t hash;
+        size_t folded_hash;
+        std::optional<V> value;  // Empty for a tombstone
 
-public:
-    PropertyMap() = default;
+        bool is_live() const { return value.has_value(); }
+    };
 
-    // Check if the map contains a key
-    bool contains_key(const std::string& key, bool case_sensitive) const {
+    // Compaction is not worth it for tiny maps.
+    static constexpr size_t MIN_COMPACT_TOMBSTONES = 8;
+
+    std::vector<Slot> slots_;
+    std::unordered_multimap<size_t, uint32_t> exact_index_;
+    std::unordered_multimap<size_t, uint32_t> folded_index_;
+    size_t tombstones_ = 0;
+
+    // Slot holding `key`, or nullopt. Case-insensitive lookups return the
+    // earliest matching entry, as a scan in insertion order would.
+    std::optional<uint32_t> find(std::string_view key, bool case_sensitive) const {
         if (case_sensitive) {
-            return map_.find(PropertyName(key)) != map_.end();
-        } else {
-            // For case-insensitive search, we need to iterate
-            for (const auto& [prop_name, value] : map_) {
-                if (CaseInsensitiveComparator{}(prop_name.name(), key)) {
-                    return true;
+            auto range = exact_index_.equal_range(avm1_name_hash(key));
+            for (auto it = range.first; it != range.second; ++it) {
+                if (slots_[it->second].key == key) {
+                    return it->second;
                 }
             }
-            return false;
+            return std::nullopt;
+        }
+
+        std::optional<uint32_t> found;
+        auto range = folded_index_.equal_range(avm1_folded_name_hash(key));
+        for (auto it = range.first; it != range.second; ++it) {
+            if ((!found || it->second < *found) &&
+                avm1_eq_ignore_case(slots_[it->second].key, key)) {
+                found = it->second;
+            }
         }
+        return found;
     }
 
-    // Get a value by key
-    std::optional<V> get(const std::string& key, bool case_sensitive) const {
-        if (case_sensitive) {
-            auto it = map_.find(PropertyName(key));
-            if (it != map_.end()) {
-                return it->second;
+    static void unindex(std::unordered_multimap<size_t, uint32_t>& index, size_t hash, uint32_t slot) {
+        auto range = index.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == slot) {
+                index.erase(it);
+                return;
             }
-        } else {
-            // For case-insensitive search
-            for (const auto& [prop_name, value] : map_) {
-                if (CaseInsensitiveComparator{}(prop_name.name(), key)) {
-                    return value;
-                }
+        }
+    }
+
+    uint32_t push_slot(const std::string& key, V value) {
+        uint32_t slot = static_cast<uint32_t>(slots_.size());
+        size_t hash = avm1_name_hash(key);
+        size_t folded_hash = avm1_folded_name_hash(key);
+        slots_.push_back(Slot{key, hash, folded_hash, std::move(value)});
+        exact_index_.emplace(hash, slot);
+        folded_index_.emplace(folded_hash, slot);
+        return slot;
+    }
+
+    void compact() {
+        std::vector<Slot> live;
+        live.reserve(slots_.size() - tombstones_);
+        for (auto& slot : slots_) {
+            if (slot.is_live()) {
+                live.push_back(std::move(slot));
             }
         }
+        slots_ = std::move(live);
+        exact_index_.clear();
+        folded_index_.clear();
+        for (uint32_t i = 0; i < slots_.size(); ++i) {
+            exact_index_.emplace(slots_[i].hash, i);
+            folded_index_.emplace(slots_[i].folded_hash, i);
+        }
+        tombstones_ = 0;
+    }
+
+    friend class OccupiedEntry<V>;
+
+    V& slot_value(uint32_t slot) { return *slots_[slot].value; }
+
+    std::pair<std::string, V> remove_slot(uint32_t index) {
+        Slot& slot = slots_[index];
+        unindex(exact_index_, slot.hash, index);
+        unindex(folded_index_, slot.folded_hash, index);
+        std::pair<std::string, V> removed{std::move(slot.key), std::move(*slot.value)};
+        slot.key.clear();
+        slot.value.reset();
+        tombstones_++;
+        if (tombstones_ >= MIN_COMPACT_TOMBSTONES && tombstones_ > slots_.size() / 2) {
+            compact();
+        }
+        return removed;
+    }
+
+public:
+    PropertyMap() = default;
+
+    // Check if the map contains a key
+    bool contains_key(const std::string& key, bool case_sensitive) const {
+        return find(key, case_sensitive).has_value();
+    }
+
+    // Get a value by key
+    std::optional<V> get(const std::string& key, bool case_sensitive) const {
+        if (auto slot = find(key, case_sensitive)) {
+            return slots_[*slot].value;
+        }
         return std::nullopt;
     }
 
     // Get a mutable reference to a value by key
     std::optional<std::reference_wrapper<V>> get_mut(const std::string& key, bool case_sensitive) {
-        if (case_sensitive) {
-            auto it = map_.find(PropertyName(key));
-            if (it != map_.end()) {
-                return std::ref(it->second);
-            }
-        } else {
-            // For case-insensitive search
-            for (auto& [prop_name, value] : map_) {
-                if (CaseInsensitiveComparator{}(prop_name.name(), key)) {
-                    return std::ref(value);
-                }
-            }
+        if (auto slot = find(key, case_sensitive)) {
+            return std::ref(*slots_[*slot].value);
         }
         return std::nullopt;
     }
 
     // Get a value by index (based on insertion order)
     std::optional<V> get_index(size_t index) const {
-        if (index < insertion_order_.size()) {
-            auto it = map_.find(insertion_order_[index]);
-            if (it != map_.end()) {
-                return it->second;
+        if (tombstones_ == 0) {
+            if (index < slots_.size()) {
+                return slots_[index].value;
+            }
+            return std::nullopt;
+        }
+        for (const auto& slot : slots_) {
+            if (slot.is_live() && index-- == 0) {
+                return slot.value;
             }
         }
         return std::nullopt;
     }
 
-    // Insert a key-value pair
+    // Number of live entries
+    size_t len() const { return slots_.size() - tombstones_; }
+
+    // Insert a key-value pair. An existing entry that matches `key` keeps
+    // its original spelling and position.
     std::optional<V> insert(const std::string& key, V value, bool case_sensitive) {
-        auto prop_name = PropertyName(key);
-        auto it = map_.find(prop_name);
-        
-        if (it != map_.end()) {
-            // Key exists, replace value
-            V old_value = std::move(it->second);
-            it->second = std::move(value);
+        if (auto slot = find(key, case_sensitive)) {
+            V old_value = std::move(*slots_[*slot].value);
+            slots_[*slot].value = std::move(value);
             return old_value;
-        } else {
-            // Key doesn't exist, insert new
-            map_.insert({prop_name, std::move(value)});
-            insertion_order_.push_back(prop_name);
-            return std::nullopt;
         }
+        push_slot(key, std::move(value));
+        return std::nullopt;
     }
 
     // Remove a key-value pair
     std::optional<V> remove(const std::string& key, bool case_sensitive) {
-        if (case_sensitive) {
-            auto it = map_.find(PropertyName(key));
-            if (it != map_.end()) {
-                V value = std::move(it->second);
-                map_.erase(it);
-                // Remove from insertion order
-                auto order_it = std::find(insertion_order_.begin(), insertion_order_.end(), 
-                                         PropertyName(key));
-                if (order_it != insertion_order_.end()) {
-                    insertion_order_.erase(order_it);
-                }
-                return value;
-            }
-        } else {
-            // For case-insensitive removal
-            for (auto it = map_.begin(); it != map_.end(); ++it) {
-                if (CaseInsensitiveComparator{}(it->first.name(), key)) {
-                    V value = std::move(it->second);
-                    auto key_to_remove = it->first;
-                    map_.erase(it);
-                    // Remove from insertion order
-                    auto order_it = std::find(insertion_order_.begin(), insertion_order_.end(), 
-                                             key_to_remove);
-                    if (order_it != insertion_order_.end()) {
-                        insertion_order_.erase(order_it);
-                    }
-                    return value;
-                }
-            }
+        if (auto slot = find(key, case_sensitive)) {
+            return remove_slot(*slot).second;
         }
         return std::nullopt;
     }
 
     // Get entry for operations
     Entry<V> entry(const std::string& key, bool case_sensitive) {
-        if (case_sensitive) {
-            auto it = map_.find(PropertyName(key));
-            if (it != map_.end()) {
-                return Entry<V>(Entry<V>::Type::OCCUPIED, key, &it->second);
-            } else {
-                return Entry<V>(Entry<V>::Type::VACANT, key, nullptr, &map_);
-            }
-        } else {
-            // For case-insensitive search
-            for (auto& [prop_name, value] : map_) {
-                if (CaseInsensitiveComparator{}(prop_name.name(), key)) {
-                    return Entry<V>(Entry<V>::Type::OCCUPIED, key, &value);
-                }
-            }
-            return Entry<V>(Entry<V>::Type::VACANT, key, nullptr, &map_);
+        if (auto slot = find(key, case_sensitive)) {
+            return Entry<V>(Entry<V>::Type::OCCUPIED, key, &*slots_[*slot].value);
         }
+        return Entry<V>(Entry<V>::Type::VACANT, key, nullptr, this);
     }
 
     // Iterator for values (in reverse insertion order to match Flash's behavior)
     class Iterator {
     private:
-        typename std::vector<PropertyName>::reverse_iterator order_it_;
-        typename std::vector<PropertyName>::reverse_iterator order_end_;
-        const std::unordered_map<PropertyName, V, PropertyNameHash>& map_;
+        typename std::vector<Slot>::const_reverse_iterator it_;
+        typename std::vector<Slot>::const_reverse_iterator end_;
+
+        void skip_tombstones() {
+            while (it_ != end_ && !it_->is_live()) {
+                ++it_;
+            }
+        }
 
     public:
-        Iterator(typename std::vector<PropertyName>::reverse_iterator begin,
-                 typename std::vector<PropertyName>::reverse_iterator end,
-                 const std::unordered_map<PropertyName, V, PropertyNameHash>& map)
-            : order_it_(begin), order_end_(end), map_(map) {}
+        Iterator(typename std::vector<Slot>::const_reverse_iterator begin,
+                 typename std::vector<Slot>::const_reverse_iterator end)
+            : it_(begin), end_(end) {
+            skip_tombstones();
+        }
 
         std::pair<std::string, V> operator*() const {
-            auto it = map_.find(*order_it_);
-            if (it != map_.end()) {
-                return {it->first.name(), it->second};
-            }
-            return {"", V{}};
+            return {it_->key, *it_->value};
         }
 
         Iterator& operator++() {
-            ++order_it_;
+            ++it_;
+            skip_tombstones();
             return *this;
         }
 
         bool operator!=(const Iterator& other) const {
-            return order_it_ != other.order_it_;
+            return it_ != other.it_;
         }
     };
 
     Iterator begin() const {
-        return Iterator(insertion_order_.rbegin(), insertion_order_.rend(), map_);
+        return Iterator(slots_.crbegin(), slots_.crend());
     }
 
     Iterator end() const {
-        return Iterator(insertion_order_.rend(), insertion_order_.rend(), map_);
+        return Iterator(slots_.crend(), slots_.crend());
     }
 };
 
 } // namespace ruffle
 
-#endif // AVM1_PROPERTY_MAP_H
\ No newline at end of file
+#endif // AVM1_PROPERTY_MAP_H
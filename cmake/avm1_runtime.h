@@ -12,10 +12,31 @@
 #include "avm1/activation.h"
 #include "avm1/error.h"
 #include "avm1/scope.h"
+#include "avm1/atom.h"
+#include "avm1/enumerator.h"
+#include "avm1/value_stack.h"
+#include "avm1/activation_pool.h"
+#include "avm1/gc.h"
+#include "avm1/profiler.h"
+#include "avm1/bytecode_cache.h"
+#include "avm1/target_path.h"
 #include "avm1/property_map.h"
 #include "avm1/globals.h"
 #include "avm1/globals/as_broadcaster.h"
+#include "avm1/interpreter.h"
+#include "avm1/script_object.h"
+#include "avm1/function.h"
+#include "avm1/callable_value.h"
+#include "movie_clip.h"
+#include "avm1/stage_object.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <random>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -65,30 +86,92 @@ public:
     const BroadcasterFunctions& broadcaster_functions() const { return broadcaster_functions_; }
     PropertyMap<std::shared_ptr<Object>>& constructor_registry() { return constructor_registry_; }
     const PropertyMap<std::shared_ptr<Object>>& constructor_registry() const { return constructor_registry_; }
+
+    // Garbage collection roots
+    void gc_trace(GcTracer& tracer) const {
+        tracer.visit_scope(global_scope_.get());
+        prototypes_.gc_trace(tracer);
+        for (const auto& [name, constructor] : constructor_registry_) {
+            tracer.visit(constructor);
+        }
+    }
 };
 
 // AVM1 runtime class
 class Avm1 {
 private:
+    // Declared first so that it outlives every object it manages. Entered
+    // (see `enter_heap`) while the globals are created and whenever script
+    // runs, so that the runtime's objects are allocated in it.
+    std::unique_ptr<GcHeap> gc_heap_;
     GlobalEnv global_env_;
     GlobalEnv global_env_swf6_;  // Separate environment for SWF6 (case-insensitive)
     bool halted_;
     bool show_debug_output_;
     std::vector<std::shared_ptr<Activation>> active_activations_;
+    // Operand stack and registers shared by all nested activations.
+    std::shared_ptr<ValueStack> value_stack_;
+    // Interned strings for compact values. Declared before the caches that
+    // bind atoms of it.
+    Avm1AtomTable atoms_;
+    // Decoded action blocks, keyed by movie and offset.
+    BytecodeCache bytecode_cache_;
+    // Activations reused across function calls.
+    ActivationPool activation_pool_;
+    // Parsed and resolved tellTarget/eval paths.
+    TargetPathCache target_path_cache_;
+    // Holders of properties found on prototype chains.
+    ProtoLookupCache proto_lookup_cache_;
+    // Null unless profiling was started.
+    std::shared_ptr<Avm1Profiler> profiler_;
     int max_recursion_depth_;
+    // Script function calls in progress, nested or on interpreter frame
+    // stacks.
+    int call_depth_;
     int max_execution_units_;
     bool debug_output_;
 
+    static GlobalEnv create_global_env(GcHeap& heap, std::shared_ptr<StringContext> context) {
+        GcHeapScope scope(heap);
+        return GlobalEnv::create(std::move(context));
+    }
+
 public:
     Avm1(std::shared_ptr<StringContext> context)
-        : global_env_(GlobalEnv::create(context)),
-          global_env_swf6_(GlobalEnv::create(context)),
+        : gc_heap_(std::make_unique<GcHeap>()),
+          global_env_(create_global_env(*gc_heap_, context)),
+          global_env_swf6_(create_global_env(*gc_heap_, context)),
           halted_(false),
           show_debug_output_(false),
+          value_stack_(std::make_shared<ValueStack>()),
+          bytecode_cache_(atoms_),
           max_recursion_depth_(256),
+          call_depth_(0),
           max_execution_units_(1000000),
           debug_output_(false) {}
 
+    // Get the garbage collected heap
+    GcHeap& gc_heap() { return *gc_heap_; }
+
+    // Make this runtime's heap current on this thread until the returned
+    // scope ends. Every entry point that runs script holds one.
+    GcHeapScope enter_heap() { return GcHeapScope(*gc_heap_); }
+
+    // Run incremental collection for at most about `budget`. Called once
+    // per frame, between frames, when no AVM1 code is running. Returns true
+    // if a collection cycle completed.
+    bool run_gc_slice(std::chrono::microseconds budget) {
+        if (!active_activations_.empty()) {
+            return false;
+        }
+        return gc_heap_->step(budget, [this](GcTracer& tracer) { gc_trace_roots(tracer); });
+    }
+
+    // Run a full collection cycle.
+    void collect_garbage() {
+        gc_heap_->collect([this](GcTracer& tracer) { gc_trace_roots(tracer); });
+    }
+
     // Get the global scope for the current SWF version
     std::shared_ptr<Scope> global_scope(int swf_version) const {
         if (swf_version <= 6) {
@@ -156,6 +239,7 @@ public:
         if (halted_) {
             return nullptr;
         }
+        auto heap_scope = enter_heap();
 
         // Create an activation for execution
         auto activation = std::make_shared<Activation>(
@@ -164,26 +248,90 @@ public:
             target_clip, 
             target_clip->object1(), 
             nullptr,  // No function for top-level execution
-            ActivationIdentifier(0, "top_level_action"));
+            ActivationIdentifier(0, "top_level_action"),
+            value_stack_);
 
         // Add to active activations
         active_activations_.push_back(activation);
+        auto leave = [&] {
+            active_activations_.erase(
+                std::remove(active_activations_.begin(), active_activations_.end(), activation),
+                active_activations_.end());
+        };
 
+        std::shared_ptr<Value> result;
         try {
-            // Execute the action script
-            // This would involve parsing and executing the SWF bytecode
-            // For now, we'll return undefined
-            return std::make_shared<Value>(Value::UNDEFINED);
+            result = activation->run_with_data(std::move(action_data));
         } catch (const Avm1Exception& e) {
             // Handle the error with the root error handler
             root_error_handler(activation, e.get_error());
-            return std::make_shared<Value>(Value::UNDEFINED);
-        } finally {
-            // Remove from active activations
-            active_activations_.erase(
-                std::remove(active_activations_.begin(), active_activations_.end(), activation),
-                active_activations_.end());
+            result = std::make_shared<Value>(Value::UNDEFINED);
+        } catch (...) {
+            leave();
+            throw;
+        }
+        leave();
+        return result;
+    }
+
+    // Run `call` from the player rather than from an action block, such as
+    // a timer callback, in a fresh activation on `clip`. Script errors are
+    // reported, not thrown.
+    void run_from_player(std::shared_ptr<UpdateContext> context,
+                         std::shared_ptr<MovieClip> clip,
+                         const std::string& name,
+                         const std::function<void(std::shared_ptr<Activation>)>& call);
+
+    // Visit every root owned by the runtime. Roots held by the player (the
+    // display list, timers) are registered by its `UpdateContext` with
+    // `GcHeap::add_root_source`.
+    void gc_trace_roots(GcTracer& tracer) const {
+        global_env_.gc_trace(tracer);
+        global_env_swf6_.gc_trace(tracer);
+        for (const auto& activation : active_activations_) {
+            activation->gc_trace(tracer);
         }
+        for (size_t i = 0; i < value_stack_->len(); ++i) {
+            tracer.visit_value(value_stack_->slot(i));
+        }
+    }
+
+    // Get the shared value stack
+    std::shared_ptr<ValueStack> value_stack() const { return value_stack_; }
+
+    // Get the bytecode cache
+    BytecodeCache& bytecode_cache() { return bytecode_cache_; }
+
+    // Get the activation pool
+    ActivationPool& activation_pool() { return activation_pool_; }
+
+    // Get the target path cache
+    TargetPathCache& target_path_cache() { return target_path_cache_; }
+
+    // Get the prototype lookup cache
+    ProtoLookupCache& proto_lookup_cache() { return proto_lookup_cache_; }
+
+    // Get the atom table
+    Avm1AtomTable& atoms() { return atoms_; }
+
+    // Start recording a profile. Any profile already being recorded is kept.
+    Avm1Profiler& start_profiling() {
+        if (!profiler_) {
+            profiler_ = std::make_shared<Avm1Profiler>();
+        }
+        return *profiler_;
+    }
+
+    // Stop profiling and return what was recorded.
+    std::shared_ptr<Avm1Profiler> stop_profiling() { return std::move(profiler_); }
+
+    // The active profiler, or null. Calls keep a weak reference to it (see
+    // `ProfilerFrame`).
+    const std::shared_ptr<Avm1Profiler>& profiler() const { return profiler_; }
+
+    // Opcode counter for `Interpreter::run`, or null when not profiling.
+    OpcodePairCounter* opcode_counter() {
+        return profiler_ ? profiler_->opcode_counter() : nullptr;
     }
 
     // Get the maximum recursion depth
@@ -192,6 +340,24 @@ public:
     // Set the maximum recursion depth
     void set_max_recursion_depth(int depth) { max_recursion_depth_ = depth; }
 
+    // Count a script function call against the recursion limit. Calls no
+    // longer use native stack, so this is the only bound on their depth.
+    void enter_call() {
+        if (call_depth_ >= max_recursion_depth_) {
+            throw Avm1Exception(Avm1Error::function_recursion_limit(
+                static_cast<uint16_t>(max_recursion_depth_)));
+        }
+        call_depth_++;
+    }
+
+    void leave_call() {
+        if (call_depth_ > 0) {
+            call_depth_--;
+        }
+    }
+
+    int call_depth() const { return call_depth_; }
+
     // Get the maximum execution units
     int max_execution_units() const { return max_execution_units_; }
 
@@ -215,6 +381,1213 @@ public:
     }
 };
 
+inline void Activation::gc_trace(GcTracer& tracer) const {
+    tracer.visit_scope(scope_.get());
+    tracer.visit(this_object_);
+    tracer.visit(callee_object_);
+    tracer.visit(arguments_object_);
+    tracer.visit(super_object_);
+    if (function_) {
+        tracer.visit_scope(function_->scope().get());
+    }
+    if (call_) {
+        tracer.visit(call_->constructed);
+        if (call_->activation) {
+            call_->activation->gc_trace(tracer);
+        }
+    }
+}
+
+inline Activation* Activation::begin_call(const DecodedActions*& body) {
+    auto& avm = *context_->avm1;
+    try {
+        avm.enter_call();
+    } catch (...) {
+        abort_call(nullptr);
+        throw;
+    }
+    if (call_->profile_id) {
+        if (auto profiler = call_->profiler.lock()) {
+            profiler->enter(*call_->profile_id);
+        }
+    }
+    body = call_->body.get();
+    return call_->activation.get();
+}
+
+inline void Activation::end_call(Activation* callee, std::optional<CompactValue> result) {
+    PreparedCall call = std::move(*call_);
+    call_.reset();
+    auto& avm = *context_->avm1;
+    if (call.profile_id) {
+        if (auto profiler = call.profiler.lock()) {
+            profiler->exit();
+        }
+    }
+    avm.leave_call();
+    // The callee's frame sits above the arguments; leave it first.
+    avm.activation_pool().release(std::move(call.activation));
+    value_stack_->drop(frame_, call.caller_args);
+    CompactValue value = result ? *result : CompactValue::undefined();
+    if (call.constructed && !value.is_object()) {
+        // The constructed object is only held by the call; keep it alive
+        // on the stack.
+        push(value_stack_->own_object(std::move(call.constructed)));
+        return;
+    }
+    push(value);
+}
+
+inline void Activation::abort_call(Activation* callee) noexcept {
+    if (!call_) {
+        return;
+    }
+    PreparedCall call = std::move(*call_);
+    call_.reset();
+    auto& avm = *context_->avm1;
+    // A callee that was never begun was not counted.
+    if (callee) {
+        if (call.profile_id) {
+            if (auto profiler = call.profiler.lock()) {
+                profiler->exit();
+            }
+        }
+        avm.leave_call();
+    }
+    avm.activation_pool().release(std::move(call.activation));
+    value_stack_->drop(frame_, call.caller_args);
+}
+
+inline void Activation::push_enumeration(CompactValue object) {
+    push(CompactValue::undefined());
+    Object* target = object.as_object();
+    if (!target) {
+        return;
+    }
+    const Avm1AtomTable& atoms = context_->avm1->atoms();
+    // The enumerator keeps the object alive while keys are owned, which
+    // may sweep.
+    KeyEnumerator keys(target->shared_from_this());
+    while (std::optional<Avm1Atom> key = keys.next(atoms, *value_stack_)) {
+        push(CompactValue::string(*key));
+    }
+}
+
+inline uint8_t Activation::swf_version() const {
+    return base_clip_->swf_version();
+}
+
+inline ExecutionLimit& Activation::execution_limit() {
+    return context_->execution_limit;
+}
+
+inline Avm1AtomTable& Activation::atoms() {
+    return context_->avm1->atoms();
+}
+
+inline ProtoLookupCache& Activation::proto_lookup_cache() {
+    return context_->avm1->proto_lookup_cache();
+}
+
+inline CompactValue Activation::compact(const Value& value) {
+    switch (value.type()) {
+        case ValueType::STRING:
+            // Most stored strings came from a constant pool, so reuse their
+            // atom rather than copying the text onto the value stack.
+            if (std::optional<Avm1Atom> atom = atoms().get(value.as_string())) {
+                return CompactValue::string(*atom);
+            }
+            return CompactValue::string(own_string(value.as_string()));
+        case ValueType::OBJECT:
+            return value_stack_->own_object(value.as_object());
+        default:
+            return CompactValue::from_value(value, atoms());
+    }
+}
+
+// The display object an AVM1 object stands for, if any.
+inline std::shared_ptr<DisplayObject> display_object_of(const Object& object) {
+    if (auto clip = object.native().get<MovieClip>()) {
+        return clip;
+    }
+    return object.native().get<DisplayObject>();
+}
+
+// The dot-syntax path of a display object, as `_level0.menu.item`.
+inline std::string display_path(const std::shared_ptr<DisplayObject>& object) {
+    if (!object->parent()) {
+        return "_level0";
+    }
+    return display_path(object->parent()) + "." + object->name();
+}
+
+inline CompactValue Activation::root_object() const {
+    auto root = base_clip_ ? base_clip_->root() : nullptr;
+    auto object = root ? root->object1() : nullptr;
+    return object ? CompactValue::object(object.get()) : CompactValue::undefined();
+}
+
+inline CompactValue Activation::parent_object() const {
+    auto parent = base_clip_ ? base_clip_->parent() : nullptr;
+    auto object = parent ? parent->object1() : nullptr;
+    return object ? CompactValue::object(object.get()) : CompactValue::undefined();
+}
+
+inline Value Activation::to_primitive(const Value& value) {
+    std::shared_ptr<Object> object = value.as_object();
+    if (!object) {
+        return value;
+    }
+    auto self = shared_from_this();
+    auto result = object->call("valueOf", self, object, {});
+    if (result && result->is_primitive()) {
+        return *result;
+    }
+    result = object->call("toString", self, object, {});
+    if (result && result->is_primitive()) {
+        return *result;
+    }
+    return Value::string("[type Object]");
+}
+
+inline double Activation::to_number(const Value& value) {
+    Value primitive = to_primitive(value);
+    if (primitive.is_undefined() || primitive.is_null()) {
+        return swf_version() >= 7 ? std::numeric_limits<double>::quiet_NaN() : 0.0;
+    }
+    return primitive.as_number();
+}
+
+inline std::string Activation::to_string(const Value& value) {
+    Value primitive = to_primitive(value);
+    if (primitive.is_undefined() && swf_version() < 7) {
+        return std::string();
+    }
+    return primitive.as_string();
+}
+
+inline std::shared_ptr<Object> Activation::to_object(const Value& value) {
+    if (auto object = value.as_object()) {
+        return object;
+    }
+    return value.coerce_to_object(shared_from_this());
+}
+
+inline std::optional<Avm1Atom> Activation::property_atom(CompactValue name) {
+    if (!name.is_string()) {
+        return std::nullopt;
+    }
+    Avm1Atom atom = name.as_atom();
+    if (atom.is_interned()) {
+        return atom;
+    }
+    return atoms().get(atom.view());
+}
+
+// Script objects with an interned name take the shape and inline cache
+// path, which works on the compact operands directly; display objects look
+// the atom up in the display property table. Anything else (a primitive,
+// an exotic object, a computed or non-string name) goes through `Value`.
+inline CompactValue Activation::get_member(CompactValue object, CompactValue name,
+                                           PropertyCache& cache) {
+    std::optional<Avm1Atom> atom = property_atom(name);
+    if (atom && object.is_object()) {
+        if (auto display = display_object_of(*object.as_object())) {
+            auto value = StageObject::get_property(std::move(display), *atom, shared_from_this());
+            return value ? compact(*value) : CompactValue::undefined();
+        }
+        if (ScriptObject* script = object.as_object()->as_script_object()) {
+            auto value = script->get_cached(*atom, cache, shared_from_this());
+            return value ? compact(*value) : CompactValue::undefined();
+        }
+    }
+
+    // Read the name before anything can run script and sweep it.
+    Value key = name.to_value();
+    std::shared_ptr<Object> target = to_object(object.to_value());
+    if (!target) {
+        return CompactValue::undefined();
+    }
+    auto self = shared_from_this();
+    auto value = target->get(key.is_string() ? key.as_string() : to_string(key), self);
+    return value ? compact(*value) : CompactValue::undefined();
+}
+
+inline void Activation::set_member(CompactValue object, CompactValue name, CompactValue value,
+                                   PropertyCache& cache) {
+    std::optional<Avm1Atom> atom = property_atom(name);
+    if (atom && object.is_object()) {
+        if (auto display = display_object_of(*object.as_object())) {
+            StageObject::set_property(std::move(display), *atom,
+                                      std::make_shared<Value>(value.to_value()), shared_from_this());
+            return;
+        }
+        if (ScriptObject* script = object.as_object()->as_script_object()) {
+            script->set_cached(*atom, value.to_value(), cache, shared_from_this());
+            return;
+        }
+    }
+
+    Value key = name.to_value();
+    auto stored = std::make_shared<Value>(value.to_value());
+    // Assignments to primitives are dropped.
+    std::shared_ptr<Object> target = object.to_value().as_object();
+    if (!target) {
+        return;
+    }
+    auto self = shared_from_this();
+    target->set(key.is_string() ? key.as_string() : to_string(key), std::move(stored), self);
+}
+
+inline std::optional<std::pair<std::shared_ptr<Object>, std::string>>
+Activation::resolve_variable_path(const std::string& path) {
+    size_t split = path.rfind(':');
+    if (split == std::string::npos) {
+        split = path.rfind('.');
+    }
+    if (split == std::string::npos && path.find('/') == std::string::npos) {
+        return std::nullopt;
+    }
+    std::string target = split == std::string::npos ? path : path.substr(0, split);
+    std::string variable = split == std::string::npos ? std::string() : path.substr(split + 1);
+    auto start = target_clip_or_root();
+    auto object = resolve_target_path(start->root(), start, target, is_case_sensitive());
+    return std::make_pair(object ? *object : nullptr, std::move(variable));
+}
+
+inline CompactValue Activation::get_variable(CompactValue path) {
+    Value path_value = path.to_value();
+    std::string name = path_value.is_string() ? path_value.as_string() : to_string(path_value);
+    auto self = shared_from_this();
+    std::shared_ptr<Value> value;
+    if (auto resolved = resolve_variable_path(name)) {
+        auto& [object, variable] = *resolved;
+        if (!object) {
+            return CompactValue::undefined();
+        }
+        if (variable.empty()) {
+            return value_stack_->own_object(object);
+        }
+        value = object->get(variable, self);
+    } else {
+        value = scope_->resolve(name, self).get_value();
+    }
+    return value ? compact(*value) : CompactValue::undefined();
+}
+
+inline void Activation::set_variable(CompactValue path, CompactValue value) {
+    Value path_value = path.to_value();
+    auto stored = std::make_shared<Value>(value.to_value());
+    std::string name = path_value.is_string() ? path_value.as_string() : to_string(path_value);
+    if (name.empty()) {
+        return;
+    }
+    auto self = shared_from_this();
+    if (auto resolved = resolve_variable_path(name)) {
+        auto& [object, variable] = *resolved;
+        if (object && !variable.empty()) {
+            object->set(variable, std::move(stored), self);
+        }
+        return;
+    }
+    scope_->set(name, std::move(stored), self);
+}
+
+inline std::optional<std::shared_ptr<Object>> Activation::resolve_target_path(
+    std::shared_ptr<DisplayObject> root,
+    std::shared_ptr<DisplayObject> start,
+    const std::string& path,
+    bool case_sensitive) {
+
+    TargetPathCache& cache = context_->avm1->target_path_cache();
+    std::shared_ptr<DisplayObject> stage = context_->stage;
+    if (auto target = cache.resolve(path, root, start, stage, case_sensitive)) {
+        if (!*target) {
+            return std::nullopt;
+        }
+        return (*target)->object1();
+    }
+
+    // Some segment names a script property rather than a clip. The walk
+    // may run getters that resolve other paths, so it works on a copy.
+    const TargetPath parsed = cache.parse(path);
+    auto self = shared_from_this();
+    std::shared_ptr<Object> object = (parsed.absolute ? root : start)->object1();
+    for (const TargetPathSegment& segment : parsed.segments) {
+        if (!object) {
+            return std::nullopt;
+        }
+        std::shared_ptr<DisplayObject> display = display_object_of(*object);
+        if (segment.kind == TargetPathSegment::Kind::UP) {
+            auto parent = display ? display->parent() : nullptr;
+            object = parent ? parent->object1() : nullptr;
+            continue;
+        }
+        if (display) {
+            if (auto container = display->as_container()) {
+                if (auto child = container->child_by_name(segment.name, case_sensitive)) {
+                    object = child->object1();
+                    continue;
+                }
+            }
+            if (!case_sensitive || segment.exact_case) {
+                std::shared_ptr<DisplayObject> next;
+                bool special = true;
+                switch (segment.kind) {
+                    case TargetPathSegment::Kind::ROOT: next = display->root(); break;
+                    case TargetPathSegment::Kind::PARENT: next = display->parent(); break;
+                    case TargetPathSegment::Kind::LEVEL:
+                        next = stage ? stage->as_container()->child_by_depth(segment.level) : nullptr;
+                        break;
+                    default: special = false; break;
+                }
+                if (special) {
+                    object = next ? next->object1() : nullptr;
+                    continue;
+                }
+            }
+        }
+        auto value = object->get(segment.name, self);
+        object = value ? value->as_object() : nullptr;
+    }
+    if (!object) {
+        return std::nullopt;
+    }
+    return object;
+}
+
+inline FrameControl Activation::set_target(const std::string& target) {
+    std::shared_ptr<Object> object;
+    if (target.empty()) {
+        target_clip_ = base_clip_;
+    } else {
+        auto start = target_clip_or_root();
+        auto resolved = resolve_target_path(start->root(), start, target, is_case_sensitive());
+        auto display = resolved ? display_object_of(**resolved) : nullptr;
+        target_clip_ = display ? display->as_movie_clip() : nullptr;
+        if (target_clip_) {
+            object = *resolved;
+        } else {
+            // Timeline actions are ignored until the target is reset.
+            context_->avm_warning("SetTarget failed: " + target + " not found");
+        }
+    }
+    scope_ = Scope::new_target_scope(scope_, object ? object : base_clip_->object1());
+    return FrameControl::CONTINUE;
+}
+
+inline std::shared_ptr<Object> Activation::define_function(const FunctionDecl& decl) {
+    auto data = action_data_ ? action_data_ : (function_ ? function_->action_data() : nullptr);
+    if (!data) {
+        throw Avm1Exception(Avm1Error::invalid_swf("DefineFunction outside of an action block"));
+    }
+    size_t body_start = data->start() + decl.body_offset;
+    auto body = std::make_shared<SwfSlice>(data->movie(), body_start, body_start + decl.body_len);
+    auto function = Avm1Function::from_decl(decl, std::move(body), scope_, constant_pool_);
+
+    const SystemPrototypes& prototypes = context_->avm1->prototypes();
+    auto prototype = ScriptObject::create(prototypes.object);
+    auto function_object = ScriptObject::create(prototypes.function, "Function");
+    function_object->set_constr(std::make_shared<FunctionObject>(function, prototype));
+    auto dont_enum = static_cast<int>(Attribute::DONT_ENUM);
+    prototype->define_value("constructor", std::make_shared<Value>(Value::object(function_object)),
+                            dont_enum);
+    function_object->define_value("prototype", std::make_shared<Value>(Value::object(prototype)),
+                                  dont_enum);
+    return function_object;
+}
+
+inline FrameControl Activation::call_value(const Value& function,
+                                           std::shared_ptr<Object> this_obj,
+                                           const std::string& name,
+                                           size_t num_args,
+                                           std::shared_ptr<Object> constructed) {
+    num_args = std::min(num_args, stack_len());
+    std::shared_ptr<Object> callee = function.as_object();
+    std::shared_ptr<FunctionObject> function_object = callee ? callee->as_function() : nullptr;
+    std::shared_ptr<Avm1Function> target = function_object ? function_object->function() : nullptr;
+    auto self = shared_from_this();
+    if (target && !target->has_native_function()) {
+        PreparedCall call = target->prepare_call(ExecutionName(name), self, this_obj,
+                                                 value_stack_->args(frame_, num_args), callee);
+        if (call.activation) {
+            call.caller_args = num_args;
+            call.constructed = std::move(constructed);
+            return stage_call(std::move(call));
+        }
+        target = nullptr;
+    }
+
+    std::shared_ptr<Value> result;
+    if (target) {
+        result = target->call_native(self, this_obj, value_stack_->args(frame_, num_args));
+    }
+    value_stack_->drop(frame_, num_args);
+    if (auto tail = take_tail_call()) {
+        // The native ends in a call: make it from here, so that a bytecode
+        // callee is staged on the interpreter like any other.
+        for (auto it = tail->args.rbegin(); it != tail->args.rend(); ++it) {
+            push(compact(**it));
+        }
+        Value tail_function = tail->function ? Value::object(tail->function) : Value::undefined();
+        return call_value(tail_function, std::move(tail->this_obj), name, tail->args.size(),
+                          std::move(constructed));
+    }
+    if (constructed && !(result && result->is_object())) {
+        push(value_stack_->own_object(std::move(constructed)));
+    } else {
+        push(result ? compact(*result) : CompactValue::undefined());
+    }
+    return FrameControl::CONTINUE;
+}
+
+inline FrameControl Activation::run_with() {
+    std::shared_ptr<Object> object = to_object(pop_value());
+    if (!object) {
+        // The body runs without the extra scope.
+        return FrameControl::CONTINUE;
+    }
+    outer_scope_ = scope_;
+    scope_ = std::make_shared<Scope>(Scope::new_with_scope(outer_scope_, std::move(object)));
+    return FrameControl::WITH;
+}
+
+inline bool Activation::catch_exception(const TryBlock& block, const Avm1Exception& error,
+                                        size_t stack_base) {
+    std::shared_ptr<Value> thrown = error.get_error().thrown_value();
+    if (!error.get_error().is_thrown_value() || !block.catch_start || !thrown) {
+        return false;
+    }
+    value_stack_->drop(frame_, stack_len() - std::min(stack_base, stack_len()));
+    if (block.catch_register) {
+        set_register(*block.catch_register, compact(*thrown));
+    } else if (block.catch_var) {
+        scope_->define_local(*block.catch_var, thrown, shared_from_this());
+    }
+    return true;
+}
+
+// Names of the properties GetProperty and SetProperty address by index.
+inline constexpr std::array<const char*, 22> DISPLAY_PROPERTY_NAMES = {
+    "_x", "_y", "_xscale", "_yscale", "_currentframe", "_totalframes", "_alpha",
+    "_visible", "_width", "_height", "_rotation", "_target", "_framesloaded", "_name",
+    "_droptarget", "_url", "_highquality", "_focusrect", "_soundbuftime", "_quality",
+    "_xmouse", "_ymouse",
+};
+
+inline FrameControl Activation::run_action(const Instruction& insn, const DecodedActions& actions,
+                                           uint32_t& next_pc) {
+    auto self = shared_from_this();
+    uint8_t version = swf_version();
+    auto push_bool = [&](bool b) {
+        push(version < 5 ? CompactValue::number(b ? 1.0 : 0.0) : CompactValue::boolean(b));
+    };
+    auto push_string = [&](std::string s) { push(CompactValue::string(own_string(std::move(s)))); };
+    // A count operand, such as an argument count; never more than is on the stack.
+    auto pop_count = [&]() -> size_t {
+        double n = to_number(pop_value());
+        if (!(n > 0)) {
+            return 0;
+        }
+        return static_cast<size_t>(std::min(n, static_cast<double>(stack_len())));
+    };
+    auto to_int32 = [&](const Value& v) -> int32_t {
+        double n = to_number(v);
+        if (!std::isfinite(n)) {
+            return 0;
+        }
+        double m = std::fmod(std::trunc(n), 4294967296.0);
+        if (m < 0) m += 4294967296.0;
+        return static_cast<int32_t>(static_cast<uint32_t>(m));
+    };
+    // `a < b` on primitives; nothing if either side is NaN.
+    auto less_than = [&](const Value& a, const Value& b) -> std::optional<bool> {
+        Value pa = to_primitive(a);
+        Value pb = to_primitive(b);
+        if (pa.is_string() && pb.is_string()) {
+            return pa.as_string() < pb.as_string();
+        }
+        double x = to_number(pa);
+        double y = to_number(pb);
+        if (std::isnan(x) || std::isnan(y)) {
+            return std::nullopt;
+        }
+        return x < y;
+    };
+    auto loose_equals = [&](const Value& a, const Value& b) -> bool {
+        bool a_nullish = a.is_undefined() || a.is_null();
+        bool b_nullish = b.is_undefined() || b.is_null();
+        if (a_nullish || b_nullish) {
+            return a_nullish && b_nullish;
+        }
+        if (a.is_object() && b.is_object()) {
+            return a.as_object() == b.as_object();
+        }
+        Value pa = to_primitive(a);
+        Value pb = to_primitive(b);
+        if (pa.type() == pb.type() && !pa.is_number()) {
+            return pa == pb;
+        }
+        return to_number(pa) == to_number(pb);
+    };
+    auto target_object = [&](const Value& target) -> std::shared_ptr<Object> {
+        std::string path = to_string(target);
+        auto start = target_clip_or_root();
+        if (path.empty()) {
+            return start->object1();
+        }
+        auto resolved = resolve_target_path(start->root(), start, path, is_case_sensitive());
+        return resolved ? *resolved : nullptr;
+    };
+    auto unimplemented = [&](const char* action) {
+        context_->avm_warning(std::string("Unimplemented action: ") + action);
+    };
+
+    switch (insn.op) {
+        case OpCode::End:
+            return FrameControl::RETURN;
+
+        // Timeline control, on the current tellTarget clip
+        case OpCode::NextFrame:
+            if (target_clip_) target_clip_->next_frame(context_);
+            break;
+        case OpCode::PreviousFrame:
+            if (target_clip_) target_clip_->prev_frame(context_);
+            break;
+        case OpCode::Play:
+            if (target_clip_) target_clip_->play(context_);
+            break;
+        case OpCode::Stop:
+            if (target_clip_) target_clip_->stop(context_);
+            break;
+        case OpCode::GotoFrame:
+            // SWF frame numbers are zero-based.
+            if (target_clip_) target_clip_->goto_frame(context_, static_cast<int>(insn.arg) + 1, true);
+            break;
+        case OpCode::GotoLabel:
+            if (target_clip_) target_clip_->goto_label(context_, actions.strings[insn.arg], true);
+            break;
+        case OpCode::GotoFrame2: {
+            Value frame = pop_value();
+            bool play = insn.arg8 & 0x1;
+            if (!target_clip_) break;
+            if (frame.is_string()) {
+                target_clip_->goto_label(context_, frame.as_string(), !play);
+            } else {
+                int number = static_cast<int>(to_number(frame)) + insn.arg16;
+                target_clip_->goto_frame(context_, number, !play);
+            }
+            break;
+        }
+        case OpCode::WaitForFrame:
+        case OpCode::WaitForFrame2:
+            // Movies are never streamed in, so every frame is loaded and
+            // nothing is skipped.
+            if (insn.op == OpCode::WaitForFrame2) pop_value();
+            break;
+        case OpCode::SetTarget:
+            return set_target(actions.strings[insn.arg]);
+        case OpCode::SetTarget2:
+            return set_target(to_string(pop_value()));
+
+        // Arithmetic and comparison, reached when an operand is an object
+        case OpCode::Add: {
+            Value b = pop_value();
+            Value a = pop_value();
+            push(CompactValue::number(to_number(a) + to_number(b)));
+            break;
+        }
+        case OpCode::Add2: {
+            Value b = to_primitive(pop_value());
+            Value a = to_primitive(pop_value());
+            if (a.is_string() || b.is_string()) {
+                push_string(to_string(a) + to_string(b));
+            } else {
+                push(CompactValue::number(to_number(a) + to_number(b)));
+            }
+            break;
+        }
+        case OpCode::Subtract:
+        case OpCode::Multiply:
+        case OpCode::Divide:
+        case OpCode::Modulo: {
+            double y = to_number(pop_value());
+            double x = to_number(pop_value());
+            double r = 0.0;
+            switch (insn.op) {
+                case OpCode::Subtract: r = x - y; break;
+                case OpCode::Multiply: r = x * y; break;
+                case OpCode::Divide:
+                    if (y == 0.0 && version < 5) {
+                        push(CompactValue::string(atoms().intern("#ERROR#")));
+                        return FrameControl::CONTINUE;
+                    }
+                    r = x / y;
+                    break;
+                default: r = std::fmod(x, y); break;
+            }
+            push(CompactValue::number(r));
+            break;
+        }
+        case OpCode::Increment:
+            push(CompactValue::number(to_number(pop_value()) + 1.0));
+            break;
+        case OpCode::Decrement:
+            push(CompactValue::number(to_number(pop_value()) - 1.0));
+            break;
+        case OpCode::BitAnd:
+        case OpCode::BitOr:
+        case OpCode::BitXor:
+        case OpCode::BitLShift:
+        case OpCode::BitRShift:
+        case OpCode::BitURShift: {
+            int32_t b = to_int32(pop_value());
+            int32_t a = to_int32(pop_value());
+            double r = 0.0;
+            switch (insn.op) {
+                case OpCode::BitAnd: r = a & b; break;
+                case OpCode::BitOr: r = a | b; break;
+                case OpCode::BitXor: r = a ^ b; break;
+                case OpCode::BitLShift:
+                    r = static_cast<int32_t>(static_cast<uint32_t>(a) << (b & 0x1F));
+                    break;
+                case OpCode::BitRShift: r = a >> (b & 0x1F); break;
+                default: r = static_cast<uint32_t>(a) >> (b & 0x1F); break;
+            }
+            push(CompactValue::number(r));
+            break;
+        }
+        case OpCode::Less: {
+            double y = to_number(pop_value());
+            double x = to_number(pop_value());
+            push_bool(x < y);
+            break;
+        }
+        case OpCode::Equals: {
+            double y = to_number(pop_value());
+            double x = to_number(pop_value());
+            push_bool(x == y);
+            break;
+        }
+        case OpCode::Less2:
+        case OpCode::Greater: {
+            Value b = pop_value();
+            Value a = pop_value();
+            auto result = insn.op == OpCode::Less2 ? less_than(a, b) : less_than(b, a);
+            push(result ? CompactValue::boolean(*result) : CompactValue::undefined());
+            break;
+        }
+        case OpCode::Equals2: {
+            Value b = pop_value();
+            Value a = pop_value();
+            push(CompactValue::boolean(loose_equals(a, b)));
+            break;
+        }
+        case OpCode::StrictEquals: {
+            Value b = pop_value();
+            Value a = pop_value();
+            push(CompactValue::boolean(a == b));
+            break;
+        }
+        case OpCode::Not: {
+            Value a = pop_value();
+            // Before SWF 7, strings are truthy by their numeric value.
+            bool truthy = a.as_bool();
+            if (a.is_string() && version < 7) {
+                double n = to_number(a);
+                truthy = n != 0.0 && !std::isnan(n);
+            }
+            push_bool(!truthy);
+            break;
+        }
+        case OpCode::And:
+        case OpCode::Or: {
+            double b = to_number(pop_value());
+            double a = to_number(pop_value());
+            bool x = a != 0.0 && !std::isnan(a);
+            bool y = b != 0.0 && !std::isnan(b);
+            push_bool(insn.op == OpCode::And ? x && y : x || y);
+            break;
+        }
+
+        // Strings
+        case OpCode::StringEquals:
+        case OpCode::StringLess:
+        case OpCode::StringGreater: {
+            std::string b = to_string(pop_value());
+            std::string a = to_string(pop_value());
+            push_bool(insn.op == OpCode::StringEquals ? a == b
+                      : insn.op == OpCode::StringLess ? a < b : a > b);
+            break;
+        }
+        case OpCode::StringAdd: {
+            std::string b = to_string(pop_value());
+            std::string a = to_string(pop_value());
+            push_string(a + b);
+            break;
+        }
+        case OpCode::StringLength:
+        case OpCode::MBStringLength: {
+            std::string s = to_string(pop_value());
+            size_t length = s.size();
+            if (insn.op == OpCode::MBStringLength) {
+                length = std::count_if(s.begin(), s.end(),
+                                       [](char c) { return (static_cast<uint8_t>(c) & 0xC0) != 0x80; });
+            }
+            push(CompactValue::number(static_cast<double>(length)));
+            break;
+        }
+        case OpCode::StringExtract:
+        case OpCode::MBStringExtract: {
+            // Flash 4 substring: one-based start, clamped.
+            double count = to_number(pop_value());
+            double start = to_number(pop_value());
+            std::string s = to_string(pop_value());
+            size_t begin = start > 1 ? std::min(static_cast<size_t>(start) - 1, s.size()) : 0;
+            size_t len = count >= 0 ? static_cast<size_t>(count) : s.size();
+            push_string(s.substr(begin, len));
+            break;
+        }
+        case OpCode::CharToAscii:
+        case OpCode::MBCharToAscii: {
+            std::string s = to_string(pop_value());
+            push(s.empty() ? CompactValue::number(std::numeric_limits<double>::quiet_NaN())
+                           : CompactValue::number(static_cast<uint8_t>(s[0])));
+            break;
+        }
+        case OpCode::AsciiToChar:
+        case OpCode::MBAsciiToChar: {
+            int32_t code = to_int32(pop_value());
+            push_string(code == 0 ? std::string() : std::string(1, static_cast<char>(code & 0xFF)));
+            break;
+        }
+        case OpCode::ToInteger: {
+            double n = to_number(pop_value());
+            push(CompactValue::number(std::isfinite(n) ? std::trunc(n) : (std::isnan(n) ? 0.0 : n)));
+            break;
+        }
+        case OpCode::ToNumber:
+            push(CompactValue::number(to_number(pop_value())));
+            break;
+        case OpCode::ToString:
+            push_string(to_primitive(pop_value()).as_string());
+            break;
+        case OpCode::TypeOf: {
+            Value v = pop_value();
+            const char* type = "object";
+            switch (v.type()) {
+                case ValueType::UNDEFINED: type = "undefined"; break;
+                case ValueType::NULL_VAL: type = "null"; break;
+                case ValueType::BOOLEAN: type = "boolean"; break;
+                case ValueType::NUMBER: type = "number"; break;
+                case ValueType::STRING: type = "string"; break;
+                case ValueType::MOVIE_CLIP: type = "movieclip"; break;
+                case ValueType::OBJECT: {
+                    auto object = v.as_object();
+                    if (object->is_function()) {
+                        type = "function";
+                    } else if (auto display = display_object_of(*object)) {
+                        type = display->as_movie_clip() ? "movieclip" : "object";
+                    }
+                    break;
+                }
+            }
+            push(CompactValue::string(atoms().intern(type)));
+            break;
+        }
+        case OpCode::TargetPath: {
+            Value v = pop_value();
+            auto object = v.as_object();
+            auto display = object ? display_object_of(*object) : nullptr;
+            if (display) {
+                push_string(display_path(display));
+            } else {
+                push(CompactValue::undefined());
+            }
+            break;
+        }
+
+        // Variables and properties
+        case OpCode::DefineLocal: {
+            auto value = std::make_shared<Value>(pop_value());
+            std::string name = to_string(pop_value());
+            scope_->define_local(name, std::move(value), self);
+            break;
+        }
+        case OpCode::DefineLocal2: {
+            std::string name = to_string(pop_value());
+            if (!scope_->locals()->has_own_property(name, self)) {
+                scope_->define_local(name, std::make_shared<Value>(Value::undefined()), self);
+            }
+            break;
+        }
+        case OpCode::Delete: {
+            std::string name = to_string(pop_value());
+            auto object = to_object(pop_value());
+            auto* script = object ? object->as_script_object() : nullptr;
+            push_bool(script && script->delete_property(self, name));
+            break;
+        }
+        case OpCode::Delete2: {
+            std::string name = to_string(pop_value());
+            push_bool(scope_->delete_value(self, name));
+            break;
+        }
+        case OpCode::GetProperty: {
+            int32_t index = to_int32(pop_value());
+            auto object = target_object(pop_value());
+            if (!object || index < 0 || static_cast<size_t>(index) >= DISPLAY_PROPERTY_NAMES.size()) {
+                push(CompactValue::undefined());
+                break;
+            }
+            auto value = object->get(DISPLAY_PROPERTY_NAMES[index], self);
+            push(value ? compact(*value) : CompactValue::undefined());
+            break;
+        }
+        case OpCode::SetProperty: {
+            auto value = std::make_shared<Value>(pop_value());
+            int32_t index = to_int32(pop_value());
+            auto object = target_object(pop_value());
+            if (object && index >= 0 && static_cast<size_t>(index) < DISPLAY_PROPERTY_NAMES.size()) {
+                object->set(DISPLAY_PROPERTY_NAMES[index], std::move(value), self);
+            }
+            break;
+        }
+        case OpCode::GetVariable:
+            push(get_variable(pop()));
+            break;
+        case OpCode::SetVariable: {
+            CompactValue value = pop();
+            set_variable(pop(), value);
+            break;
+        }
+        case OpCode::GetMember: {
+            CompactValue name = pop();
+            push(get_member(pop(), name, actions.property_caches[insn.arg]));
+            break;
+        }
+        case OpCode::SetMember: {
+            CompactValue value = pop();
+            CompactValue name = pop();
+            set_member(pop(), name, value, actions.property_caches[insn.arg]);
+            break;
+        }
+        case OpCode::InitArray: {
+            size_t count = pop_count();
+            auto array = ScriptObject::create(context_->avm1->prototypes().array, "Array");
+            array->set_array_like(true);
+            for (size_t i = 0; i < count; ++i) {
+                array->set_element(self, static_cast<int32_t>(i), std::make_shared<Value>(pop_value()));
+            }
+            push(value_stack_->own_object(std::move(array)));
+            break;
+        }
+        case OpCode::InitObject: {
+            double n = to_number(pop_value());
+            size_t pairs = n > 0 ? std::min(static_cast<size_t>(n), stack_len() / 2) : 0;
+            auto object = ScriptObject::create(context_->avm1->prototypes().object);
+            for (size_t i = 0; i < pairs; ++i) {
+                auto value = std::make_shared<Value>(pop_value());
+                object->set(to_string(pop_value()), std::move(value), self);
+            }
+            push(value_stack_->own_object(std::move(object)));
+            break;
+        }
+
+        // Calls. Bytecode functions are staged for the interpreter to run;
+        // natives are called here.
+        case OpCode::CallFunction: {
+            std::string name = to_string(pop_value());
+            size_t num_args = pop_count();
+            CallableValue callable = scope_->resolve(name, self);
+            auto function = callable.get_value();
+            auto this_obj = callable.get_object();
+            if (!this_obj) {
+                this_obj = target_clip_or_root()->object1();
+            }
+            return call_value(function ? *function : Value::undefined(), std::move(this_obj), name,
+                              num_args, nullptr);
+        }
+        case OpCode::CallMethod: {
+            CompactValue name_value = pop();
+            std::optional<Avm1Atom> atom = property_atom(name_value);
+            Value name = name_value.to_value();
+            Value object_value = pop_value();
+            size_t num_args = pop_count();
+            std::string method = name.is_undefined() ? std::string() : to_string(name);
+            // Through `super`, methods run on this activation's `this`.
+            bool is_super = super_object_ && object_value.as_object() == super_object_;
+            if (method.empty()) {
+                if (is_super) {
+                    // `super(...)` runs the superclass constructor.
+                    auto constructor = super_object_->get("__constructor__", self);
+                    return call_value(constructor ? *constructor : Value::undefined(), this_object_,
+                                      "super", num_args, nullptr);
+                }
+                // The object itself is the function.
+                return call_value(object_value, nullptr, method, num_args, nullptr);
+            }
+            auto object = to_object(object_value);
+            std::shared_ptr<Value> function;
+            if (auto* script = object ? object->as_script_object() : nullptr; script && atom) {
+                function = script->get_cached(*atom, actions.property_caches[insn.arg], self);
+            } else if (object) {
+                function = object->get(method, self);
+            }
+            return call_value(function ? *function : Value::undefined(),
+                              is_super ? this_object_ : std::move(object), method, num_args, nullptr);
+        }
+        case OpCode::NewObject:
+        case OpCode::NewMethod: {
+            std::string name;
+            std::shared_ptr<Value> constructor;
+            if (insn.op == OpCode::NewObject) {
+                name = to_string(pop_value());
+                constructor = scope_->resolve(name, self).get_value();
+            } else {
+                Value name_value = pop_value();
+                Value object_value = pop_value();
+                name = name_value.is_undefined() ? std::string() : to_string(name_value);
+                if (name.empty()) {
+                    constructor = std::make_shared<Value>(object_value);
+                } else if (auto object = to_object(object_value)) {
+                    constructor = object->get(name, self);
+                }
+            }
+            size_t num_args = pop_count();
+            auto constructor_object = constructor ? constructor->as_object() : nullptr;
+            if (!constructor_object || !constructor_object->is_function()) {
+                value_stack_->drop(frame_, num_args);
+                push(CompactValue::undefined());
+                break;
+            }
+            auto prototype = constructor_object->get("prototype", self);
+            auto this_obj = ScriptObject::create(prototype ? prototype->as_object() : nullptr);
+            auto dont_enum = static_cast<int>(Attribute::DONT_ENUM);
+            this_obj->define_value("__constructor__", std::make_shared<Value>(*constructor), dont_enum);
+            if (version < 7) {
+                this_obj->define_value("constructor", std::make_shared<Value>(*constructor), dont_enum);
+            }
+            return call_value(*constructor, this_obj, name, num_args, this_obj);
+        }
+        case OpCode::DefineFunction:
+        case OpCode::DefineFunction2: {
+            const FunctionDecl& decl = actions.functions[insn.arg];
+            auto function = define_function(decl);
+            if (decl.name.empty()) {
+                push(value_stack_->own_object(std::move(function)));
+            } else {
+                scope_->define_local(decl.name, std::make_shared<Value>(Value::object(function)), self);
+            }
+            break;
+        }
+
+        // Classes
+        case OpCode::InstanceOf:
+        case OpCode::CastOp: {
+            Value first = pop_value();
+            Value second = pop_value();
+            // InstanceOf pops the constructor first, CastOp the object.
+            const Value& constructor = insn.op == OpCode::InstanceOf ? first : second;
+            const Value& value = insn.op == OpCode::InstanceOf ? second : first;
+            bool is_instance = false;
+            auto object = value.as_object();
+            auto constructor_object = constructor.as_object();
+            if (object && constructor_object) {
+                auto prototype = constructor_object->get("prototype", self);
+                auto target = prototype ? prototype->as_object() : nullptr;
+                int depth = 0;
+                for (auto proto = object->proto(); proto && target; proto = proto->proto()) {
+                    if (++depth == 255) {
+                        throw Avm1Exception(Avm1Error::prototype_recursion_limit());
+                    }
+                    if (proto == target) {
+                        is_instance = true;
+                        break;
+                    }
+                }
+            }
+            if (insn.op == OpCode::InstanceOf) {
+                push(CompactValue::boolean(is_instance));
+            } else {
+                push(is_instance ? value_stack_->own_object(object) : CompactValue::null());
+            }
+            break;
+        }
+        case OpCode::Extends: {
+            auto superclass = pop_value().as_object();
+            auto subclass = pop_value().as_object();
+            if (!superclass || !subclass) {
+                break;
+            }
+            auto super_prototype = superclass->get("prototype", self);
+            auto prototype = ScriptObject::create(super_prototype ? super_prototype->as_object() : nullptr);
+            auto dont_enum = static_cast<int>(Attribute::DONT_ENUM);
+            prototype->define_value("__constructor__",
+                                    std::make_shared<Value>(Value::object(superclass)), dont_enum);
+            if (version < 7) {
+                prototype->define_value("constructor",
+                                        std::make_shared<Value>(Value::object(superclass)), dont_enum);
+            }
+            subclass->set("prototype", std::make_shared<Value>(Value::object(prototype)), self);
+            break;
+        }
+        case OpCode::ImplementsOp: {
+            // Interfaces only matter to `instanceof` checks on interfaces,
+            // which are not modelled; pop the operands.
+            pop_value();
+            size_t count = pop_count();
+            value_stack_->drop(frame_, count);
+            break;
+        }
+
+        // Control flow
+        case OpCode::With:
+            return run_with();
+        case OpCode::Throw: {
+            auto value = std::make_shared<Value>(pop_value());
+            throw Avm1Exception(Avm1Error::thrown_value(std::move(value)));
+        }
+
+        // Player services
+        case OpCode::Trace: {
+            Value value = pop_value();
+            context_->avm_trace(value.is_undefined() ? "undefined" : to_string(value));
+            break;
+        }
+        case OpCode::GetTime: {
+            auto now = std::chrono::steady_clock::now().time_since_epoch();
+            push(CompactValue::number(std::floor(
+                std::chrono::duration<double, std::milli>(now).count())));
+            break;
+        }
+        case OpCode::RandomNumber: {
+            thread_local std::mt19937 rng(std::random_device{}());
+            int32_t max = to_int32(pop_value());
+            push(CompactValue::number(max <= 0 ? 0 : std::uniform_int_distribution<int32_t>(0, max - 1)(rng)));
+            break;
+        }
+        case OpCode::GetUrl:
+            unimplemented("GetUrl");
+            break;
+        case OpCode::GetUrl2:
+            pop_value();
+            pop_value();
+            unimplemented("GetUrl2");
+            break;
+        case OpCode::FsCommand2: {
+            size_t count = pop_count();
+            value_stack_->drop(frame_, count);
+            unimplemented("FsCommand2");
+            break;
+        }
+        case OpCode::CloneSprite:
+            pop_value();
+            pop_value();
+            pop_value();
+            unimplemented("CloneSprite");
+            break;
+        case OpCode::RemoveSprite:
+            pop_value();
+            unimplemented("RemoveSprite");
+            break;
+        case OpCode::StartDrag: {
+            pop_value();
+            pop_value();
+            if (to_number(pop_value()) != 0.0) {
+                value_stack_->drop(frame_, 4);
+            }
+            unimplemented("StartDrag");
+            break;
+        }
+        case OpCode::EndDrag:
+            unimplemented("EndDrag");
+            break;
+        case OpCode::Call:
+            pop_value();
+            unimplemented("Call");
+            break;
+        case OpCode::ToggleQuality:
+        case OpCode::StopSounds:
+            unimplemented(insn.op == OpCode::ToggleQuality ? "ToggleQuality" : "StopSounds");
+            break;
+
+        default:
+            // Everything else has an inline handler that only comes here
+            // for object operands, covered above, or is ignored like Flash
+            // ignores unknown actions.
+            break;
+    }
+    return FrameControl::CONTINUE;
+}
+
+inline std::shared_ptr<Value> Activation::run_actions(std::shared_ptr<const DecodedActions> actions) {
+    auto& avm = *context_->avm1;
+    bool was_executing = is_executing_;
+    is_executing_ = true;
+    std::optional<CompactValue> result;
+    try {
+        result = Interpreter<Activation>::run(*this, *actions, avm.opcode_counter());
+    } catch (...) {
+        is_executing_ = was_executing;
+        throw;
+    }
+    is_executing_ = was_executing;
+    // Converted before this activation's frame is left, which may sweep
+    // what the result borrows.
+    return std::make_shared<Value>(result ? result->to_value() : Value::undefined());
+}
+
+inline std::shared_ptr<Value> Activation::run_with_data(std::shared_ptr<SwfSlice> data) {
+    auto actions = context_->avm1->bytecode_cache().get_or_decode(*data);
+    action_data_ = std::move(data);
+    return run_actions(std::move(actions));
+}
+
+inline std::shared_ptr<Object> Avm1Function::create_arguments_object(
+    std::shared_ptr<Activation> caller,
+    std::shared_ptr<Object> callee,
+    StackArgs args) const {
+
+    auto context = caller->context();
+    auto arguments = ScriptObject::create(context->avm1->prototypes().array, "Array");
+    arguments->set_array_like(true);
+    for (size_t i = 0; i < args.size(); ++i) {
+        arguments->set_element(caller, static_cast<int32_t>(i),
+                               std::make_shared<Value>(args[i].to_value()));
+    }
+    auto dont_enum = static_cast<int>(Attribute::DONT_ENUM);
+    if (callee) {
+        arguments->define_value("callee", std::make_shared<Value>(Value::object(callee)), dont_enum);
+    }
+    // `caller` is the calling function, or null from top-level code.
+    auto calling_function = caller->function() ? caller->callee() : nullptr;
+    arguments->define_value("caller",
+                            std::make_shared<Value>(calling_function ? Value::object(calling_function)
+                                                                     : Value::null()),
+                            dont_enum);
+    return arguments;
+}
+
+inline std::shared_ptr<Object> Avm1Function::create_super_object(
+    std::shared_ptr<Activation> caller,
+    std::shared_ptr<Object> this_obj) const {
+
+    // `super` looks methods up one prototype above `this`'s class, and
+    // calling it runs the constructor `Extends` recorded on the class
+    // prototype. Method calls through it are bound back to `this` by the
+    // activation; see CallMethod.
+    auto class_proto = this_obj ? this_obj->proto() : nullptr;
+    auto super_obj = ScriptObject::create(class_proto ? class_proto->proto() : nullptr);
+    if (class_proto) {
+        if (auto constructor = class_proto->get("__constructor__", caller)) {
+            super_obj->define_value("__constructor__", std::move(constructor),
+                                    static_cast<int>(Attribute::DONT_ENUM));
+        }
+    }
+    return super_obj;
+}
+
 // Utility function used by Avm1::action_wait_for_frame and Avm1::action_wait_for_frame_2
 inline void skip_actions(std::shared_ptr<Reader> reader, uint8_t num_actions_to_skip) {
     for (int i = 0; i < num_actions_to_skip; ++i) {
@@ -258,6 +1631,42 @@ inline void root_error_handler(std::shared_ptr<Activation> activation, Avm1Error
     activation->context()->avm1.halt();
 }
 
+inline void Avm1::run_from_player(std::shared_ptr<UpdateContext> context,
+                                  std::shared_ptr<MovieClip> clip,
+                                  const std::string& name,
+                                  const std::function<void(std::shared_ptr<Activation>)>& call) {
+    if (halted_) {
+        return;
+    }
+    auto heap_scope = enter_heap();
+    auto activation = std::make_shared<Activation>(
+        context,
+        global_scope(clip->swf_version()),
+        clip,
+        clip->object1(),
+        nullptr,
+        ActivationIdentifier(0, name),
+        value_stack_);
+
+    active_activations_.push_back(activation);
+    auto leave = [&] {
+        active_activations_.erase(
+            std::remove(active_activations_.begin(), active_activations_.end(), activation),
+            active_activations_.end());
+    };
+    try {
+        call(activation);
+    } catch (const Avm1Exception& e) {
+        root_error_handler(activation, e.get_error());
+    } catch (...) {
+        leave();
+        throw;
+    }
+    leave();
+}
+
+extern template class Interpreter<Activation>;
+
 } // namespace ruffle
 
 #endif // AVM1_RUNTIME_H
\ No newline at end of file
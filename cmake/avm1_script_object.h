@@ -13,8 +13,12 @@
 #include "avm1/error.h"
 #include "avm1/function.h"
 #include "avm1/property.h"
-#include "avm1/property_map.h"
+#include "avm1/shape.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -59,52 +63,308 @@ public:
 
         return std::make_shared<Value>(Value::UNDEFINED);
     }
+
+    void gc_trace(GcTracer& tracer) const {
+        tracer.visit(callback_);
+        if (user_data_) {
+            tracer.visit_value(*user_data_);
+        }
+    }
 };
 
 // Script object class for AVM1
 class ScriptObject : public Object {
 private:
-    std::shared_ptr<PropertyMap> properties_;
+    // Own properties: `shape_` maps names to indices into `slots_`.
+    std::shared_ptr<Shape> shape_;
+    std::vector<Property> slots_;
     std::shared_ptr<Object> prototype_;
     std::shared_ptr<FunctionObject> constructor_;
     std::unordered_map<std::string, std::shared_ptr<Watcher>> watchers_;
     std::shared_ptr<NativeObject> native_object_;
     std::string type_name_;
-    bool is_array_like_;  // Flag for array-like behavior
+    // Whether the object has array behaviour: dense elements and `length`.
+    // Set for objects created as "Array", or by `set_array_like`.
+    bool is_array_like_;
+
+    // Dense element storage for array-like objects.
+    //
+    // While in use, elements 0..dense_.size()-1 all exist and no index keys
+    // are in the shape. `dense_named_[i]` is the shape's slot count when
+    // element i was added, which is enough to reproduce the insertion order
+    // for enumeration. A hole, an element with attributes
+    // or a watched index moves the elements into the shape for good.
+    std::vector<std::shared_ptr<Value>> dense_;
+    std::vector<uint32_t> dense_named_;
+    bool sparse_;
+
+    bool is_array() const { return is_array_like_; }
+    bool is_dense() const { return is_array() && !sparse_; }
+
+    // Parse a canonical array index: "0" or digits without a leading zero,
+    // below 2^31.
+    static std::optional<uint32_t> parse_array_index(const std::string& name) {
+        if (name.empty() || name.size() > 10 || (name[0] == '0' && name.size() > 1)) {
+            return std::nullopt;
+        }
+        uint64_t index = 0;
+        for (char c : name) {
+            if (c < '0' || c > '9') {
+                return std::nullopt;
+            }
+            index = index * 10 + static_cast<uint64_t>(c - '0');
+        }
+        if (index > static_cast<uint64_t>(INT32_MAX)) {
+            return std::nullopt;
+        }
+        return static_cast<uint32_t>(index);
+    }
+
+    // Dense element named `name`, if any.
+    std::optional<uint32_t> dense_index(const std::string& name) const {
+        if (!is_dense() || dense_.empty()) {
+            return std::nullopt;
+        }
+        auto index = parse_array_index(name);
+        if (index && *index < dense_.size()) {
+            return index;
+        }
+        return std::nullopt;
+    }
+
+    void gc_write_barrier_property(const Property& prop) const {
+        gc_write_barrier(prop.data());
+        gc_write_barrier_cell(prop.getter().get());
+        if (auto setter = prop.setter()) {
+            gc_write_barrier_cell(setter->get());
+        }
+    }
+
+    // Store element `index` densely if that keeps the storage hole-free.
+    bool try_set_dense(uint32_t index, std::shared_ptr<Value>& value) {
+        if (!is_dense() || index > dense_.size()) {
+            return false;
+        }
+        gc_write_barrier(value);
+        if (index == dense_.size()) {
+            dense_.push_back(std::move(value));
+            dense_named_.push_back(shape_->slot_count());
+            bump_epoch();
+        } else {
+            dense_[index] = std::move(value);
+        }
+        return true;
+    }
+
+    // Move dense elements into the shape, in insertion order.
+    void make_sparse() {
+        if (sparse_) {
+            return;
+        }
+        sparse_ = true;
+        if (dense_.empty()) {
+            return;
+        }
+        std::vector<std::pair<std::string, Property>> ordered;
+        ordered.reserve(slots_.size() + dense_.size());
+        uint32_t named = 0;
+        size_t element = 0;
+        while (named < shape_->slot_count() || element < dense_.size()) {
+            if (element < dense_.size() && dense_named_[element] <= named) {
+                ordered.emplace_back(std::to_string(element),
+                                     Property::new_stored(std::move(dense_[element]), Attribute{}));
+                ++element;
+            } else {
+                if (!shape_->is_removed(named)) {
+                    ordered.emplace_back(shape_->key(named), std::move(slots_[named]));
+                }
+                ++named;
+            }
+        }
+        dense_.clear();
+        dense_named_.clear();
+        shape_ = Shape::empty();
+        slots_.clear();
+        for (auto& [key, prop] : ordered) {
+            add_slot(key, std::move(prop));
+        }
+    }
+
+    void make_sparse_for(const std::string& name) {
+        if (is_dense() && parse_array_index(name)) {
+            make_sparse();
+        }
+    }
+
+    static bool is_case_sensitive(const std::shared_ptr<Activation>& activation) {
+        return activation && activation->is_case_sensitive();
+    }
+
+    static bool is_plain_writable(uint32_t flags) {
+        return !(flags & (Shape::VIRTUAL | Shape::WATCHED |
+                          static_cast<uint32_t>(Attribute::READ_ONLY) |
+                          static_cast<uint32_t>(Attribute::VERSION_MASK)));
+    }
+
+    uint32_t slot_flags(const Property& prop, const std::string& name) const {
+        uint32_t flags = static_cast<uint16_t>(prop.attributes());
+        if (prop.is_virtual()) flags |= Shape::VIRTUAL;
+        if (watchers_.count(name)) flags |= Shape::WATCHED;
+        return flags;
+    }
+
+    void add_slot(const std::string& name, Property prop) {
+        gc_write_barrier_property(prop);
+        bump_epoch();
+        uint32_t flags = slot_flags(prop, name);
+        if (!shape_->is_dictionary()) {
+            if (auto next = shape_->with_property(name, flags)) {
+                shape_ = std::move(next);
+                slots_.push_back(std::move(prop));
+                return;
+            }
+            shape_ = shape_->to_dictionary();
+        }
+        shape_->add_slot(name, flags);
+        slots_.push_back(std::move(prop));
+    }
+
+    // Move to the shape matching slot `slot`'s current attributes, so that
+    // inline caches recorded against the old layout stop matching.
+    void update_slot_flags(uint32_t slot) {
+        uint32_t flags = slot_flags(slots_[slot], shape_->key(slot));
+        if (flags == shape_->flags(slot)) {
+            return;
+        }
+        if (!shape_->is_dictionary()) {
+            if (auto next = shape_->with_flags(slot, flags)) {
+                shape_ = std::move(next);
+                return;
+            }
+            shape_ = shape_->to_dictionary();
+        }
+        shape_->set_slot_flags(slot, flags);
+    }
+
+    // Drop the shape's tombstones and the matching values.
+    void compact_slots() {
+        std::vector<uint32_t> live_before(shape_->slot_count() + 1, 0);
+        std::vector<Property> live;
+        live.reserve(shape_->len());
+        for (uint32_t slot = 0; slot < shape_->slot_count(); ++slot) {
+            live_before[slot + 1] = live_before[slot];
+            if (!shape_->is_removed(slot)) {
+                live.push_back(std::move(slots_[slot]));
+                live_before[slot + 1]++;
+            }
+        }
+        for (auto& named : dense_named_) {
+            named = live_before[named];
+        }
+        slots_ = std::move(live);
+        shape_->compact();
+    }
+
+    std::shared_ptr<Value> get_slot(uint32_t slot, const std::shared_ptr<Activation>& activation) const {
+        const Property& prop = slots_[slot];
+        if (prop.is_virtual()) {
+            return prop.getter()->call("get", activation,
+                                       std::const_pointer_cast<Object>(shared_from_this()), {});
+        }
+        return prop.data();
+    }
+
+    void set_slot(uint32_t slot, std::shared_ptr<Value> value,
+                  const std::shared_ptr<Activation>& activation) {
+        Property& prop = slots_[slot];
+        if (prop.is_virtual()) {
+            if (prop.setter() && *prop.setter()) {
+                (*prop.setter())->call("set", activation, shared_from_this(), {std::move(value)});
+            }
+            return;
+        }
+        uint32_t old_flags = shape_->flags(slot);
+        gc_write_barrier(value);
+        prop.set_data(std::move(value));
+        // Overwriting clears the SWF version bits.
+        if (static_cast<uint16_t>(prop.attributes()) != (old_flags & Shape::ATTRIBUTE_MASK)) {
+            update_slot_flags(slot);
+        }
+    }
 
 public:
     ScriptObject(std::shared_ptr<Object> prototype = nullptr,
                  const std::string& type_name = "Object")
-        : Object(prototype, type_name), prototype_(std::move(prototype)),
-          type_name_(type_name), is_array_like_(false) {
-        properties_ = std::make_shared<PropertyMap>();
-    }
+        : Object(prototype, type_name), shape_(Shape::empty()), prototype_(std::move(prototype)),
+          type_name_(type_name), is_array_like_(type_name == "Array"), sparse_(false) {}
 
     // Create a new script object
     static std::shared_ptr<ScriptObject> create(std::shared_ptr<Object> prototype = nullptr,
                                                const std::string& type_name = "Object") {
+        if (auto heap = GcHeap::current()) {
+            return heap->allocate<ScriptObject>(std::move(prototype), type_name);
+        }
         return std::make_shared<ScriptObject>(std::move(prototype), type_name);
     }
 
+    // Garbage collection
+    void gc_trace(GcTracer& tracer) const override {
+        Object::gc_trace(tracer);
+        for (const auto& prop : slots_) {
+            if (auto data = prop.data()) {
+                tracer.visit_value(*data);
+            }
+            tracer.visit(prop.getter());
+            if (auto setter = prop.setter()) {
+                tracer.visit(*setter);
+            }
+        }
+        for (const auto& value : dense_) {
+            if (value) {
+                tracer.visit_value(*value);
+            }
+        }
+        for (const auto& [name, watcher] : watchers_) {
+            watcher->gc_trace(tracer);
+        }
+        tracer.visit(prototype_);
+        gc_trace_function(tracer, constructor_.get());
+        if (native_object_) {
+            native_object_->gc_trace(tracer);
+        }
+    }
+
+    void gc_clear() override {
+        Object::gc_clear();
+        shape_ = Shape::empty();
+        slots_.clear();
+        dense_.clear();
+        dense_named_.clear();
+        sparse_ = false;
+        watchers_.clear();
+        prototype_.reset();
+        constructor_.reset();
+        native_object_.reset();
+    }
+
     // Get a property value
     std::shared_ptr<Value> get(const std::string& name,
                               std::shared_ptr<Activation> activation) const override {
-        // First check for watched properties
-        auto watcher_it = watchers_.find(name);
-        if (watcher_it != watchers_.end()) {
-            // For watched properties, we might need special handling
-            // For now, just return the value from the property map
+        if (auto index = dense_index(name)) {
+            return dense_[*index];
         }
 
-        // Check the property map
-        auto prop = properties_->get(name);
-        if (prop) {
-            return prop->get_value();
+        uint32_t slot = shape_->find(name, is_case_sensitive(activation));
+        if (slot != Shape::NOT_FOUND) {
+            return get_slot(slot, activation);
         }
 
         // Search in prototype chain
         if (prototype_) {
-            return prototype_->get(name, activation);
+            auto [holder, depth] = lookup_proto_chain(prototype_, name, activation);
+            if (holder) {
+                return holder->get_own(name, activation);
+            }
         }
 
         return std::make_shared<Value>(Value::UNDEFINED);
@@ -123,28 +383,189 @@ public:
             watcher_it->second->call(activation, name, old_value, value, shared_from_this());
         }
 
-        // Set the property in the property map
-        properties_->set(name, std::move(value));
+        if (is_dense()) {
+            if (auto index = parse_array_index(name)) {
+                if (try_set_dense(*index, value)) {
+                    return;
+                }
+                make_sparse();
+            }
+        }
+
+        uint32_t slot = shape_->find(name, is_case_sensitive(activation));
+        if (slot == Shape::NOT_FOUND) {
+            add_slot(name, Property::new_stored(std::move(value), Attribute{}));
+        } else {
+            set_slot(slot, std::move(value), activation);
+        }
     }
 
     // Define a property with attributes
     void define_value(const std::string& name,
                      std::shared_ptr<Value> value,
                      int attributes = 0) override {
-        properties_->define_value(name, std::move(value), attributes);
+        auto attrs = static_cast<Attribute>(attributes);
+        if (is_dense()) {
+            auto index = parse_array_index(name);
+            if (index && attributes == 0 && try_set_dense(*index, value)) {
+                return;
+            }
+            make_sparse_for(name);
+        }
+        uint32_t slot = shape_->find(name, true);
+        if (slot == Shape::NOT_FOUND) {
+            add_slot(name, Property::new_stored(std::move(value), attrs));
+        } else {
+            gc_write_barrier(value);
+            slots_[slot] = Property::new_stored(std::move(value), attrs);
+            update_slot_flags(slot);
+        }
+    }
+
+    // Define a virtual property, as `addProperty` does
+    void add_property(const std::string& name,
+                      std::shared_ptr<Object> getter,
+                      std::optional<std::shared_ptr<Object>> setter,
+                      Attribute attributes,
+                      bool case_sensitive) {
+        make_sparse_for(name);
+        uint32_t slot = shape_->find(name, case_sensitive);
+        if (slot == Shape::NOT_FOUND) {
+            add_slot(name, Property::new_virtual(std::move(getter), std::move(setter), attributes));
+        } else {
+            gc_write_barrier_cell(getter.get());
+            if (setter) {
+                gc_write_barrier_cell(setter->get());
+            }
+            slots_[slot].set_virtual(std::move(getter), std::move(setter));
+            slots_[slot].set_attributes(attributes);
+            update_slot_flags(slot);
+        }
+    }
+
+    // Set and clear attribute bits on an own property, as `ASSetPropFlags`
+    // does. Returns false if there is no such property.
+    bool set_attributes(const std::string& name,
+                        Attribute set_attributes,
+                        Attribute clear_attributes,
+                        bool case_sensitive) {
+        make_sparse_for(name);
+        uint32_t slot = shape_->find(name, case_sensitive);
+        if (slot == Shape::NOT_FOUND) {
+            return false;
+        }
+        auto attrs = static_cast<uint16_t>(slots_[slot].attributes());
+        attrs = (attrs & ~static_cast<uint16_t>(clear_attributes)) |
+                static_cast<uint16_t>(set_attributes);
+        slots_[slot].set_attributes(static_cast<Attribute>(attrs));
+        update_slot_flags(slot);
+        return true;
     }
 
     // Watch a property
     void watch(const std::string& name,
                std::shared_ptr<Object> callback,
                std::shared_ptr<Value> user_data) {
+        gc_write_barrier_cell(callback.get());
+        gc_write_barrier(user_data);
         auto watcher = std::make_shared<Watcher>(std::move(callback), std::move(user_data));
         watchers_[name] = std::move(watcher);
+        make_sparse_for(name);
+        uint32_t slot = shape_->find(name, true);
+        if (slot != Shape::NOT_FOUND) {
+            update_slot_flags(slot);
+        }
     }
 
     // Unwatch a property
     void unwatch(const std::string& name) {
         watchers_.erase(name);
+        uint32_t slot = shape_->find(name, true);
+        if (slot != Shape::NOT_FOUND) {
+            update_slot_flags(slot);
+        }
+    }
+
+    // Get a property through an inline cache.
+    //
+    // `cache` belongs to the access site (see `DecodedActions::property_caches`).
+    // A hit reads the slot directly; a miss does the normal lookup, including
+    // the prototype chain by atom, and records the slot if it is a plain own
+    // data property. Returns null if there is no such property.
+    std::shared_ptr<Value> get_cached(Avm1Atom name,
+                                      PropertyCache& cache,
+                                      const std::shared_ptr<Activation>& activation) const {
+        uint32_t slot = cache.lookup(*shape_, name);
+        if (slot != Shape::NOT_FOUND) {
+            return slots_[slot].data();
+        }
+        slot = shape_->find(name.as_str(), is_case_sensitive(activation));
+        if (slot != Shape::NOT_FOUND) {
+            if (!(shape_->flags(slot) & Shape::VIRTUAL)) {
+                cache.update(*shape_, name, slot);
+            }
+            return get_slot(slot, activation);
+        }
+        if (auto index = dense_index(name.as_str())) {
+            return dense_[*index];
+        }
+        if (prototype_) {
+            auto [holder, depth] = lookup_proto_chain(prototype_, name, activation);
+            if (holder) {
+                return holder->get_own(name.as_str(), activation);
+            }
+        }
+        return nullptr;
+    }
+
+    // Set a property through an inline cache. Only existing, writable,
+    // unwatched data properties are cached, and a hit overwrites the slot's
+    // value in place; anything else takes `set`.
+    void set_cached(Avm1Atom name,
+                    Value value,
+                    PropertyCache& cache,
+                    const std::shared_ptr<Activation>& activation) {
+        uint32_t slot = cache.lookup(*shape_, name);
+        if (slot != Shape::NOT_FOUND) {
+            gc_write_barrier(&value);
+            slots_[slot].assign_data(std::move(value));
+            return;
+        }
+        slot = shape_->find(name.as_str(), is_case_sensitive(activation));
+        if (slot != Shape::NOT_FOUND && is_plain_writable(shape_->flags(slot))) {
+            cache.update(*shape_, name, slot);
+        }
+        set(name.as_str(), std::make_shared<Value>(std::move(value)), activation);
+    }
+
+    // Own keys in the same order as `get_keys`. `position` counts the named
+    // slots still to visit and `secondary` the dense elements.
+    std::optional<OwnKey> next_own_key(OwnKeyCursor& cursor) const override {
+        if (!cursor.started) {
+            cursor.position = shape_->slot_count();
+            cursor.secondary = static_cast<uint32_t>(dense_.size());
+            cursor.started = true;
+        }
+        uint32_t& named = cursor.position;
+        uint32_t& element = cursor.secondary;
+        // Deleting during enumeration may have compacted the slots.
+        named = std::min(named, shape_->slot_count());
+        element = std::min(element, static_cast<uint32_t>(dense_.size()));
+        while (named > 0 && shape_->is_removed(named - 1) &&
+               !(element > 0 && dense_named_[element - 1] >= named)) {
+            --named;
+        }
+        if (element > 0 && dense_named_[element - 1] >= named) {
+            --element;
+            auto result = std::to_chars(cursor.digits, cursor.digits + sizeof(cursor.digits), element);
+            return OwnKey{std::string_view(cursor.digits, result.ptr - cursor.digits), true};
+        }
+        if (named > 0) {
+            --named;
+            bool hidden = shape_->flags(named) & static_cast<uint32_t>(Attribute::DONT_ENUM);
+            return OwnKey{shape_->key(named), !hidden};
+        }
+        return std::nullopt;
     }
 
     // Get all property names
@@ -152,9 +573,22 @@ public:
                                      bool include_prototype = true) const override {
         std::vector<std::string> keys;
 
-        // Add own properties
-        auto own_keys = properties_->get_keys();
-        keys.insert(keys.end(), own_keys.begin(), own_keys.end());
+        // Own properties come most recently added first, the order of
+        // Ruffle's `PropertyMap::iter` and of Flash. (The property map this
+        // replaced was unordered, so its order was unspecified.)
+        uint32_t named = shape_->slot_count();
+        size_t element = dense_.size();
+        while (named > 0 || element > 0) {
+            if (element > 0 && dense_named_[element - 1] >= named) {
+                keys.push_back(std::to_string(element - 1));
+                --element;
+            } else {
+                if (!shape_->is_removed(named - 1)) {
+                    keys.push_back(shape_->key(named - 1));
+                }
+                --named;
+            }
+        }
 
         // Optionally add prototype properties
         if (include_prototype && prototype_) {
@@ -172,22 +606,37 @@ public:
     // Check if this object has a specific property
     bool has_property(const std::string& name,
                     std::shared_ptr<Activation> activation) const override {
-        if (properties_->has_property(name)) {
+        if (has_own_property(name, activation)) {
             return true;
         }
 
-        if (prototype_) {
-            return prototype_->has_property(name, activation);
-        }
+        return prototype_ &&
+               lookup_proto_chain(prototype_, name, activation).first != nullptr;
+    }
 
-        return false;
+    bool has_own_property(const std::string& name,
+                          std::shared_ptr<Activation> activation) const override {
+        return dense_index(name) ||
+               shape_->find(name, is_case_sensitive(activation)) != Shape::NOT_FOUND;
+    }
+
+    std::shared_ptr<Value> get_own(const std::string& name,
+                                   std::shared_ptr<Activation> activation) const override {
+        if (auto index = dense_index(name)) {
+            return dense_[*index];
+        }
+        uint32_t slot = shape_->find(name, is_case_sensitive(activation));
+        return slot != Shape::NOT_FOUND ? get_slot(slot, activation) : nullptr;
     }
 
     // Get element by index (array-like access)
     std::shared_ptr<Value> get_element(std::shared_ptr<Activation> activation,
                                       int32_t index) const {
-        if (is_array_like_ || type_name_ == "Array") {
-            // For array-like objects, treat index as string property
+        if (is_array()) {
+            if (is_dense() && index >= 0 && static_cast<uint32_t>(index) < dense_.size()) {
+                return dense_[index];
+            }
+            // Holes and sparse elements are ordinary properties
             std::string index_str = std::to_string(index);
             return get(index_str, activation);
         }
@@ -200,8 +649,10 @@ public:
     void set_element(std::shared_ptr<Activation> activation,
                     int32_t index,
                     std::shared_ptr<Value> value) {
-        if (is_array_like_ || type_name_ == "Array") {
-            // For array-like objects, treat index as string property
+        if (is_array()) {
+            if (index >= 0 && try_set_dense(static_cast<uint32_t>(index), value)) {
+                return;
+            }
             std::string index_str = std::to_string(index);
             set(index_str, std::move(value), activation);
         }
@@ -209,7 +660,7 @@ public:
 
     // Delete element by index
     bool delete_element(std::shared_ptr<Activation> activation, int32_t index) {
-        if (is_array_like_ || type_name_ == "Array") {
+        if (is_array()) {
             std::string index_str = std::to_string(index);
             return delete_property(activation, index_str);
         }
@@ -219,60 +670,120 @@ public:
     // Delete a property
     bool delete_property(std::shared_ptr<Activation> activation,
                         const std::string& name) {
-        return properties_->delete_property(name);
+        if (auto index = dense_index(name)) {
+            if (*index + 1 != dense_.size()) {
+                // Deleting from the middle would leave a hole
+                make_sparse();
+                return delete_property(activation, name);
+            }
+            dense_.pop_back();
+            dense_named_.pop_back();
+            bump_epoch();
+            return true;
+        }
+
+        uint32_t slot = shape_->find(name, is_case_sensitive(activation));
+        if (slot == Shape::NOT_FOUND || !slots_[slot].can_delete()) {
+            return false;
+        }
+        // Shared shapes only ever grow, so deleting moves this object to a
+        // private layout.
+        if (!shape_->is_dictionary()) {
+            shape_ = shape_->to_dictionary();
+        }
+        shape_->remove_slot(slot);
+        slots_[slot] = Property::new_stored(nullptr, Attribute{});
+        if (shape_->needs_compaction()) {
+            compact_slots();
+        }
+        bump_epoch();
+        return true;
     }
 
     // Get the length of the object (for array-like objects)
     int32_t length(std::shared_ptr<Activation> activation) const {
-        if (is_array_like_ || type_name_ == "Array") {
-            // Find the highest numeric index and return length
-            int32_t max_index = -1;
-            auto keys = get_keys(activation, false);
-            for (const auto& key : keys) {
-                try {
-                    int32_t index = std::stoi(key);
-                    if (index > max_index) {
-                        max_index = index;
-                    }
-                } catch (...) {
-                    // Not a numeric key, continue
-                }
+        if (!is_array()) {
+            return 0;
+        }
+        // Dense elements are exactly 0..dense_.size()-1, with no index keys
+        // in the shape.
+        if (!sparse_) {
+            return static_cast<int32_t>(dense_.size());
+        }
+        int64_t length = 0;
+        for (uint32_t slot = 0; slot < shape_->slot_count(); ++slot) {
+            if (shape_->is_removed(slot)) {
+                continue;
+            }
+            if (auto index = parse_array_index(shape_->key(slot))) {
+                length = std::max<int64_t>(length, int64_t(*index) + 1);
             }
-            return max_index + 1;
         }
-        return 0;
+        return static_cast<int32_t>(std::min<int64_t>(length, INT32_MAX));
     }
 
     // Set the length of the object (for array-like objects)
     void set_length(std::shared_ptr<Activation> activation, int32_t new_length) {
-        if (is_array_like_ || type_name_ == "Array") {
-            // Remove elements with indices >= new_length
-            auto keys = get_keys(activation, false);
-            for (const auto& key : keys) {
-                try {
-                    int32_t index = std::stoi(key);
-                    if (index >= new_length) {
-                        delete_property(activation, key);
-                    }
-                } catch (...) {
-                    // Not a numeric key, continue
-                }
+        if (!is_array()) {
+            return;
+        }
+        size_t keep = static_cast<size_t>(std::max(new_length, 0));
+        if (!sparse_) {
+            if (keep < dense_.size()) {
+                dense_.resize(keep);
+                dense_named_.resize(keep);
+                bump_epoch();
+            }
+            return;
+        }
+
+        // Remove elements with indices >= new_length
+        std::vector<std::string> doomed;
+        for (uint32_t slot = 0; slot < shape_->slot_count(); ++slot) {
+            auto index = parse_array_index(shape_->key(slot));
+            if (index && *index >= keep && !shape_->is_removed(slot)) {
+                doomed.push_back(shape_->key(slot));
             }
         }
+        for (const auto& key : doomed) {
+            delete_property(activation, key);
+        }
     }
 
+    ScriptObject* as_script_object() override { return this; }
+
     // Getters
-    std::shared_ptr<PropertyMap> properties() const { return properties_; }
+    const Shape& shape() const { return *shape_; }
     std::shared_ptr<Object> proto() const override { return prototype_; }
     std::shared_ptr<FunctionObject> constr() const override { return constructor_; }
     std::shared_ptr<NativeObject> native() const { return native_object_; }
     const std::string& type_name() const override { return type_name_; }
 
     // Setters
-    void set_proto(std::shared_ptr<Object> proto) override { prototype_ = std::move(proto); }
-    void set_constr(std::shared_ptr<FunctionObject> constr) override { constructor_ = std::move(constr); }
+    void set_proto(std::shared_ptr<Object> proto) override {
+        gc_write_barrier_cell(proto.get());
+        prototype_ = std::move(proto);
+        bump_epoch();
+    }
+    void set_constr(std::shared_ptr<FunctionObject> constr) override {
+        gc_write_barrier_function(constr.get());
+        constructor_ = std::move(constr);
+    }
     void set_native(std::shared_ptr<NativeObject> native) { native_object_ = std::move(native); }
-    void set_array_like(bool array_like) { is_array_like_ = array_like; }
+    void set_array_like(bool array_like) {
+        if (!array_like && is_array_like_) {
+            make_sparse();
+        } else if (array_like && !is_array()) {
+            // Elements already stored as properties stay there
+            for (uint32_t slot = 0; slot < shape_->slot_count(); ++slot) {
+                if (!shape_->is_removed(slot) && parse_array_index(shape_->key(slot))) {
+                    sparse_ = true;
+                    break;
+                }
+            }
+        }
+        is_array_like_ = array_like;
+    }
 
     // Convert to value
     std::shared_ptr<Value> as_value() const override {
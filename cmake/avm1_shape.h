@@ -0,0 +1,394 @@
+/*
+ * C++ header for AVM1 object shapes
+ * Shared property layouts ("hidden classes") and the inline caches keyed by them
+ */
+
+#ifndef AVM1_SHAPE_H
+#define AVM1_SHAPE_H
+
+#include "avm1/atom.h"
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ruffle {
+
+// The layout of an object's own properties.
+//
+// A shape maps property names to slot indices and records, per slot, the
+// property attributes plus whether the property is virtual (has a getter or
+// setter) or watched. Objects that received the same properties in the same
+// order, with the same attributes, share one shape, so an inline cache that
+// has seen a shape once can read the slot without a name lookup.
+//
+// Shared shapes form an immutable transition tree rooted at `Shape::empty()`.
+// Adding a property or changing a slot's flags moves the object to a child
+// shape. Shared shapes are never freed, so their ids are never reused; the
+// tree is capped at `MAX_SHARED_SHAPES` so that it cannot grow without bound.
+//
+// The tree is shared by every runtime in the process, so shared shapes are
+// thread-safe: ids come from an atomic counter, transitions are added under
+// a per-shape lock and the name table is built once.
+//
+// Deleting a property, or growing past the transition limits, moves the
+// object to a private "dictionary" shape which it mutates in place. Inline
+// caches never record dictionary shapes. A dictionary shape belongs to one
+// object and is not thread-safe.
+//
+// Removing a slot from a dictionary shape leaves a tombstone, so later slots
+// keep their indices and removal is O(1). Once tombstones outnumber live
+// slots, the owner compacts the shape together with its values.
+class Shape {
+public:
+    // Slot flags. The low 16 bits are the property's `Attribute` bits.
+    static constexpr uint32_t ATTRIBUTE_MASK = 0xFFFF;
+    static constexpr uint32_t VIRTUAL = 1u << 16;
+    static constexpr uint32_t WATCHED = 1u << 17;
+
+    static constexpr uint32_t NOT_FOUND = std::numeric_limits<uint32_t>::max();
+
+    // Objects with more properties than this are kept in dictionary mode;
+    // they are almost always used as hash maps, and sharing their layout
+    // would only grow the transition tree.
+    static constexpr size_t MAX_SHARED_PROPERTIES = 64;
+    // Maximum children per shared shape.
+    static constexpr size_t MAX_TRANSITIONS = 64;
+    // Maximum shared shapes in the process. Past this, new layouts go
+    // straight to dictionary mode.
+    static constexpr size_t MAX_SHARED_SHAPES = 1 << 16;
+
+private:
+    enum class Kind : uint8_t {
+        ROOT,
+        ADD,          // Appends `key_` as slot `slot_`
+        RECONFIGURE,  // Replaces the flags of slot `slot_`
+        DICTIONARY
+    };
+
+    struct SlotInfo {
+        std::string key;
+        uint32_t flags;
+        bool removed = false;
+    };
+
+    // Compaction is not worth it for tiny dictionaries.
+    static constexpr size_t MIN_COMPACT_TOMBSTONES = 8;
+
+    // Name -> slot index, built lazily for shared shapes.
+    struct Table {
+        std::vector<SlotInfo> slots;
+        std::unordered_map<std::string, uint32_t> exact;
+        std::unordered_multimap<size_t, uint32_t> folded;
+        size_t tombstones = 0;
+
+        void add(const std::string& key, uint32_t flags) {
+            uint32_t slot = static_cast<uint32_t>(slots.size());
+            slots.push_back({key, flags, false});
+            exact.emplace(key, slot);
+            folded.emplace(avm1_folded_name_hash(key), slot);
+        }
+
+        // Leave a tombstone in `slot`; other slots keep their indices.
+        void remove(uint32_t slot) {
+            exact.erase(slots[slot].key);
+            auto range = folded.equal_range(avm1_folded_name_hash(slots[slot].key));
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == slot) {
+                    folded.erase(it);
+                    break;
+                }
+            }
+            slots[slot].key.clear();
+            slots[slot].removed = true;
+            tombstones++;
+        }
+
+        void compact() {
+            std::vector<SlotInfo> live;
+            live.reserve(slots.size() - tombstones);
+            for (auto& slot : slots) {
+                if (!slot.removed) {
+                    live.push_back(std::move(slot));
+                }
+            }
+            slots.clear();
+            exact.clear();
+            folded.clear();
+            tombstones = 0;
+            for (auto& slot : live) {
+                add(slot.key, slot.flags);
+            }
+        }
+
+        uint32_t find(const std::string& key, bool case_sensitive) const {
+            if (case_sensitive) {
+                auto it = exact.find(key);
+                return it != exact.end() ? it->second : NOT_FOUND;
+            }
+            // Prefer the first matching slot, like a scan in insertion order.
+            uint32_t found = NOT_FOUND;
+            auto range = folded.equal_range(avm1_folded_name_hash(key));
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second < found && avm1_eq_ignore_case(slots[it->second].key, key)) {
+                    found = it->second;
+                }
+            }
+            return found;
+        }
+    };
+
+    struct TransitionKey {
+        Kind kind;
+        std::string key;
+        uint32_t slot;
+        uint32_t flags;
+
+        bool operator==(const TransitionKey& other) const {
+            return kind == other.kind && slot == other.slot && flags == other.flags &&
+                   key == other.key;
+        }
+    };
+
+    struct TransitionKeyHash {
+        size_t operator()(const TransitionKey& k) const {
+            size_t h = avm1_name_hash(k.key);
+            h ^= (static_cast<size_t>(k.slot) << 20) ^ k.flags ^ static_cast<size_t>(k.kind);
+            return h;
+        }
+    };
+
+    // Shared shapes: the parent owns its children, so a raw back pointer
+    // is enough.
+    const Shape* parent_;
+    Kind kind_;
+    std::string key_;
+    uint32_t slot_;
+    uint32_t flags_;
+    uint32_t count_;
+    uint32_t id_;
+    mutable std::unique_ptr<Table> table_;
+    mutable std::once_flag table_once_;
+    mutable std::mutex transitions_mutex_;
+    mutable std::unordered_map<TransitionKey, std::shared_ptr<Shape>, TransitionKeyHash> transitions_;
+
+    static uint32_t next_id() {
+        static std::atomic<uint32_t> id{0};
+        return id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static std::atomic<size_t>& shared_shapes() {
+        static std::atomic<size_t> count{0};
+        return count;
+    }
+
+    Shape(const Shape* parent, Kind kind, std::string key, uint32_t slot, uint32_t flags,
+          uint32_t count)
+        : parent_(parent), kind_(kind), key_(std::move(key)), slot_(slot), flags_(flags),
+          count_(count), id_(next_id()) {}
+
+    const Table& table() const {
+        if (kind_ == Kind::DICTIONARY) {
+            return *table_;
+        }
+        std::call_once(table_once_, [this] {
+            std::vector<const Shape*> chain;
+            for (const Shape* s = this; s; s = s->parent_) {
+                chain.push_back(s);
+            }
+            auto table = std::make_unique<Table>();
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                const Shape* s = *it;
+                if (s->kind_ == Kind::ADD) {
+                    table->add(s->key_, s->flags_);
+                } else if (s->kind_ == Kind::RECONFIGURE) {
+                    table->slots[s->slot_].flags = s->flags_;
+                }
+            }
+            table_ = std::move(table);
+        });
+        return *table_;
+    }
+
+    std::shared_ptr<Shape> transition(TransitionKey key) const {
+        std::lock_guard<std::mutex> lock(transitions_mutex_);
+        auto it = transitions_.find(key);
+        if (it != transitions_.end()) {
+            return it->second;
+        }
+        if (transitions_.size() >= MAX_TRANSITIONS) {
+            return nullptr;
+        }
+        if (shared_shapes().fetch_add(1, std::memory_order_relaxed) >= MAX_SHARED_SHAPES) {
+            shared_shapes().fetch_sub(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        uint32_t count = key.kind == Kind::ADD ? count_ + 1 : count_;
+        std::shared_ptr<Shape> child(
+            new Shape(this, key.kind, key.key, key.slot, key.flags, count));
+        transitions_.emplace(std::move(key), child);
+        return child;
+    }
+
+public:
+    Shape(const Shape&) = delete;
+    Shape& operator=(const Shape&) = delete;
+
+    // The shape of an object without own properties.
+    static std::shared_ptr<Shape> empty() {
+        static std::shared_ptr<Shape> root(new Shape(nullptr, Kind::ROOT, std::string(), 0, 0, 0));
+        return root;
+    }
+
+    uint32_t id() const { return id_; }
+    // Number of properties.
+    uint32_t len() const { return count_; }
+    // Number of slots, including tombstones. Slot indices run up to this.
+    uint32_t slot_count() const {
+        return kind_ == Kind::DICTIONARY ? static_cast<uint32_t>(table_->slots.size()) : count_;
+    }
+    bool is_removed(uint32_t slot) const {
+        return kind_ == Kind::DICTIONARY && table_->slots[slot].removed;
+    }
+    bool is_dictionary() const { return kind_ == Kind::DICTIONARY; }
+
+    // Slot holding `key`, or `NOT_FOUND`.
+    uint32_t find(const std::string& key, bool case_sensitive) const {
+        if (count_ == 0) {
+            return NOT_FOUND;
+        }
+        return table().find(key, case_sensitive);
+    }
+
+    const std::string& key(uint32_t slot) const { return table().slots[slot].key; }
+    uint32_t flags(uint32_t slot) const { return table().slots[slot].flags; }
+
+    // Shared-shape transitions. Both return null if this shape cannot grow
+    // further; the caller should switch to a dictionary shape.
+    std::shared_ptr<Shape> with_property(const std::string& key, uint32_t flags) const {
+        assert(!is_dictionary());
+        if (count_ >= MAX_SHARED_PROPERTIES) {
+            return nullptr;
+        }
+        return transition({Kind::ADD, key, count_, flags});
+    }
+
+    std::shared_ptr<Shape> with_flags(uint32_t slot, uint32_t flags) const {
+        assert(!is_dictionary() && slot < count_ && this->flags(slot) != flags);
+        return transition({Kind::RECONFIGURE, std::string(), slot, flags});
+    }
+
+    // A private, mutable copy of this layout.
+    std::shared_ptr<Shape> to_dictionary() const {
+        std::shared_ptr<Shape> dict(
+            new Shape(nullptr, Kind::DICTIONARY, std::string(), 0, 0, count_));
+        dict->table_ = std::make_unique<Table>(count_ == 0 ? Table() : table());
+        return dict;
+    }
+
+    // Dictionary-shape mutation. Every change takes a fresh id so that an
+    // id never describes two different layouts.
+    void add_slot(const std::string& key, uint32_t flags) {
+        assert(is_dictionary());
+        table_->add(key, flags);
+        count_++;
+        id_ = next_id();
+    }
+
+    void set_slot_flags(uint32_t slot, uint32_t flags) {
+        assert(is_dictionary());
+        table_->slots[slot].flags = flags;
+        id_ = next_id();
+    }
+
+    // Remove `slot`, leaving a tombstone.
+    void remove_slot(uint32_t slot) {
+        assert(is_dictionary() && !is_removed(slot));
+        table_->remove(slot);
+        count_--;
+        id_ = next_id();
+    }
+
+    // Whether enough slots are tombstones that `compact` should run.
+    bool needs_compaction() const {
+        return is_dictionary() && table_->tombstones >= MIN_COMPACT_TOMBSTONES &&
+               table_->tombstones > table_->slots.size() / 2;
+    }
+
+    // Drop tombstones, moving live slots down in order. The owner must
+    // compact its values to match.
+    void compact() {
+        assert(is_dictionary());
+        table_->compact();
+        id_ = next_id();
+    }
+};
+
+// A polymorphic inline cache for one property access site.
+//
+// Records up to `MAX_ENTRIES` (shape id, name, slot) triples. The name is
+// part of the key because a site such as `obj[key]` may look up a
+// different name on every execution. Once more shapes than
+// that have been seen the site is megamorphic and stops caching, since
+// probing a long list would cost more than the lookup it saves.
+//
+// Caches only ever hold shared shape ids. Any change that could make a
+// cached slot unsuitable (an attribute change through `ASSetPropFlags`, a
+// getter or setter added by `addProperty`, a `watch`) moves the object to a
+// different shape, so a hit is always safe to use without further checks.
+class PropertyCache {
+public:
+    static constexpr size_t MAX_ENTRIES = 4;
+
+private:
+    struct Entry {
+        uint32_t shape_id;
+        Avm1Atom name;
+        uint32_t slot;
+    };
+
+    std::array<Entry, MAX_ENTRIES> entries_{};
+    uint8_t len_ = 0;
+    bool megamorphic_ = false;
+
+public:
+    // Cached slot of `name` in `shape`, or `Shape::NOT_FOUND`.
+    uint32_t lookup(const Shape& shape, Avm1Atom name) const {
+        for (uint8_t i = 0; i < len_; ++i) {
+            if (entries_[i].shape_id == shape.id() && entries_[i].name == name) {
+                return entries_[i].slot;
+            }
+        }
+        return Shape::NOT_FOUND;
+    }
+
+    void update(const Shape& shape, Avm1Atom name, uint32_t slot) {
+        if (megamorphic_ || shape.is_dictionary()) {
+            return;
+        }
+        if (len_ == MAX_ENTRIES) {
+            megamorphic_ = true;
+            len_ = 0;
+            return;
+        }
+        entries_[len_++] = {shape.id(), name, slot};
+    }
+
+    bool is_monomorphic() const { return len_ == 1; }
+    bool is_megamorphic() const { return megamorphic_; }
+
+    void clear() {
+        len_ = 0;
+        megamorphic_ = false;
+    }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_SHAPE_H
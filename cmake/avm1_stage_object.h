@@ -13,8 +13,12 @@
 #include "avm1/error.h"
 #include "avm1/property_map.h"
 #include "avm1/clamp.h"
+#include "avm1/atom.h"
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
@@ -24,6 +28,200 @@ namespace ruffle {
 class DisplayObject;
 class MovieClip;
 
+// A display object property such as `_x`, with its accessors. Read-only
+// properties have no setter.
+struct DisplayProperty {
+    using Getter = std::shared_ptr<Value> (*)(const std::shared_ptr<DisplayObject>& dobj,
+                                              const std::shared_ptr<Activation>& activation);
+    using Setter = void (*)(const std::shared_ptr<DisplayObject>& dobj,
+                            const std::shared_ptr<Value>& value,
+                            const std::shared_ptr<Activation>& activation);
+
+    std::string_view name;
+    Getter get;
+    Setter set;
+};
+
+// Accessors of the display object properties
+class DisplayPropertyAccessors {
+public:
+    using DObj = std::shared_ptr<DisplayObject>;
+    using Act = std::shared_ptr<Activation>;
+    using Val = std::shared_ptr<Value>;
+
+    static Val get_x(const DObj& dobj, const Act&) { return std::make_shared<Value>(dobj->x()); }
+    static void set_x(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_x(value->coerce_to_number(activation));
+    }
+
+    static Val get_y(const DObj& dobj, const Act&) { return std::make_shared<Value>(dobj->y()); }
+    static void set_y(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_y(value->coerce_to_number(activation));
+    }
+
+    // Scale and alpha are in percent
+    static Val get_xscale(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(dobj->scale_x() * 100.0);
+    }
+    static void set_xscale(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_scale_x(value->coerce_to_number(activation) / 100.0);
+    }
+
+    static Val get_yscale(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(dobj->scale_y() * 100.0);
+    }
+    static void set_yscale(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_scale_y(value->coerce_to_number(activation) / 100.0);
+    }
+
+    static Val get_alpha(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(dobj->alpha() * 100.0);
+    }
+    static void set_alpha(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_alpha(value->coerce_to_number(activation) / 100.0);
+    }
+
+    static Val get_rotation(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(dobj->rotation());
+    }
+    static void set_rotation(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_rotation(value->coerce_to_number(activation));
+    }
+
+    static Val get_visible(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(dobj->visible());
+    }
+    static void set_visible(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_visible(value->coerce_to_boolean(activation));
+    }
+
+    static Val get_width(const DObj& dobj, const Act&) { return std::make_shared<Value>(dobj->width()); }
+    static void set_width(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_width(value->coerce_to_number(activation));
+    }
+
+    static Val get_height(const DObj& dobj, const Act&) { return std::make_shared<Value>(dobj->height()); }
+    static void set_height(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_height(value->coerce_to_number(activation));
+    }
+
+    static Val get_name(const DObj& dobj, const Act&) { return std::make_shared<Value>(dobj->name()); }
+    static void set_name(const DObj& dobj, const Val& value, const Act& activation) {
+        dobj->set_name(value->coerce_to_string(activation));
+    }
+
+    static Val get_currentframe(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(static_cast<double>(dobj->current_frame()));
+    }
+
+    static Val get_totalframes(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(static_cast<double>(dobj->total_frames()));
+    }
+
+    static Val get_target(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(dobj->target_path());
+    }
+
+    static Val get_framesloaded(const DObj& dobj, const Act&) {
+        return std::make_shared<Value>(static_cast<double>(dobj->frames_loaded()));
+    }
+
+    static Val get_url(const DObj& dobj, const Act&) { return std::make_shared<Value>(dobj->url()); }
+
+    // Mouse coordinates, in the object's local space
+    static Val get_xmouse(const DObj& dobj, const Act& activation) {
+        return std::make_shared<Value>(dobj->local_mouse_position(activation->context()).x);
+    }
+
+    static Val get_ymouse(const DObj& dobj, const Act& activation) {
+        return std::make_shared<Value>(dobj->local_mouse_position(activation->context()).y);
+    }
+};
+
+inline constexpr std::array<DisplayProperty, 17> DISPLAY_PROPERTIES = {{
+    {"_x", &DisplayPropertyAccessors::get_x, &DisplayPropertyAccessors::set_x},
+    {"_y", &DisplayPropertyAccessors::get_y, &DisplayPropertyAccessors::set_y},
+    {"_xscale", &DisplayPropertyAccessors::get_xscale, &DisplayPropertyAccessors::set_xscale},
+    {"_yscale", &DisplayPropertyAccessors::get_yscale, &DisplayPropertyAccessors::set_yscale},
+    {"_currentframe", &DisplayPropertyAccessors::get_currentframe, nullptr},
+    {"_totalframes", &DisplayPropertyAccessors::get_totalframes, nullptr},
+    {"_alpha", &DisplayPropertyAccessors::get_alpha, &DisplayPropertyAccessors::set_alpha},
+    {"_visible", &DisplayPropertyAccessors::get_visible, &DisplayPropertyAccessors::set_visible},
+    {"_width", &DisplayPropertyAccessors::get_width, &DisplayPropertyAccessors::set_width},
+    {"_height", &DisplayPropertyAccessors::get_height, &DisplayPropertyAccessors::set_height},
+    {"_rotation", &DisplayPropertyAccessors::get_rotation, &DisplayPropertyAccessors::set_rotation},
+    {"_target", &DisplayPropertyAccessors::get_target, nullptr},
+    {"_framesloaded", &DisplayPropertyAccessors::get_framesloaded, nullptr},
+    {"_name", &DisplayPropertyAccessors::get_name, &DisplayPropertyAccessors::set_name},
+    {"_url", &DisplayPropertyAccessors::get_url, nullptr},
+    {"_xmouse", &DisplayPropertyAccessors::get_xmouse, nullptr},
+    {"_ymouse", &DisplayPropertyAccessors::get_ymouse, nullptr},
+}};
+
+// Perfect hash from the ASCII-folded name hash of a display property to
+// its index in `DISPLAY_PROPERTIES`. The multiplier is searched for at
+// compile time so that no two properties share a slot.
+struct DisplayPropertyHash {
+    static constexpr unsigned BITS = 6;
+    static constexpr uint8_t EMPTY = 0xFF;
+
+    uint64_t multiplier;
+    std::array<uint8_t, size_t(1) << BITS> slots;
+
+    static constexpr size_t slot(uint64_t hash, uint64_t multiplier) {
+        return static_cast<size_t>((hash * multiplier) >> (64 - BITS));
+    }
+
+    constexpr size_t slot(uint64_t hash) const { return slot(hash, multiplier); }
+};
+
+constexpr DisplayPropertyHash make_display_property_hash() {
+    DisplayPropertyHash hash{0, {}};
+    for (uint64_t multiplier = 0x9E3779B97F4A7C15ull; ; multiplier += 2) {
+        hash.multiplier = multiplier;
+        for (auto& slot : hash.slots) {
+            slot = DisplayPropertyHash::EMPTY;
+        }
+        bool collision = false;
+        for (size_t i = 0; i < DISPLAY_PROPERTIES.size() && !collision; ++i) {
+            size_t slot = hash.slot(avm1_folded_name_hash(DISPLAY_PROPERTIES[i].name));
+            collision = hash.slots[slot] != DisplayPropertyHash::EMPTY;
+            hash.slots[slot] = static_cast<uint8_t>(i);
+        }
+        if (!collision) {
+            return hash;
+        }
+    }
+}
+
+inline constexpr DisplayPropertyHash DISPLAY_PROPERTY_HASH = make_display_property_hash();
+
+// Find a display property given the ASCII-folded hash of its name.
+// Property names are never case sensitive.
+inline const DisplayProperty* find_display_property(size_t folded_hash, std::string_view name) {
+    uint8_t index = DISPLAY_PROPERTY_HASH.slots[DISPLAY_PROPERTY_HASH.slot(folded_hash)];
+    if (index == DisplayPropertyHash::EMPTY) {
+        return nullptr;
+    }
+    const DisplayProperty& property = DISPLAY_PROPERTIES[index];
+    return avm1_eq_ignore_case(property.name, name) ? &property : nullptr;
+}
+
+// Atoms carry their folded hash, so this is a single table probe.
+inline const DisplayProperty* find_display_property(Avm1Atom name) {
+    if (name.len() < 2 || name.view()[0] != '_') {
+        return nullptr;
+    }
+    return find_display_property(name.folded_hash(), name.view());
+}
+
+inline const DisplayProperty* find_display_property(std::string_view name) {
+    if (name.size() < 2 || name[0] != '_') {
+        return nullptr;
+    }
+    return find_display_property(avm1_folded_name_hash(name), name);
+}
+
 // Stage object functionality for AVM1
 class StageObject {
 public:
@@ -32,73 +230,34 @@ public:
         std::shared_ptr<DisplayObject> dobj,
         const std::string& name,
         std::shared_ptr<Activation> activation) {
-        
-        // Property search order for DisplayObjects:
-
-        // 1) Path properties such as `_root`, `_parent`, `_levelN` (obeys case sensitivity)
-        bool magic_property = name.length() > 0 && name[0] == '_';
-        if (magic_property) {
-            auto object = resolve_path_property(dobj, name, activation);
-            if (object) {
-                return object;
-            }
-        }
-
-        // 2) Child display objects with the given instance name
-        auto child = dobj->child_by_name(name, activation->is_case_sensitive());
-        if (child) {
-            auto child_obj = child->object1();
-            if (child_obj) {
-                return child_obj->as_value();
-            } else {
-                // If an object doesn't have an object representation, e.g. Graphic,
-                // then trying to access it returns the parent instead
-                auto parent = child->parent();
-                if (parent) {
-                    auto parent_obj = parent->object1();
-                    if (parent_obj) {
-                        return parent_obj->as_value();
-                    }
-                }
-            }
-            return std::make_shared<Value>(Value::UNDEFINED);
-        }
-
-        // 3) Display object properties such as `_x`, `_y` (never case sensitive)
-        if (magic_property) {
-            auto property = activation->context()->avm1.get_display_property(name);
-            if (property) {
-                return property;
-            }
-        }
-
-        // 4) Properties of the underlying object
-        if (auto obj = dobj->object1()) {
-            return obj->get(name, activation);
-        }
+        return get_property(std::move(dobj), name, find_display_property(name), activation);
+    }
 
-        return nullptr; // Property not found
+    // As above, for an interned name; the display property lookup uses the
+    // atom's precomputed hash.
+    static std::shared_ptr<Value> get_property(
+        std::shared_ptr<DisplayObject> dobj,
+        Avm1Atom name,
+        std::shared_ptr<Activation> activation) {
+        return get_property(std::move(dobj), name.as_str(), find_display_property(name), activation);
     }
 
     // Set a property on a display object
-    static bool set_property(
+    static void set_property(
         std::shared_ptr<DisplayObject> dobj,
         const std::string& name,
         std::shared_ptr<Value> value,
         std::shared_ptr<Activation> activation) {
-        
-        // Check if it's a magic property (starts with underscore)
-        if (name.length() > 0 && name[0] == '_') {
-            return set_magic_property(dobj, name, value, activation);
-        }
-
-        // Otherwise, set it as a regular property
-        if (auto obj = dobj->object1()) {
-            obj->set(name, value, activation);
-            return true;
-        }
+        set_property(std::move(dobj), name, find_display_property(name), std::move(value), activation);
+    }
 
-        return false;
+    static void set_property(
+        std::shared_ptr<DisplayObject> dobj,
+        Avm1Atom name,
+        std::shared_ptr<Value> value,
+        std::shared_ptr<Activation> activation) {
+        set_property(std::move(dobj), name.as_str(), find_display_property(name), std::move(value),
+                     activation);
     }
 
     // Resolve path properties like _root, _parent, _levelN
@@ -133,60 +292,6 @@ public:
         return nullptr; // Not a recognized path property
     }
 
-    // Set magic properties (those starting with underscore)
-    static bool set_magic_property(
-        std::shared_ptr<DisplayObject> dobj,
-        const std::string& name,
-        std::shared_ptr<Value> value,
-        std::shared_ptr<Activation> activation) {
-        
-        // Handle display object properties like _x, _y, _xscale, _yscale, etc.
-        if (name == "_x") {
-            double x = value->coerce_to_number(activation);
-            dobj->set_x(x);
-            return true;
-        } else if (name == "_y") {
-            double y = value->coerce_to_number(activation);
-            dobj->set_y(y);
-            return true;
-        } else if (name == "_xscale") {
-            double xscale = value->coerce_to_number(activation);
-            dobj->set_scale_x(xscale / 100.0); // Scale is in percentage
-            return true;
-        } else if (name == "_yscale") {
-            double yscale = value->coerce_to_number(activation);
-            dobj->set_scale_y(yscale / 100.0); // Scale is in percentage
-            return true;
-        } else if (name == "_alpha") {
-            double alpha = value->coerce_to_number(activation);
-            dobj->set_alpha(alpha / 100.0); // Alpha is in percentage
-            return true;
-        } else if (name == "_rotation") {
-            double rotation = value->coerce_to_number(activation);
-            dobj->set_rotation(rotation);
-            return true;
-        } else if (name == "_visible") {
-            bool visible = value->coerce_to_boolean(activation);
-            dobj->set_visible(visible);
-            return true;
-        } else if (name == "_width") {
-            double width = value->coerce_to_number(activation);
-            dobj->set_width(width);
-            return true;
-        } else if (name == "_height") {
-            double height = value->coerce_to_number(activation);
-            dobj->set_height(height);
-            return true;
-        } else if (name == "_name") {
-            std::string name_str = value->coerce_to_string(activation);
-            dobj->set_name(name_str);
-            return true;
-        }
-
-        // Property not handled
-        return false;
-    }
-
     // Coerce a value according to property index (for SetProperty action)
     static std::shared_ptr<Value> action_property_coerce(
         std::shared_ptr<Activation> activation,
@@ -219,6 +324,79 @@ public:
     }
 
 private:
+    // `property` is the display property named `name`, if any.
+    static std::shared_ptr<Value> get_property(
+        std::shared_ptr<DisplayObject> dobj,
+        const std::string& name,
+        const DisplayProperty* property,
+        std::shared_ptr<Activation> activation) {
+        
+        // Property search order for DisplayObjects:
+
+        // 1) Path properties such as `_root`, `_parent`, `_levelN` (obeys case sensitivity)
+        bool magic_property = name.length() > 0 && name[0] == '_';
+        if (magic_property) {
+            auto object = resolve_path_property(dobj, name, activation);
+            if (object) {
+                return object;
+            }
+        }
+
+        // 2) Child display objects with the given instance name
+        auto child = dobj->child_by_name(name, activation->is_case_sensitive());
+        if (child) {
+            auto child_obj = child->object1();
+            if (child_obj) {
+                return child_obj->as_value();
+            } else {
+                // If an object doesn't have an object representation, e.g. Graphic,
+                // then trying to access it returns the parent instead
+                auto parent = child->parent();
+                if (parent) {
+                    auto parent_obj = parent->object1();
+                    if (parent_obj) {
+                        return parent_obj->as_value();
+                    }
+                }
+            }
+            return std::make_shared<Value>(Value::UNDEFINED);
+        }
+
+        // 3) Display object properties such as `_x`, `_y` (never case sensitive)
+        if (property) {
+            return property->get(dobj, activation);
+        }
+
+        // 4) Properties of the underlying object
+        if (auto obj = dobj->object1()) {
+            return obj->get(name, activation);
+        }
+
+        return nullptr; // Property not found
+    }
+
+    static void set_property(
+        std::shared_ptr<DisplayObject> dobj,
+        const std::string& name,
+        const DisplayProperty* property,
+        std::shared_ptr<Value> value,
+        std::shared_ptr<Activation> activation) {
+
+        // Display object properties such as `_x`; writes to read-only ones
+        // are ignored.
+        if (property) {
+            if (property->set) {
+                property->set(dobj, value, activation);
+            }
+            return;
+        }
+
+        // Otherwise, set it as a regular property
+        if (auto obj = dobj->object1()) {
+            obj->set(name, std::move(value), activation);
+        }
+    }
+
     // Helper function to coerce property values to numbers
     static std::optional<double> property_coerce_to_number(
         std::shared_ptr<Activation> activation,
@@ -244,58 +422,12 @@ public:
         const std::string& name,
         std::shared_ptr<Activation> activation) {
         
-        if (name == "_x") {
-            return std::make_shared<Value>(dobj->x());
-        } else if (name == "_y") {
-            return std::make_shared<Value>(dobj->y());
-        } else if (name == "_xscale") {
-            return std::make_shared<Value>(dobj->scale_x() * 100.0); // Scale is in percentage
-        } else if (name == "_yscale") {
-            return std::make_shared<Value>(dobj->scale_y() * 100.0); // Scale is in percentage
-        } else if (name == "_alpha") {
-            return std::make_shared<Value>(dobj->alpha() * 100.0); // Alpha is in percentage
-        } else if (name == "_rotation") {
-            return std::make_shared<Value>(dobj->rotation());
-        } else if (name == "_visible") {
-            return std::make_shared<Value>(dobj->visible());
-        } else if (name == "_width") {
-            return std::make_shared<Value>(dobj->width());
-        } else if (name == "_height") {
-            return std::make_shared<Value>(dobj->height());
-        } else if (name == "_name") {
-            return std::make_shared<Value>(dobj->name());
-        } else if (name == "_currentframe") {
-            return std::make_shared<Value>(static_cast<double>(dobj->current_frame()));
-        } else if (name == "_totalframes") {
-            return std::make_shared<Value>(static_cast<double>(dobj->total_frames()));
-        } else if (name == "_target") {
-            return std::make_shared<Value>(dobj->target_path());
-        } else if (name == "_framesloaded") {
-            return std::make_shared<Value>(static_cast<double>(dobj->frames_loaded()));
-        } else if (name == "_url") {
-            return std::make_shared<Value>(dobj->url());
-        } else if (name == "_xmouse") {
-            return std::make_shared<Value>(x_mouse(activation, dobj));
-        } else if (name == "_ymouse") {
-            return std::make_shared<Value>(y_mouse(activation, dobj));
+        if (const DisplayProperty* property = find_display_property(name)) {
+            return property->get(dobj, activation);
         }
 
         return nullptr; // Not a recognized display property
     }
-
-private:
-    // Helper functions for mouse coordinates
-    static double x_mouse(std::shared_ptr<Activation> activation,
-                         std::shared_ptr<DisplayObject> this_obj) {
-        auto local = this_obj->local_mouse_position(activation->context());
-        return local.x; // Assuming local position is in pixels
-    }
-
-    static double y_mouse(std::shared_ptr<Activation> activation,
-                         std::shared_ptr<DisplayObject> this_obj) {
-        auto local = this_obj->local_mouse_position(activation->context());
-        return local.y; // Assuming local position is in pixels
-    }
 };
 
 } // namespace ruffle
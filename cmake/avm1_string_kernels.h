@@ -0,0 +1,425 @@
+/*
+ * C++ header for AVM1 string kernels
+ * parseInt, parseFloat, escape and unescape over string views
+ */
+
+#ifndef AVM1_STRING_KERNELS_H
+#define AVM1_STRING_KERNELS_H
+
+#include "number_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AVM1_STRING_KERNELS_SSE2 1
+#endif
+
+namespace ruffle {
+
+// Whitespace skipped before parseInt and parseFloat digits.
+constexpr bool avm1_is_parse_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Value of `c` as a digit in bases up to 36, or 36 if it is not one.
+constexpr int avm1_digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return 36;
+}
+
+// Characters `escape` leaves alone: ASCII letters and digits.
+constexpr bool avm1_is_escape_safe(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+// Index of the first byte `escape` must encode, or `s.size()`.
+inline size_t avm1_find_escape_byte(std::string_view s) {
+    size_t i = 0;
+#ifdef AVM1_STRING_KERNELS_SSE2
+    // Bytes >= 0x80 compare as negative, so they fail every range test.
+    const __m128i before_0 = _mm_set1_epi8('0' - 1);
+    const __m128i after_9 = _mm_set1_epi8('9' + 1);
+    const __m128i before_a = _mm_set1_epi8('a' - 1);
+    const __m128i after_z = _mm_set1_epi8('z' + 1);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    for (; i + 16 <= s.size(); i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, before_0), _mm_cmplt_epi8(v, after_9));
+        __m128i folded = _mm_or_si128(v, lower);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, before_a),
+                                       _mm_cmplt_epi8(folded, after_z));
+        int safe = _mm_movemask_epi8(_mm_or_si128(digit, letter));
+        if (safe != 0xFFFF) {
+            unsigned unsafe = static_cast<unsigned>(~safe) & 0xFFFFu;
+            size_t offset = 0;
+            while (!(unsafe & 1u)) {
+                unsafe >>= 1;
+                ++offset;
+            }
+            return i + offset;
+        }
+    }
+#endif
+    for (; i < s.size(); ++i) {
+        if (!avm1_is_escape_safe(static_cast<unsigned char>(s[i]))) {
+            return i;
+        }
+    }
+    return s.size();
+}
+
+// Index of the first '%' or '+', or `s.size()`.
+inline size_t avm1_find_unescape_byte(std::string_view s) {
+    size_t i = 0;
+#ifdef AVM1_STRING_KERNELS_SSE2
+    const __m128i percent = _mm_set1_epi8('%');
+    const __m128i plus = _mm_set1_epi8('+');
+    for (; i + 16 <= s.size(); i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+        int hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, percent),
+                                                  _mm_cmpeq_epi8(v, plus)));
+        if (hits != 0) {
+            size_t offset = 0;
+            while (!(hits & 1)) {
+                hits >>= 1;
+                ++offset;
+            }
+            return i + offset;
+        }
+    }
+#endif
+    for (; i < s.size(); ++i) {
+        if (s[i] == '%' || s[i] == '+') {
+            return i;
+        }
+    }
+    return s.size();
+}
+
+// `parseInt` with Flash's quirks:
+//
+// - A "0x" prefix is stripped whatever the radix, and must come before any
+//   spaces or sign: parseInt("0x  -10") is -16, parseInt("  -0x10") -0.
+// - "+0x"/"-0x" is NaN unless the radix is above 33, where "0x" are digits
+//   and the sign is ignored.
+// - Without a radix, "0" followed only by octal digits (optionally signed)
+//   is octal: parseInt("0123") is 83.
+// - A radix outside [2, 36] is NaN; digits stop at the first non-digit.
+inline double avm1_parse_int(std::string_view s, std::optional<int32_t> radix) {
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    if (radix && (*radix < 2 || *radix > 36)) {
+        return NaN;
+    }
+
+    bool ignore_sign = false;
+    int base;
+    auto is_x = [](char c) { return c == 'x' || c == 'X'; };
+    auto is_octal = [](std::string_view digits) {
+        if (digits.empty()) return false;
+        for (char c : digits) {
+            if (c < '0' || c > '7') return false;
+        }
+        return true;
+    };
+    if (s.size() >= 3 && (s[0] == '+' || s[0] == '-') && s[1] == '0' && is_x(s[2])) {
+        if (radix.value_or(0) <= 33) {
+            return NaN;
+        }
+        ignore_sign = true;
+        base = *radix;
+    } else if (s.size() >= 2 && s[0] == '0' && is_x(s[1])) {
+        s.remove_prefix(2);
+        base = radix.value_or(16);
+    } else if (!radix && ((s.size() >= 2 && s[0] == '0' && is_octal(s.substr(1))) ||
+                          (s.size() >= 3 && (s[0] == '+' || s[0] == '-') && s[1] == '0' &&
+                           is_octal(s.substr(2))))) {
+        base = 8;
+    } else {
+        base = radix.value_or(10);
+    }
+
+    size_t i = 0;
+    while (i < s.size() && avm1_is_parse_space(s[i])) {
+        ++i;
+    }
+    double sign = 1.0;
+    if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+        sign = s[i] == '-' ? -1.0 : 1.0;
+        ++i;
+    }
+
+    // Up to 2^53 the running value is exact in an integer.
+    uint64_t exact = 0;
+    double result = 0.0;
+    bool empty = true;
+    bool use_double = false;
+    for (; i < s.size(); ++i) {
+        int digit = avm1_digit_value(s[i]);
+        if (digit >= base) {
+            break;
+        }
+        empty = false;
+        if (!use_double && exact < (uint64_t(1) << 53) / 36) {
+            exact = exact * static_cast<uint64_t>(base) + static_cast<uint64_t>(digit);
+        } else {
+            if (!use_double) {
+                result = static_cast<double>(exact);
+                use_double = true;
+            }
+            result = result * base + digit;
+        }
+    }
+    if (empty) {
+        return NaN;
+    }
+    if (!use_double) {
+        result = static_cast<double>(exact);
+    }
+    return ignore_sign ? result : result * sign;
+}
+
+// `parseFloat` (and, with `strict`, `Number`) as Flash does it: leading
+// spaces, an optional sign, digits with any number of '.', and an optional
+// 'e' exponent whose digits may be missing. Without any digits or a '.'
+// the result is NaN; `strict` also rejects trailing characters.
+//
+// Flash sums each digit scaled with `decimal_shift` instead of rounding
+// correctly, so "3.14159" is a few ulps off the nearest double and
+// "1.7976931348623157e308" overflows to Infinity.
+inline double avm1_parse_float(std::string_view s, bool strict = false) {
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+    auto parse_sign = [](std::string_view& rest) {
+        if (!rest.empty() && (rest[0] == '-' || rest[0] == '+')) {
+            bool negative = rest[0] == '-';
+            rest.remove_prefix(1);
+            return negative;
+        }
+        return false;
+    };
+    auto skip_digits = [&](std::string_view& rest) {
+        size_t i = 0;
+        while (i < rest.size() && is_digit(rest[i])) {
+            ++i;
+        }
+        rest.remove_prefix(i);
+    };
+
+    while (!s.empty() && avm1_is_parse_space(s[0])) {
+        s.remove_prefix(1);
+    }
+    bool negative = parse_sign(s);
+    std::string_view after_sign = s;
+
+    skip_digits(s);
+    // Decimal exponent of the first digit. Like the exponent below, it
+    // wraps instead of overflowing.
+    uint32_t exp = static_cast<uint32_t>(after_sign.size() - s.size()) - 1u;
+    if (!s.empty() && s[0] == '.') {
+        s.remove_prefix(1);
+        skip_digits(s);
+    }
+    if (s.size() == after_sign.size()) {
+        return NaN;
+    }
+
+    if (!s.empty() && (s[0] == 'e' || s[0] == 'E')) {
+        s.remove_prefix(1);
+        bool exponent_negative = parse_sign(s);
+        uint32_t exponent = 0;
+        while (!s.empty() && is_digit(s[0])) {
+            exponent = exponent * 10u + static_cast<uint32_t>(s[0] - '0');
+            s.remove_prefix(1);
+        }
+        if (exponent_negative) {
+            exponent = 0u - exponent;
+        }
+        exp += exponent;
+    }
+
+    if (strict && !s.empty()) {
+        return NaN;
+    }
+
+    // Every digit before the exponent counts, past any number of '.'.
+    double result = 0.0;
+    for (char c : after_sign) {
+        if (is_digit(c)) {
+            result += decimal_shift(static_cast<double>(c - '0'), static_cast<int32_t>(exp));
+            exp -= 1u;
+        } else if (c != '.') {
+            break;
+        }
+    }
+    return negative ? -result : result;
+}
+
+// A string as a number, as `Number` and arithmetic coerce it. "0x" reads
+// the rest as hexadecimal digits that wrap to a signed 32-bit integer;
+// anything else must be a whole strict `parseFloat` literal, so "12abc"
+// and "" are NaN.
+inline double avm1_string_to_number(std::string_view s) {
+    if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        uint32_t value = 0;
+        for (char c : s.substr(2)) {
+            int digit = avm1_digit_value(c);
+            if (digit >= 16) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            value = value * 16u + static_cast<uint32_t>(digit);
+        }
+        return static_cast<double>(static_cast<int32_t>(value));
+    }
+    return avm1_parse_float(s, true);
+}
+
+// `escape`: every byte other than an ASCII letter or digit becomes "%XX".
+// Returns nothing if there is nothing to escape, so the caller can keep the
+// original string.
+inline std::optional<std::string> avm1_escape(std::string_view s) {
+    size_t first = avm1_find_escape_byte(s);
+    if (first == s.size()) {
+        return std::nullopt;
+    }
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(s.size() + (s.size() - first) * 2);
+    out.append(s.data(), first);
+    size_t i = first;
+    while (i < s.size()) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (avm1_is_escape_safe(c)) {
+            // Copy the whole run of safe bytes at once.
+            size_t run = avm1_find_escape_byte(s.substr(i));
+            out.append(s.data() + i, run);
+            i += run;
+            continue;
+        }
+        out += '%';
+        out += HEX[c >> 4];
+        out += HEX[c & 0xF];
+        ++i;
+    }
+    return out;
+}
+
+// Append `bytes` as valid UTF-8, replacing each maximal invalid
+// subsequence with U+FFFD, as Rust's `String::from_utf8_lossy` does.
+inline void avm1_append_utf8_lossy(std::string& out, std::string_view bytes) {
+    static constexpr char REPLACEMENT[] = "\xEF\xBF\xBD";
+    size_t i = 0;
+    while (i < bytes.size()) {
+        unsigned char lead = static_cast<unsigned char>(bytes[i]);
+        if (lead < 0x80) {
+            out += static_cast<char>(lead);
+            ++i;
+            continue;
+        }
+        size_t len = 0;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            len = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            len = 3;
+            low = lead == 0xE0 ? 0xA0 : 0x80;
+            high = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            len = 4;
+            low = lead == 0xF0 ? 0x90 : 0x80;
+            high = lead == 0xF4 ? 0x8F : 0xBF;
+        }
+        size_t valid = len == 0 ? 0 : 1;
+        while (valid > 0 && valid < len && i + valid < bytes.size()) {
+            unsigned char c = static_cast<unsigned char>(bytes[i + valid]);
+            unsigned char min = valid == 1 ? low : 0x80;
+            unsigned char max = valid == 1 ? high : 0xBF;
+            if (c < min || c > max) {
+                break;
+            }
+            ++valid;
+        }
+        if (len != 0 && valid == len) {
+            out.append(bytes.data() + i, len);
+            i += len;
+        } else {
+            out += REPLACEMENT;
+            i += valid == 0 ? 1 : valid;
+        }
+    }
+}
+
+// `unescape`: "%XX" becomes the byte XX and '+' a space.
+//
+// Flash's decoder is a small state machine: '%' (re)starts an escape that
+// takes the next hex digits, and the first other character ends it and is
+// dropped. The digits of an escape interrupted by another '%' are kept, so
+// "%4%41" collects 0x441, which is not a byte and decodes to nothing:
+//
+//   "%41"  -> "A"     "%G41" -> "41"
+//   "%%41" -> "A"     "%4"   -> ""
+//
+// The decoded bytes are read as UTF-8, with invalid sequences replaced.
+// Returns nothing if there is nothing to decode.
+inline std::optional<std::string> avm1_unescape(std::string_view s) {
+    size_t first = avm1_find_unescape_byte(s);
+    if (first == s.size()) {
+        return std::nullopt;
+    }
+    std::string bytes;
+    bytes.reserve(s.size());
+    bytes.append(s.data(), first);
+    int remain = 0;
+    // Value of the current escape's hex digits, saturated above a byte.
+    uint32_t digits = 0;
+    // Set once the output may not be valid UTF-8.
+    bool repair = false;
+    for (size_t i = first; i < s.size(); ++i) {
+        char c = s[i];
+        int value = avm1_digit_value(c);
+        if (c == '%') {
+            remain = 2;
+        } else if (remain > 0 && value < 16) {
+            --remain;
+            digits = std::min<uint32_t>((digits << 4) | static_cast<uint32_t>(value), 0x100);
+            if (remain == 0) {
+                if (digits <= 0xFF) {
+                    bytes += static_cast<char>(digits);
+                    repair |= digits >= 0x80;
+                }
+                digits = 0;
+            }
+        } else if (remain > 0) {
+            // Dropping part of a multi-byte character leaves the rest.
+            remain = 0;
+            digits = 0;
+            repair |= static_cast<unsigned char>(c) >= 0x80;
+        } else if (c == '+') {
+            bytes += ' ';
+        } else {
+            size_t run = avm1_find_unescape_byte(s.substr(i));
+            bytes.append(s.data() + i, run);
+            i += run - 1;
+        }
+    }
+    if (!repair) {
+        return bytes;
+    }
+    std::string out;
+    out.reserve(bytes.size());
+    avm1_append_utf8_lossy(out, bytes);
+    return out;
+}
+
+} // namespace ruffle
+
+#endif // AVM1_STRING_KERNELS_H
@@ -71,7 +71,13 @@ public:
         return std::make_shared<Value>(Value::UNDEFINED);
     }
 
-    // Call a constructor using super
+    // Call a constructor using super.
+    //
+    // Like other natives that end in a call, this and `call_method` leave
+    // the call pending on `activation` as a tail call (see
+    // `Activation::tail_call`), so that a bytecode callee runs on the
+    // interpreter rather than nested on the native stack. Bytecode reaches
+    // `super` through CallMethod, which stages the call directly.
     std::shared_ptr<Value> call(const std::string& name,
                                std::shared_ptr<Activation> activation,
                                const std::vector<std::shared_ptr<Value>>& args) const {
@@ -92,13 +98,13 @@ public:
         }
 
         // Check if it's a function
-        auto func_obj = constructor_obj->as_function();
-        if (!func_obj) {
+        if (!constructor_obj->as_function()) {
             return std::make_shared<Value>(Value::UNDEFINED);
         }
 
-        // Execute the constructor
-        return func_obj->exec_constructor(name, activation, this_, depth_ + 1, args);
+        // Run the constructor on `this`
+        activation->tail_call(std::move(constructor_obj), this_, args);
+        return std::make_shared<Value>(Value::UNDEFINED);
     }
 
     // Call a method using super
@@ -119,16 +125,9 @@ public:
             return std::make_shared<Value>(Value::UNDEFINED);
         }
 
-        auto method_obj = search_result.first->as_object();
-        int depth = search_result.second;
-
-        // Execute the method
-        if (auto func_obj = method_obj->as_function()) {
-            return func_obj->exec(name, activation, this_obj, depth_ + depth + 1, args, reason, method_obj);
-        } else {
-            // If it's not a function, try to call it directly
-            return method_obj->call(name, activation, this_obj, args);
-        }
+        // Run the method on `this`
+        activation->tail_call(search_result.first->as_object(), std::move(this_obj), args);
+        return std::make_shared<Value>(Value::UNDEFINED);
     }
 };
 
@@ -0,0 +1,311 @@
+/*
+ * C++ header for AVM1 target path resolution
+ * Parsed and resolved target paths, cached per display list generation
+ */
+
+#ifndef AVM1_TARGET_PATH_H
+#define AVM1_TARGET_PATH_H
+
+#include "avm1/atom.h"
+#include "display_object_container.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ruffle {
+
+// One step of a target path.
+struct TargetPathSegment {
+    enum class Kind : uint8_t {
+        // A child instance name, or failing that a script property
+        NAME,
+        // `..`, the SWF4-style parent
+        UP,
+        // `_root`, `_parent` and `_levelN`. A child with the same name
+        // still takes precedence.
+        ROOT,
+        PARENT,
+        LEVEL
+    };
+
+    Kind kind;
+    std::string name;
+    // For LEVEL, the level number.
+    int32_t level;
+    // Whether `name` is spelled exactly `_root` etc. In case sensitive SWFs
+    // other spellings are plain names.
+    bool exact_case;
+};
+
+// A target path such as `_root.menu.item3`, `/hud/score` or `../clip`,
+// split into segments. `:`, `.` and `/` all separate segments; a leading
+// `/` starts from the root.
+struct TargetPath {
+    bool absolute = false;
+    // False if some segment can't be resolved from the display list alone
+    // (an empty name, or junk after `..`); such paths are always resolved
+    // the slow way.
+    bool cacheable = true;
+    std::vector<TargetPathSegment> segments;
+
+    static TargetPath parse(std::string_view path) {
+        TargetPath parsed;
+        if (!path.empty() && path.front() == '/') {
+            parsed.absolute = true;
+            path.remove_prefix(1);
+        }
+        while (!path.empty()) {
+            // `foo`, `:foo` and `:::foo` are all the same
+            while (!path.empty() && path.front() == ':') {
+                path.remove_prefix(1);
+            }
+            if (path.empty()) {
+                break;
+            }
+
+            if (path.size() >= 2 && path[0] == '.' && path[1] == '.') {
+                path.remove_prefix(2);
+                if (!path.empty() && path.front() != '/' && path.front() != ':') {
+                    parsed.cacheable = false;
+                    break;
+                }
+                if (!path.empty() && path.front() == '/') {
+                    path.remove_prefix(1);
+                }
+                parsed.segments.push_back({TargetPathSegment::Kind::UP, std::string(), 0, true});
+                continue;
+            }
+
+            size_t end = 0;
+            while (end < path.size() && path[end] != ':' && path[end] != '.' && path[end] != '/') {
+                ++end;
+            }
+            std::string_view name = path.substr(0, end);
+            path.remove_prefix(end < path.size() ? end + 1 : end);
+            if (name.empty()) {
+                parsed.cacheable = false;
+                break;
+            }
+            parsed.segments.push_back(classify(name));
+        }
+        return parsed;
+    }
+
+private:
+    static TargetPathSegment classify(std::string_view name) {
+        TargetPathSegment segment{TargetPathSegment::Kind::NAME, std::string(name), 0, true};
+        if (name.size() < 2 || name.front() != '_') {
+            return segment;
+        }
+        if (avm1_eq_ignore_case(name, "_root")) {
+            segment.kind = TargetPathSegment::Kind::ROOT;
+            segment.exact_case = name == "_root";
+        } else if (avm1_eq_ignore_case(name, "_parent")) {
+            segment.kind = TargetPathSegment::Kind::PARENT;
+            segment.exact_case = name == "_parent";
+        } else if (name.size() > 6 && avm1_eq_ignore_case(name.substr(0, 6), "_level")) {
+            int32_t level = 0;
+            for (char c : name.substr(6)) {
+                if (c < '0' || c > '9' || level > 0xFFFF) {
+                    return segment;
+                }
+                level = level * 10 + (c - '0');
+            }
+            segment.kind = TargetPathSegment::Kind::LEVEL;
+            segment.level = level;
+            segment.exact_case = name.substr(0, 6) == "_level";
+        }
+        return segment;
+    }
+};
+
+// Caches target path resolution for tellTarget, eval and slash/dot
+// variable paths, which legacy content evaluates in nearly every frame.
+//
+// Paths are parsed once per distinct string; path strings are kept here
+// rather than interned, so that computed paths don't grow the atom table. A
+// resolution is cached per (path, start clip, root) together with the
+// display list generations of the start clip and the root it was made in,
+// and holds the target weakly; any add, remove, reorder or rename in either
+// display list makes it stale. Only resolutions made purely through
+// the display list are cached: as soon as a segment names a script property
+// instead of a clip, `resolve` returns nothing and the caller falls back to
+// the full, uncached resolution.
+class TargetPathCache {
+public:
+    // Entries are dropped all at once beyond this many.
+    static constexpr size_t MAX_ENTRIES = 4096;
+
+private:
+    struct Key {
+        const DisplayObject* start;
+        const DisplayObject* root;
+        bool case_sensitive;
+
+        bool operator==(const Key& other) const {
+            return start == other.start && root == other.root &&
+                   case_sensitive == other.case_sensitive;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t h = std::hash<const void*>{}(key.start);
+            h = h * 31 + std::hash<const void*>{}(key.root);
+            return h * 2 + (key.case_sensitive ? 1 : 0);
+        }
+    };
+
+    struct Entry {
+        // The key's objects, so that an entry for one that has since died
+        // isn't taken for a new object at the same address.
+        std::weak_ptr<DisplayObject> start;
+        std::weak_ptr<DisplayObject> root;
+        uint64_t start_generation;
+        uint64_t root_generation;
+        // Null if the path resolves to nothing.
+        std::weak_ptr<DisplayObject> target;
+        bool found;
+    };
+
+    // A parsed path and its resolutions.
+    struct PathEntry {
+        TargetPath parsed;
+        std::unordered_map<Key, Entry, KeyHash> resolved;
+    };
+
+    std::unordered_map<std::string, PathEntry> paths_;
+    size_t resolved_count_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    PathEntry& entry(const std::string& path) {
+        auto it = paths_.find(path);
+        if (it == paths_.end()) {
+            if (paths_.size() >= MAX_ENTRIES) {
+                clear();
+            }
+            it = paths_.emplace(path, PathEntry{TargetPath::parse(path), {}}).first;
+        }
+        return it->second;
+    }
+
+    // Walk `path` through the display list. Returns nothing if a segment
+    // needs a script property lookup.
+    static std::optional<std::shared_ptr<DisplayObject>> walk(
+        const TargetPath& path,
+        const std::shared_ptr<DisplayObject>& root,
+        const std::shared_ptr<DisplayObject>& start,
+        const std::shared_ptr<DisplayObject>& stage,
+        bool case_sensitive) {
+
+        std::shared_ptr<DisplayObject> object = path.absolute ? root : start;
+        for (const TargetPathSegment& segment : path.segments) {
+            if (!object) {
+                return object;
+            }
+            if (segment.kind == TargetPathSegment::Kind::UP) {
+                object = object->parent();
+                continue;
+            }
+
+            // Display object children come first, then path properties.
+            if (auto container = object->as_container()) {
+                if (auto child = container->child_by_name(segment.name, case_sensitive)) {
+                    object = std::move(child);
+                    continue;
+                }
+            }
+            if (case_sensitive && !segment.exact_case) {
+                return std::nullopt;
+            }
+            switch (segment.kind) {
+                case TargetPathSegment::Kind::ROOT:
+                    object = object->root();
+                    break;
+                case TargetPathSegment::Kind::PARENT:
+                    object = object->parent();
+                    break;
+                case TargetPathSegment::Kind::LEVEL: {
+                    auto levels = stage ? stage->as_container() : nullptr;
+                    object = levels ? levels->child_by_depth(segment.level) : nullptr;
+                    break;
+                }
+                default:
+                    return std::nullopt;
+            }
+        }
+        return object;
+    }
+
+public:
+    // The parsed form of `path`.
+    const TargetPath& parse(const std::string& path) { return entry(path).parsed; }
+
+    // Resolve `path` from `start`, or from `root` if it is absolute. Levels
+    // are children of `stage` by depth.
+    //
+    // Returns the display object the path names, null if it names nothing,
+    // or nothing at all if it can't be resolved through the display list
+    // alone.
+    std::optional<std::shared_ptr<DisplayObject>> resolve(
+        const std::string& path,
+        const std::shared_ptr<DisplayObject>& root,
+        const std::shared_ptr<DisplayObject>& start,
+        const std::shared_ptr<DisplayObject>& stage,
+        bool case_sensitive) {
+
+        PathEntry& path_entry = entry(path);
+        Key key{start.get(), root.get(), case_sensitive};
+        uint64_t start_generation = start ? start->display_list_generation() : 0;
+        uint64_t root_generation = root ? root->display_list_generation() : 0;
+        auto it = path_entry.resolved.find(key);
+        if (it != path_entry.resolved.end() && it->second.start_generation == start_generation &&
+            it->second.root_generation == root_generation && !it->second.start.expired() &&
+            !it->second.root.expired()) {
+            auto target = it->second.target.lock();
+            if (target || !it->second.found) {
+                hits_++;
+                return target;
+            }
+        }
+        misses_++;
+
+        if (!path_entry.parsed.cacheable) {
+            return std::nullopt;
+        }
+        auto result = walk(path_entry.parsed, root, start, stage, case_sensitive);
+        if (!result) {
+            return std::nullopt;
+        }
+        if (resolved_count_ >= MAX_ENTRIES) {
+            for (auto& [text, cached] : paths_) {
+                cached.resolved.clear();
+            }
+            resolved_count_ = 0;
+        }
+        auto [slot, inserted] = path_entry.resolved.insert_or_assign(
+            key, Entry{start, root, start_generation, root_generation, *result, *result != nullptr});
+        if (inserted) {
+            resolved_count_++;
+        }
+        return result;
+    }
+
+    void clear() {
+        paths_.clear();
+        resolved_count_ = 0;
+    }
+
+    size_t len() const { return resolved_count_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+};
+
+} // namespace ruffle
+
+#endif // AVM1_TARGET_PATH_H
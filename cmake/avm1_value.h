@@ -10,6 +10,9 @@
 #include "avm1/object.h"
 #include "avm1/activation.h"
 #include "avm1/error.h"
+#include "avm1/string_kernels.h"
+#include "avm1/value_type.h"
+#include "number_format.h"
 #include <memory>
 #include <string>
 #include <variant>
@@ -25,17 +28,6 @@ class Object;
 class Activation;
 class MovieClipReference;
 
-// Enum for value types
-enum class ValueType {
-    UNDEFINED,
-    NULL_VAL,
-    BOOLEAN,
-    NUMBER,
-    STRING,
-    OBJECT,
-    MOVIE_CLIP
-};
-
 // Value class for AVM1
 class Value {
 private:
@@ -101,28 +93,18 @@ public:
     double as_number() const {
         if (is_number()) return std::get<double>(data_);
         if (is_boolean()) return std::get<bool>(data_) ? 1.0 : 0.0;
-        if (is_string()) {
-            try {
-                return std::stod(std::get<std::string>(data_));
-            } catch (...) {
-                return std::numeric_limits<double>::quiet_NaN();
-            }
-        }
+        if (is_string()) return avm1_string_to_number(std::get<std::string>(data_));
         if (is_null() || is_undefined()) return std::numeric_limits<double>::quiet_NaN();
         return 0.0; // Objects convert to 0
     }
 
+    // The string held by a string value, without copying it; null for
+    // every other type.
+    const std::string* string_ref() const { return std::get_if<std::string>(&data_); }
+
     std::string as_string() const {
         if (is_string()) return std::get<std::string>(data_);
-        if (is_number()) {
-            double num = std::get<double>(data_);
-            if (std::isnan(num)) return "NaN";
-            if (std::isinf(num)) return num > 0 ? "Infinity" : "-Infinity";
-            if (num == static_cast<int64_t>(num)) {
-                return std::to_string(static_cast<int64_t>(num));
-            }
-            return std::to_string(num);
-        }
+        if (is_number()) return format_avm1_number(std::get<double>(data_));
         if (is_boolean()) return std::get<bool>(data_) ? "true" : "false";
         if (is_null()) return "null";
         if (is_undefined()) return "undefined";
@@ -272,26 +254,10 @@ public:
 const Value Value::UNDEFINED = Value(std::monostate{});
 const Value Value::NULL_VAL = Value(); // Using the null constructor
 
-// Helper function to convert float to string in AVM1 style
-inline std::string f64_to_string(std::shared_ptr<Activation> activation, double value) {
-    if (std::isnan(value)) return "NaN";
-    if (std::isinf(value)) return value > 0 ? "Infinity" : "-Infinity";
-    
-    // Format the number according to AVM1 rules
-    // This is a simplified version - a full implementation would handle
-    // all the edge cases mentioned in the original Rust tests
-    if (value == static_cast<long long>(value)) {
-        return std::to_string(static_cast<long long>(value));
-    } else {
-        // Use scientific notation for very large or very small numbers
-        if (value > 1e15 || (value > 0 && value < 1e-5) || (value < 0 && value > -1e-5)) {
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "%.6g", value);
-            return std::string(buffer);
-        } else {
-            return std::to_string(value);
-        }
-    }
+// Helper function to convert float to string in AVM1 style. The format
+// does not depend on the SWF version.
+inline std::string f64_to_string(std::shared_ptr<Activation> /*activation*/, double value) {
+    return format_avm1_number(value);
 }
 
 } // namespace ruffle
@@ -0,0 +1,269 @@
+/*
+ * C++ header for the AVM1 value stack
+ * A single contiguous operand stack and register file shared by nested activations
+ */
+
+#ifndef AVM1_VALUE_STACK_H
+#define AVM1_VALUE_STACK_H
+
+#include "avm1/compact_value.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ruffle {
+
+// A window into the value stack owned by one activation.
+//
+// Layout, from the bottom of the frame:
+//
+//   [register_base, register_base + register_count)  local registers
+//   [operand_base, ...)                              operand stack
+//
+// Frames store indices rather than pointers, so they stay valid when the
+// stack grows.
+struct StackFrame {
+    size_t register_base;
+    size_t operand_base;
+    // Number of local registers, as declared by DefineFunction2. Zero means
+    // the frame uses the global registers instead.
+    uint8_t register_count;
+};
+
+class ValueStack;
+
+// Call arguments that are still on the caller's operand stack.
+//
+// AVM1 pushes arguments last to first, so the first argument is the
+// topmost of them. Arguments are addressed by stack index rather than by
+// pointer: the callee pushes onto the same stack, which may reallocate it.
+// The arguments stay valid until the caller drops them after the call
+// returns.
+class StackArgs {
+private:
+    const ValueStack* stack_;
+    size_t base_;
+    size_t len_;
+
+public:
+    StackArgs() : stack_(nullptr), base_(0), len_(0) {}
+    StackArgs(const ValueStack* stack, size_t base, size_t len)
+        : stack_(stack), base_(base), len_(len) {}
+
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+
+    // Missing arguments read as `undefined`.
+    inline CompactValue operator[](size_t index) const;
+};
+
+// The AVM1 value stack.
+//
+// One `ValueStack` is owned by the AVM1 runtime and shared by every nested
+// activation. Entering a frame reserves its registers at the top of the
+// stack; leaving it truncates the stack back to where the frame started.
+// The backing store is allocated once up front and only ever grows, so
+// pushes and pops never allocate in steady state.
+//
+// The stack also owns what its values borrow but nothing else does:
+// strings computed at run time and objects returned from calls. Those are
+// swept once no slot refers to them any more (see `sweep_owned`).
+class ValueStack {
+public:
+    // Flash exposes four registers to code that does not declare its own.
+    static constexpr uint8_t NUM_GLOBAL_REGISTERS = 4;
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+    // Owned strings and objects are swept once they grow past twice what
+    // survived the last sweep, and never below these.
+    static constexpr size_t MIN_SWEEP_BYTES = 64 * 1024;
+    static constexpr size_t MIN_SWEEP_OBJECTS = 1024;
+
+private:
+    std::vector<CompactValue> slots_;
+    size_t top_;
+    std::vector<std::unique_ptr<Avm1AtomEntry>> owned_strings_;
+    std::vector<std::shared_ptr<Object>> owned_objects_;
+    size_t owned_bytes_ = 0;
+    size_t sweep_bytes_ = MIN_SWEEP_BYTES;
+    size_t sweep_objects_ = MIN_SWEEP_OBJECTS;
+
+    void ensure_capacity(size_t additional) {
+        size_t needed = top_ + additional;
+        if (needed > slots_.size()) {
+            slots_.resize(std::max(needed, slots_.size() * 2));
+        }
+    }
+
+public:
+    explicit ValueStack(size_t capacity = DEFAULT_CAPACITY)
+        : slots_(std::max<size_t>(capacity, NUM_GLOBAL_REGISTERS)),
+          top_(NUM_GLOBAL_REGISTERS) {}
+
+    ValueStack(const ValueStack&) = delete;
+    ValueStack& operator=(const ValueStack&) = delete;
+
+    // Reserve a frame with `register_count` local registers, all undefined.
+    StackFrame enter_frame(uint8_t register_count) {
+        ensure_capacity(register_count);
+        StackFrame frame{top_, top_ + register_count, register_count};
+        std::fill(slots_.begin() + top_, slots_.begin() + frame.operand_base,
+                  CompactValue::undefined());
+        top_ = frame.operand_base;
+        return frame;
+    }
+
+    // Release a frame and everything pushed above it. Frames must be left in
+    // the reverse order they were entered. Leaving the outermost frame
+    // sweeps what the script left behind.
+    void leave_frame(const StackFrame& frame) {
+        assert(frame.register_base <= top_);
+        top_ = frame.register_base;
+        if (top_ == NUM_GLOBAL_REGISTERS) {
+            sweep_owned();
+        }
+    }
+
+    // A string computed at run time, such as the result of a concatenation.
+    //
+    // It is not interned, so it costs nothing once the stack drops it:
+    // building a long string piece by piece keeps only the pieces still
+    // referenced. Creating one may sweep, freeing owned strings and objects
+    // that are no longer on the stack; callers must have copied what they
+    // need out of popped operands first.
+    Avm1Atom own_string(std::string text) {
+        if (owned_bytes_ >= sweep_bytes_) {
+            sweep_owned();
+        }
+        owned_bytes_ += sizeof(Avm1AtomEntry) + text.size();
+        owned_strings_.push_back(std::make_unique<Avm1AtomEntry>(std::move(text), false));
+        return Avm1Atom(owned_strings_.back().get());
+    }
+
+    // `object` as a stack value, kept alive for as long as a slot refers to
+    // it. Used for objects that may have no other owner, such as the result
+    // of a call. May sweep, like `own_string`.
+    CompactValue own_object(std::shared_ptr<Object> object) {
+        if (!object) {
+            return CompactValue::null();
+        }
+        if (owned_objects_.size() >= sweep_objects_) {
+            sweep_owned();
+        }
+        Object* raw = object.get();
+        owned_objects_.push_back(std::move(object));
+        return CompactValue::object(raw);
+    }
+
+    // Free the owned strings and objects that no live slot refers to.
+    void sweep_owned() {
+        std::unordered_set<const void*> live;
+        for (size_t i = 0; i < top_; ++i) {
+            const CompactValue& value = slots_[i];
+            if (value.is_string() && !value.as_atom().is_interned()) {
+                live.insert(value.as_atom().entry());
+            } else if (value.is_object()) {
+                live.insert(value.as_object());
+            }
+        }
+        // Each survivor is kept once, however often it was owned.
+        owned_bytes_ = 0;
+        size_t kept = 0;
+        for (auto& entry : owned_strings_) {
+            if (live.erase(entry.get())) {
+                owned_bytes_ += sizeof(Avm1AtomEntry) + entry->text.size();
+                owned_strings_[kept++] = std::move(entry);
+            }
+        }
+        owned_strings_.resize(kept);
+        kept = 0;
+        for (auto& object : owned_objects_) {
+            if (live.erase(object.get())) {
+                owned_objects_[kept++] = std::move(object);
+            }
+        }
+        owned_objects_.resize(kept);
+        sweep_bytes_ = std::max(MIN_SWEEP_BYTES, owned_bytes_ * 2);
+        sweep_objects_ = std::max(MIN_SWEEP_OBJECTS, owned_objects_.size() * 2);
+    }
+
+    // Operand stack operations
+    void push(CompactValue value) {
+        ensure_capacity(1);
+        slots_[top_++] = value;
+    }
+
+    // Popping past the bottom of a frame yields `undefined`, as in Flash.
+    CompactValue pop(const StackFrame& frame) {
+        if (top_ <= frame.operand_base) {
+            return CompactValue::undefined();
+        }
+        return slots_[--top_];
+    }
+
+    CompactValue peek(const StackFrame& frame) const {
+        if (top_ <= frame.operand_base) {
+            return CompactValue::undefined();
+        }
+        return slots_[top_ - 1];
+    }
+
+    // Number of operands currently pushed in `frame`.
+    size_t operand_count(const StackFrame& frame) const {
+        return top_ - frame.operand_base;
+    }
+
+    // The top `count` operands of `frame` as call arguments, first argument
+    // on top.
+    StackArgs args(const StackFrame& frame, size_t count) const {
+        count = std::min(count, operand_count(frame));
+        return StackArgs(this, top_ - count, count);
+    }
+
+    CompactValue slot(size_t index) const { return slots_[index]; }
+
+    // Discard the top `count` operands of `frame`.
+    void drop(const StackFrame& frame, size_t count) {
+        top_ -= std::min(count, operand_count(frame));
+    }
+
+    // Register operations. Out-of-range registers read as `undefined` and
+    // ignore writes.
+    CompactValue get_register(const StackFrame& frame, uint8_t index) const {
+        if (frame.register_count == 0) {
+            return index < NUM_GLOBAL_REGISTERS ? slots_[index] : CompactValue::undefined();
+        }
+        if (index >= frame.register_count) {
+            return CompactValue::undefined();
+        }
+        return slots_[frame.register_base + index];
+    }
+
+    void set_register(const StackFrame& frame, uint8_t index, CompactValue value) {
+        if (frame.register_count == 0) {
+            if (index < NUM_GLOBAL_REGISTERS) {
+                slots_[index] = value;
+            }
+        } else if (index < frame.register_count) {
+            slots_[frame.register_base + index] = value;
+        }
+    }
+
+    // Total number of live slots, including the global registers.
+    size_t len() const { return top_; }
+    size_t owned_strings() const { return owned_strings_.size(); }
+    size_t owned_objects() const { return owned_objects_.size(); }
+    size_t capacity() const { return slots_.size(); }
+};
+
+inline CompactValue StackArgs::operator[](size_t index) const {
+    return index < len_ ? stack_->slot(base_ + len_ - 1 - index) : CompactValue::undefined();
+}
+
+} // namespace ruffle
+
+#endif // AVM1_VALUE_STACK_H
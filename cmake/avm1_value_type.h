@@ -0,0 +1,24 @@
+/*
+ * C++ header for AVM1 value types
+ * The type tag shared by `Value` and `CompactValue`
+ */
+
+#ifndef AVM1_VALUE_TYPE_H
+#define AVM1_VALUE_TYPE_H
+
+namespace ruffle {
+
+// Enum for value types
+enum class ValueType {
+    UNDEFINED,
+    NULL_VAL,
+    BOOLEAN,
+    NUMBER,
+    STRING,
+    OBJECT,
+    MOVIE_CLIP
+};
+
+} // namespace ruffle
+
+#endif // AVM1_VALUE_TYPE_H
@@ -12,8 +12,12 @@
 #include "avm1/activation.h"
 #include "avm1/error.h"
 #include "avm1/array_builder.h"
+#include "xml_reader.h"
+#include "xml_utils.h"
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <list>
@@ -102,15 +106,21 @@ public:
     }
 
     // Remove node from this node's child list
-    void orphan_child(std::shared_ptr<XmlNode> child) {
+    void orphan_child(std::shared_ptr<Activation> activation, std::shared_ptr<XmlNode> child) {
         auto it = std::find(children_.begin(), children_.end(), child);
         if (it != children_.end()) {
+            size_t position = static_cast<size_t>(it - children_.begin());
             children_.erase(it);
+            cached_child_removed(activation, position);
         }
     }
 
-    // Insert child into the children list of this node
-    void insert_child(size_t position, std::shared_ptr<XmlNode> child) {
+    // Insert child into the children list of this node.
+    //
+    // `activation` is only used to update an existing .childNodes array.
+    void insert_child(std::shared_ptr<Activation> activation,
+                      size_t position,
+                      std::shared_ptr<XmlNode> child) {
         // Check for cyclic references
         if (is_ancestor(child)) {
             return; // Don't insert if it would create a cycle
@@ -118,16 +128,15 @@ public:
 
         // Remove from old parent if exists
         if (child->parent_ && child->parent_ != shared_from_this()) {
-            child->parent_->orphan_child(child);
+            child->parent_->orphan_child(activation, child);
         }
 
         child->set_parent(shared_from_this());
 
-        if (position <= children_.size()) {
-            children_.insert(children_.begin() + position, child);
-        } else {
-            children_.push_back(child); // If position is out of bounds, append to end
-        }
+        // If position is out of bounds, append to end
+        position = std::min(position, children_.size());
+        children_.insert(children_.begin() + position, child);
+        cached_child_inserted(activation, position);
 
         // Set up sibling relationships
         std::shared_ptr<XmlNode> new_prev = (position > 0) ? children_[position - 1] : nullptr;
@@ -136,14 +145,14 @@ public:
     }
 
     // Append a child element to the end of the child list
-    void append_child(std::shared_ptr<XmlNode> child) {
-        insert_child(children_.size(), std::move(child));
+    void append_child(std::shared_ptr<Activation> activation, std::shared_ptr<XmlNode> child) {
+        insert_child(std::move(activation), children_.size(), std::move(child));
     }
 
     // Remove this node from its parent
-    void remove_node() {
+    void remove_node(std::shared_ptr<Activation> activation) {
         if (parent_) {
-            parent_->orphan_child(shared_from_this());
+            parent_->orphan_child(std::move(activation), shared_from_this());
             disown_siblings();
             set_parent(nullptr);
         }
@@ -274,7 +283,7 @@ public:
         auto object = std::make_shared<Object>(&activation->context()->strings, prototype);
         
         introduce_script_object(object);
-        object->set_native(activation->context()->gc(), NativeObject(object));
+        object->native() = NativeObject(shared_from_this());
         
         return object;
     }
@@ -282,6 +291,32 @@ public:
     // Obtain the script object for a given XML tree node's attributes
     std::shared_ptr<Object> attributes() const { return attributes_; }
 
+    // Visit the AVM1 objects reachable from this node, as the native data of
+    // its script object.
+    //
+    // Nodes are not collector cells, so the tree is walked from here. The
+    // walk stops at nodes that have a script object of their own: visiting
+    // that object traces them.
+    void gc_trace(GcTracer& tracer) const {
+        gc_trace_own(tracer);
+        for (const auto& child : children_) {
+            child->gc_trace_down(tracer);
+        }
+        const XmlNode* from = this;
+        for (const XmlNode* node = parent_.get(); node; from = node, node = node->parent_.get()) {
+            if (node->script_object_) {
+                tracer.visit(node->script_object_);
+                break;
+            }
+            node->gc_trace_own(tracer);
+            for (const auto& child : node->children_) {
+                if (child.get() != from) {
+                    child->gc_trace_down(tracer);
+                }
+            }
+        }
+    }
+
     // Gets a lazy-created .childNodes array
     std::shared_ptr<Object> get_or_init_cached_child_nodes(std::shared_ptr<Activation> activation) {
         if (cached_child_nodes_) {
@@ -294,7 +329,8 @@ public:
         return array;
     }
 
-    // Refreshes the .childNodes array. Call this after every child list mutation
+    // Rebuilds the .childNodes array from the child list. Child list
+    // mutations keep the array up to date themselves.
     void refresh_cached_child_nodes(std::shared_ptr<Activation> activation) {
         if (cached_child_nodes_) {
             cached_child_nodes_->set_length(activation, 0);
@@ -305,6 +341,63 @@ public:
         }
     }
 
+private:
+    void gc_trace_own(GcTracer& tracer) const {
+        tracer.visit(script_object_);
+        tracer.visit(attributes_);
+        tracer.visit(cached_child_nodes_);
+    }
+
+    void gc_trace_down(GcTracer& tracer) const {
+        if (script_object_) {
+            tracer.visit(script_object_);
+            return;
+        }
+        gc_trace_own(tracer);
+        for (const auto& child : children_) {
+            child->gc_trace_down(tracer);
+        }
+    }
+
+    // Patch .childNodes after `children_[position]` was inserted. Appending
+    // costs one element store; inserting shifts the elements after it.
+    // If script has resized the array it is rebuilt instead.
+    //
+    // Without an activation the array is left alone: only the tree builder
+    // inserts that way, and the parse rebuilds the array when it finishes.
+    void cached_child_inserted(std::shared_ptr<Activation> activation, size_t position) {
+        if (!cached_child_nodes_ || !activation) {
+            return;
+        }
+        int32_t old_length = static_cast<int32_t>(children_.size() - 1);
+        if (cached_child_nodes_->length(activation) != old_length) {
+            refresh_cached_child_nodes(activation);
+            return;
+        }
+        for (int32_t i = old_length; i > static_cast<int32_t>(position); --i) {
+            cached_child_nodes_->set_element(activation, i, cached_child_nodes_->get_element(activation, i - 1));
+        }
+        auto child_obj = children_[position]->script_object(activation);
+        cached_child_nodes_->set_element(activation, static_cast<int32_t>(position), child_obj->as_value());
+    }
+
+    // Patch .childNodes after the child at `position` was removed.
+    void cached_child_removed(std::shared_ptr<Activation> activation, size_t position) {
+        if (!cached_child_nodes_ || !activation) {
+            return;
+        }
+        int32_t new_length = static_cast<int32_t>(children_.size());
+        if (cached_child_nodes_->length(activation) != new_length + 1) {
+            refresh_cached_child_nodes(activation);
+            return;
+        }
+        for (int32_t i = static_cast<int32_t>(position); i < new_length; ++i) {
+            cached_child_nodes_->set_element(activation, i, cached_child_nodes_->get_element(activation, i + 1));
+        }
+        cached_child_nodes_->set_length(activation, new_length);
+    }
+
+public:
     // Create a duplicate copy of this node
     std::shared_ptr<XmlNode> duplicate(bool deep) const {
         auto attributes = std::make_shared<Object>(nullptr);
@@ -318,7 +411,8 @@ public:
 
         if (deep) {
             for (const auto& child : children_) {
-                clone->append_child(child->duplicate(deep));
+                // A fresh clone has no .childNodes array to update
+                clone->append_child(nullptr, child->duplicate(deep));
             }
         }
 
@@ -343,66 +437,103 @@ public:
         return std::nullopt;
     }
 
-    // Convert the given node to a string of UTF-8 encoded XML
+    // Convert the given node to a string of UTF-8 encoded XML.
+    //
+    // Runs in two passes over the tree: the first measures the exact output
+    // length, the second writes into a buffer reserved once, escaping text
+    // straight into it.
     std::string to_string(std::shared_ptr<Activation> activation) const {
+        std::vector<CoercedAttribute> coerced;
         std::string result;
-        write_node_to_string(activation, result);
+        result.reserve(serialized_length(activation, coerced));
+        size_t next_coerced = 0;
+        write_node_to_string(activation, result, coerced, next_coerced);
         return result;
     }
 
 private:
-    // Write the contents of this node, including its children, to the given string
-    void write_node_to_string(std::shared_ptr<Activation> activation, std::string& result) const {
-        if (node_type_ == ELEMENT_NODE) {
-            if (node_value_) {
-                result += "<" + *node_value_;
-
-                // Add attributes
-                for (const auto& [key, value] : attributes_->get_properties()) {
-                    std::string value_str = value->coerce_to_string(activation);
-                    // Escape the value
-                    std::string escaped_value = escape_xml(value_str);
+    // An attribute value that isn't a string, coerced while measuring so
+    // that its `toString` only runs once.
+    struct CoercedAttribute {
+        std::shared_ptr<Value> value;
+        std::string text;
+    };
 
-                    result += " " + key + "=\"" + escaped_value + "\"";
-                }
+    // Length of this node's XML, including its children. Attribute values
+    // that need coercion are coerced here, in document order.
+    size_t serialized_length(std::shared_ptr<Activation> activation,
+                             std::vector<CoercedAttribute>& coerced) const {
+        if (node_type_ != ELEMENT_NODE) {
+            return node_value_ ? XmlUtils::escaped_length(*node_value_) : 0;
+        }
 
-                if (children_.empty()) {
-                    result += " />";
-                } else {
-                    result += ">";
-                    for (const auto& child : children_) {
-                        child->write_node_to_string(activation, result);
-                    }
-                    result += "</" + *node_value_ + ">";
-                }
-            } else {
-                // If no tag name, just process children
-                for (const auto& child : children_) {
-                    child->write_node_to_string(activation, result);
+        size_t length = 0;
+        if (node_value_) {
+            // <name key="value" ... />, or <name ...>children</name>
+            length += 1 + node_value_->size();
+            for (const auto& [key, value] : attributes_->get_properties()) {
+                const std::string* text = value->string_ref();
+                if (!text) {
+                    coerced.push_back({value, value->coerce_to_string(activation)});
+                    text = &coerced.back().text;
                 }
+                length += 1 + key.size() + 2 + XmlUtils::escaped_length(*text) + 1;
             }
-        } else {
+            length += children_.empty() ? 3 : 1 + 2 + node_value_->size() + 1;
+        }
+        for (const auto& child : children_) {
+            length += child->serialized_length(activation, coerced);
+        }
+        return length;
+    }
+
+    // Write the contents of this node, including its children, to the given string
+    void write_node_to_string(std::shared_ptr<Activation> activation,
+                              std::string& result,
+                              const std::vector<CoercedAttribute>& coerced,
+                              size_t& next_coerced) const {
+        if (node_type_ != ELEMENT_NODE) {
             // Text node
             if (node_value_) {
-                result += escape_xml(*node_value_);
+                XmlUtils::append_escaped(result, *node_value_);
             }
+            return;
         }
-    }
 
-    // Helper function to escape XML
-    static std::string escape_xml(const std::string& input) {
-        std::string result;
-        for (char c : input) {
-            switch (c) {
-                case '&': result += "&amp;"; break;
-                case '<': result += "&lt;"; break;
-                case '>': result += "&gt;"; break;
-                case '\"': result += "&quot;"; break;
-                case '\'': result += "&apos;"; break;
-                default: result += c; break;
+        if (node_value_) {
+            result += '<';
+            result += *node_value_;
+            for (const auto& [key, value] : attributes_->get_properties()) {
+                result += ' ';
+                result += key;
+                result += "=\"";
+                if (const std::string* text = value->string_ref()) {
+                    XmlUtils::append_escaped(result, *text);
+                } else if (next_coerced < coerced.size() && coerced[next_coerced].value == value) {
+                    XmlUtils::append_escaped(result, coerced[next_coerced++].text);
+                } else {
+                    // A `toString` run while measuring changed the attributes.
+                    XmlUtils::append_escaped(result, value->coerce_to_string(activation));
+                }
+                result += '"';
             }
+            if (children_.empty()) {
+                result += " />";
+                return;
+            }
+            result += '>';
+        }
+
+        // Without a tag name, only the children are written
+        for (const auto& child : children_) {
+            child->write_node_to_string(activation, result, coerced, next_coerced);
+        }
+
+        if (node_value_) {
+            result += "</";
+            result += *node_value_;
+            result += '>';
         }
-        return result;
     }
 
 public:
@@ -437,6 +568,220 @@ inline std::shared_ptr<XmlNode> create_xml_node(uint8_t node_type,
     return std::make_shared<XmlNodeWithSharedFromThis>(node_type, std::move(node_value));
 }
 
+// Builds an XML tree under `document` from the events of an `XmlReader`,
+// as `XML.parseXML` does.
+//
+// `consume` adds every node the reader has input for, so a document being
+// loaded can be fed to a streaming reader and consumed chunk by chunk: the
+// tree grows as the bytes arrive and only the unparsed tail is buffered.
+class XmlTreeBuilder {
+private:
+    // `document` and the elements still open inside it
+    std::vector<std::shared_ptr<XmlNode>> open_;
+    bool ignore_white_;
+    XmlStatus status_ = XmlStatus::NO_ERROR;
+    std::optional<std::string> xml_decl_;
+    std::optional<std::string> doctype_;
+    // Decoded text, reused between nodes
+    std::string scratch_;
+    bool done_ = false;
+
+    static bool is_whitespace(std::string_view text) {
+        return std::all_of(text.begin(), text.end(), [](char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        });
+    }
+
+    void add_text(std::string_view text) {
+        if (text.empty() || (ignore_white_ && is_whitespace(text))) {
+            return;
+        }
+        open_.back()->append_child(nullptr, create_xml_node(TEXT_NODE, std::string(text)));
+    }
+
+    void add_element(const XmlEvent& event, const std::vector<XmlAttribute>& attributes) {
+        auto element = create_xml_node(ELEMENT_NODE, std::string(event.name));
+        for (const XmlAttribute& attribute : attributes) {
+            std::string_view value = XmlReader::decode(attribute.value, scratch_);
+            element->attributes()->define_value(std::string(attribute.name),
+                                                std::make_shared<Value>(std::string(value)));
+        }
+        open_.back()->append_child(nullptr, element);
+        if (!event.empty) {
+            open_.push_back(std::move(element));
+        }
+    }
+
+    void close_element(std::string_view name) {
+        std::optional<std::string> open_name = open_.size() > 1 ? open_.back()->node_name() : std::nullopt;
+        if (!open_name || *open_name != name) {
+            fail(XmlStatus::MISMATCHED_END);
+            return;
+        }
+        open_.pop_back();
+    }
+
+    void fail(XmlStatus status) {
+        status_ = status;
+        done_ = true;
+    }
+
+public:
+    XmlTreeBuilder(std::shared_ptr<XmlNode> document, bool ignore_white)
+        : ignore_white_(ignore_white) {
+        open_.push_back(std::move(document));
+    }
+
+    // Add the nodes `reader` has input for. Returns true once the document
+    // is complete or has failed to parse, false if the reader needs more
+    // input first. Nodes added before an error are kept, as in Flash.
+    bool consume(XmlReader& reader) {
+        while (!done_) {
+            XmlEvent event = reader.next();
+            switch (event.kind) {
+                case XmlEventKind::START_ELEMENT:
+                    add_element(event, reader.attributes());
+                    break;
+                case XmlEventKind::END_ELEMENT:
+                    close_element(event.name);
+                    break;
+                case XmlEventKind::TEXT:
+                    add_text(XmlReader::decode(event.text, scratch_));
+                    break;
+                case XmlEventKind::CDATA:
+                    add_text(event.text);
+                    break;
+                case XmlEventKind::DECLARATION:
+                    xml_decl_ = "<?" + std::string(event.text) + "?>";
+                    break;
+                case XmlEventKind::DOCTYPE:
+                    doctype_ = "<!" + std::string(event.text) + ">";
+                    break;
+                case XmlEventKind::COMMENT:
+                case XmlEventKind::PROCESSING_INSTRUCTION:
+                    break;
+                case XmlEventKind::NEED_MORE_INPUT:
+                    return false;
+                case XmlEventKind::END_OF_INPUT:
+                    if (open_.size() > 1) {
+                        fail(XmlStatus::MISMATCHED_START);
+                    }
+                    done_ = true;
+                    break;
+                case XmlEventKind::ERROR:
+                    fail(reader.status());
+                    break;
+            }
+        }
+        return true;
+    }
+
+    // The value for `XML.status`
+    XmlStatus status() const { return status_; }
+
+    // The value for `XML.xmlDecl`, if the document had one
+    const std::optional<std::string>& xml_decl() const { return xml_decl_; }
+
+    // The value for `XML.docTypeDecl`, if the document had one
+    const std::optional<std::string>& doctype() const { return doctype_; }
+};
+
+// The document behind an AVM1 `XML` object: its root node and what the
+// last parse reported. This replaces the `Xml` of
+// core/src/avm1/globals/xml.rs.
+//
+// Every parse goes through `XmlReader` and `XmlTreeBuilder`. `parse_xml`
+// takes a complete string, as `XML.parseXML` does; `begin_load`,
+// `load_chunk` and `finish_load` take a document as it downloads, so a
+// loaded document is built chunk by chunk instead of being held whole.
+class XmlDocument {
+private:
+    std::shared_ptr<XmlNode> root_;
+    XmlStatus status_ = XmlStatus::NO_ERROR;
+    std::optional<std::string> xml_decl_;
+    std::optional<std::string> doctype_;
+    // A load in progress
+    std::optional<XmlReader> reader_;
+    std::optional<XmlTreeBuilder> builder_;
+
+    // `XML.parseXML` replaces the whole document.
+    void clear(std::shared_ptr<Activation> activation) {
+        while (!root_->children().empty()) {
+            std::shared_ptr<XmlNode> child = root_->children().back();
+            child->remove_node(activation);
+        }
+        status_ = XmlStatus::NO_ERROR;
+    }
+
+    void finish_parse(std::shared_ptr<Activation> activation) {
+        status_ = builder_->status();
+        if (builder_->xml_decl()) {
+            xml_decl_ = builder_->xml_decl();
+        }
+        if (builder_->doctype()) {
+            doctype_ = builder_->doctype();
+        }
+        builder_.reset();
+        reader_.reset();
+        // The builder appends without an activation.
+        root_->refresh_cached_child_nodes(std::move(activation));
+    }
+
+public:
+    XmlDocument() : root_(create_xml_node(ELEMENT_NODE)) {}
+
+    std::shared_ptr<XmlNode> root() const { return root_; }
+
+    // The value for `XML.status`
+    XmlStatus status() const { return status_; }
+
+    // The value for `XML.xmlDecl`
+    const std::optional<std::string>& xml_decl() const { return xml_decl_; }
+
+    // The value for `XML.docTypeDecl`
+    const std::optional<std::string>& doctype() const { return doctype_; }
+
+    // Replace the document with the one parsed from `data`.
+    void parse_xml(std::shared_ptr<Activation> activation, std::string_view data, bool ignore_white) {
+        clear(activation);
+        reader_.emplace(XmlReader::from_bytes(data));
+        builder_.emplace(root_, ignore_white);
+        builder_->consume(*reader_);
+        finish_parse(std::move(activation));
+    }
+
+    // Start replacing the document with one fed to `load_chunk`.
+    void begin_load(std::shared_ptr<Activation> activation, bool ignore_white) {
+        clear(activation);
+        reader_.emplace(XmlReader::streaming());
+        builder_.emplace(root_, ignore_white);
+    }
+
+    // Add the nodes in the next chunk of a load. Returns true once the
+    // document has failed to parse, after which the rest can be dropped.
+    bool load_chunk(std::shared_ptr<Activation> activation, std::string_view chunk) {
+        if (!builder_) {
+            return true;
+        }
+        reader_->feed(chunk);
+        if (builder_->consume(*reader_)) {
+            finish_parse(std::move(activation));
+            return true;
+        }
+        return false;
+    }
+
+    // The load has no more data.
+    void finish_load(std::shared_ptr<Activation> activation) {
+        if (!builder_) {
+            return;
+        }
+        reader_->finish();
+        builder_->consume(*reader_);
+        finish_parse(std::move(activation));
+    }
+};
+
 } // namespace ruffle
 
 #endif // AVM1_XML_H
\ No newline at end of file
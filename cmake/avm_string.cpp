@@ -31,6 +31,22 @@ void WString::push_str(const WString& other) {
     data.insert(data.end(), other.data.begin(), other.data.end());
 }
 
+void WString::push_str(std::u16string_view other) {
+    data.insert(data.end(), other.begin(), other.end());
+}
+
+bool WString::try_push_str(std::u16string_view other) {
+    size_t old_size = data.size();
+    if (old_size + other.size() > data.capacity()) {
+        return false;
+    }
+    // Resizing within the capacity keeps `other` valid even if it points
+    // into `data`, and the copy never overlaps it.
+    data.resize(old_size + other.size());
+    std::copy(other.begin(), other.end(), data.begin() + old_size);
+    return true;
+}
+
 void WString::reserve(size_t capacity) {
     data.reserve(capacity);
 }
@@ -65,7 +81,27 @@ bool WString::operator==(const WString& other) const {
 // Implementation of AvmStringRepr
 template<typename GCContext>
 AvmStringRepr<GCContext>::AvmStringRepr(WString str, bool dependent) 
-    : string_data(std::move(str)), is_dependent_flag(dependent), is_interned_flag(false) {}
+    : buffer(std::make_shared<AvmStringBuffer>(AvmStringBuffer{std::move(str)})), offset(0),
+      length(buffer->units.size()),
+      is_dependent_flag(dependent), is_interned_flag(false) {}
+
+template<typename GCContext>
+AvmStringRepr<GCContext>::AvmStringRepr(std::shared_ptr<AvmStringBuffer> shared, size_t start, size_t len,
+                                        bool dependent)
+    : buffer(std::move(shared)), offset(start), length(len),
+      is_dependent_flag(dependent), is_interned_flag(false) {}
+
+template<typename GCContext>
+const WString& AvmStringRepr<GCContext>::as_wstr() const {
+    if (offset == 0 && length == buffer->units.size()) {
+        buffer->pinned = true;
+        return buffer->units;
+    }
+    if (!detached) {
+        detached.emplace(std::u16string(view()));
+    }
+    return *detached;
+}
 
 template<typename GCContext>
 AvmStringRepr<GCContext> AvmStringRepr<GCContext>::from_raw(WString str, bool dependent) {
@@ -82,9 +118,8 @@ std::unique_ptr<AvmStringRepr<GCContext>> AvmStringRepr<GCContext>::new_dependen
     std::shared_ptr<AvmStringRepr> parent, size_t start, size_t end) {
     // Create a dependent string that references part of the parent string
     WString substr;
-    if (start < parent->string_data.size() && end <= parent->string_data.size() && start <= end) {
-        substr.data.assign(parent->string_data.data.begin() + start, 
-                          parent->string_data.data.begin() + end);
+    if (start < parent->len() && end <= parent->len() && start <= end) {
+        substr = WString(std::u16string(parent->view().substr(start, end - start)));
     }
     auto repr = std::make_unique<AvmStringRepr<GCContext>>(substr, true);
     return repr;
@@ -93,9 +128,18 @@ std::unique_ptr<AvmStringRepr<GCContext>> AvmStringRepr<GCContext>::new_dependen
 template<typename GCContext>
 std::unique_ptr<AvmStringRepr<GCContext>> AvmStringRepr<GCContext>::try_append_inline(
     std::shared_ptr<AvmStringRepr> left, const std::shared_ptr<AvmStringRepr>& right) {
-    // For simplicity, we'll return nullptr indicating inline append is not possible
-    // In a real implementation, this would try to append in-place if possible
-    return nullptr;
+    // Only the repr that ends at the buffer's used units may extend it;
+    // any other would overwrite units a later append already owns.
+    AvmStringBuffer& buffer = *left->buffer;
+    if (buffer.pinned || left->offset + left->length != buffer.units.size()) {
+        return nullptr;
+    }
+    if (!buffer.units.try_push_str(right->view())) {
+        return nullptr;
+    }
+    // The result depends on `left`'s buffer, which `left` still views.
+    return std::make_unique<AvmStringRepr<GCContext>>(
+        left->buffer, left->offset, left->length + right->length, true);
 }
 
 // Implementation of AvmString
@@ -154,7 +198,7 @@ bool AvmString<GCContext>::is_dependent() const {
 
 template<typename GCContext>
 bool AvmString<GCContext>::is_wide() const {
-    for (auto ch : repr->as_wstr().c_str()) {
+    for (auto ch : repr->view()) {
         if (ch > 0xFF) return true;
     }
     return false;
@@ -167,12 +211,11 @@ AvmString<GCContext> AvmString<GCContext>::concat(GCContext& mc,
         return right;
     } else if (right.is_empty()) {
         return left;
+    } else if (auto appended = AvmStringRepr<GCContext>::try_append_inline(left.repr, right.repr)) {
+        return AvmString<GCContext>(std::shared_ptr<AvmStringRepr<GCContext>>(appended.release()));
     } else {
-        // Perform concatenation
-        WString result = left.as_wstr();
-        result.push_str(right.as_wstr());
-        
-        // Apply growth logic similar to the original
+        // Copy into a buffer with room to grow, so that appending to the
+        // result can happen in place
         size_t new_size = left.len() + right.len();
         size_t new_capacity;
         if (new_size < 32) {
@@ -183,9 +226,11 @@ AvmString<GCContext> AvmString<GCContext>::concat(GCContext& mc,
             new_capacity = new_size * 2;
         }
         
-        result.reserve(new_capacity);
-        auto repr = std::make_shared<AvmStringRepr<GCContext>>(
-            AvmStringRepr<GCContext>::from_raw(std::move(result), false));
+        auto result = std::make_shared<AvmStringBuffer>();
+        result->units.reserve(new_capacity);
+        result->units.push_str(left.view());
+        result->units.push_str(right.view());
+        auto repr = std::make_shared<AvmStringRepr<GCContext>>(std::move(result), 0, new_size, false);
         return AvmString<GCContext>(repr);
     }
 }
@@ -203,7 +248,7 @@ bool AvmString<GCContext>::operator==(const AvmString& other) const {
     }
     
     // Compare the actual string content
-    return this->as_wstr() == other.as_wstr();
+    return this->view() == other.view();
 }
 
 // Explicit template instantiation for common GC contexts
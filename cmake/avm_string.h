@@ -9,6 +9,8 @@
 #include <string>
 #include <memory>
 #include <cstring>
+#include <optional>
+#include <string_view>
 #include <vector>
 #include <utility>
 
@@ -29,10 +31,15 @@ public:
     explicit WString(const char16_t* wide_c_str);
     
     size_t size() const { return data.size(); }
+    size_t capacity() const { return data.capacity(); }
     bool empty() const { return data.empty(); }
     const char16_t* c_str() const { return data.data(); }
     
     void push_str(const WString& other);
+    void push_str(std::u16string_view other);
+    // Append `other` only if it fits in the spare capacity, so the buffer
+    // does not move. `other` may be part of this string.
+    bool try_push_str(std::u16string_view other);
     void reserve(size_t capacity);
     
     static WString from_utf8(const std::string& utf8);
@@ -43,18 +50,44 @@ public:
     bool operator!=(const WString& other) const { return !(*this == other); }
 };
 
+// Units shared by the reprs of strings built by concatenation. Once
+// `as_wstr` has handed out a reference to all of them, the buffer is
+// pinned and never grows again, so that reference cannot change.
+struct AvmStringBuffer {
+    WString units;
+    bool pinned = false;
+};
+
 // Represents the string representation
+//
+// A repr is `length` units at `offset` in a buffer that several reprs may
+// share. Concatenation appends in place when the left operand ends where
+// the buffer's used units end, the buffer has spare capacity and is not
+// pinned; the result then views the longer run of the same buffer (see
+// `try_append_inline`).
 template<typename GCContext>
 class AvmStringRepr {
 private:
-    WString string_data;
+    std::shared_ptr<AvmStringBuffer> buffer;
+    size_t offset;
+    size_t length;
+    // `as_wstr` of a repr that no longer spans its whole buffer, copied out
+    // on first use
+    mutable std::optional<WString> detached;
     bool is_dependent_flag;
     bool is_interned_flag;
 
 public:
     AvmStringRepr(WString str, bool dependent = false);
+    AvmStringRepr(std::shared_ptr<AvmStringBuffer> buffer, size_t offset, size_t length, bool dependent);
     
-    const WString& as_wstr() const { return string_data; }
+    // The units as a `WString`. This pins a shared buffer, or copies the
+    // units out if the repr only views part of it; prefer `view`.
+    const WString& as_wstr() const;
+    std::u16string_view view() const {
+        return std::u16string_view(buffer->units.c_str() + offset, length);
+    }
+    size_t len() const { return length; }
     bool is_dependent() const { return is_dependent_flag; }
     bool is_interned() const { return is_interned_flag; }
     
@@ -85,9 +118,10 @@ public:
 
     // Methods
     const WString& as_wstr() const;
+    std::u16string_view view() const { return repr->view(); }
     bool is_dependent() const;
-    bool is_empty() const { return repr->as_wstr().empty(); }
-    size_t len() const { return repr->as_wstr().size(); }
+    bool is_empty() const { return repr->len() == 0; }
+    size_t len() const { return repr->len(); }
     bool is_wide() const; // Check if string contains wide characters
     
     // String operations
@@ -104,7 +138,7 @@ namespace std {
     template<typename GCContext>
     struct hash<AvmString<GCContext>> {
         size_t operator()(const AvmString<GCContext>& str) const {
-            return hash<std::u16string>{}(std::u16string(str.as_wstr().c_str(), str.len()));
+            return hash<std::u16string_view>{}(str.view());
         }
     };
 }
@@ -21,6 +21,7 @@
 #include "library.h"
 #include "player.h"
 #include "timer.h"
+#include "execution_limit.h"
 #include "focus_tracker.h"
 #include "input_manager.h"
 #include "context_menu.h"
@@ -150,6 +151,16 @@ public:
         }
     }
 
+    // Call `f` with the clip of every queued action.
+    template<typename F>
+    void for_each_clip(F&& f) const {
+        for (const auto& queue : action_queues_) {
+            for (const auto& action : queue) {
+                f(action.clip);
+            }
+        }
+    }
+
     // Pop an action from the queue (prioritizing higher priority actions)
     std::optional<QueuedAction> pop_action() {
         for (int i = NUM_PRIORITIES - 1; i >= 0; --i) {
@@ -288,6 +299,11 @@ public:
     // is raised. This defaults to 15 seconds but can be changed.
     std::chrono::milliseconds max_execution_duration;
 
+    // Decides when a running script is stopped. By default a wall-clock
+    // limit of `max_execution_duration`, sampled every few thousand
+    // instructions; an instruction budget makes the cut-off reproducible.
+    ExecutionLimit execution_limit;
+
     // A tracker for the current keyboard focused element
     FocusTracker focus_tracker;
 
@@ -333,6 +349,12 @@ public:
     // requires a separate clean-up pass when running frame-scripts instead of executing them in place
     std::deque<std::shared_ptr<MovieClip>> frame_script_cleanup_queue;
 
+private:
+    // `gc_trace_avm1_roots`, registered with the AVM1 heap.
+    GcHeap::RootSourceId avm1_root_source_ = 0;
+
+public:
+
     // Constructor
     UpdateContext(GCContext* gc_ctx,
                   std::shared_ptr<StringContext> str_ctx,
@@ -384,6 +406,7 @@ public:
           start_time(std::chrono::steady_clock::now()), 
           update_start(std::chrono::steady_clock::now()),
           max_execution_duration(std::chrono::seconds(15)), 
+          execution_limit(ExecutionLimit::with_wall_clock(max_execution_duration)),
           times_get_time_called(0), forced_frame_rate(false) {
         
         // Initialize other members
@@ -392,10 +415,18 @@ public:
         frame_rate = new double(12.0);  // Default frame rate
         actions_since_timeout_check = new uint32_t(0);
         frame_phase = new FramePhase(FramePhase::LOADING);
+
+        if (avm1) {
+            avm1_root_source_ = avm1->gc_heap().add_root_source(
+                [this](GcTracer& tracer) { gc_trace_avm1_roots(tracer); });
+        }
     }
 
     // Destructor
     ~UpdateContext() {
+        if (avm1) {
+            avm1->gc_heap().remove_root_source(avm1_root_source_);
+        }
         delete instance_counter;
         delete time_offset;
         delete frame_rate;
@@ -406,6 +437,77 @@ public:
     // Convenience method to retrieve the current GC context
     GCContext* gc() const { return gc_context; }
 
+    // Longest the AVM1 collector may run at the end of a tick, as a share
+    // of the frame time.
+    static constexpr double AVM1_GC_SLICE_FRACTION = 0.1;
+
+    // Start an update: running the scripts of a frame, or firing timers.
+    // `update_start` and the execution limit cover one update, so a script
+    // is stopped once it has run for `max_execution_duration` (or used up
+    // its instruction budget) within it.
+    void begin_update() {
+        update_start = std::chrono::steady_clock::now();
+        execution_limit.set_duration(max_execution_duration);
+        execution_limit.start();
+    }
+
+    // The frame update of a player tick: run the frame of every level, as
+    // one update, before `tick_avm1`.
+    void run_frame_avm1() {
+        begin_update();
+        if (!stage) {
+            return;
+        }
+        auto heap_scope = avm1->enter_heap();
+        // The player owns the context for the whole update; clips borrow it.
+        std::shared_ptr<UpdateContext> borrowed(std::shared_ptr<UpdateContext>(), this);
+        // Scripts may load or unload levels while the frame runs.
+        std::vector<std::shared_ptr<DisplayObject>> levels = stage->children();
+        for (const auto& level : levels) {
+            if (auto clip = level->as_movie_clip()) {
+                clip->run_frame_avm1(borrowed);
+            }
+        }
+    }
+
+    // The end of a player tick, after the frame has run: fire the timers
+    // that came due in the `dt` ms that passed, then give the AVM1
+    // collector its slice while no script is on the stack. Returns the time
+    // until the next timer.
+    std::optional<double> tick_avm1(double dt) {
+        std::optional<double> next_timer;
+        {
+            // Timers run as an update of their own, as in Flash Player.
+            begin_update();
+            auto heap_scope = avm1->enter_heap();
+            next_timer = timers->update_timers(this, dt);
+        }
+        auto frame_time = std::chrono::duration<double>(1.0 / *frame_rate);
+        avm1->run_gc_slice(std::chrono::duration_cast<std::chrono::microseconds>(
+            frame_time * AVM1_GC_SLICE_FRACTION));
+        return next_timer;
+    }
+
+    // Script objects that only the player references: those of the display
+    // list, of clips with queued actions, of timers and of shared objects.
+    void gc_trace_avm1_roots(GcTracer& tracer) const {
+        if (stage) {
+            stage->gc_trace_avm1(tracer);
+        }
+        action_queue->for_each_clip([&tracer](const auto& clip) {
+            if (clip) {
+                clip->gc_trace_avm1(tracer);
+            }
+        });
+        for (const auto& text_field : unbound_text_fields) {
+            text_field->gc_trace_avm1(tracer);
+        }
+        timers->gc_trace(tracer);
+        for (const auto& [name, object] : avm1_shared_objects) {
+            tracer.visit(object);
+        }
+    }
+
     // Get the global sound transform
     const SoundTransform& global_sound_transform() const {
         return audio_manager->global_sound_transform();
@@ -544,6 +646,10 @@ public:
         // Clean up the stage before loading another root movie
         sockets->close_all();
         timers->remove_all();
+        // The old movie's action blocks can no longer run.
+        if (root_swf) {
+            avm1->bytecode_cache().remove_movie(root_swf.get());
+        }
 
         set_root_movie(std::move(movie));
     }
@@ -658,6 +764,32 @@ public:
     }
 };
 
+inline void Timers::run_callback(UpdateContext* context, const TimerCallback& callback,
+                                 const std::vector<std::shared_ptr<Value>>& params) {
+    auto root = context->stage ? context->stage->root_clip() : nullptr;
+    auto clip = root ? root->as_movie_clip() : nullptr;
+    if (!clip) {
+        return;
+    }
+    // Timers only fire from within an update, which the context outlives;
+    // the activation borrows it.
+    std::shared_ptr<UpdateContext> borrowed(std::shared_ptr<UpdateContext>(), context);
+    context->avm1->run_from_player(borrowed, clip, "[Timer Callback]",
+                                   [&](std::shared_ptr<Activation> activation) {
+        std::shared_ptr<Object> function = callback.object;
+        std::shared_ptr<Object> this_obj;
+        if (callback.kind == TimerCallback::Kind::AVM1_METHOD) {
+            // Looked up on every tick, as the method may have been replaced.
+            auto method = callback.object->get(callback.method_name, activation);
+            function = method ? method->as_object() : nullptr;
+            this_obj = callback.object;
+        }
+        if (auto function_object = function ? function->as_function() : nullptr) {
+            function_object->call("[Timer Callback]", activation, this_obj, params);
+        }
+    });
+}
+
 } // namespace ruffle
 
 #endif // CONTEXT_H
\ No newline at end of file
@@ -56,6 +56,15 @@ enum class DisplayObjectType {
     LOADER_DISPLAY
 };
 
+// Counts changes to one player's display list: adds, removes, reorders and
+// renames. Caches of name lookups, such as `TargetPathCache`, are only valid
+// for the generation they were filled in. Every display object starts with
+// its own counter and takes its parent's when it is attached, so the objects
+// of a player share the stage's.
+struct DisplayListGeneration {
+    uint64_t value = 0;
+};
+
 // Base class for all display objects
 class DisplayObject {
 protected:
@@ -83,6 +92,10 @@ protected:
     uint16_t id_;
     DisplayObjectType type_;
 
+private:
+    std::shared_ptr<DisplayListGeneration> display_list_generation_ =
+        std::make_shared<DisplayListGeneration>();
+
 public:
     DisplayObject(DisplayObjectType type, uint16_t id)
         : type_(type), id_(id), depth_(0), visible_(true), x_(0.0f), y_(0.0f),
@@ -118,9 +131,23 @@ public:
     uint16_t id() const { return id_; }
     DisplayObjectType type() const { return type_; }
 
+    // The generation of the display list this object is in.
+    uint64_t display_list_generation() const { return display_list_generation_->value; }
+    void invalidate_display_list() { ++display_list_generation_->value; }
+
     // Setters
-    void set_parent(std::shared_ptr<DisplayObject> parent) { parent_ = std::move(parent); }
-    void set_name(const std::string& name) { name_ = name; }
+    void set_parent(std::shared_ptr<DisplayObject> parent) {
+        invalidate_display_list();
+        parent_ = std::move(parent);
+        if (parent_ && parent_->display_list_generation_ != display_list_generation_) {
+            share_display_list_generation(parent_->display_list_generation_);
+        }
+        invalidate_display_list();
+    }
+    void set_name(const std::string& name) {
+        name_ = name;
+        invalidate_display_list();
+    }
     void set_depth(int depth) { depth_ = depth; }
     void set_visible(bool visible) { visible_ = visible; }
     void set_x(float x) { x_ = x; }
@@ -142,6 +169,27 @@ public:
     void set_removed(bool removed) { is_removed_ = removed; }
     void set_movie(std::shared_ptr<SwfMovie> movie) { movie_ = std::move(movie); }
 
+    // Count this object and every object below it in `generation`.
+    void share_display_list_generation(const std::shared_ptr<DisplayListGeneration>& generation) {
+        display_list_generation_ = generation;
+        if (auto container = as_container()) {
+            for (const auto& child : container->children()) {
+                child->share_display_list_generation(generation);
+            }
+        }
+    }
+
+    // Visit the AVM1 script objects of this object and every object below
+    // it. The display list is a root of the AVM1 heap.
+    void gc_trace_avm1(GcTracer& tracer) {
+        tracer.visit(avm1_object_);
+        if (auto container = as_container()) {
+            for (const auto& child : container->children()) {
+                child->gc_trace_avm1(tracer);
+            }
+        }
+    }
+
     // Virtual methods to be implemented by subclasses
     virtual void render(std::shared_ptr<RenderContext> context) = 0;
     virtual void update(std::shared_ptr<UpdateContext> context) = 0;
@@ -351,6 +399,7 @@ public:
         std::shared_ptr<DisplayObject> child2 = get_child_by_depth(depth2);
 
         if (child1 && child2) {
+            invalidate_display_list();
             child1->set_depth(depth2);
             child2->set_depth(depth1);
 
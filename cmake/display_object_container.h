@@ -127,12 +127,14 @@ public:
 
     // Replace a child at a specific depth
     std::shared_ptr<DisplayObject> replace_at_depth(std::shared_ptr<DisplayObject> child, int depth) {
+        child->invalidate_display_list();
         // Find if there's already a child at this depth
         auto existing_it = depth_list_.find(depth);
         std::shared_ptr<DisplayObject> removed_child = nullptr;
         
         if (existing_it != depth_list_.end()) {
             removed_child = existing_it->second;
+            removed_child->invalidate_display_list();
             
             // Remove from render list if it's there
             auto render_it = std::find(render_list_.begin(), render_list_.end(), removed_child);
@@ -159,6 +161,7 @@ public:
 
     // Insert a child at a specific index in the render list
     void insert_at_index(std::shared_ptr<DisplayObject> child, size_t index) {
+        child->invalidate_display_list();
         if (index <= render_list_.size()) {
             render_list_.insert(render_list_.begin() + index, child);
         } else {
@@ -168,13 +171,16 @@ public:
 
     // Swap two children in the render list
     void swap_at_index(size_t index1, size_t index2) {
+        // Render order decides which of two same-named children wins.
         if (index1 < render_list_.size() && index2 < render_list_.size()) {
+            render_list_[index1]->invalidate_display_list();
             std::swap(render_list_[index1], render_list_[index2]);
         }
     }
 
     // Remove a child from the depth list
     void remove_child_from_depth_list(std::shared_ptr<DisplayObject> child) {
+        child->invalidate_display_list();
         // Remove from depth list
         for (auto it = depth_list_.begin(); it != depth_list_.end();) {
             if (it->second == child) {
@@ -187,6 +193,7 @@ public:
 
     // Remove a child from the render list
     bool remove_child_from_render_list(std::shared_ptr<DisplayObject> child) {
+        child->invalidate_display_list();
         auto it = std::find(render_list_.begin(), render_list_.end(), child);
         if (it != render_list_.end()) {
             render_list_.erase(it);
@@ -197,6 +204,7 @@ public:
 
     // Insert a child into the depth list
     void insert_child_into_depth_list(int depth, std::shared_ptr<DisplayObject> child) {
+        child->invalidate_display_list();
         depth_list_[depth] = child;
     }
 
@@ -212,6 +220,7 @@ public:
         for (size_t index : sorted_indices) {
             if (index < render_list_.size()) {
                 auto child = render_list_[index];
+                child->invalidate_display_list();
                 render_list_.erase(render_list_.begin() + index);
                 
                 // Also remove from depth list
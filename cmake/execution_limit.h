@@ -0,0 +1,162 @@
+/*
+ * C++ header for script execution limits
+ * Instruction budgets and sampled wall-clock timeouts shared by AVM1 and AVM2
+ */
+
+#ifndef EXECUTION_LIMIT_H
+#define EXECUTION_LIMIT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace ruffle {
+
+// Decides when a running script has run for too long.
+//
+// Interpreters call `tick` for every instruction, which only decrements a
+// counter, and `check` at backward branches and calls, which only compares
+// it with zero until it runs out. A superinstruction is charged for the
+// opcodes it replaces, so fusion does not move the cut-off point. What happens then depends on the mode:
+//
+// - An instruction budget is exhausted once the counter runs out. The
+//   cut-off point depends only on the code executed, so it is the same on
+//   every run.
+// - A wall-clock limit refills the counter with `sample_interval`
+//   instructions and reads the clock each time it runs out, so the clock is
+//   read once per interval rather than once per loop iteration.
+//
+// The limit covers one update: `UpdateContext::begin_update` starts it
+// before the player runs scripts for a frame or fires timers.
+class ExecutionLimit {
+public:
+    enum class Mode : uint8_t {
+        NONE,
+        INSTRUCTION_BUDGET,
+        WALL_CLOCK
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t DEFAULT_SAMPLE_INTERVAL = 10000;
+
+private:
+    // Instructions left until the next slow check. Signed so that `charge`
+    // can take it past zero safely.
+    int64_t fuel_;
+    Mode mode_;
+    uint64_t budget_;
+    uint32_t sample_interval_;
+    std::chrono::milliseconds duration_;
+    Clock::time_point deadline_;
+    // Instructions executed before the current refill.
+    uint64_t executed_before_refill_;
+    int64_t last_refill_;
+    bool exceeded_;
+
+    ExecutionLimit(Mode mode, uint64_t budget, std::chrono::milliseconds duration,
+                   uint32_t sample_interval)
+        : fuel_(0), mode_(mode), budget_(budget),
+          sample_interval_(std::max<uint32_t>(sample_interval, 1)), duration_(duration),
+          executed_before_refill_(0), last_refill_(0), exceeded_(false) {
+        start();
+    }
+
+    void refill(int64_t amount) {
+        executed_before_refill_ += static_cast<uint64_t>(last_refill_ - fuel_);
+        fuel_ = amount;
+        last_refill_ = amount;
+    }
+
+public:
+    // No limit at all.
+    static ExecutionLimit none() {
+        return ExecutionLimit(Mode::NONE, 0, std::chrono::milliseconds(0), DEFAULT_SAMPLE_INTERVAL);
+    }
+
+    // Stop after `instructions` instructions per update.
+    static ExecutionLimit with_instruction_budget(uint64_t instructions) {
+        return ExecutionLimit(Mode::INSTRUCTION_BUDGET, instructions, std::chrono::milliseconds(0),
+                              DEFAULT_SAMPLE_INTERVAL);
+    }
+
+    // Stop after `duration` of wall-clock time per update, reading the clock
+    // every `sample_interval` instructions.
+    static ExecutionLimit with_wall_clock(std::chrono::milliseconds duration,
+                                          uint32_t sample_interval = DEFAULT_SAMPLE_INTERVAL) {
+        return ExecutionLimit(Mode::WALL_CLOCK, 0, duration, sample_interval);
+    }
+
+    // Begin a new update.
+    void start() {
+        exceeded_ = false;
+        executed_before_refill_ = 0;
+        last_refill_ = 0;
+        fuel_ = 0;
+        switch (mode_) {
+            case Mode::NONE:
+                refill(std::numeric_limits<int64_t>::max());
+                break;
+            case Mode::INSTRUCTION_BUDGET:
+                refill(static_cast<int64_t>(std::min<uint64_t>(
+                    budget_, static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))));
+                break;
+            case Mode::WALL_CLOCK:
+                deadline_ = Clock::now() + duration_;
+                refill(sample_interval_);
+                break;
+        }
+        executed_before_refill_ = 0;
+    }
+
+    // Charge one executed instruction.
+    void tick() { --fuel_; }
+
+    // Charge `instructions` more at once, for the opcodes a superinstruction
+    // replaces beyond the one `tick` already counted.
+    void charge(uint32_t instructions) { fuel_ -= instructions; }
+
+    // Returns true once the script must be stopped. Cheap unless the counter
+    // has run out.
+    bool check() {
+        if (fuel_ > 0) {
+            return false;
+        }
+        return check_slow();
+    }
+
+    bool check_slow() {
+        switch (mode_) {
+            case Mode::NONE:
+                refill(std::numeric_limits<int64_t>::max());
+                return false;
+            case Mode::INSTRUCTION_BUDGET:
+                exceeded_ = true;
+                return true;
+            case Mode::WALL_CLOCK:
+                if (Clock::now() >= deadline_) {
+                    exceeded_ = true;
+                    return true;
+                }
+                refill(sample_interval_);
+                return false;
+        }
+        return false;
+    }
+
+    // Change the wall-clock limit, from the next `start` on.
+    void set_duration(std::chrono::milliseconds duration) { duration_ = duration; }
+
+    Mode mode() const { return mode_; }
+    bool exceeded() const { return exceeded_; }
+
+    // Instructions executed since `start`.
+    uint64_t executed() const {
+        return executed_before_refill_ + static_cast<uint64_t>(last_refill_ - fuel_);
+    }
+};
+
+} // namespace ruffle
+
+#endif // EXECUTION_LIMIT_H
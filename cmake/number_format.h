@@ -0,0 +1,231 @@
+/*
+ * C++ header for number to string conversion
+ * Flash's AVM1 number formatting
+ */
+
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace ruffle {
+
+// Strings of the integers [0, SIZE), so the most common coercions (array
+// indices, counters, scores) need no formatting at all.
+class SmallIntStrings {
+public:
+    static constexpr int32_t SIZE = 1024;
+
+private:
+    std::array<std::string, SIZE> strings_;
+
+    SmallIntStrings() {
+        for (int32_t i = 0; i < SIZE; ++i) {
+            strings_[i] = std::to_string(i);
+        }
+    }
+
+public:
+    static const SmallIntStrings& get() {
+        static const SmallIntStrings instance;
+        return instance;
+    }
+
+    static bool contains(double value) {
+        return value >= 0.0 && value < SIZE && static_cast<double>(static_cast<int32_t>(value)) == value;
+    }
+
+    const std::string& operator[](int32_t i) const { return strings_[i]; }
+};
+
+// `value * 10^exp` by repeated squaring of 10. Multiplying and dividing
+// are kept apart because Flash's results depend on exactly this rounding.
+inline double decimal_shift(double value, int32_t exp) {
+    double base = 10.0;
+    if (exp > 0) {
+        while (exp > 0) {
+            if (exp & 1) {
+                value *= base;
+            }
+            exp >>= 1;
+            base *= base;
+        }
+    } else {
+        // Negated as unsigned, so that INT32_MIN does not overflow.
+        uint32_t magnitude = 0u - static_cast<uint32_t>(exp);
+        while (magnitude > 0) {
+            if (magnitude & 1) {
+                value /= base;
+            }
+            magnitude >>= 1;
+            base *= base;
+        }
+    }
+    return value;
+}
+
+// Number to string as AVM1 does it: 15 significant digits, positional
+// between 1e-5 and 1e15 and exponential outside, "0" for both zeros.
+//
+//   0.1 + 0.2   -> "0.3"
+//   1 / 3       -> "0.333333333333333"
+//   1e15        -> "1e+15"
+//   0.00000999  -> "9.99e-6"
+//
+// Non-integers go through Flash's own algorithm rather than a correctly
+// rounded one: the value is scaled into [1, 10) with `decimal_shift`, 16
+// digits are extracted by repeatedly multiplying by 10, and the last one
+// rounds the rest half away from zero. Its carry handling is buggy, and the
+// bugs are kept: -9999999999999996 formats as "-e+16" and
+// -0.000009999999999999996 as "-10e-6".
+inline std::string format_avm1_number(double value) {
+    if (std::isnan(value)) return "NaN";
+    if (std::isinf(value)) return value > 0 ? "Infinity" : "-Infinity";
+    if (value == 0.0) return "0";
+    if (SmallIntStrings::contains(value)) {
+        return SmallIntStrings::get()[static_cast<int32_t>(value)];
+    }
+    if (value >= -2147483648.0 && value <= 2147483647.0 &&
+        static_cast<double>(static_cast<int32_t>(value)) == value) {
+        return std::to_string(static_cast<int32_t>(value));
+    }
+
+    std::string buf;
+    buf.reserve(32);
+    bool negative = value < 0.0;
+    if (negative) {
+        value = -value;
+        buf += '-';
+    }
+
+    // Estimate the decimal exponent from the binary one.
+    constexpr uint64_t MANTISSA_BITS = 52;
+    constexpr uint64_t EXPONENT_MASK = 0x7ff;
+    constexpr int32_t EXPONENT_BIAS = 1023;
+    auto binary_exponent = [](double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return static_cast<int32_t>((bits >> MANTISSA_BITS) & EXPONENT_MASK) - EXPONENT_BIAS;
+    };
+    int32_t exp_base2 = binary_exponent(value);
+    if (exp_base2 == -EXPONENT_BIAS) {
+        // Subnormal: scale by 2^54 into the normal range first.
+        exp_base2 = binary_exponent(value * 1.801439850948198e16) - 54;
+    }
+    // Flash's log10(2), less precise than the real one.
+    constexpr double LOG10_2 = 0.301029995663981;
+    int32_t exp = static_cast<int32_t>(std::round(exp_base2 * LOG10_2));
+
+    // Shift into [0, 10); the estimate can be off by one either way.
+    double mantissa = decimal_shift(value, -exp);
+    if (static_cast<int32_t>(mantissa) == 0) {
+        exp -= 1;
+        mantissa = decimal_shift(value, -exp);
+    }
+    if (static_cast<int32_t>(mantissa) >= 10) {
+        exp += 1;
+        mantissa = decimal_shift(value, -exp);
+    }
+
+    auto digit = [&mantissa]() {
+        int32_t d = static_cast<int32_t>(mantissa);
+        mantissa -= d;
+        mantissa *= 10.0;
+        return static_cast<char>('0' + d);
+    };
+
+    constexpr int32_t MAX_DECIMAL_PLACES = 15;
+    if (exp >= 15) {
+        // 1.2345e+15, without a leading '0' to carry into.
+        buf += digit();
+        buf += '.';
+        for (int32_t i = 0; i < MAX_DECIMAL_PLACES - 1; ++i) {
+            buf += digit();
+        }
+    } else if (exp >= 0) {
+        // 12345.678901234
+        buf += '0';
+        for (int32_t i = 0; i <= exp; ++i) {
+            buf += digit();
+        }
+        buf += '.';
+        for (int32_t i = 0; i < MAX_DECIMAL_PLACES - exp - 1; ++i) {
+            buf += digit();
+        }
+        exp = 0;
+    } else if (exp >= -5) {
+        // 0.0012345678901234
+        buf += "00.";
+        buf.append(static_cast<size_t>(-exp - 1), '0');
+        for (int32_t i = 0; i < MAX_DECIMAL_PLACES; ++i) {
+            buf += digit();
+        }
+        exp = 0;
+    } else {
+        // 1.345e-15. Flash means to skip a leading zero digit here but
+        // compares the character against 0, so it never does.
+        buf += '0';
+        buf += digit();
+        buf += '.';
+        for (int32_t i = 0; i < MAX_DECIMAL_PLACES - 1; ++i) {
+            buf += digit();
+        }
+    }
+
+    // Round on the next digit, ties away from zero, carrying past nines.
+    if (digit() >= '5') {
+        for (auto it = buf.rbegin(); it != buf.rend(); ++it) {
+            if (*it == '9') {
+                *it = '0';
+            } else if (*it >= '0') {
+                *it += 1;
+                break;
+            }
+        }
+    }
+
+    while (!buf.empty() && buf.back() == '0') {
+        buf.pop_back();
+    }
+    if (!buf.empty() && buf.back() == '.') {
+        buf.pop_back();
+    }
+
+    if (exp != 0) {
+        // Flash's fix-ups for the carry above, which miss the sign.
+        size_t first = buf.find_first_not_of('0');
+        buf.erase(0, first == std::string::npos ? buf.size() : first);
+        if (buf.empty()) {
+            // 9.999 rounded to 0.000 with nowhere to carry the 1.
+            buf += '1';
+            exp += 1;
+        } else {
+            // 100e+15 to 1e+17.
+            size_t last = buf.find_last_not_of('0');
+            if (last == 0 || last == std::string::npos) {
+                exp += static_cast<int32_t>(buf.size()) - 1;
+                buf.resize(1);
+            }
+        }
+        buf += exp < 0 ? "e-" : "e+";
+        buf += std::to_string(exp < 0 ? -static_cast<int64_t>(exp) : exp);
+    }
+
+    // Drop the carry digit if it went unused.
+    size_t i = negative ? 1 : 0;
+    if (i < buf.size() && buf[i] == '0' && (i + 1 >= buf.size() || buf[i + 1] != '.')) {
+        if (i > 0) {
+            buf[i] = buf[i - 1];
+        }
+        buf.erase(0, 1);
+    }
+    return buf;
+}
+
+} // namespace ruffle
+
+#endif // NUMBER_FORMAT_H
@@ -107,7 +107,7 @@ AvmAtom<GCContext> StringContext<GCContext>::intern(const AvmString<GCContext>&
         return str.as_interned();
     } else {
         // Intern the string
-        return interner->intern(gc(), str.as_wstr());
+        return interner->intern(gc(), str.view());
     }
 }
 
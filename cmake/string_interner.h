@@ -170,8 +170,13 @@ public:
 
     // Method to intern a string
     AvmAtom<GCContext> intern(GCContext& gc_context, const WString& str) {
+        return intern(gc_context, std::u16string_view(str.c_str(), str.size()));
+    }
+
+    // Intern a string's units, which are only copied if they are new
+    AvmAtom<GCContext> intern(GCContext& gc_context, std::u16string_view str) {
         // Try to find existing interned string
-        std::string key = std::string(str.c_str(), str.size());  // Simple key for demo
+        std::string key = units_key(str);
         auto existing = interned_.find(gc_context, key);
         
         if (existing) {
@@ -180,7 +185,7 @@ public:
         } else {
             // Create new interned string
             auto repr = std::make_shared<AvmStringRepr<GCContext>>(
-                AvmStringRepr<GCContext>::from_raw(str, true));  // Mark as interned
+                AvmStringRepr<GCContext>::from_raw(WString(std::u16string(str)), true));  // Mark as interned
             auto inserted = interned_.insert_fresh(gc_context, key, repr);
             return AvmAtom<GCContext>(inserted);
         }
@@ -189,8 +194,7 @@ public:
     // Method to intern a static string
     AvmAtom<GCContext> intern_static(GCContext& gc_context, const char16_t* str) {
         WString wstr(str);
-        std::string key = std::string(reinterpret_cast<const char*>(str), 
-                                     std::char_traits<char16_t>::length(str) * sizeof(char16_t));
+        std::string key = units_key(str);
         auto repr = std::make_shared<AvmStringRepr<GCContext>>(
             AvmStringRepr<GCContext>::from_raw_static(str, true));
         auto inserted = interned_.insert_fresh(gc_context, key, repr);
@@ -199,7 +203,7 @@ public:
 
     // Method to get an interned string if it exists
     std::optional<AvmAtom<GCContext>> get(GCContext& gc_context, const WString& str) {
-        std::string key = std::string(str.c_str(), str.size());  // Simple key for demo
+        std::string key = units_key(std::u16string_view(str.c_str(), str.size()));
         auto result = interned_.find(gc_context, key);
         if (result) {
             return AvmAtom<GCContext>(result);
@@ -217,7 +221,7 @@ public:
             return common_.str_;
         } else if (end_index == start_index + 1) {
             // Check if it's an ASCII character
-            char16_t c = str.as_wstr().c_str()[start_index];
+            char16_t c = str.view()[start_index];
             if (c < ASCII_CHARS_LEN) {
                 return static_cast<AvmString<GCContext>>(common_.ascii_chars[c]);
             }
@@ -233,6 +237,11 @@ public:
     }
 
 private:
+    // The table's key for a string: its units' bytes
+    static std::string units_key(std::u16string_view str) {
+        return std::string(reinterpret_cast<const char*>(str.data()), str.size() * sizeof(char16_t));
+    }
+
     void initialize_common_strings(GCContext& gc_context) {
         // Common strings are initialized in the constructor of CommonStrings
     }
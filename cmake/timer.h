@@ -0,0 +1,244 @@
+/*
+ * C++ header for timer functionality
+ * This replaces the functionality of core/src/timer.rs
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "avm1.h"
+#include "avm1/object.h"
+#include "avm1/value.h"
+#include "avm1/gc.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ruffle {
+
+// Forward declarations
+class UpdateContext;
+
+// What a timer calls when it fires.
+struct TimerCallback {
+    enum class Kind {
+        // `setInterval(function, interval, ...)`
+        AVM1_FUNCTION,
+        // `setInterval(object, "method", interval, ...)`; the method is looked
+        // up on every tick, so it may be replaced while the timer runs.
+        AVM1_METHOD
+    };
+
+    Kind kind;
+    std::shared_ptr<Object> object;
+    std::string method_name;
+
+    static TimerCallback avm1_function(std::shared_ptr<Object> function) {
+        return TimerCallback{Kind::AVM1_FUNCTION, std::move(function), std::string()};
+    }
+
+    static TimerCallback avm1_method(std::shared_ptr<Object> this_object, std::string name) {
+        return TimerCallback{Kind::AVM1_METHOD, std::move(this_object), std::move(name)};
+    }
+};
+
+// A single timer created by `setInterval` or `setTimeout`.
+struct Timer {
+    int32_t id;
+    TimerCallback callback;
+    std::vector<std::shared_ptr<Value>> params;
+    // When the timer next fires, in milliseconds of player time.
+    int64_t tick_time;
+    // Milliseconds between ticks.
+    int64_t interval;
+    // Timeouts fire once and are then removed.
+    bool is_timeout;
+};
+
+// The set of pending timers.
+//
+// Timers are ordered in a binary min-heap on (tick time, id), so adding one
+// is O(log n) and an update only touches timers that are due. Removal is
+// O(1): the timer is dropped from the id map and its heap entry is skipped
+// when it reaches the top. Timers due at the same time fire in the order
+// they were created, as in Flash.
+//
+// Script objects referenced by callbacks and parameters are only reachable
+// through this set; `UpdateContext::gc_trace_avm1_roots` traces it as a root
+// of the AVM1 heap.
+class Timers {
+public:
+    // Default number of times one interval may fire in a single update. A
+    // stalled frame otherwise makes short intervals fire once for every
+    // period missed.
+    static constexpr uint32_t DEFAULT_MAX_CATCH_UP = 10;
+
+private:
+    struct HeapEntry {
+        int64_t tick_time;
+        int32_t id;
+
+        // `std::push_heap` builds a max-heap; invert for earliest first.
+        bool operator<(const HeapEntry& other) const {
+            if (tick_time != other.tick_time) {
+                return tick_time > other.tick_time;
+            }
+            return id > other.id;
+        }
+    };
+
+    std::vector<HeapEntry> heap_;
+    std::unordered_map<int32_t, Timer> timers_;
+    int64_t cur_time_;
+    // Sub-millisecond remainder of the time passed to `update_timers`.
+    double pending_time_;
+    int32_t next_id_;
+    uint32_t max_catch_up_;
+
+    void schedule(int32_t id, int64_t tick_time) {
+        heap_.push_back({tick_time, id});
+        std::push_heap(heap_.begin(), heap_.end());
+    }
+
+    // Drop heap entries of removed timers once they outnumber live ones.
+    void compact_if_stale() {
+        if (heap_.size() > 64 && heap_.size() > timers_.size() * 2) {
+            heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                                       [this](const HeapEntry& entry) {
+                                           return timers_.count(entry.id) == 0;
+                                       }),
+                        heap_.end());
+            std::make_heap(heap_.begin(), heap_.end());
+        }
+    }
+
+    // Pop the earliest live entry due at or before `cur_time_`.
+    std::optional<HeapEntry> pop_due() {
+        while (!heap_.empty()) {
+            HeapEntry top = heap_.front();
+            if (timers_.count(top.id) == 0) {
+                std::pop_heap(heap_.begin(), heap_.end());
+                heap_.pop_back();
+                continue;
+            }
+            if (top.tick_time > cur_time_) {
+                return std::nullopt;
+            }
+            std::pop_heap(heap_.begin(), heap_.end());
+            heap_.pop_back();
+            return top;
+        }
+        return std::nullopt;
+    }
+
+    // Call the timer's callback in a fresh AVM1 activation.
+    static void run_callback(UpdateContext* context, const TimerCallback& callback,
+                             const std::vector<std::shared_ptr<Value>>& params);
+
+public:
+    Timers() : cur_time_(0), pending_time_(0.0), next_id_(1), max_catch_up_(DEFAULT_MAX_CATCH_UP) {}
+
+    // Add a timer firing `interval` ms from now. Returns its id, which is
+    // never reused.
+    int32_t add_timer(TimerCallback callback,
+                      int32_t interval,
+                      std::vector<std::shared_ptr<Value>> params,
+                      bool is_timeout) {
+        int32_t id = next_id_++;
+        // Keep time moving forward, so a zero interval cannot refire within
+        // the same update indefinitely.
+        int64_t period = std::max<int64_t>(interval, 1);
+        int64_t tick_time = cur_time_ + period;
+        timers_.emplace(id, Timer{id, std::move(callback), std::move(params), tick_time,
+                                  period, is_timeout});
+        schedule(id, tick_time);
+        return id;
+    }
+
+    // Remove a timer. Returns false if there was no such timer.
+    bool remove(int32_t id) {
+        if (timers_.erase(id) == 0) {
+            return false;
+        }
+        compact_if_stale();
+        return true;
+    }
+
+    void remove_all() {
+        timers_.clear();
+        heap_.clear();
+    }
+
+    size_t len() const { return timers_.size(); }
+    bool is_empty() const { return timers_.empty(); }
+
+    uint32_t max_catch_up() const { return max_catch_up_; }
+    void set_max_catch_up(uint32_t max_catch_up) { max_catch_up_ = std::max<uint32_t>(max_catch_up, 1); }
+
+    // Milliseconds until the next timer is due, if any.
+    std::optional<double> time_until_next_timer() {
+        while (!heap_.empty() && timers_.count(heap_.front().id) == 0) {
+            std::pop_heap(heap_.begin(), heap_.end());
+            heap_.pop_back();
+        }
+        if (heap_.empty()) {
+            return std::nullopt;
+        }
+        return static_cast<double>(std::max<int64_t>(heap_.front().tick_time - cur_time_, 0));
+    }
+
+    // Advance player time by `dt` ms and fire every timer that came due, in
+    // (tick time, id) order. An interval that falls behind fires at most
+    // `max_catch_up()` times and then skips the periods it missed. Returns
+    // the time until the next timer.
+    std::optional<double> update_timers(UpdateContext* context, double dt) {
+        pending_time_ += dt;
+        auto whole = static_cast<int64_t>(pending_time_);
+        cur_time_ += whole;
+        pending_time_ -= static_cast<double>(whole);
+
+        std::unordered_map<int32_t, uint32_t> fired;
+        while (auto entry = pop_due()) {
+            auto it = timers_.find(entry->id);
+            // Copy what the callback needs: it may add or remove timers,
+            // including this one.
+            TimerCallback callback = it->second.callback;
+            std::vector<std::shared_ptr<Value>> params = it->second.params;
+
+            if (it->second.is_timeout) {
+                timers_.erase(it);
+            } else {
+                Timer& timer = it->second;
+                int64_t next_tick = timer.tick_time + timer.interval;
+                if (++fired[timer.id] >= max_catch_up_ && next_tick <= cur_time_) {
+                    next_tick = cur_time_ + timer.interval;
+                }
+                timer.tick_time = next_tick;
+                schedule(timer.id, next_tick);
+            }
+
+            run_callback(context, callback, params);
+        }
+        return time_until_next_timer();
+    }
+
+    // Garbage collection roots
+    void gc_trace(GcTracer& tracer) const {
+        for (const auto& [id, timer] : timers_) {
+            tracer.visit(timer.callback.object);
+            for (const auto& param : timer.params) {
+                if (param) {
+                    tracer.visit_value(*param);
+                }
+            }
+        }
+    }
+};
+
+} // namespace ruffle
+
+#endif // TIMER_H
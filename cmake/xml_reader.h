@@ -0,0 +1,392 @@
+/*
+ * C++ header for streaming XML parsing
+ * A pull parser over borrowed or incrementally fed bytes, for AVM1 and AVM2 XML
+ */
+
+#ifndef XML_READER_H
+#define XML_READER_H
+
+#include "xml_utils.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ruffle {
+
+// Parse errors, numbered as AVM1's `XML.status` reports them.
+enum class XmlStatus : int8_t {
+    NO_ERROR = 0,
+    CDATA_NOT_TERMINATED = -2,
+    DECL_NOT_TERMINATED = -3,
+    DOCTYPE_NOT_TERMINATED = -4,
+    COMMENT_NOT_TERMINATED = -5,
+    ELEMENT_MALFORMED = -6,
+    OUT_OF_MEMORY = -7,
+    ATTRIBUTE_NOT_TERMINATED = -8,
+    // A start tag without an end tag
+    MISMATCHED_START = -9,
+    // An end tag without a start tag
+    MISMATCHED_END = -10
+};
+
+enum class XmlEventKind : uint8_t {
+    // `name`, `empty` for `<a/>`, and `XmlReader::attributes`
+    START_ELEMENT,
+    // `name`
+    END_ELEMENT,
+    // `text`, still escaped
+    TEXT,
+    // `text`, literal
+    CDATA,
+    // `text` between `<!--` and `-->`
+    COMMENT,
+    // `text` between `<!` and `>`, such as `DOCTYPE html`
+    DOCTYPE,
+    // `text` between `<?` and `?>` of an `<?xml ...?>` declaration
+    DECLARATION,
+    // `text` between `<?` and `?>` of any other processing instruction
+    PROCESSING_INSTRUCTION,
+    // The input so far ends inside a token; feed more and call `next` again
+    NEED_MORE_INPUT,
+    END_OF_INPUT,
+    // See `XmlReader::status`
+    ERROR
+};
+
+struct XmlAttribute {
+    std::string_view name;
+    // Still escaped; see `XmlReader::decode`.
+    std::string_view value;
+};
+
+struct XmlEvent {
+    XmlEventKind kind;
+    std::string_view name;
+    std::string_view text;
+    bool empty = false;
+};
+
+// A pull parser that reads XML one token at a time.
+//
+// Event names, text and attribute values are views of the input, not
+// copies; `decode` only allocates for text that actually contains
+// entities. A reader either borrows a complete document (`from_bytes`,
+// e.g. a loaded `Buffer` or `SwfSlice`) or is fed chunks as they arrive
+// (`streaming`). A streaming reader keeps only the unparsed tail of what it
+// was fed, so a document being downloaded never has to exist in memory as
+// a whole.
+//
+// Views returned by `next` and `attributes` are valid until the next call
+// to `next` or `feed`.
+//
+// The parser is lenient the way Flash is: it does not check that end tags
+// match (see `XmlTreeBuilder`), accepts any bytes in names and text, and
+// leaves encodings alone.
+class XmlReader {
+private:
+    // Fed input not yet parsed, for streaming readers.
+    std::string buffer_;
+    std::string_view input_;
+    size_t pos_ = 0;
+    // Bytes of an incomplete token already searched for its end, so that
+    // a token spanning many chunks is not rescanned from its start.
+    size_t scanned_ = 0;
+    // An incomplete start tag's element name length and the attributes
+    // already parsed, as offsets from the token's start since `feed` moves
+    // the input. `pending_quote_` is set while inside an attribute value,
+    // the last span, whose end is still being searched for.
+    struct AttributeSpan {
+        size_t name, name_length, value, value_length;
+    };
+    size_t tag_name_end_ = 0;
+    std::vector<AttributeSpan> attribute_spans_;
+    char pending_quote_ = 0;
+    // `[` nesting of an incomplete doctype at `scanned_`.
+    int doctype_depth_ = 0;
+    bool finished_;
+    XmlStatus status_ = XmlStatus::NO_ERROR;
+    std::vector<XmlAttribute> attributes_;
+
+    explicit XmlReader(std::string_view input, bool finished)
+        : input_(input), finished_(finished) {}
+
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    static bool is_partial(std::string_view rest, std::string_view literal) {
+        return rest.size() < literal.size() && literal.substr(0, rest.size()) == rest;
+    }
+
+    XmlEvent fail(XmlStatus status) {
+        status_ = status;
+        return XmlEvent{XmlEventKind::ERROR, {}, {}};
+    }
+
+    // The current token runs past the input. `scanned` bytes of it need not
+    // be searched again.
+    XmlEvent incomplete(XmlStatus error, size_t scanned = 0) {
+        if (finished_) {
+            return fail(error);
+        }
+        scanned_ = scanned;
+        return XmlEvent{XmlEventKind::NEED_MORE_INPUT, {}, {}};
+    }
+
+    XmlEvent emit(XmlEventKind kind, size_t end, std::string_view name, std::string_view text,
+                  bool empty = false) {
+        pos_ = end;
+        scanned_ = 0;
+        tag_name_end_ = 0;
+        doctype_depth_ = 0;
+        return XmlEvent{kind, name, text, empty};
+    }
+
+    XmlEvent read_text() {
+        size_t end = input_.find('<', pos_ + scanned_);
+        if (end == std::string_view::npos) {
+            if (!finished_) {
+                return incomplete(XmlStatus::NO_ERROR, input_.size() - pos_);
+            }
+            end = input_.size();
+        }
+        return emit(XmlEventKind::TEXT, end, {}, input_.substr(pos_, end - pos_));
+    }
+
+    // A token from `open` to the next `close`, such as a comment.
+    XmlEvent read_delimited(size_t open, std::string_view close, XmlEventKind kind, XmlStatus error) {
+        size_t from = pos_ + std::max(open, scanned_);
+        size_t end = input_.find(close, from);
+        if (end == std::string_view::npos) {
+            // The end may straddle the chunk boundary.
+            size_t available = input_.size() - pos_;
+            return incomplete(error, std::max(open, available - std::min(available, close.size() - 1)));
+        }
+        return emit(kind, end + close.size(), {}, input_.substr(pos_ + open, end - pos_ - open));
+    }
+
+    // `<!...>`, which may contain a bracketed internal subset.
+    XmlEvent read_doctype() {
+        int depth = doctype_depth_;
+        for (size_t i = pos_ + std::max<size_t>(2, scanned_); i < input_.size(); ++i) {
+            char c = input_[i];
+            if (c == '[') {
+                ++depth;
+            } else if (c == ']' && depth > 0) {
+                --depth;
+            } else if (c == '>' && depth == 0) {
+                return emit(XmlEventKind::DOCTYPE, i + 1, {}, input_.substr(pos_ + 2, i - pos_ - 2));
+            }
+        }
+        doctype_depth_ = depth;
+        return incomplete(XmlStatus::DOCTYPE_NOT_TERMINATED, input_.size() - pos_);
+    }
+
+    XmlEvent read_processing_instruction() {
+        XmlEvent event = read_delimited(2, "?>", XmlEventKind::PROCESSING_INSTRUCTION,
+                                        XmlStatus::DECL_NOT_TERMINATED);
+        if (event.kind == XmlEventKind::PROCESSING_INSTRUCTION && event.text.substr(0, 3) == "xml" &&
+            (event.text.size() == 3 || is_space(event.text[3]))) {
+            event.kind = XmlEventKind::DECLARATION;
+        }
+        return event;
+    }
+
+    XmlEvent read_end_tag() {
+        size_t end = input_.find('>', pos_ + std::max<size_t>(2, scanned_));
+        if (end == std::string_view::npos) {
+            return incomplete(XmlStatus::ELEMENT_MALFORMED, input_.size() - pos_);
+        }
+        std::string_view name = input_.substr(pos_ + 2, end - pos_ - 2);
+        while (!name.empty() && is_space(name.back())) {
+            name.remove_suffix(1);
+        }
+        if (name.empty()) {
+            return fail(XmlStatus::ELEMENT_MALFORMED);
+        }
+        return emit(XmlEventKind::END_ELEMENT, end + 1, name, {});
+    }
+
+    // Start tags resume where the last scan stopped: inside the element
+    // name, at the start of the next attribute, or inside a value.
+    XmlEvent read_start_tag() {
+        size_t i = pos_ + std::max<size_t>(1, scanned_);
+        auto skip_space = [&] {
+            while (i < input_.size() && is_space(input_[i])) {
+                ++i;
+            }
+        };
+        auto name_end = [&] {
+            while (i < input_.size() && !is_space(input_[i]) && input_[i] != '/' &&
+                   input_[i] != '>' && input_[i] != '=') {
+                ++i;
+            }
+        };
+
+        if (tag_name_end_ == 0) {
+            name_end();
+            if (i >= input_.size()) {
+                return incomplete(XmlStatus::ELEMENT_MALFORMED, i - pos_);
+            }
+            if (i == pos_ + 1) {
+                return fail(XmlStatus::ELEMENT_MALFORMED);
+            }
+            tag_name_end_ = i - pos_;
+            attribute_spans_.clear();
+        }
+
+        if (pending_quote_ != 0) {
+            size_t value_end = input_.find(pending_quote_, i);
+            if (value_end == std::string_view::npos) {
+                return incomplete(XmlStatus::ATTRIBUTE_NOT_TERMINATED, input_.size() - pos_);
+            }
+            AttributeSpan& span = attribute_spans_.back();
+            span.value_length = value_end - pos_ - span.value;
+            pending_quote_ = 0;
+            i = value_end + 1;
+        }
+
+        while (true) {
+            skip_space();
+            // An attribute cut short is parsed again from here.
+            size_t attribute_start = i;
+            if (i >= input_.size()) {
+                return incomplete(XmlStatus::ELEMENT_MALFORMED, attribute_start - pos_);
+            }
+            if (input_[i] == '>') {
+                return emit_start_tag(i + 1, false);
+            }
+            if (input_[i] == '/') {
+                if (i + 1 >= input_.size()) {
+                    return incomplete(XmlStatus::ELEMENT_MALFORMED, attribute_start - pos_);
+                }
+                if (input_[i + 1] != '>') {
+                    return fail(XmlStatus::ELEMENT_MALFORMED);
+                }
+                return emit_start_tag(i + 2, true);
+            }
+
+            name_end();
+            size_t name_length = i - attribute_start;
+            skip_space();
+            if (i >= input_.size()) {
+                return incomplete(XmlStatus::ELEMENT_MALFORMED, attribute_start - pos_);
+            }
+            if (name_length == 0 || input_[i] != '=') {
+                return fail(XmlStatus::ELEMENT_MALFORMED);
+            }
+            ++i;
+            skip_space();
+            if (i >= input_.size()) {
+                return incomplete(XmlStatus::ELEMENT_MALFORMED, attribute_start - pos_);
+            }
+            char quote = input_[i];
+            if (quote != '"' && quote != '\'') {
+                return fail(XmlStatus::ELEMENT_MALFORMED);
+            }
+            attribute_spans_.push_back({attribute_start - pos_, name_length, i + 1 - pos_, 0});
+            size_t value_end = input_.find(quote, i + 1);
+            if (value_end == std::string_view::npos) {
+                pending_quote_ = quote;
+                return incomplete(XmlStatus::ATTRIBUTE_NOT_TERMINATED, input_.size() - pos_);
+            }
+            attribute_spans_.back().value_length = value_end - (i + 1);
+            i = value_end + 1;
+        }
+    }
+
+    XmlEvent emit_start_tag(size_t end, bool empty) {
+        attributes_.clear();
+        for (const AttributeSpan& span : attribute_spans_) {
+            attributes_.push_back({input_.substr(pos_ + span.name, span.name_length),
+                                   input_.substr(pos_ + span.value, span.value_length)});
+        }
+        std::string_view name = input_.substr(pos_ + 1, tag_name_end_ - 1);
+        return emit(XmlEventKind::START_ELEMENT, end, name, {}, empty);
+    }
+
+    XmlEvent read_markup() {
+        std::string_view rest = input_.substr(pos_);
+        if (!finished_ && (rest.size() < 2 || is_partial(rest, "<!--") || is_partial(rest, "<![CDATA["))) {
+            return XmlEvent{XmlEventKind::NEED_MORE_INPUT, {}, {}};
+        }
+        if (rest.size() < 2) {
+            return fail(XmlStatus::ELEMENT_MALFORMED);
+        }
+        if (rest.substr(0, 4) == "<!--") {
+            return read_delimited(4, "-->", XmlEventKind::COMMENT, XmlStatus::COMMENT_NOT_TERMINATED);
+        }
+        if (rest.substr(0, 9) == "<![CDATA[") {
+            return read_delimited(9, "]]>", XmlEventKind::CDATA, XmlStatus::CDATA_NOT_TERMINATED);
+        }
+        switch (rest[1]) {
+            case '!': return read_doctype();
+            case '?': return read_processing_instruction();
+            case '/': return read_end_tag();
+            default: return read_start_tag();
+        }
+    }
+
+public:
+    // Parse `document`, which must outlive the reader. Nothing is copied.
+    static XmlReader from_bytes(std::string_view document) {
+        return XmlReader(document, true);
+    }
+
+    // Parse input passed to `feed` as it arrives, until `finish`.
+    static XmlReader streaming() {
+        return XmlReader(std::string_view(), false);
+    }
+
+    // Append the next chunk of a streaming reader's input. Only the part
+    // not yet parsed is kept.
+    void feed(std::string_view chunk) {
+        if (finished_) {
+            return;
+        }
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+        buffer_.append(chunk);
+        input_ = buffer_;
+    }
+
+    // No more input will be fed.
+    void finish() { finished_ = true; }
+
+    XmlEvent next() {
+        if (status_ != XmlStatus::NO_ERROR) {
+            return XmlEvent{XmlEventKind::ERROR, {}, {}};
+        }
+        if (pos_ >= input_.size()) {
+            return XmlEvent{finished_ ? XmlEventKind::END_OF_INPUT : XmlEventKind::NEED_MORE_INPUT,
+                            {}, {}};
+        }
+        if (input_[pos_] != '<') {
+            return read_text();
+        }
+        return read_markup();
+    }
+
+    // Attributes of the last START_ELEMENT.
+    const std::vector<XmlAttribute>& attributes() const { return attributes_; }
+
+    XmlStatus status() const { return status_; }
+
+    // Bytes held that have not been parsed yet.
+    size_t buffered() const { return input_.size() - pos_; }
+
+    // `raw` with its entities decoded. Returns `raw` itself unless it
+    // contains an entity, in which case the result is built in `scratch`.
+    static std::string_view decode(std::string_view raw, std::string& scratch, bool avm2 = false) {
+        if (raw.find('&') == std::string_view::npos) {
+            return raw;
+        }
+        scratch = avm2 ? XmlUtils::avm2_unescape(raw) : XmlUtils::avm1_unescape(raw);
+        return scratch;
+    }
+};
+
+} // namespace ruffle
+
+#endif // XML_READER_H
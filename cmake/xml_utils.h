@@ -6,135 +6,277 @@
 #ifndef XML_UTILS_H
 #define XML_UTILS_H
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <regex>
-#include <stdexcept>
 #include <optional>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XML_UTILS_SSE2 1
+#endif
+
 namespace ruffle {
 
 // XML utility functions for handling entity unescaping
 class XmlUtils {
 private:
-    // Regular expressions for matching XML entities
-    static const std::regex& get_avm1_entity_regex() {
-        static const std::regex avm1_regex(R"(&[^;&]*;)");
-        return avm1_regex;
+    // Index of the first `c` at or after `from`, or `s.size()`.
+    static size_t find_byte(std::string_view s, size_t from, char c) {
+        size_t i = from;
+#ifdef XML_UTILS_SSE2
+        const __m128i needle = _mm_set1_epi8(c);
+        for (; i + 16 <= s.size(); i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+            if (unsigned hits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)))) {
+                return i + std::countr_zero(hits);
+            }
+        }
+#endif
+        for (; i < s.size(); ++i) {
+            if (s[i] == c) {
+                return i;
+            }
+        }
+        return s.size();
     }
 
-    static const std::regex& get_avm2_entity_regex() {
-        static const std::regex avm2_regex(R"(&[^;]*;)");
-        return avm2_regex;
+    // Append `codepoint` as UTF-8. Surrogates are encoded like any other
+    // codepoint.
+    static void append_utf8(std::string& out, uint32_t codepoint) {
+        if (codepoint <= 0x7F) {
+            out += static_cast<char>(codepoint);
+        } else if (codepoint <= 0x7FF) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else if (codepoint <= 0xFFFF) {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codepoint >> 18));
+            out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
     }
 
-    // Helper function to unescape a single XML entity
-    static std::string unescape_entity(const std::string& entity) {
-        // Handle common XML entities
-        if (entity == "&amp;") return "&";
-        else if (entity == "&lt;") return "<";
-        else if (entity == "&gt;") return ">";
-        else if (entity == "&quot;") return "\"";
-        else if (entity == "&apos;") return "'";
-        
-        // Handle numeric character references
-        if (entity.length() > 3 && entity[1] == '#') {
-            try {
-                unsigned int codepoint;
-                if (entity[2] == 'x' || entity[2] == 'X') {
-                    // Hexadecimal
-                    codepoint = std::stoi(entity.substr(3, entity.length() - 4), nullptr, 16);
-                } else {
-                    // Decimal
-                    codepoint = std::stoi(entity.substr(2, entity.length() - 3));
-                }
-                
-                // Convert codepoint to UTF-8
-                if (codepoint <= 0x7F) {
-                    return std::string(1, static_cast<char>(codepoint));
-                } else if (codepoint <= 0x7FF) {
-                    std::string result;
-                    result += static_cast<char>(0xC0 | (codepoint >> 6));
-                    result += static_cast<char>(0x80 | (codepoint & 0x3F));
-                    return result;
-                } else if (codepoint <= 0xFFFF) {
-                    std::string result;
-                    result += static_cast<char>(0xE0 | (codepoint >> 12));
-                    result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-                    result += static_cast<char>(0x80 | (codepoint & 0x3F));
-                    return result;
-                } else if (codepoint <= 0x10FFFF) {
-                    std::string result;
-                    result += static_cast<char>(0xF0 | (codepoint >> 18));
-                    result += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
-                    result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-                    result += static_cast<char>(0x80 | (codepoint & 0x3F));
-                    return result;
-                }
-            } catch (...) {
-                // If conversion fails, return the original entity
-                return entity;
+    // The codepoint of a numeric character reference's digits, read the way
+    // `std::stoi` reads them: leading whitespace, an optional sign, an
+    // optional "0x" in hex, then digits up to the first non-digit. Nothing
+    // if there are no digits or the value is not a valid codepoint.
+    static std::optional<uint32_t> parse_codepoint(std::string_view digits, int base) {
+        size_t i = 0;
+        while (i < digits.size() && (digits[i] == ' ' || (digits[i] >= '\t' && digits[i] <= '\r'))) {
+            ++i;
+        }
+        bool negative = false;
+        if (i < digits.size() && (digits[i] == '+' || digits[i] == '-')) {
+            negative = digits[i] == '-';
+            ++i;
+        }
+        auto digit_value = [base](char c) -> int {
+            int value = c >= '0' && c <= '9' ? c - '0'
+                      : c >= 'a' && c <= 'z' ? c - 'a' + 10
+                      : c >= 'A' && c <= 'Z' ? c - 'A' + 10
+                      : 36;
+            return value < base ? value : -1;
+        };
+        if (base == 16 && i + 2 < digits.size() && digits[i] == '0' &&
+            (digits[i + 1] == 'x' || digits[i + 1] == 'X') && digit_value(digits[i + 2]) >= 0) {
+            i += 2;
+        }
+        if (i >= digits.size() || digit_value(digits[i]) < 0) {
+            return std::nullopt;
+        }
+        uint32_t value = 0;
+        for (; i < digits.size(); ++i) {
+            int digit = digit_value(digits[i]);
+            if (digit < 0) {
+                break;
             }
+            // Anything past the last codepoint is rejected either way.
+            value = std::min<uint32_t>(value * base + digit, 0x110000);
+        }
+        if (value > 0x10FFFF || (negative && value != 0)) {
+            return std::nullopt;
         }
-        
-        // If entity is not recognized, return it as-is
-        return entity;
+        return value;
     }
 
-    // Handles flash-specific XML unescaping behavior
-    static std::string custom_unescape(const std::string& input, const std::regex& entity_regex) {
-        std::string result;
-        std::sregex_iterator iter(input.begin(), input.end(), entity_regex);
-        std::sregex_iterator end;
+    // Append what `entity` ("&...;") decodes to, or the entity itself if
+    // it is not one we know.
+    static void append_entity(std::string& out, std::string_view entity) {
+        std::string_view name = entity.substr(1, entity.size() - 2);
+        if (name == "amp") {
+            out += '&';
+        } else if (name == "lt") {
+            out += '<';
+        } else if (name == "gt") {
+            out += '>';
+        } else if (name == "quot") {
+            out += '"';
+        } else if (name == "apos") {
+            out += '\'';
+        } else if (name.size() > 1 && name[0] == '#') {
+            std::optional<uint32_t> codepoint = name[1] == 'x' || name[1] == 'X'
+                ? parse_codepoint(name.substr(2), 16)
+                : parse_codepoint(name.substr(1), 10);
+            if (codepoint) {
+                append_utf8(out, *codepoint);
+            } else {
+                out += entity;
+            }
+        } else {
+            out += entity;
+        }
+    }
 
-        size_t last_end = 0;
+    // Decode the entities in `input`. An entity runs from '&' to the next
+    // ';'. With `nested_ampersand`, an '&' before the ';' starts over, so
+    // "&&amp;" decodes to "&&"; without it, the whole "&&amp;" is one
+    // (unknown) entity and is kept.
+    static std::string unescape(std::string_view input, bool nested_ampersand) {
+        size_t amp = find_byte(input, 0, '&');
+        if (amp == input.size()) {
+            return std::string(input);
+        }
+        std::string result;
+        result.reserve(input.size());
+        size_t copied = 0;
+        while (amp < input.size()) {
+            size_t end = amp + 1;
+            if (nested_ampersand) {
+                while (end < input.size() && input[end] != ';' && input[end] != '&') {
+                    ++end;
+                }
+                if (end < input.size() && input[end] == '&') {
+                    amp = end;
+                    continue;
+                }
+            } else {
+                end = find_byte(input, end, ';');
+            }
+            if (end == input.size()) {
+                break;
+            }
+            result.append(input.data() + copied, amp - copied);
+            append_entity(result, input.substr(amp, end + 1 - amp));
+            copied = end + 1;
+            amp = find_byte(input, copied, '&');
+        }
+        result.append(input.data() + copied, input.size() - copied);
+        return result;
+    }
 
-        for (; iter != end; ++iter) {
-            std::smatch match = *iter;
-            size_t start = match.position();
-            size_t end_pos = start + match.length();
+#ifdef XML_UTILS_SSE2
+    struct EscapeMasks {
+        unsigned amp;
+        unsigned angle;
+        unsigned quote;
+    };
 
-            // Add text before the entity
-            result += input.substr(last_end, start - last_end);
+    // Which of the 16 bytes at `p` are '&', '<' or '>', and quotes.
+    static EscapeMasks escape_masks(const char* p) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto eq = [&](char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+        return EscapeMasks{
+            static_cast<unsigned>(_mm_movemask_epi8(eq('&'))),
+            static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(eq('<'), eq('>')))),
+            static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(eq('"'), eq('\'')))),
+        };
+    }
+#endif
 
-            // Process the entity
-            std::string entity = match.str();
-            std::string decoded = unescape_entity(entity);
-            result += decoded;
+    // The entity `c` is written as, or nothing if it is written as is.
+    static constexpr std::string_view escape_entity(char c) {
+        switch (c) {
+            case '&': return "&amp;";
+            case '<': return "&lt;";
+            case '>': return "&gt;";
+            case '"': return "&quot;";
+            case '\'': return "&apos;";
+            default: return {};
+        }
+    }
 
-            last_end = end_pos;
+    // Index of the first byte at or after `from` that needs escaping, or
+    // `s.size()`.
+    static size_t find_escape(std::string_view s, size_t from) {
+        size_t i = from;
+#ifdef XML_UTILS_SSE2
+        for (; i + 16 <= s.size(); i += 16) {
+            EscapeMasks m = escape_masks(s.data() + i);
+            if (unsigned any = m.amp | m.angle | m.quote) {
+                return i + std::countr_zero(any);
+            }
         }
+#endif
+        for (; i < s.size(); ++i) {
+            if (!escape_entity(s[i]).empty()) {
+                return i;
+            }
+        }
+        return s.size();
+    }
 
-        // Add remaining text after the last entity
-        result += input.substr(last_end);
+public:
+    // Length of `s` once escaped by `append_escaped`.
+    static size_t escaped_length(std::string_view s) {
+        size_t length = s.size();
+        size_t i = 0;
+#ifdef XML_UTILS_SSE2
+        for (; i + 16 <= s.size(); i += 16) {
+            EscapeMasks m = escape_masks(s.data() + i);
+            length += 4 * std::popcount(m.amp) + 3 * std::popcount(m.angle) +
+                      5 * std::popcount(m.quote);
+        }
+#endif
+        for (; i < s.size(); ++i) {
+            std::string_view entity = escape_entity(s[i]);
+            if (!entity.empty()) {
+                length += entity.size() - 1;
+            }
+        }
+        return length;
+    }
 
-        return result;
+    // Append `s` to `out` with '&', '<', '>' and quotes escaped as
+    // entities. Text between them is copied in bulk.
+    static void append_escaped(std::string& out, std::string_view s) {
+        size_t start = 0;
+        for (size_t i = find_escape(s, 0); i < s.size(); i = find_escape(s, start)) {
+            out.append(s.data() + start, i - start);
+            out += escape_entity(s[i]);
+            start = i + 1;
+        }
+        out.append(s.data() + start, s.size() - start);
     }
 
 public:
     // AVM1 XML unescaping. Decodes entities individually, even when
     // preceded by a bare '&' (e.g. "&&amp;" becomes "&&").
     static std::string avm1_unescape(const std::vector<uint8_t>& input) {
-        // Convert input bytes to string
-        std::string input_str(input.begin(), input.end());
-        return custom_unescape(input_str, get_avm1_entity_regex());
+        return unescape(std::string_view(reinterpret_cast<const char*>(input.data()), input.size()), true);
     }
 
     // AVM2 E4X XML unescaping. Does not decode entities preceded by a
     // bare '&' (e.g. "&&amp;" is preserved as "&&amp;").
     static std::string avm2_unescape(const std::vector<uint8_t>& input) {
-        // Convert input bytes to string
-        std::string input_str(input.begin(), input.end());
-        return custom_unescape(input_str, get_avm2_entity_regex());
+        return unescape(std::string_view(reinterpret_cast<const char*>(input.data()), input.size()), false);
     }
 
-    // Overloaded versions that accept string directly
-    static std::string avm1_unescape(const std::string& input) {
-        return custom_unescape(input, get_avm1_entity_regex());
+    // Overloaded versions that accept strings and slices of a larger buffer
+    static std::string avm1_unescape(std::string_view input) {
+        return unescape(input, true);
     }
 
-    static std::string avm2_unescape(const std::string& input) {
-        return custom_unescape(input, get_avm2_entity_regex());
+    static std::string avm2_unescape(std::string_view input) {
+        return unescape(input, false);
     }
 };
 
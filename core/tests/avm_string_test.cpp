@@ -0,0 +1,90 @@
+// AvmString concatenation: in-place appends must never change a string
+// that already exists.
+
+// The templates are defined in the .cpp and instantiated by their users.
+#include "avm_string.cpp"
+#include "test_support.h"
+
+namespace {
+
+struct TestGc {};
+using String = AvmString<TestGc>;
+
+String utf8(TestGc& gc, const char* s) {
+    return String::new_utf8(gc, s);
+}
+
+std::u16string units(const String& s) {
+    return std::u16string(s.view());
+}
+
+} // namespace
+
+static void append_after_a_derived_string_copies(TestGc& gc) {
+    // The first concatenation makes a buffer with spare capacity.
+    String a = String::concat(gc, utf8(gc, "ab"), utf8(gc, "cd"));
+    String b = String::concat(gc, a, utf8(gc, "ef"));
+    CHECK(b.is_dependent());
+    // `a` no longer ends the buffer, so this must not write over "ef".
+    String c = String::concat(gc, a, utf8(gc, "XY"));
+    CHECK(!c.is_dependent());
+    CHECK_EQ(units(a), std::u16string(u"abcd"));
+    CHECK_EQ(units(b), std::u16string(u"abcdef"));
+    CHECK_EQ(units(c), std::u16string(u"abcdXY"));
+    // `b` still ends the buffer and may grow it.
+    String d = String::concat(gc, b, utf8(gc, "gh"));
+    CHECK(d.is_dependent());
+    CHECK_EQ(units(b), std::u16string(u"abcdef"));
+    CHECK_EQ(units(d), std::u16string(u"abcdefgh"));
+}
+
+static void held_wstr_references_do_not_change(TestGc& gc) {
+    String a = String::concat(gc, utf8(gc, "ab"), utf8(gc, "cd"));
+    const WString& held = a.as_wstr();
+    String b = String::concat(gc, a, utf8(gc, "ef"));
+    CHECK_EQ(held.size(), size_t(4));
+    CHECK(held == WString(u"abcd"));
+    CHECK_EQ(units(b), std::u16string(u"abcdef"));
+    CHECK(!b.is_dependent());
+}
+
+static void appending_a_string_to_itself(TestGc& gc) {
+    String a = String::concat(gc, utf8(gc, "ab"), utf8(gc, "c"));
+    String b = String::concat(gc, a, a);
+    CHECK(b.is_dependent());
+    CHECK_EQ(units(b), std::u16string(u"abcabc"));
+    CHECK_EQ(units(String::concat(gc, b, b)), std::u16string(u"abcabcabcabc"));
+}
+
+static void append_loops_share_one_buffer(TestGc& gc) {
+    String piece = utf8(gc, "line\n");
+    String log = utf8(gc, "");
+    size_t copies = 0;
+    for (int i = 0; i < 100000; ++i) {
+        log = String::concat(gc, log, piece);
+        copies += log.is_dependent() ? 0 : 1;
+    }
+    CHECK_EQ(log.len(), size_t(500000));
+    // Capacity doubles on every copy.
+    CHECK(copies < 32);
+    CHECK(String::substring(gc, log, 5, 9).view() == u"line");
+}
+
+static void equality_and_hashing_use_the_view(TestGc& gc) {
+    String a = String::concat(gc, utf8(gc, "ab"), utf8(gc, "cd"));
+    String b = String::concat(gc, a, utf8(gc, "ef"));
+    String c = utf8(gc, "abcdef");
+    CHECK(b == c);
+    CHECK(!(a == c));
+    CHECK_EQ(std::hash<String>{}(b), std::hash<String>{}(c));
+}
+
+int main() {
+    TestGc gc;
+    append_after_a_derived_string_copies(gc);
+    held_wstr_references_do_not_change(gc);
+    appending_a_string_to_itself(gc);
+    append_loops_share_one_buffer(gc);
+    equality_and_hashing_use_the_view(gc);
+    return ruffle::test::test_exit_code();
+}
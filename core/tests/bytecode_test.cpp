@@ -0,0 +1,84 @@
+// Decoding action blocks into instruction arrays.
+
+#include "avm1/bytecode.h"
+#include "test_support.h"
+#include <vector>
+
+using namespace ruffle;
+
+static std::shared_ptr<DecodedActions> decode(const std::vector<uint8_t>& bytes) {
+    return decode_actions(bytes.data(), bytes.size());
+}
+
+static void end_does_not_stop_decoding() {
+    // Jump over an End to the Stop after it.
+    auto actions = decode({0x99, 0x02, 0x00, 0x01, 0x00, 0x00, 0x07});
+    CHECK_EQ(actions->code.size(), size_t(4));
+    CHECK(actions->code[0].op == OpCode::Jump);
+    CHECK_EQ(actions->code[0].arg, uint32_t(2));
+    CHECK(actions->code[1].op == OpCode::End);
+    CHECK(actions->code[2].op == OpCode::Stop);
+    CHECK(actions->code[3].op == OpCode::End);
+}
+
+static void branch_into_an_action_decodes_its_bytes() {
+    // The jump lands on the operand of GotoFrame, whose bytes read as Play
+    // and Stop; that run then falls off the end of the block.
+    auto actions = decode({0x99, 0x02, 0x00, 0x03, 0x00, 0x81, 0x02, 0x00, 0x06, 0x07});
+    CHECK_EQ(actions->code.size(), size_t(6));
+    CHECK_EQ(actions->code[0].arg, uint32_t(3));
+    CHECK(actions->code[1].op == OpCode::GotoFrame);
+    CHECK_EQ(actions->code[1].arg, uint32_t(0x0706));
+    CHECK(actions->code[2].op == OpCode::End);
+    CHECK(actions->code[3].op == OpCode::Play);
+    CHECK(actions->code[4].op == OpCode::Stop);
+    CHECK(actions->code[5].op == OpCode::Jump);
+    CHECK_EQ(actions->code[5].arg, uint32_t(2));
+    CHECK_EQ(actions->byte_offsets[3], uint32_t(8));
+}
+
+static void run_rejoins_decoded_code() {
+    // The jump lands on the payload of an unknown action; the Play decoded
+    // there is followed by the Stop the block already has.
+    auto actions = decode({0x99, 0x02, 0x00, 0x03, 0x00, 0xC0, 0x01, 0x00, 0x06, 0x07});
+    CHECK_EQ(actions->code.size(), size_t(6));
+    CHECK(actions->code[2].op == OpCode::Stop);
+    CHECK_EQ(actions->code[0].arg, uint32_t(4));
+    CHECK(actions->code[4].op == OpCode::Play);
+    CHECK(actions->code[5].op == OpCode::Jump);
+    CHECK_EQ(actions->code[5].arg, uint32_t(2));
+}
+
+static void bound_pools_are_atoms_of_the_table() {
+    // ConstantPool "a", "b".
+    auto actions = decode({0x88, 0x06, 0x00, 0x02, 0x00, 'a', 0x00, 'b', 0x00, 0x00});
+    Avm1AtomTable atoms;
+    actions->bind_atoms(atoms);
+    CHECK_EQ(actions->pool_atoms.size(), size_t(1));
+    CHECK_EQ(actions->pool_atoms[0]->size(), size_t(2));
+    CHECK((*actions->pool_atoms[0])[0] == atoms.intern("a"));
+    CHECK((*actions->pool_atoms[0])[1] == atoms.intern("b"));
+}
+
+static void named_catch_defines_a_local() {
+    // Try { Play } catch (e) { Stop }
+    auto named = decode({0x8F, 0x09, 0x00, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 'e', 0x00,
+                         0x06, 0x07, 0x00});
+    CHECK(named->try_blocks[0].catch_var == std::optional<std::string>("e"));
+    CHECK(named->defines_locals);
+
+    // The same, catching into register 1.
+    auto in_register = decode({0x8F, 0x08, 0x00, 0x05, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+                               0x06, 0x07, 0x00});
+    CHECK(!in_register->try_blocks[0].catch_var);
+    CHECK(!in_register->defines_locals);
+}
+
+int main() {
+    end_does_not_stop_decoding();
+    branch_into_an_action_decodes_its_bytes();
+    run_rejoins_decoded_code();
+    bound_pools_are_atoms_of_the_table();
+    named_catch_defines_a_local();
+    return ruffle::test::test_exit_code();
+}
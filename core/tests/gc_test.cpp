@@ -0,0 +1,206 @@
+// The AVM1 collector: cells reachable only from a root source survive, and
+// each runtime's heap is separate.
+
+#include "avm1/gc.h"
+#include "avm1/native_object.h"
+#include "test_support.h"
+#include <thread>
+
+using namespace ruffle;
+
+namespace {
+
+class TestCell : public GcCell, public std::enable_shared_from_this<TestCell> {
+public:
+    std::vector<std::shared_ptr<TestCell>> references;
+    bool cleared = false;
+
+    void gc_trace(GcTracer& tracer) const override {
+        for (const auto& reference : references) {
+            tracer.visit(reference);
+        }
+    }
+
+    void gc_clear() override {
+        references.clear();
+        cleared = true;
+    }
+
+    std::shared_ptr<GcCell> gc_retain() override { return weak_from_this().lock(); }
+};
+
+// A cell that refers to itself, so only the collector can free it.
+std::shared_ptr<TestCell> make_cycle(GcHeap& heap) {
+    auto cell = heap.allocate<TestCell>();
+    cell->references.push_back(cell);
+    return cell;
+}
+
+// Stand-ins for what the player holds outside the runtime.
+struct Clip {
+    std::shared_ptr<TestCell> object;
+};
+
+struct Timer {
+    std::vector<std::shared_ptr<TestCell>> params;
+};
+
+// An object whose native data is traced with it.
+class NativeCell : public GcCell, public std::enable_shared_from_this<NativeCell> {
+public:
+    NativeObject native;
+
+    void gc_trace(GcTracer& tracer) const override { native.gc_trace(tracer); }
+    void gc_clear() override { native = NativeObject(); }
+    std::shared_ptr<GcCell> gc_retain() override { return weak_from_this().lock(); }
+};
+
+} // namespace
+
+namespace ruffle {
+
+// The real XML node needs the whole runtime. This stand-in holds its
+// objects the same way: only through the node, which only the script
+// object's native data refers to.
+class XmlNode {
+public:
+    std::shared_ptr<NativeCell> script_object;
+    std::shared_ptr<TestCell> attributes;
+    std::shared_ptr<TestCell> cached_child_nodes;
+    std::vector<std::shared_ptr<XmlNode>> children;
+
+    void gc_trace(GcTracer& tracer) const {
+        tracer.visit(script_object);
+        tracer.visit(attributes);
+        tracer.visit(cached_child_nodes);
+        for (const auto& child : children) {
+            child->gc_trace(tracer);
+        }
+    }
+};
+
+} // namespace ruffle
+
+static void clip_keeps_its_object_alive() {
+    GcHeap heap;
+    GcHeapScope scope(heap);
+    auto clip = std::make_shared<Clip>();
+    clip->object = make_cycle(heap);
+    std::weak_ptr<TestCell> weak = clip->object;
+
+    auto id = heap.add_root_source([&clip](GcTracer& tracer) {
+        if (clip) {
+            tracer.visit(clip->object);
+        }
+    });
+    heap.collect({});
+    CHECK(!clip->object->cleared);
+    CHECK_EQ(heap.stats().collected, size_t(0));
+
+    // Once the clip is gone the cycle is garbage.
+    clip.reset();
+    heap.remove_root_source(id);
+    heap.collect({});
+    CHECK(weak.expired());
+    CHECK_EQ(heap.stats().collected, size_t(1));
+}
+
+static void timer_keeps_its_parameters_alive() {
+    GcHeap heap;
+    GcHeapScope scope(heap);
+    Timer timer;
+    timer.params.push_back(make_cycle(heap));
+    auto unrooted = make_cycle(heap);
+    std::weak_ptr<TestCell> weak_unrooted = unrooted;
+    unrooted.reset();
+
+    heap.add_root_source([&timer](GcTracer& tracer) {
+        for (const auto& param : timer.params) {
+            tracer.visit(param);
+        }
+    });
+    heap.collect({});
+    CHECK(!timer.params[0]->cleared);
+    CHECK(weak_unrooted.expired());
+}
+
+static void heaps_belong_to_their_runtime() {
+    GcHeap first;
+    GcHeap second;
+    CHECK(GcHeap::current() == nullptr);
+    std::shared_ptr<TestCell> in_second;
+    {
+        GcHeapScope first_scope(first);
+        auto in_first = first.allocate<TestCell>();
+        {
+            GcHeapScope second_scope(second);
+            CHECK(GcHeap::current() == &second);
+            in_second = make_cycle(second);
+        }
+        CHECK(GcHeap::current() == &first);
+
+        // Another thread has no current heap.
+        GcHeap* seen = &first;
+        std::thread([&seen] { seen = GcHeap::current(); }).join();
+        CHECK(seen == nullptr);
+    }
+    CHECK(GcHeap::current() == nullptr);
+    CHECK_EQ(first.cell_count(), size_t(0));
+    CHECK_EQ(second.cell_count(), size_t(1));
+
+    // Collecting one runtime's heap leaves the other's cells alone.
+    first.collect({});
+    CHECK(!in_second->cleared);
+    second.collect({});
+    CHECK(in_second->cleared);
+}
+
+static void cells_outside_a_scope_are_not_collected() {
+    GcHeap heap;
+    auto cell = std::make_shared<TestCell>();
+    cell->references.push_back(cell);
+    heap.collect({});
+    CHECK(!cell->cleared);
+    CHECK_EQ(heap.cell_count(), size_t(0));
+    cell->references.clear();
+}
+
+static void native_data_keeps_xml_objects_alive() {
+    GcHeap heap;
+    GcHeapScope scope(heap);
+    auto node = std::make_shared<XmlNode>();
+    node->script_object = heap.allocate<NativeCell>();
+    node->attributes = make_cycle(heap);
+    node->cached_child_nodes = make_cycle(heap);
+    auto child = std::make_shared<XmlNode>();
+    child->attributes = make_cycle(heap);
+    node->children.push_back(child);
+    node->script_object->native = NativeObject(node);
+    CHECK(node->script_object->native.type() == NativeObjectType::XML_NODE);
+
+    std::shared_ptr<NativeCell> root = node->script_object;
+    std::weak_ptr<TestCell> attributes = node->attributes;
+    heap.add_root_source([&root](GcTracer& tracer) { tracer.visit(root); });
+    node.reset();
+    child.reset();
+    heap.collect({});
+    CHECK(!attributes.lock()->cleared);
+    auto kept = root->native.get<XmlNode>();
+    CHECK(!kept->cached_child_nodes->cleared);
+    CHECK(!kept->children[0]->attributes->cleared);
+
+    // Once the script object is unreachable, so is the tree.
+    kept.reset();
+    root.reset();
+    heap.collect({});
+    CHECK(attributes.expired());
+}
+
+int main() {
+    clip_keeps_its_object_alive();
+    timer_keeps_its_parameters_alive();
+    heaps_belong_to_their_runtime();
+    cells_outside_a_scope_are_not_collected();
+    native_data_keeps_xml_objects_alive();
+    return ruffle::test::test_exit_code();
+}
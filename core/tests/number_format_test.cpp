@@ -0,0 +1,76 @@
+// Flash's number to string conversion, checked against the vectors of
+// Ruffle's `f64_to_string` test (core/src/avm1/value.rs).
+
+#include "number_format.h"
+#include "test_support.h"
+#include <limits>
+
+using ruffle::format_avm1_number;
+
+static void avm1_vectors() {
+    const double MAX = std::numeric_limits<double>::max();
+    const double MIN_POSITIVE = std::numeric_limits<double>::min();
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+    const double INF = std::numeric_limits<double>::infinity();
+
+    const struct {
+        double value;
+        const char* expected;
+    } cases[] = {
+        {0.0, "0"},
+        {-0.0, "0"},
+        {1.0, "1"},
+        {5.0, "5"},
+        {1.4, "1.4"},
+        {-990.123, "-990.123"},
+        {NaN, "NaN"},
+        {INF, "Infinity"},
+        {-INF, "-Infinity"},
+        {9.9999e14, "999990000000000"},
+        {-9.9999e14, "-999990000000000"},
+        {1e15, "1e+15"},
+        {-1e15, "-1e+15"},
+        {1e-5, "0.00001"},
+        {-1e-5, "-0.00001"},
+        {0.999e-5, "9.99e-6"},
+        {-0.999e-5, "-9.99e-6"},
+        {0.19999999999999996, "0.2"},
+        {-0.19999999999999996, "-0.2"},
+        {100000.12345678912, "100000.123456789"},
+        {-100000.12345678912, "-100000.123456789"},
+        {0.8000000000000005, "0.800000000000001"},
+        {-0.8000000000000005, "-0.800000000000001"},
+        {0.8300000000000005, "0.83"},
+        {1e-320, "9.99988867182684e-321"},
+        {-MAX, "-1.79769313486231e+308"},
+        {MIN_POSITIVE, "2.2250738585072e-308"},
+        {MAX, "1.79769313486231e+308"},
+        {5e-324, "4.94065645841247e-324"},
+        {9.999999999999999, "10"},
+        {-9.999999999999999, "-10"},
+        {9999999999999996.0, "1e+16"},
+        {-9999999999999996.0, "-e+16"},
+        {0.000009999999999999996, "1e-5"},
+        {-0.000009999999999999996, "-10e-6"},
+        {0.00009999999999999996, "0.0001"},
+        {-0.00009999999999999996, "-0.0001"},
+    };
+    for (const auto& c : cases) {
+        CHECK_EQ(format_avm1_number(c.value), std::string(c.expected));
+    }
+}
+
+static void small_integers_use_the_cache() {
+    CHECK_EQ(format_avm1_number(0.0), std::string("0"));
+    CHECK_EQ(format_avm1_number(1023.0), std::string("1023"));
+    CHECK_EQ(format_avm1_number(1024.0), std::string("1024"));
+    CHECK_EQ(format_avm1_number(-1.0), std::string("-1"));
+    CHECK_EQ(format_avm1_number(2147483647.0), std::string("2147483647"));
+    CHECK_EQ(format_avm1_number(2147483648.0), std::string("2147483648"));
+}
+
+int main() {
+    avm1_vectors();
+    small_integers_use_the_cache();
+    return ruffle::test::test_exit_code();
+}
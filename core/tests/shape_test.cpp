@@ -0,0 +1,123 @@
+// Shapes and the inline caches keyed by them.
+
+#include "avm1/shape.h"
+#include "test_support.h"
+#include <set>
+#include <thread>
+
+using namespace ruffle;
+
+static void cache_hits_need_the_same_name() {
+    Avm1AtomTable atoms;
+    Avm1Atom a = atoms.intern("a");
+    Avm1Atom b = atoms.intern("b");
+    auto shape = Shape::empty()->with_property("a", 0)->with_property("b", 0);
+
+    // One `obj[key]` site, executed with a different key each time.
+    PropertyCache cache;
+    cache.update(*shape, a, shape->find("a", true));
+    CHECK_EQ(cache.lookup(*shape, a), uint32_t(0));
+    CHECK_EQ(cache.lookup(*shape, b), Shape::NOT_FOUND);
+    cache.update(*shape, b, shape->find("b", true));
+    CHECK_EQ(cache.lookup(*shape, b), uint32_t(1));
+    CHECK_EQ(cache.lookup(*shape, a), uint32_t(0));
+    CHECK(!cache.is_megamorphic());
+}
+
+static void cache_ignores_dictionary_shapes_and_goes_megamorphic() {
+    Avm1AtomTable atoms;
+    Avm1Atom x = atoms.intern("x");
+    auto dictionary = Shape::empty()->with_property("x", 0)->to_dictionary();
+    PropertyCache cache;
+    cache.update(*dictionary, x, 0);
+    CHECK_EQ(cache.lookup(*dictionary, x), Shape::NOT_FOUND);
+
+    for (size_t i = 0; i <= PropertyCache::MAX_ENTRIES; ++i) {
+        auto shape = Shape::empty()->with_property("p" + std::to_string(i), 0)->with_property("x", 0);
+        cache.update(*shape, x, 1);
+    }
+    CHECK(cache.is_megamorphic());
+}
+
+static void shared_shapes_are_reused() {
+    auto first = Shape::empty()->with_property("a", 0)->with_property("b", 1);
+    auto second = Shape::empty()->with_property("a", 0)->with_property("b", 1);
+    CHECK(first == second);
+    CHECK(Shape::empty()->with_property("a", 0)->with_property("b", 2) != first);
+    CHECK_EQ(first->find("B", false), uint32_t(1));
+    CHECK_EQ(first->find("B", true), Shape::NOT_FOUND);
+}
+
+static void dictionary_removal_leaves_tombstones() {
+    auto shape = Shape::empty()->to_dictionary();
+    for (const char* key : {"a", "B", "c", "b"}) {
+        shape->add_slot(key, 0);
+    }
+    uint32_t id = shape->id();
+    shape->remove_slot(1);
+    CHECK(shape->id() != id);
+    CHECK_EQ(shape->len(), uint32_t(3));
+    CHECK_EQ(shape->slot_count(), uint32_t(4));
+    CHECK(shape->is_removed(1));
+    CHECK_EQ(shape->find("a", true), uint32_t(0));
+    CHECK_EQ(shape->find("c", true), uint32_t(2));
+    CHECK_EQ(shape->find("b", true), uint32_t(3));
+    CHECK_EQ(shape->find("B", true), Shape::NOT_FOUND);
+    CHECK_EQ(shape->find("B", false), uint32_t(3));
+    CHECK(!shape->needs_compaction());
+}
+
+static void dictionary_compacts_when_mostly_tombstones() {
+    auto shape = Shape::empty()->to_dictionary();
+    for (int i = 0; i < 20; ++i) {
+        std::string key = "k";
+        key += std::to_string(i);
+        shape->add_slot(key, static_cast<uint32_t>(i));
+    }
+    for (uint32_t slot = 0; slot < 11; ++slot) {
+        shape->remove_slot(slot);
+    }
+    CHECK(shape->needs_compaction());
+    uint32_t id = shape->id();
+    shape->compact();
+    CHECK(shape->id() != id);
+    CHECK(!shape->needs_compaction());
+    CHECK_EQ(shape->len(), uint32_t(9));
+    CHECK_EQ(shape->slot_count(), uint32_t(9));
+    CHECK_EQ(shape->find("k11", true), uint32_t(0));
+    CHECK_EQ(shape->find("K19", false), uint32_t(8));
+    CHECK_EQ(shape->flags(8), uint32_t(19));
+    CHECK_EQ(shape->find("k3", true), Shape::NOT_FOUND);
+}
+
+static void transitions_are_thread_safe() {
+    std::vector<std::shared_ptr<Shape>> results(8);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&results, t] {
+            std::shared_ptr<Shape> shape = Shape::empty();
+            for (int i = 0; i < 32; ++i) {
+                shape = shape->with_property("threaded" + std::to_string(i), 0);
+                shape->find("threaded0", false);
+            }
+            results[t] = shape;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& shape : results) {
+        CHECK(shape == results[0]);
+    }
+    CHECK_EQ(results[0]->find("threaded31", true), uint32_t(31));
+}
+
+int main() {
+    cache_hits_need_the_same_name();
+    cache_ignores_dictionary_shapes_and_goes_megamorphic();
+    shared_shapes_are_reused();
+    dictionary_removal_leaves_tombstones();
+    dictionary_compacts_when_mostly_tombstones();
+    transitions_are_thread_safe();
+    return ruffle::test::test_exit_code();
+}
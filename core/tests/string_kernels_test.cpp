@@ -0,0 +1,99 @@
+// AVM1's string globals, checked against the behaviour of Ruffle's
+// `unescape` (core/src/avm1/globals.rs) and `parse_float_impl`
+// (core/src/avm1/value.rs).
+
+#include "avm1/string_kernels.h"
+#include "test_support.h"
+#include <bit>
+#include <cmath>
+
+using namespace ruffle;
+
+static std::string unescaped(std::string_view s) {
+    return avm1_unescape(s).value_or(std::string(s));
+}
+
+static uint64_t bits(double value) {
+    return std::bit_cast<uint64_t>(value);
+}
+
+static void unescape_abandons_escapes_at_non_hex() {
+    CHECK_EQ(unescaped("%41"), std::string("A"));
+    CHECK_EQ(unescaped("a+b"), std::string("a b"));
+    CHECK_EQ(unescaped("%G41"), std::string("41"));
+    CHECK_EQ(unescaped("%%41"), std::string("A"));
+    CHECK_EQ(unescaped("%4"), std::string(""));
+    CHECK_EQ(unescaped("%4G"), std::string(""));
+    CHECK_EQ(unescaped("%+41"), std::string("41"));
+    // The digits of an interrupted escape are kept.
+    CHECK_EQ(unescaped("%4%41"), std::string(""));
+    CHECK_EQ(unescaped("%0%041"), std::string("\x04" "1"));
+    CHECK(!avm1_unescape("plain").has_value());
+}
+
+static void unescape_repairs_utf8() {
+    CHECK_EQ(unescaped("%C3%A9"), std::string("\xC3\xA9"));
+    CHECK_EQ(unescaped("%FF"), std::string("\xEF\xBF\xBD"));
+    // Dropping the first byte of "é" leaves an invalid continuation byte.
+    CHECK_EQ(unescaped("%E\xC3\xA9"), std::string("\xEF\xBF\xBD"));
+}
+
+static void parse_float_sums_scaled_digits() {
+    // Flash is a ulp above the nearest double here.
+    CHECK_EQ(bits(avm1_parse_float("3.14159")), uint64_t(0x400921f9f01b866f));
+    CHECK_EQ(bits(avm1_parse_float("0.1")), uint64_t(0x3fb999999999999a));
+    CHECK_EQ(bits(avm1_parse_float("123456789.123456789")), uint64_t(0x419d6f34547e6b75));
+    CHECK_EQ(avm1_parse_float("1.7976931348623157e308"), INFINITY);
+}
+
+static void parse_float_accepts_flash_syntax() {
+    CHECK_EQ(avm1_parse_float("."), 0.0);
+    CHECK_EQ(avm1_parse_float("1.2.3"), 1.23);
+    CHECK_EQ(avm1_parse_float("  -12.5e-1xyz"), -1.25);
+    CHECK_EQ(avm1_parse_float("1e"), 1.0);
+    CHECK_EQ(avm1_parse_float("+.5"), 0.5);
+    CHECK(std::isnan(avm1_parse_float("-")));
+    CHECK(std::isnan(avm1_parse_float("e5")));
+    CHECK(std::isnan(avm1_parse_float("1.2.3", true)));
+    CHECK(std::isnan(avm1_parse_float("12px", true)));
+    CHECK_EQ(avm1_parse_float("12", true), 12.0);
+}
+
+static void string_to_number_is_strict() {
+    CHECK(std::isnan(avm1_string_to_number("12abc")));
+    CHECK(std::isnan(avm1_string_to_number("")));
+    CHECK(std::isnan(avm1_string_to_number("0x")));
+    CHECK(std::isnan(avm1_string_to_number("0x1g")));
+    CHECK_EQ(avm1_string_to_number(" -1.5e1"), -15.0);
+    CHECK_EQ(avm1_string_to_number("0x10"), 16.0);
+    CHECK_EQ(avm1_string_to_number("0XFFFFFFFF"), -1.0);
+    CHECK_EQ(avm1_string_to_number("0x100000010"), 16.0);
+}
+
+static void parse_int_quirks() {
+    CHECK_EQ(avm1_parse_int("0x10", std::nullopt), 16.0);
+    CHECK_EQ(avm1_parse_int("0123", std::nullopt), 83.0);
+    CHECK_EQ(avm1_parse_int("-0x10", 36), 42804.0);
+    CHECK(std::isnan(avm1_parse_int("-0x10", std::nullopt)));
+    CHECK(std::signbit(avm1_parse_int("  -0x10", std::nullopt)));
+    CHECK(std::isnan(avm1_parse_int("10", 37)));
+}
+
+static void escape_encodes_all_but_alphanumerics() {
+    CHECK(!avm1_escape("abcXYZ019").has_value());
+    CHECK_EQ(*avm1_escape("a b/\xC3\xA9"), std::string("a%20b%2F%C3%A9"));
+    // Long enough to go through the vector scan on both sides of the escape.
+    CHECK_EQ(*avm1_escape("abcdefghijklmnopqrstuvwxyz-ABCDEFGHIJKLMNOPQRSTUVWXYZ"),
+             std::string("abcdefghijklmnopqrstuvwxyz%2DABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+}
+
+int main() {
+    unescape_abandons_escapes_at_non_hex();
+    unescape_repairs_utf8();
+    parse_float_sums_scaled_digits();
+    parse_float_accepts_flash_syntax();
+    string_to_number_is_strict();
+    parse_int_quirks();
+    escape_encodes_all_but_alphanumerics();
+    return ruffle::test::test_exit_code();
+}
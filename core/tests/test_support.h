@@ -0,0 +1,69 @@
+/*
+ * Assertions for the C++ core unit tests
+ * Failures are reported and counted; `test_exit_code` turns the count into the exit status
+ */
+
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace ruffle::test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+template<typename T>
+std::string describe(const T& value) {
+    std::ostringstream out;
+    out.precision(17);
+    out << value;
+    return out.str();
+}
+
+inline std::string describe(const std::u16string& value) {
+    std::string out;
+    for (char16_t c : value) {
+        out += c < 0x80 ? static_cast<char>(c) : '?';
+    }
+    return out;
+}
+
+inline void fail(const char* file, int line, const std::string& message) {
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+    ++failures();
+}
+
+inline int test_exit_code() {
+    if (failures() != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace ruffle::test
+
+#define CHECK(condition)                                                             \
+    do {                                                                             \
+        if (!(condition)) {                                                          \
+            ::ruffle::test::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                  \
+    do {                                                                            \
+        const auto actual_value = (actual);                                         \
+        const auto expected_value = (expected);                                     \
+        if (!(actual_value == expected_value)) {                                    \
+            ::ruffle::test::fail(__FILE__, __LINE__,                                \
+                                 #actual " is " + ::ruffle::test::describe(actual_value) + \
+                                 ", expected " + ::ruffle::test::describe(expected_value)); \
+        }                                                                           \
+    } while (0)
+
+#endif // TEST_SUPPORT_H
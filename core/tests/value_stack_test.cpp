@@ -0,0 +1,109 @@
+// The value stack: frames, registers, call arguments and owned strings.
+
+#include "avm1/value_stack.h"
+#include "test_support.h"
+
+using namespace ruffle;
+
+static void popping_past_a_frame_yields_undefined() {
+    ValueStack stack;
+    StackFrame frame = stack.enter_frame(0);
+    stack.push(CompactValue::number(1.0));
+    CHECK_EQ(stack.operand_count(frame), size_t(1));
+    CHECK(stack.peek(frame) == CompactValue::number(1.0));
+    CHECK(stack.pop(frame) == CompactValue::number(1.0));
+    CHECK(stack.pop(frame).is_undefined());
+    CHECK(stack.peek(frame).is_undefined());
+
+    // An inner frame cannot pop its caller's operands.
+    stack.push(CompactValue::boolean(true));
+    StackFrame inner = stack.enter_frame(2);
+    CHECK(stack.pop(inner).is_undefined());
+    stack.leave_frame(inner);
+    CHECK(stack.pop(frame) == CompactValue::boolean(true));
+    stack.leave_frame(frame);
+    CHECK_EQ(stack.len(), size_t(ValueStack::NUM_GLOBAL_REGISTERS));
+}
+
+static void registers_are_local_to_their_frame() {
+    ValueStack stack;
+    StackFrame outer = stack.enter_frame(0);
+    stack.set_register(outer, 1, CompactValue::number(10.0));
+    stack.set_register(outer, ValueStack::NUM_GLOBAL_REGISTERS, CompactValue::number(99.0));
+    CHECK(stack.get_register(outer, ValueStack::NUM_GLOBAL_REGISTERS).is_undefined());
+
+    StackFrame inner = stack.enter_frame(3);
+    CHECK(stack.get_register(inner, 1).is_undefined());
+    stack.set_register(inner, 1, CompactValue::number(20.0));
+    stack.set_register(inner, 3, CompactValue::number(30.0));
+    CHECK(stack.get_register(inner, 1) == CompactValue::number(20.0));
+    CHECK(stack.get_register(inner, 3).is_undefined());
+    stack.leave_frame(inner);
+
+    CHECK(stack.get_register(outer, 1) == CompactValue::number(10.0));
+    // A frame entered again starts with undefined registers.
+    StackFrame again = stack.enter_frame(3);
+    CHECK(stack.get_register(again, 1).is_undefined());
+    stack.leave_frame(again);
+    stack.leave_frame(outer);
+}
+
+static void args_survive_the_stack_growing() {
+    ValueStack stack(8);
+    StackFrame caller = stack.enter_frame(0);
+    stack.push(CompactValue::number(3.0));
+    stack.push(CompactValue::number(2.0));
+    stack.push(CompactValue::number(1.0));
+    StackArgs args = stack.args(caller, 2);
+    CHECK_EQ(args.size(), size_t(2));
+
+    // The callee pushes well past the initial capacity.
+    StackFrame callee = stack.enter_frame(4);
+    for (int i = 0; i < 100; ++i) {
+        stack.push(CompactValue::number(-1.0));
+    }
+    CHECK(stack.capacity() > size_t(8));
+    CHECK(args[0] == CompactValue::number(1.0));
+    CHECK(args[1] == CompactValue::number(2.0));
+    CHECK(args[2].is_undefined());
+    stack.leave_frame(callee);
+
+    stack.drop(caller, 2);
+    CHECK(stack.pop(caller) == CompactValue::number(3.0));
+    // Asking for more arguments than were pushed takes what is there.
+    stack.push(CompactValue::null());
+    CHECK_EQ(stack.args(caller, 5).size(), size_t(1));
+    stack.leave_frame(caller);
+}
+
+static void sweeping_keeps_only_referenced_strings() {
+    ValueStack stack;
+    StackFrame frame = stack.enter_frame(0);
+    Avm1Atom kept = stack.own_string("kept");
+    stack.push(CompactValue::string(kept));
+    stack.own_string("dropped");
+    stack.set_register(frame, 0, CompactValue::string(stack.own_string("in a register")));
+    CHECK_EQ(stack.owned_strings(), size_t(3));
+
+    stack.sweep_owned();
+    CHECK_EQ(stack.owned_strings(), size_t(2));
+    CHECK_EQ(stack.pop(frame).as_string(), std::string("kept"));
+    CHECK_EQ(stack.get_register(frame, 0).as_string(), std::string("in a register"));
+
+    // Owned strings compare by contents, interned ones by atom.
+    Avm1AtomTable atoms;
+    CHECK(CompactValue::string(stack.own_string("a")) == CompactValue::string(atoms.intern("a")));
+    CHECK(CompactValue::string(atoms.intern("a")) != CompactValue::string(atoms.intern("b")));
+
+    // Leaving the outermost frame sweeps what is left, global registers aside.
+    stack.leave_frame(frame);
+    CHECK_EQ(stack.owned_strings(), size_t(1));
+}
+
+int main() {
+    popping_past_a_frame_yields_undefined();
+    registers_are_local_to_their_frame();
+    args_survive_the_stack_growing();
+    sweeping_keeps_only_referenced_strings();
+    return ruffle::test::test_exit_code();
+}
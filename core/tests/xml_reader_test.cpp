@@ -0,0 +1,112 @@
+// The streaming XML reader: a document fed in chunks of any size must read
+// the same as the document read whole.
+
+#include "xml_reader.h"
+#include "test_support.h"
+
+using namespace ruffle;
+
+static const char* const DOCUMENT =
+    "<?xml version=\"1.0\"?><!DOCTYPE a [<!ENTITY b \"c\">]>"
+    "<root id='1' name = \"x &amp; y\"><!-- note --><item/>"
+    "text &lt; more<![CDATA[<raw>]]><?pi data?><empty a=\"\" /></root >";
+
+// Every event of `reader` as one line each, until it needs more input or ends.
+static bool drain(XmlReader& reader, std::string& trace) {
+    while (true) {
+        XmlEvent event = reader.next();
+        switch (event.kind) {
+            case XmlEventKind::NEED_MORE_INPUT:
+                return false;
+            case XmlEventKind::END_OF_INPUT:
+                trace += "end\n";
+                return true;
+            case XmlEventKind::ERROR:
+                trace += "error " + std::to_string(static_cast<int>(reader.status())) + "\n";
+                return true;
+            default:
+                break;
+        }
+        trace += std::to_string(static_cast<int>(event.kind)) + " [" + std::string(event.name) + "] [" +
+                 std::string(event.text) + "]" + (event.empty ? " empty" : "");
+        if (event.kind == XmlEventKind::START_ELEMENT) {
+            for (const XmlAttribute& attribute : reader.attributes()) {
+                trace += " " + std::string(attribute.name) + "=" + std::string(attribute.value);
+            }
+        }
+        trace += "\n";
+    }
+}
+
+static std::string read_whole(std::string_view document) {
+    XmlReader reader = XmlReader::from_bytes(document);
+    std::string trace;
+    drain(reader, trace);
+    return trace;
+}
+
+static std::string read_in_chunks(std::string_view document, size_t chunk_size) {
+    XmlReader reader = XmlReader::streaming();
+    std::string trace;
+    for (size_t i = 0; i < document.size(); i += chunk_size) {
+        reader.feed(document.substr(i, chunk_size));
+        if (drain(reader, trace)) {
+            return trace;
+        }
+    }
+    reader.finish();
+    drain(reader, trace);
+    return trace;
+}
+
+static void chunked_input_reads_like_whole_input() {
+    std::string whole = read_whole(DOCUMENT);
+    CHECK(whole.find("name= \"x") == std::string::npos);
+    CHECK(whole.find(" id=1 name=x &amp; y") != std::string::npos);
+    CHECK(whole.find("[DOCTYPE a [<!ENTITY b \"c\">]]") != std::string::npos);
+    CHECK(whole.substr(whole.size() - 4) == "end\n");
+    for (size_t chunk_size = 1; chunk_size <= 7; ++chunk_size) {
+        CHECK_EQ(read_in_chunks(DOCUMENT, chunk_size), whole);
+    }
+}
+
+static void long_tag_spans_many_chunks() {
+    std::string value(20000, 'v');
+    std::string document = "<a first=\"1\" long='" + value + "' last=\"2\"></a>";
+    std::string whole = read_whole(document);
+    CHECK_EQ(read_in_chunks(document, 1), whole);
+    CHECK_EQ(read_in_chunks(document, 333), whole);
+    CHECK(whole.find(" first=1 long=" + value + " last=2\n") != std::string::npos);
+
+    // Only the incomplete tag is buffered while it arrives.
+    XmlReader reader = XmlReader::streaming();
+    reader.feed("<p>text</p><a b='");
+    std::string trace;
+    CHECK(!drain(reader, trace));
+    CHECK_EQ(reader.buffered(), size_t(6));
+}
+
+static void errors_report_flash_status_codes() {
+    CHECK_EQ(read_whole("<a b='1></a>"), std::string("error -8\n"));
+    CHECK_EQ(read_whole("<a b=1></a>").substr(0, 8), std::string("error -6"));
+    CHECK_EQ(read_whole("<!-- open"), std::string("error -5\n"));
+    CHECK_EQ(read_whole("<![CDATA[ open"), std::string("error -2\n"));
+    CHECK_EQ(read_whole("<!DOCTYPE [ >"), std::string("error -4\n"));
+    CHECK_EQ(read_whole("<?xml "), std::string("error -3\n"));
+    CHECK_EQ(read_in_chunks("<a b='1></a>", 2), std::string("error -8\n"));
+}
+
+static void decode_only_allocates_for_entities() {
+    std::string scratch;
+    std::string_view plain = "plain";
+    CHECK(XmlReader::decode(plain, scratch).data() == plain.data());
+    CHECK_EQ(std::string(XmlReader::decode("a &amp; b", scratch)), std::string("a & b"));
+}
+
+int main() {
+    chunked_input_reads_like_whole_input();
+    long_tag_spans_many_chunks();
+    errors_report_flash_status_codes();
+    decode_only_allocates_for_entities();
+    return ruffle::test::test_exit_code();
+}